@@ -0,0 +1,123 @@
+#include "lcc.hpp"
+
+namespace lcc
+{
+    namespace AST
+    {
+        thread_local ASTContext *ASTContext::_current = nullptr;
+
+        ASTContext::ASTContext() : _previous(_current)
+        {
+            _current = this;
+        }
+
+        ASTContext::~ASTContext()
+        {
+            for (auto slab : _slabs)
+                ::operator delete(slab);
+            _current = _previous;
+        }
+
+        void *ASTContext::allocate(size_t size)
+        {
+            constexpr size_t align = alignof(std::max_align_t);
+            size = (size + align - 1) & ~(align - 1);
+
+            if (size > (size_t)(_end - _cur)) // start a new slab, oversized nodes get their own
+            {
+                size_t slabSize = std::max(size, SLAB_SIZE);
+                char *slab = static_cast<char *>(::operator new(slabSize));
+                _slabs.push_back(slab);
+                _cur = slab;
+                _end = slab + slabSize;
+            }
+
+            void *ptr = _cur;
+            _cur += size;
+            _numAllocations++;
+            _bytesAllocated += size;
+            return ptr;
+        }
+
+        void ASTContext::rewind(const Mark &mark)
+        {
+            for (size_t i = mark.numSlabs; i < _slabs.size(); i++)
+                ::operator delete(_slabs[i]);
+            _slabs.resize(mark.numSlabs);
+
+            _cur = mark.cur;
+            _end = mark.end;
+            _numAllocations = mark.numAllocations;
+            _bytesAllocated = mark.bytesAllocated;
+            _numNodes = mark.numNodes;
+        }
+
+        ASTContext *ASTContext::current()
+        {
+            if (_current == nullptr)
+            {
+                static ASTContext defaultContext;
+                return &defaultContext;
+            }
+            return _current;
+        }
+
+        namespace
+        {
+            // Every node class declares its own dump(), hiding ASTNode::dump(), so calling
+            // it through the concrete type reaches the node's dumper instead of recursing here.
+            class ASTDumper : public ASTVisitor<ASTDumper, void, true>
+            {
+            public:
+                ASTDumper(DumpWriter &writer) : _writer(writer){};
+
+#define AST_NODE(name)                                                                          \
+    static_assert(!std::is_same_v<decltype(&name::dump), decltype(&ASTNode::dump)>, #name); \
+    void gen(const name *node) { node->dump(_writer); }
+#include "ASTNodeKind.inc"
+#undef AST_NODE
+
+            private:
+                DumpWriter &_writer;
+            };
+        }
+
+        void ASTNode::dump(DumpWriter &writer) const
+        {
+            ASTDumper dumper(writer);
+            dumper.visit(this);
+        }
+
+        void ASTNode::dumpChild(DumpWriter &writer, std::string_view key, const ASTNode *child)
+        {
+            writer.writeKey(key);
+            writer.beginArray();
+            child->dump(writer);
+            writer.endArray();
+        }
+
+        // Children released while a subtree is being torn down are queued and deleted by the
+        // outermost call, so the native stack depth stays constant regardless of AST shape.
+        void ASTNode::destroyLater(std::unique_ptr<ASTNode> node)
+        {
+            static thread_local std::vector<std::unique_ptr<ASTNode>> pendingNodes;
+            static thread_local bool isDestroying = false;
+
+            if (node == nullptr)
+                return;
+
+            pendingNodes.push_back(std::move(node));
+            if (isDestroying)
+                return;
+
+            isDestroying = true;
+            while (!pendingNodes.empty())
+            {
+                std::unique_ptr<ASTNode> pendingNode = std::move(pendingNodes.back());
+                pendingNodes.pop_back();
+                pendingNode.reset(); // may queue more nodes
+            }
+            isDestroying = false;
+        }
+    }
+}
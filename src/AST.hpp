@@ -1,31 +1,133 @@
 #pragma once
 
+#include <cstdint>
 #include <iostream>
 #include <memory>
+#include <vector>
 
-#include <nlohmann/json.hpp>
-
-using json = nlohmann::ordered_json;
+#include "Dumper.hpp"
+#include "Type.hpp"
 
 // AST nodes
 namespace lcc
 {
+    class Parser;
     class LR1Parser;
     class IRGeneratorBase;
     class QuaternionIRGenerator;
     class LLVMIRGenerator;
+    class ASTCache;
+    class Sema;
+    class ExprFolder;
+    class ConstEvaluator;
+    class DeadCodeEliminator;
 
     namespace AST
     {
+        // Bump allocator that owns the storage of all AST nodes of a translation unit.
+        // A context becomes the thread's active context while it is alive (contexts nest
+        // LIFO), and every node allocated meanwhile is released together with it.
+        class ASTContext
+        {
+        public:
+            ASTContext();
+            ASTContext(const ASTContext &) = delete;
+            ASTContext &operator=(const ASTContext &) = delete;
+            ~ASTContext();
+
+            void *allocate(size_t size);
+
+            // allocation state, rewind() releases everything allocated after mark() at once
+            typedef struct _Mark
+            {
+                size_t numSlabs;
+                char *cur;
+                char *end;
+                size_t numAllocations;
+                size_t bytesAllocated;
+                uint32_t numNodes;
+            } Mark;
+
+            Mark mark() const { return {_slabs.size(), _cur, _end, _numAllocations, _bytesAllocated, _numNodes}; };
+            // nodes allocated after mark must have been destroyed, their ids are handed out again
+            void rewind(const Mark &mark);
+
+            // active context, nodes created outside any translation unit go to a process wide one
+            static ASTContext *current();
+
+            // ids are dense per context, so generators can keep per-node data in flat side tables
+            uint32_t nextNodeId() { return _numNodes++; };
+
+            uint32_t numNodes() const { return _numNodes; };
+            size_t numAllocations() const { return _numAllocations; };
+            size_t bytesAllocated() const { return _bytesAllocated; };
+            size_t numSlabs() const { return _slabs.size(); };
+
+        private:
+            static constexpr size_t SLAB_SIZE = 64 * 1024;
+            static thread_local ASTContext *_current;
+
+            std::vector<char *> _slabs;
+            char *_cur{nullptr};
+            char *_end{nullptr};
+            size_t _numAllocations{0};
+            size_t _bytesAllocated{0};
+            uint32_t _numNodes{0};
+            ASTContext *_previous{nullptr};
+        };
+
         // AST node base class
         class ASTNode
         {
         public:
-            std::string place{""}; // for IR generation
+            // concrete node classes, visitors dispatch on this instead of virtual calls
+            enum class Kind : uint8_t
+            {
+#define AST_NODE(name) name,
+#include "ASTNodeKind.inc"
+#undef AST_NODE
+            };
+
+        private:
+            uint32_t _id;
+            Kind _kind;
+
         public:
-            virtual json asJson() const = 0;
-            virtual bool gen(lcc::IRGeneratorBase *generator) { return true; }; // CHANGE THIS TO PURE VIRTUAL LATER!!!
+            ASTNode(Kind kind) : _id(ASTContext::current()->nextNodeId()), _kind(kind){};
             virtual ~ASTNode(){};
+
+            // nodes live in the active ASTContext, deleting one only runs its destructor
+            static void *operator new(size_t size) { return ASTContext::current()->allocate(size); };
+            static void operator delete(void *ptr){};
+
+            uint32_t id() const { return _id; };
+            Kind kind() const { return _kind; };
+
+            // streams the subtree to writer, dispatched to the dump() of the concrete node class
+            void dump(DumpWriter &writer) const;
+
+        protected:
+            // writes key: [child], the layout used for every child link in the dumps
+            static void dumpChild(DumpWriter &writer, std::string_view key, const ASTNode *child);
+            template <typename T>
+            static void dumpChildren(DumpWriter &writer, std::string_view key, const std::vector<std::unique_ptr<T>> &children)
+            {
+                writer.writeKey(key);
+                writer.beginArray();
+                for (const auto &child : children)
+                    child->dump(writer);
+                writer.endArray();
+            }
+
+            // Destructors hand their children over here instead of letting unique_ptr
+            // delete them in place, so tearing down a deep AST never recurses.
+            static void destroyLater(std::unique_ptr<ASTNode> node);
+            template <typename T>
+            static void destroyLater(std::vector<std::unique_ptr<T>> &nodes)
+            {
+                for (auto &node : nodes)
+                    destroyLater(std::move(node));
+            }
         };
 
         // Decls
@@ -68,6 +170,8 @@ namespace lcc
         // Decl base class
         class Decl : public ASTNode
         {
+        public:
+            Decl(Kind kind) : ASTNode(kind){};
         };
 
         // root node for AST
@@ -77,17 +181,20 @@ namespace lcc
             friend class lcc::IRGeneratorBase;
             friend class lcc::QuaternionIRGenerator;
             friend class lcc::LLVMIRGenerator;
+            friend class lcc::ASTCache;
+            friend class lcc::Sema;
+            friend class lcc::ExprFolder;
+            friend class lcc::ConstEvaluator;
+            friend class lcc::DeadCodeEliminator;
 
         protected:
             std::vector<std::unique_ptr<Decl>> _decls;
 
         public:
-            TranslationUnitDecl(std::vector<std::unique_ptr<Decl>> &decls) : _decls(std::move(decls)){};
-            ~TranslationUnitDecl() = default;
+            TranslationUnitDecl(std::vector<std::unique_ptr<Decl>> &decls) : Decl(Kind::TranslationUnitDecl), _decls(std::move(decls)){};
+            ~TranslationUnitDecl();
 
-            virtual json asJson() const override;
-
-            virtual bool gen(lcc::IRGeneratorBase *generator) override;
+            void dump(DumpWriter &writer) const;
         };
 
         // This represents a decl that may have a name
@@ -97,12 +204,12 @@ namespace lcc
             std::string _name;
 
         public:
-            NamedDecl(const std::string &name) : _name(name){};
+            NamedDecl(Kind kind, const std::string &name) : Decl(kind), _name(name){};
             ~NamedDecl() = default;
 
-            virtual json asJson() const override;
+            void dump(DumpWriter &writer) const;
 
-            const std::string name() const { return _name; };
+            const std::string &name() const { return _name; };
         };
 
         // Represents a variable declaration or definition.
@@ -110,56 +217,60 @@ namespace lcc
         {
             friend class lcc::QuaternionIRGenerator;
             friend class lcc::LLVMIRGenerator;
+            friend class lcc::ASTCache;
+            friend class lcc::Sema;
+            friend class lcc::ExprFolder;
+            friend class lcc::ConstEvaluator;
+            friend class lcc::DeadCodeEliminator;
 
         protected:
-            std::string _type;
+            const Type *_type;
             bool _isInitialized;
             std::unique_ptr<Expr> _value;
 
         public:
-            VarDecl(const std::string &name, const std::string &type,
-                    bool isInitialized = false, std::unique_ptr<Expr> value = nullptr) : NamedDecl(name), _type(type), _isInitialized(isInitialized), _value(std::move(value)){};
-
-            virtual json asJson() const override;
+            VarDecl(const std::string &name, const Type *type,
+                    bool isInitialized = false, std::unique_ptr<Expr> value = nullptr, Kind kind = Kind::VarDecl) : NamedDecl(kind, name), _type(type), _isInitialized(isInitialized), _value(std::move(value)){};
+            ~VarDecl();
 
-            virtual bool gen(lcc::IRGeneratorBase *generator) override;
+            void dump(DumpWriter &writer) const;
 
-            const std::string type() const { return _type; };
+            const Type *type() const { return _type; };
         };
 
         // Represents a parameter to a function.
         class ParmVarDecl : public VarDecl
         {
-            friend class lcc::LR1Parser;
-
-        protected:
-            std::unique_ptr<ParmVarDecl> _nextParmVarDecl;
-
         public:
-            ParmVarDecl(const std::string &name, const std::string &type, std::unique_ptr<ParmVarDecl> nextParmVarDecl = nullptr) : VarDecl(name, type), _nextParmVarDecl(std::move(nextParmVarDecl)){};
+            ParmVarDecl(const std::string &name, const Type *type) : VarDecl(name, type, false, nullptr, Kind::ParmVarDecl){};
 
-            virtual json asJson() const override;
+            void dump(DumpWriter &writer) const;
         };
 
         // Represents a function declaration or definition.
         class FunctionDecl : public NamedDecl
         {
+            friend class lcc::Parser;
             friend class lcc::QuaternionIRGenerator;
             friend class lcc::LLVMIRGenerator;
+            friend class lcc::ASTCache;
+            friend class lcc::Sema;
+            friend class lcc::ExprFolder;
+            friend class lcc::ConstEvaluator;
+            friend class lcc::DeadCodeEliminator;
 
         protected:
-            std::string _type;
+            const Type *_type; // return type
             std::vector<std::unique_ptr<ParmVarDecl>> _params;
             std::unique_ptr<Stmt> _body;
 
             bool _isExtern{false};
 
         public:
-            FunctionDecl(const std::string &name, const std::string &type, std::vector<std::unique_ptr<ParmVarDecl>> &params, std::unique_ptr<Stmt> body = nullptr, bool isExtern = false) : NamedDecl(name), _type(type), _params(std::move(params)), _body(std::move(body)), _isExtern(isExtern){};
+            FunctionDecl(const std::string &name, const Type *type, std::vector<std::unique_ptr<ParmVarDecl>> &params, std::unique_ptr<Stmt> body = nullptr, bool isExtern = false) : NamedDecl(Kind::FunctionDecl, name), _type(type), _params(std::move(params)), _body(std::move(body)), _isExtern(isExtern){};
+            ~FunctionDecl();
 
-            virtual json asJson() const override;
-
-            virtual bool gen(lcc::IRGeneratorBase *generator) override;
+            void dump(DumpWriter &writer) const;
         };
     } // Decl end
 
@@ -167,7 +278,7 @@ namespace lcc
     namespace AST
     {
         // Binary operator types
-        enum class BinaryOpType
+        enum class BinaryOpType : uint8_t
         {
             BO_UNDEFINED = 0,
 #define BINARY_OPERATION(name, disc) BO_##name,
@@ -177,7 +288,7 @@ namespace lcc
 #undef BINARY_OPERATION
         };
 
-        enum class UnaryOpType
+        enum class UnaryOpType : uint8_t
         {
             UO_UNDEFINED = 0,
 #define BINARY_OPERATION(name, disc)
@@ -190,27 +301,35 @@ namespace lcc
         // Expr base class
         class Expr : public ASTNode
         {
+            friend class lcc::Sema;
+            friend class lcc::ExprFolder;
+            friend class lcc::ConstEvaluator;
+            friend class lcc::DeadCodeEliminator;
+
         protected:
             bool _isLValue{false};
+            const Type *_exprType{nullptr}; // set by Sema
 
         public:
+            Expr(Kind kind) : ASTNode(kind){};
+
             bool isLValue() const { return _isLValue; };
+            const Type *exprType() const { return _exprType; };
         };
 
         // Integer literal value
         class IntegerLiteral : public Expr
         {
             friend class lcc::QuaternionIRGenerator;
+            friend class lcc::ASTCache;
 
         protected:
             int _value;
 
         public:
-            IntegerLiteral(int value) : _value(value) { _isLValue = false; }; // Integer literal should be LValue instead of RValue
-
-            virtual json asJson() const override;
+            IntegerLiteral(int value) : Expr(Kind::IntegerLiteral), _value(value) { _isLValue = false; }; // Integer literal should be LValue instead of RValue
 
-            virtual bool gen(lcc::IRGeneratorBase *generator) override;
+            void dump(DumpWriter &writer) const;
 
             int value() const { return _value; };
         };
@@ -219,16 +338,15 @@ namespace lcc
         class FloatingLiteral : public Expr
         {
             friend class lcc::QuaternionIRGenerator;
+            friend class lcc::ASTCache;
 
         protected:
             float _value;
 
         public:
-            FloatingLiteral(float value) : _value(value) { _isLValue = false; }; // Floating literal should be LValue instead of RValue
+            FloatingLiteral(float value) : Expr(Kind::FloatingLiteral), _value(value) { _isLValue = false; }; // Floating literal should be LValue instead of RValue
 
-            virtual json asJson() const override;
-
-            virtual bool gen(lcc::IRGeneratorBase *generator) override;
+            void dump(DumpWriter &writer) const;
 
             float value() const { return _value; };
         };
@@ -237,16 +355,15 @@ namespace lcc
         class CharacterLiteral : public Expr
         {
             friend class lcc::QuaternionIRGenerator;
+            friend class lcc::ASTCache;
 
         protected:
             char _value;
 
         public:
-            CharacterLiteral(char value) : _value(value) { _isLValue = false; }; // Char literal should be LValue instead of RValue
-
-            virtual json asJson() const override;
+            CharacterLiteral(char value) : Expr(Kind::CharacterLiteral), _value(value) { _isLValue = false; }; // Char literal should be LValue instead of RValue
 
-            virtual bool gen(lcc::IRGeneratorBase *generator) override;
+            void dump(DumpWriter &writer) const;
 
             char value() const { return _value; };
         };
@@ -255,9 +372,10 @@ namespace lcc
         class StringLiteral : public Expr
         {
             friend class lcc::QuaternionIRGenerator;
+            friend class lcc::ASTCache;
 
         public:
-            enum class StringKind
+            enum class StringKind : uint8_t
             {
                 Ordinary,
                 Wide,
@@ -271,11 +389,9 @@ namespace lcc
             StringKind _kind;
 
         public:
-            StringLiteral(const std::string &value, StringKind kind = StringKind::Ordinary) : _value(value), _kind(kind) { _isLValue = false; }; // String literal should be LValue instead of RValue
+            StringLiteral(const std::string &value, StringKind kind = StringKind::Ordinary) : Expr(Kind::StringLiteral), _value(value), _kind(kind) { _isLValue = false; }; // String literal should be LValue instead of RValue
 
-            virtual json asJson() const override;
-
-            virtual bool gen(lcc::IRGeneratorBase *generator) override;
+            void dump(DumpWriter &writer) const;
 
             const std::string value() const { return _value; };
 
@@ -287,21 +403,23 @@ namespace lcc
         {
             friend class lcc::QuaternionIRGenerator;
             friend class lcc::LLVMIRGenerator;
+            friend class lcc::ASTCache;
+            friend class lcc::Sema;
 
         protected:
             std::string _name;
             bool _isCall;
             bool _isArray;
+            const NamedDecl *_decl{nullptr}; // referenced VarDecl or FunctionDecl, bound by Sema
 
         public:
-            DeclRefExpr(const std::string &name, bool isCall = false, bool isArray = false) : 
-                _name(name), _isCall(isCall), _isArray(isArray) { _isLValue = !isCall; };
-
-            virtual json asJson() const override;
+            DeclRefExpr(const std::string &name, bool isCall = false, bool isArray = false, Kind kind = Kind::DeclRefExpr) : 
+                Expr(kind), _name(name), _isCall(isCall), _isArray(isArray) { _isLValue = !isCall; };
 
-            virtual bool gen(lcc::IRGeneratorBase *generator) override;
+            void dump(DumpWriter &writer) const;
 
-            const std::string name() const { return _name; };
+            const std::string &name() const { return _name; };
+            const NamedDecl *decl() const { return _decl; };
         };
 
         // Binary operator type expression
@@ -309,10 +427,15 @@ namespace lcc
         {
             friend class lcc::QuaternionIRGenerator;
             friend class lcc::LLVMIRGenerator;
+            friend class lcc::ASTCache;
+            friend class lcc::Sema;
+            friend class lcc::ExprFolder;
+            friend class lcc::ConstEvaluator;
+            friend class lcc::DeadCodeEliminator;
 
         public:
             // https://en.cppreference.com/w/cpp/language/operator_precedence
-            enum class Precedence
+            enum class Precedence : uint8_t
             {
                 UNDEFINED = 0,
                 COMMA = 1,          // ,
@@ -336,10 +459,9 @@ namespace lcc
 
         public:
             BinaryOperator(BinaryOpType type, std::unique_ptr<Expr> lhs, std::unique_ptr<Expr> rhs);
+            ~BinaryOperator();
 
-            virtual json asJson() const override;
-
-            virtual bool gen(lcc::IRGeneratorBase *generator) override;
+            void dump(DumpWriter &writer) const;
 
             bool isAssignment() const;
 
@@ -351,17 +473,21 @@ namespace lcc
         {
             friend class lcc::QuaternionIRGenerator;
             friend class lcc::LLVMIRGenerator;
+            friend class lcc::ASTCache;
+            friend class lcc::Sema;
+            friend class lcc::ExprFolder;
+            friend class lcc::ConstEvaluator;
+            friend class lcc::DeadCodeEliminator;
 
         protected:
             UnaryOpType _type;
             std::unique_ptr<Expr> _body;
 
         public:
-            UnaryOperator(UnaryOpType type, std::unique_ptr<Expr> body) : _type(type), _body(std::move(body)){};
-
-            virtual json asJson() const override;
+            UnaryOperator(UnaryOpType type, std::unique_ptr<Expr> body) : Expr(Kind::UnaryOperator), _type(type), _body(std::move(body)){};
+            ~UnaryOperator();
 
-            virtual bool gen(lcc::IRGeneratorBase *generator) override;
+            void dump(DumpWriter &writer) const;
 
             UnaryOpType type() const { return _type; };
         };
@@ -371,19 +497,23 @@ namespace lcc
         {
             friend class lcc::QuaternionIRGenerator;
             friend class lcc::LLVMIRGenerator;
+            friend class lcc::ASTCache;
+            friend class lcc::Sema;
+            friend class lcc::ExprFolder;
+            friend class lcc::ConstEvaluator;
+            friend class lcc::DeadCodeEliminator;
 
         protected:
             std::unique_ptr<Expr> _subExpr;
 
         public:
-            ParenExpr(std::unique_ptr<Expr> expr) : _subExpr(std::move(expr))
+            ParenExpr(std::unique_ptr<Expr> expr) : Expr(Kind::ParenExpr), _subExpr(std::move(expr))
             {
                 _isLValue = _subExpr->isLValue();
             };
+            ~ParenExpr();
 
-            virtual json asJson() const override;
-
-            virtual bool gen(lcc::IRGeneratorBase *generator) override;
+            void dump(DumpWriter &writer) const;
         };
 
         // Represents a function call (C99 6.5.2.2, C++ [expr.call]).
@@ -391,17 +521,21 @@ namespace lcc
         {
             friend class lcc::QuaternionIRGenerator;
             friend class lcc::LLVMIRGenerator;
+            friend class lcc::ASTCache;
+            friend class lcc::Sema;
+            friend class lcc::ExprFolder;
+            friend class lcc::ConstEvaluator;
+            friend class lcc::DeadCodeEliminator;
 
         protected:
             std::unique_ptr<DeclRefExpr> _functionExpr;
             std::vector<std::unique_ptr<Expr>> _params;
 
         public:
-            CallExpr(std::unique_ptr<DeclRefExpr> function, std::vector<std::unique_ptr<Expr>> &params) : _functionExpr(std::move(function)), _params(std::move(params)){};
-
-            virtual json asJson() const override;
+            CallExpr(std::unique_ptr<DeclRefExpr> function, std::vector<std::unique_ptr<Expr>> &params) : Expr(Kind::CallExpr), _functionExpr(std::move(function)), _params(std::move(params)){};
+            ~CallExpr();
 
-            virtual bool gen(lcc::IRGeneratorBase *generator) override;
+            void dump(DumpWriter &writer) const;
         };
 
         // Base class for type casts, including both implicit casts (ImplicitCastExpr) and explicit casts
@@ -409,9 +543,14 @@ namespace lcc
         {
             friend class lcc::QuaternionIRGenerator;
             friend class lcc::LLVMIRGenerator;
+            friend class lcc::ASTCache;
+            friend class lcc::Sema;
+            friend class lcc::ExprFolder;
+            friend class lcc::ConstEvaluator;
+            friend class lcc::DeadCodeEliminator;
 
         public:
-            enum class CastType
+            enum class CastType : uint8_t
             {
                 LValueToRValue = 0
             };
@@ -421,38 +560,39 @@ namespace lcc
             std::unique_ptr<Expr> _subExpr;
 
         public:
-            CastExpr(std::unique_ptr<Expr> expr, const CastType type) : _subExpr(std::move(expr)), _type(type){};
+            CastExpr(std::unique_ptr<Expr> expr, const CastType type, Kind kind = Kind::CastExpr) : Expr(kind), _type(type), _subExpr(std::move(expr)){};
+            ~CastExpr();
 
-            virtual json asJson() const override;
-
-            virtual bool gen(lcc::IRGeneratorBase *generator) override;
+            void dump(DumpWriter &writer) const;
         };
 
         // Allows us to explicitly represent implicit type conversions
         class ImplicitCastExpr : public CastExpr
         {
         public:
-            ImplicitCastExpr(std::unique_ptr<Expr> expr, CastType type) : CastExpr(std::move(expr), type){};
-
-            virtual json asJson() const override;
+            ImplicitCastExpr(std::unique_ptr<Expr> expr, CastType type) : CastExpr(std::move(expr), type, Kind::ImplicitCastExpr){};
 
-            virtual bool gen(lcc::IRGeneratorBase *generator) override;
+            void dump(DumpWriter &writer) const;
         };
 
         class ArraySubscriptExpr : public DeclRefExpr
         {
             friend class lcc::QuaternionIRGenerator;
             friend class lcc::LLVMIRGenerator;
+            friend class lcc::ASTCache;
+            friend class lcc::Sema;
+            friend class lcc::ExprFolder;
+            friend class lcc::ConstEvaluator;
+            friend class lcc::DeadCodeEliminator;
 
         protected:
             std::unique_ptr<Expr> _lhs, _rhs;
 
         public:
             ArraySubscriptExpr(const std::string& name, std::unique_ptr<Expr> lhs, std::unique_ptr<Expr> rhs);
+            ~ArraySubscriptExpr();
 
-            virtual json asJson() const override;
-
-            virtual bool gen(lcc::IRGeneratorBase *generator) override;
+            void dump(DumpWriter &writer) const;
         };
     } // Expr end
 
@@ -462,20 +602,17 @@ namespace lcc
         // Stmt base class
         class Stmt : public ASTNode
         {
-            friend class lcc::LR1Parser;
-
-        protected:
-            std::unique_ptr<Stmt> _nextStmt;
-
         public:
-            Stmt(std::unique_ptr<Stmt> nextStmt = nullptr) : _nextStmt(std::move(nextStmt)){};
+            Stmt(Kind kind) : ASTNode(kind){};
         };
 
         // This is the null statement ";": C99 6.8.3p3.
         class NullStmt : public Stmt
         {
         public:
-            virtual json asJson() const override;
+            NullStmt() : Stmt(Kind::NullStmt){};
+
+            void dump(DumpWriter &writer) const;
         };
 
         // Represents a statement that could possibly have a value and type.
@@ -483,16 +620,20 @@ namespace lcc
         {
             friend class lcc::QuaternionIRGenerator;
             friend class lcc::LLVMIRGenerator;
+            friend class lcc::ASTCache;
+            friend class lcc::Sema;
+            friend class lcc::ExprFolder;
+            friend class lcc::ConstEvaluator;
+            friend class lcc::DeadCodeEliminator;
 
         protected:
             std::unique_ptr<Expr> _expr;
 
         public:
-            ValueStmt(std::unique_ptr<Expr> expr) : _expr(std::move(expr)){};
+            ValueStmt(std::unique_ptr<Expr> expr) : Stmt(Kind::ValueStmt), _expr(std::move(expr)){};
+            ~ValueStmt();
 
-            virtual json asJson() const override;
-
-            virtual bool gen(lcc::IRGeneratorBase *generator) override;
+            void dump(DumpWriter &writer) const;
         };
 
         // This represents an if/then/else.
@@ -500,6 +641,11 @@ namespace lcc
         {
             friend class lcc::QuaternionIRGenerator;
             friend class lcc::LLVMIRGenerator;
+            friend class lcc::ASTCache;
+            friend class lcc::Sema;
+            friend class lcc::ExprFolder;
+            friend class lcc::ConstEvaluator;
+            friend class lcc::DeadCodeEliminator;
 
         protected:
             std::unique_ptr<Expr> _condition;
@@ -507,11 +653,10 @@ namespace lcc
             std::unique_ptr<Stmt> _elseBody;
 
         public:
-            IfStmt(std::unique_ptr<Expr> condition, std::unique_ptr<Stmt> body, std::unique_ptr<Stmt> elseBody = nullptr) : _condition(std::move(condition)), _body(std::move(body)), _elseBody(std::move(elseBody)){};
-
-            virtual json asJson() const override;
+            IfStmt(std::unique_ptr<Expr> condition, std::unique_ptr<Stmt> body, std::unique_ptr<Stmt> elseBody = nullptr) : Stmt(Kind::IfStmt), _condition(std::move(condition)), _body(std::move(body)), _elseBody(std::move(elseBody)){};
+            ~IfStmt();
 
-            virtual bool gen(lcc::IRGeneratorBase *generator) override;
+            void dump(DumpWriter &writer) const;
         };
 
         // This represents a 'while' stmt.
@@ -519,17 +664,21 @@ namespace lcc
         {
             friend class lcc::QuaternionIRGenerator;
             friend class lcc::LLVMIRGenerator;
+            friend class lcc::ASTCache;
+            friend class lcc::Sema;
+            friend class lcc::ExprFolder;
+            friend class lcc::ConstEvaluator;
+            friend class lcc::DeadCodeEliminator;
 
         protected:
             std::unique_ptr<Expr> _condition;
             std::unique_ptr<Stmt> _body;
 
         public:
-            WhileStmt(std::unique_ptr<Expr> condition, std::unique_ptr<Stmt> body) : _condition(std::move(condition)), _body(std::move(body)){};
+            WhileStmt(std::unique_ptr<Expr> condition, std::unique_ptr<Stmt> body) : Stmt(Kind::WhileStmt), _condition(std::move(condition)), _body(std::move(body)){};
+            ~WhileStmt();
 
-            virtual json asJson() const override;
-
-            virtual bool gen(lcc::IRGeneratorBase *generator) override;
+            void dump(DumpWriter &writer) const;
         };
 
         // Adaptor class for mixing declarations with statements and expressions.
@@ -537,16 +686,20 @@ namespace lcc
         {
             friend class lcc::QuaternionIRGenerator;
             friend class lcc::LLVMIRGenerator;
+            friend class lcc::ASTCache;
+            friend class lcc::Sema;
+            friend class lcc::ExprFolder;
+            friend class lcc::ConstEvaluator;
+            friend class lcc::DeadCodeEliminator;
 
         protected:
             std::vector<std::unique_ptr<Decl>> _decls;
 
         public:
-            DeclStmt(std::vector<std::unique_ptr<Decl>> &decls) : _decls(std::move(decls)){};
-
-            virtual json asJson() const override;
+            DeclStmt(std::vector<std::unique_ptr<Decl>> &decls) : Stmt(Kind::DeclStmt), _decls(std::move(decls)){};
+            ~DeclStmt();
 
-            virtual bool gen(lcc::IRGeneratorBase *generator) override;
+            void dump(DumpWriter &writer) const;
         };
 
         // This represents a group of statements like { stmt stmt }.
@@ -554,16 +707,20 @@ namespace lcc
         {
             friend class lcc::QuaternionIRGenerator;
             friend class lcc::LLVMIRGenerator;
+            friend class lcc::ASTCache;
+            friend class lcc::Sema;
+            friend class lcc::ExprFolder;
+            friend class lcc::ConstEvaluator;
+            friend class lcc::DeadCodeEliminator;
 
         protected:
             std::vector<std::unique_ptr<Stmt>> _body;
 
         public:
-            CompoundStmt(std::vector<std::unique_ptr<Stmt>> &body) : _body(std::move(body)){};
+            CompoundStmt(std::vector<std::unique_ptr<Stmt>> &body) : Stmt(Kind::CompoundStmt), _body(std::move(body)){};
+            ~CompoundStmt();
 
-            virtual json asJson() const override;
-
-            virtual bool gen(lcc::IRGeneratorBase *generator) override;
+            void dump(DumpWriter &writer) const;
         };
 
         // This represents a return, optionally of an expression: return; return 4;.
@@ -571,16 +728,20 @@ namespace lcc
         {
             friend class lcc::QuaternionIRGenerator;
             friend class lcc::LLVMIRGenerator;
+            friend class lcc::ASTCache;
+            friend class lcc::Sema;
+            friend class lcc::ExprFolder;
+            friend class lcc::ConstEvaluator;
+            friend class lcc::DeadCodeEliminator;
 
         protected:
             std::unique_ptr<Expr> _value;
 
         public:
-            ReturnStmt(std::unique_ptr<Expr> value = nullptr) : _value(std::move(value)){};
-
-            virtual json asJson() const override;
+            ReturnStmt(std::unique_ptr<Expr> value = nullptr) : Stmt(Kind::ReturnStmt), _value(std::move(value)){};
+            ~ReturnStmt();
 
-            virtual bool gen(lcc::IRGeneratorBase *generator) override;
+            void dump(DumpWriter &writer) const;
         };
 
         // AsmStmt is the base class for GCCAsmStmt and MSAsmStmt, in LameCC this statement
@@ -589,6 +750,11 @@ namespace lcc
         {
             friend class lcc::QuaternionIRGenerator;
             friend class lcc::LLVMIRGenerator;
+            friend class lcc::ASTCache;
+            friend class lcc::Sema;
+            friend class lcc::ExprFolder;
+            friend class lcc::ConstEvaluator;
+            friend class lcc::DeadCodeEliminator;
 
         protected:
             std::string _asmString;
@@ -617,11 +783,9 @@ namespace lcc
                 std::string &asmString,
                 std::vector<std::pair<std::string, std::unique_ptr<DeclRefExpr>>> &outputConstraints,
                 std::vector<std::pair<std::string, std::unique_ptr<Expr>>> &inputConstraints,
-                std::vector<std::string> &clbRegs) : _asmString(asmString), _outputConstraints(std::move(outputConstraints)), _inputConstraints(std::move(inputConstraints)), _clbRegs(clbRegs){};
-
-            virtual json asJson() const override;
+                std::vector<std::string> &clbRegs) : Stmt(Kind::AsmStmt), _asmString(asmString), _outputConstraints(std::move(outputConstraints)), _inputConstraints(std::move(inputConstraints)), _clbRegs(clbRegs){};
 
-            virtual bool gen(lcc::IRGeneratorBase *generator) override;
+            void dump(DumpWriter &writer) const;
 
             /// AsmStringPiece - this is part of a decomposed asm string specification
             /// (for use with the AnalyzeAsmString function below).  An asm string is
@@ -0,0 +1,759 @@
+#include "lcc.hpp"
+#include <cstring>
+#include <filesystem>
+#include <random>
+
+#include "llvm/Support/xxhash.h"
+
+namespace lcc
+{
+    std::unique_ptr<ASTCache> ASTCache::_inst;
+
+    namespace
+    {
+        constexpr char MAGIC[4] = {'L', 'C', 'C', 'A'};
+        constexpr uint64_t FORMAT_VERSION = 1; // bump whenever the node encoding changes
+
+        bool ReadFile(const std::string &path, std::string &content)
+        {
+            std::ifstream ifs(path, std::ios::binary | std::ios::ate);
+            if (!ifs)
+                return false;
+
+            std::streamoff size = ifs.tellg();
+            if (size < 0)
+                return false;
+            content.resize(size);
+            ifs.seekg(0);
+            ifs.read(content.data(), content.size());
+            return !ifs.fail();
+        }
+
+        std::string ToHex(uint64_t value)
+        {
+            static const char *hexDigits = "0123456789abcdef";
+
+            std::string hex(16, '0');
+            for (int i = 15; i >= 0; i--, value >>= 4)
+                hex[i] = hexDigits[value & 0xf];
+            return hex;
+        }
+
+        // values of the last BinaryOpType and UnaryOpType enumerators, UNDEFINED is never serialized
+        constexpr uint8_t LAST_BINARY_OP_TYPE = 0
+#define BINARY_OPERATION(name, disc) +1
+#define UNARY_OPERATION(name, disc)
+#include "OperationType.inc"
+#undef UNARY_OPERATION
+#undef BINARY_OPERATION
+            ;
+        constexpr uint8_t LAST_UNARY_OP_TYPE = 0
+#define BINARY_OPERATION(name, disc)
+#define UNARY_OPERATION(name, disc) +1
+#include "OperationType.inc"
+#undef UNARY_OPERATION
+#undef BINARY_OPERATION
+            ;
+    }
+
+    // Record layout: children first(in source order), then the node's kind byte and its own
+    // fields. Integers are LEB128 varints, strings are length prefixed.
+    class ASTCache::Writer : public AST::ASTVisitor<Writer, void, true>
+    {
+    public:
+        Writer(std::string &out) : _out(out){};
+
+        void gen(const AST::TranslationUnitDecl *node)
+        {
+            for (const auto &decl : node->_decls)
+                visit(decl);
+            writeKind(node);
+            writeVarint(node->_decls.size());
+        }
+
+        void gen(const AST::VarDecl *node)
+        {
+            if (node->_value != nullptr)
+                visit(node->_value);
+            writeKind(node);
+            writeType(node->_type);
+            writeString(node->_name);
+            writeByte(node->_value != nullptr); // initialized iff it has a value, as built by the parsers
+        }
+
+        void gen(const AST::ParmVarDecl *node)
+        {
+            writeKind(node);
+            writeType(node->_type);
+            writeString(node->_name);
+        }
+
+        void gen(const AST::FunctionDecl *node)
+        {
+            for (const auto &param : node->_params)
+                visit(param);
+            if (node->_body != nullptr)
+                visit(node->_body);
+            writeKind(node);
+            writeType(node->_type);
+            writeString(node->_name);
+            writeVarint(node->_params.size());
+            writeByte((node->_body != nullptr) | node->_isExtern << 1);
+        }
+
+        void gen(const AST::IntegerLiteral *node)
+        {
+            writeKind(node);
+            writeSigned(node->_value);
+        }
+
+        void gen(const AST::FloatingLiteral *node)
+        {
+            char bytes[sizeof(float)];
+            std::memcpy(bytes, &node->_value, sizeof(float));
+            writeKind(node);
+            _out.append(bytes, sizeof(float));
+        }
+
+        void gen(const AST::CharacterLiteral *node)
+        {
+            writeKind(node);
+            writeByte(node->_value);
+        }
+
+        void gen(const AST::StringLiteral *node)
+        {
+            writeKind(node);
+            writeString(node->_value);
+            writeByte(static_cast<uint8_t>(node->_kind));
+        }
+
+        void gen(const AST::DeclRefExpr *node)
+        {
+            writeKind(node);
+            writeString(node->_name);
+            writeByte(node->_isCall | node->_isArray << 1);
+        }
+
+        void gen(const AST::BinaryOperator *node)
+        {
+            visit(node->_lhs);
+            visit(node->_rhs);
+            writeKind(node);
+            writeByte(static_cast<uint8_t>(node->_type));
+        }
+
+        void gen(const AST::UnaryOperator *node)
+        {
+            visit(node->_body);
+            writeKind(node);
+            writeByte(static_cast<uint8_t>(node->_type));
+        }
+
+        void gen(const AST::ParenExpr *node)
+        {
+            visit(node->_subExpr);
+            writeKind(node);
+        }
+
+        void gen(const AST::CallExpr *node)
+        {
+            visit(node->_functionExpr);
+            for (const auto &param : node->_params)
+                visit(param);
+            writeKind(node);
+            writeVarint(node->_params.size());
+        }
+
+        void gen(const AST::CastExpr *node)
+        {
+            visit(node->_subExpr);
+            writeKind(node);
+            writeByte(static_cast<uint8_t>(node->_type));
+        }
+
+        void gen(const AST::ArraySubscriptExpr *node)
+        {
+            visit(node->_lhs);
+            visit(node->_rhs);
+            writeKind(node);
+            writeString(node->_name);
+        }
+
+        void gen(const AST::NullStmt *node)
+        {
+            writeKind(node);
+        }
+
+        void gen(const AST::ValueStmt *node)
+        {
+            visit(node->_expr);
+            writeKind(node);
+        }
+
+        void gen(const AST::IfStmt *node)
+        {
+            visit(node->_condition);
+            visit(node->_body);
+            if (node->_elseBody != nullptr)
+                visit(node->_elseBody);
+            writeKind(node);
+            writeByte(node->_elseBody != nullptr);
+        }
+
+        void gen(const AST::WhileStmt *node)
+        {
+            visit(node->_condition);
+            visit(node->_body);
+            writeKind(node);
+        }
+
+        void gen(const AST::DeclStmt *node)
+        {
+            for (const auto &decl : node->_decls)
+                visit(decl);
+            writeKind(node);
+            writeVarint(node->_decls.size());
+        }
+
+        void gen(const AST::CompoundStmt *node)
+        {
+            for (const auto &stmt : node->_body)
+                visit(stmt);
+            writeKind(node);
+            writeVarint(node->_body.size());
+        }
+
+        void gen(const AST::ReturnStmt *node)
+        {
+            if (node->_value != nullptr)
+                visit(node->_value);
+            writeKind(node);
+            writeByte(node->_value != nullptr);
+        }
+
+        void gen(const AST::AsmStmt *node)
+        {
+            for (const auto &constraint : node->_outputConstraints)
+                visit(constraint.second);
+            for (const auto &constraint : node->_inputConstraints)
+                visit(constraint.second);
+            writeKind(node);
+            writeString(node->_asmString);
+            writeVarint(node->_outputConstraints.size());
+            for (const auto &constraint : node->_outputConstraints)
+                writeString(constraint.first);
+            writeVarint(node->_inputConstraints.size());
+            for (const auto &constraint : node->_inputConstraints)
+                writeString(constraint.first);
+            writeVarint(node->_clbRegs.size());
+            for (const auto &reg : node->_clbRegs)
+                writeString(reg);
+        }
+
+    private:
+        void writeByte(uint8_t byte)
+        {
+            _out.push_back(static_cast<char>(byte));
+        }
+
+        void writeKind(const AST::ASTNode *node)
+        {
+            writeByte(static_cast<uint8_t>(node->kind()));
+        }
+
+        void writeVarint(uint64_t value)
+        {
+            while (value >= 0x80)
+            {
+                writeByte(static_cast<uint8_t>(value) | 0x80);
+                value >>= 7;
+            }
+            writeByte(static_cast<uint8_t>(value));
+        }
+
+        void writeSigned(int64_t value)
+        {
+            writeVarint((static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63)); // zigzag
+        }
+
+        void writeString(const std::string &str)
+        {
+            writeVarint(str.size());
+            _out.append(str);
+        }
+
+        // pointer and array layers outermost first, terminated by the builtin element type
+        void writeType(const AST::Type *type)
+        {
+            for (; !type->isBuiltin(); type = type->elementType())
+            {
+                writeByte(static_cast<uint8_t>(type->kind()));
+                if (type->isArray())
+                    writeVarint(type->length());
+            }
+            writeByte(static_cast<uint8_t>(type->kind()));
+        }
+
+    private:
+        std::string &_out;
+    };
+
+    // Rebuilds nodes through their constructors, which re-derive the implicit casts and
+    // lvalue flags exactly as the parsers did. Any malformed input makes run() return nullptr.
+    class ASTCache::Reader
+    {
+    public:
+        Reader(std::string_view data) : _cur(data.data()), _end(data.data() + data.size()){};
+
+        std::unique_ptr<AST::ASTNode> run()
+        {
+            while (_cur < _end && !_isFailed)
+                readNode();
+
+            if (_isFailed || _nodes.size() != 1)
+                return nullptr;
+            return std::move(_nodes.back());
+        }
+
+    private:
+        using Kind = AST::ASTNode::Kind;
+
+        void readNode()
+        {
+            switch (static_cast<Kind>(readByte()))
+            {
+            case Kind::TranslationUnitDecl:
+            {
+                auto decls = popList<AST::Decl>(readVarint());
+                push(std::make_unique<AST::TranslationUnitDecl>(decls));
+                break;
+            }
+            case Kind::VarDecl:
+            {
+                const AST::Type *type = readType();
+                std::string name = readString();
+                std::unique_ptr<AST::Expr> value = readFlags(1) ? pop<AST::Expr>() : nullptr;
+                bool isInitialized = value != nullptr;
+                push(std::make_unique<AST::VarDecl>(name, type, isInitialized, std::move(value)));
+                break;
+            }
+            case Kind::ParmVarDecl:
+            {
+                const AST::Type *type = readType();
+                push(std::make_unique<AST::ParmVarDecl>(readString(), type));
+                break;
+            }
+            case Kind::FunctionDecl:
+            {
+                const AST::Type *type = readType();
+                std::string name = readString();
+                size_t numParams = readVarint();
+                uint8_t flags = readFlags(3);
+                std::unique_ptr<AST::Stmt> body = (flags & 1) ? pop<AST::Stmt>() : nullptr;
+                auto params = popList<AST::ParmVarDecl>(numParams);
+                push(std::make_unique<AST::FunctionDecl>(name, type, params, std::move(body), flags & 2));
+                break;
+            }
+            case Kind::IntegerLiteral:
+                push(std::make_unique<AST::IntegerLiteral>(static_cast<int>(readSigned())));
+                break;
+            case Kind::FloatingLiteral:
+            {
+                float value = 0;
+                if (!expect(sizeof(float)))
+                    break;
+                std::memcpy(&value, _cur, sizeof(float));
+                _cur += sizeof(float);
+                push(std::make_unique<AST::FloatingLiteral>(value));
+                break;
+            }
+            case Kind::CharacterLiteral:
+                push(std::make_unique<AST::CharacterLiteral>(static_cast<char>(readByte())));
+                break;
+            case Kind::StringLiteral:
+            {
+                std::string value = readString();
+                auto kind = static_cast<AST::StringLiteral::StringKind>(readEnum(static_cast<uint8_t>(AST::StringLiteral::StringKind::UTF32)));
+                push(std::make_unique<AST::StringLiteral>(value, kind));
+                break;
+            }
+            case Kind::DeclRefExpr:
+            {
+                std::string name = readString();
+                uint8_t flags = readFlags(3);
+                push(std::make_unique<AST::DeclRefExpr>(name, flags & 1, flags & 2));
+                break;
+            }
+            case Kind::BinaryOperator:
+            {
+                auto type = static_cast<AST::BinaryOpType>(readEnum(LAST_BINARY_OP_TYPE, 1));
+                auto rhs = pop<AST::Expr>();
+                auto lhs = pop<AST::Expr>();
+                if (lhs != nullptr && rhs != nullptr)
+                    push(std::make_unique<AST::BinaryOperator>(type, std::move(lhs), std::move(rhs)));
+                break;
+            }
+            case Kind::UnaryOperator:
+            {
+                auto type = static_cast<AST::UnaryOpType>(readEnum(LAST_UNARY_OP_TYPE, 1));
+                push(std::make_unique<AST::UnaryOperator>(type, pop<AST::Expr>()));
+                break;
+            }
+            case Kind::ParenExpr:
+            {
+                auto subExpr = pop<AST::Expr>();
+                if (subExpr != nullptr)
+                    push(std::make_unique<AST::ParenExpr>(std::move(subExpr)));
+                break;
+            }
+            case Kind::CallExpr:
+            {
+                auto params = popList<AST::Expr>(readVarint());
+                push(std::make_unique<AST::CallExpr>(pop<AST::DeclRefExpr>(), params));
+                break;
+            }
+            case Kind::CastExpr:
+            {
+                auto type = static_cast<AST::CastExpr::CastType>(readEnum(static_cast<uint8_t>(AST::CastExpr::CastType::LValueToRValue)));
+                push(std::make_unique<AST::CastExpr>(pop<AST::Expr>(), type));
+                break;
+            }
+            case Kind::ImplicitCastExpr:
+            {
+                auto type = static_cast<AST::CastExpr::CastType>(readEnum(static_cast<uint8_t>(AST::CastExpr::CastType::LValueToRValue)));
+                push(std::make_unique<AST::ImplicitCastExpr>(pop<AST::Expr>(), type));
+                break;
+            }
+            case Kind::ArraySubscriptExpr:
+            {
+                std::string name = readString();
+                auto rhs = pop<AST::Expr>();
+                auto lhs = pop<AST::Expr>();
+                if (lhs != nullptr && rhs != nullptr)
+                    push(std::make_unique<AST::ArraySubscriptExpr>(name, std::move(lhs), std::move(rhs)));
+                break;
+            }
+            case Kind::NullStmt:
+                push(std::make_unique<AST::NullStmt>());
+                break;
+            case Kind::ValueStmt:
+                push(std::make_unique<AST::ValueStmt>(pop<AST::Expr>()));
+                break;
+            case Kind::IfStmt:
+            {
+                std::unique_ptr<AST::Stmt> elseBody = readFlags(1) ? pop<AST::Stmt>() : nullptr;
+                auto body = pop<AST::Stmt>();
+                push(std::make_unique<AST::IfStmt>(pop<AST::Expr>(), std::move(body), std::move(elseBody)));
+                break;
+            }
+            case Kind::WhileStmt:
+            {
+                auto body = pop<AST::Stmt>();
+                push(std::make_unique<AST::WhileStmt>(pop<AST::Expr>(), std::move(body)));
+                break;
+            }
+            case Kind::DeclStmt:
+            {
+                auto decls = popList<AST::Decl>(readVarint());
+                push(std::make_unique<AST::DeclStmt>(decls));
+                break;
+            }
+            case Kind::CompoundStmt:
+            {
+                auto body = popList<AST::Stmt>(readVarint());
+                push(std::make_unique<AST::CompoundStmt>(body));
+                break;
+            }
+            case Kind::ReturnStmt:
+                push(std::make_unique<AST::ReturnStmt>(readFlags(1) ? pop<AST::Expr>() : nullptr));
+                break;
+            case Kind::AsmStmt:
+            {
+                std::string asmString = readString();
+                std::vector<std::string> outputNames(readCount());
+                for (auto &name : outputNames)
+                    name = readString();
+                std::vector<std::string> inputNames(readCount());
+                for (auto &name : inputNames)
+                    name = readString();
+                std::vector<std::string> clbRegs(readCount());
+                for (auto &reg : clbRegs)
+                    reg = readString();
+
+                auto inputExprs = popList<AST::Expr>(inputNames.size());
+                auto outputExprs = popList<AST::DeclRefExpr>(outputNames.size());
+                if (_isFailed)
+                    break;
+                std::vector<std::pair<std::string, std::unique_ptr<AST::DeclRefExpr>>> outputConstraints;
+                for (size_t i = 0; i < outputNames.size(); i++)
+                    outputConstraints.emplace_back(outputNames[i], std::move(outputExprs[i]));
+                std::vector<std::pair<std::string, std::unique_ptr<AST::Expr>>> inputConstraints;
+                for (size_t i = 0; i < inputNames.size(); i++)
+                    inputConstraints.emplace_back(inputNames[i], std::move(inputExprs[i]));
+                push(std::make_unique<AST::AsmStmt>(asmString, outputConstraints, inputConstraints, clbRegs));
+                break;
+            }
+            default:
+                _isFailed = true;
+                break;
+            }
+        }
+
+        template <typename T>
+        void push(std::unique_ptr<T> node)
+        {
+            if (!_isFailed)
+                _nodes.push_back(std::move(node));
+        }
+
+        // top of the node stack, nullptr(and the reader fails) if it's missing or of the wrong class
+        template <typename T>
+        std::unique_ptr<T> pop()
+        {
+            if (_isFailed || _nodes.empty())
+            {
+                _isFailed = true;
+                return nullptr;
+            }
+
+            if (!isKindOf<T>(_nodes.back()->kind()))
+            {
+                _isFailed = true;
+                return nullptr;
+            }
+
+            auto node = std::unique_ptr<T>(static_cast<T *>(_nodes.back().release()));
+            _nodes.pop_back();
+            return node;
+        }
+
+        // cheaper than dynamic_cast, and pop() is the hot path of the reader
+        template <typename T>
+        static bool isKindOf(Kind kind)
+        {
+            if constexpr (std::is_same_v<T, AST::Decl>)
+                return kind >= Kind::TranslationUnitDecl && kind <= Kind::FunctionDecl;
+            else if constexpr (std::is_same_v<T, AST::Expr>)
+                return kind >= Kind::IntegerLiteral && kind <= Kind::ArraySubscriptExpr;
+            else if constexpr (std::is_same_v<T, AST::Stmt>)
+                return kind >= Kind::NullStmt && kind <= Kind::AsmStmt;
+            else if constexpr (std::is_same_v<T, AST::DeclRefExpr>)
+                return kind == Kind::DeclRefExpr || kind == Kind::ArraySubscriptExpr;
+            else
+            {
+                static_assert(std::is_same_v<T, AST::ParmVarDecl>);
+                return kind == Kind::ParmVarDecl;
+            }
+        }
+
+        // the last count nodes on the stack, in the order they were pushed
+        template <typename T>
+        std::vector<std::unique_ptr<T>> popList(size_t count)
+        {
+            std::vector<std::unique_ptr<T>> nodes;
+            if (_isFailed || count > _nodes.size())
+            {
+                _isFailed = true;
+                return nodes;
+            }
+
+            nodes.resize(count);
+            for (size_t i = count; i > 0 && !_isFailed; i--)
+                nodes[i - 1] = pop<T>();
+            return nodes;
+        }
+
+        // flag byte, fails on bits outside mask
+        uint8_t readFlags(uint8_t mask)
+        {
+            uint8_t flags = readByte();
+            if (flags & ~mask)
+                _isFailed = true;
+            return flags & mask;
+        }
+
+        // enumerator in [first, last], fails outside it
+        uint8_t readEnum(uint8_t last, uint8_t first = 0)
+        {
+            uint8_t value = readByte();
+            if (value < first || value > last)
+            {
+                _isFailed = true;
+                return first;
+            }
+            return value;
+        }
+
+        bool expect(size_t size)
+        {
+            if ((size_t)(_end - _cur) < size)
+                _isFailed = true;
+            return !_isFailed;
+        }
+
+        uint8_t readByte()
+        {
+            if (!expect(1))
+                return 0;
+            return static_cast<uint8_t>(*_cur++);
+        }
+
+        uint64_t readVarint()
+        {
+            uint64_t value = 0;
+            for (int shift = 0; shift < 64 && expect(1); shift += 7)
+            {
+                uint8_t byte = static_cast<uint8_t>(*_cur++);
+                value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+                if (!(byte & 0x80))
+                    return value;
+            }
+            _isFailed = true;
+            return 0;
+        }
+
+        int64_t readSigned()
+        {
+            uint64_t value = readVarint();
+            return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+        }
+
+        // element count that can't exceed the remaining input, so a corrupt one can't over-allocate
+        size_t readCount()
+        {
+            uint64_t count = readVarint();
+            if (count > (uint64_t)(_end - _cur))
+            {
+                _isFailed = true;
+                return 0;
+            }
+            return count;
+        }
+
+        std::string readString()
+        {
+            uint64_t size = readVarint();
+            if (!expect(size))
+                return std::string();
+            std::string str(_cur, size);
+            _cur += size;
+            return str;
+        }
+
+        const AST::Type *readType()
+        {
+            std::vector<std::pair<AST::Type::Kind, size_t>> layers; // outermost first
+            AST::Type::Kind kind;
+            while ((kind = static_cast<AST::Type::Kind>(readByte())) == AST::Type::Kind::Pointer || kind == AST::Type::Kind::Array)
+                layers.emplace_back(kind, kind == AST::Type::Kind::Array ? readVarint() : 0);
+
+            if (_isFailed || kind > AST::Type::Kind::Array)
+            {
+                _isFailed = true;
+                return AST::Type::getBuiltin(AST::Type::Kind::Int);
+            }
+
+            const AST::Type *type = AST::Type::getBuiltin(kind);
+            for (auto layer = layers.rbegin(); layer != layers.rend(); layer++)
+                type = layer->first == AST::Type::Kind::Pointer ? AST::Type::getPointer(type) : AST::Type::getArray(type, layer->second);
+            return type;
+        }
+
+    private:
+        const char *_cur;
+        const char *_end;
+        bool _isFailed{false};
+        std::vector<std::unique_ptr<AST::ASTNode>> _nodes;
+    };
+
+    void ASTCache::serialize(const AST::ASTNode *astRoot, std::string &out)
+    {
+        Writer writer(out);
+        writer.visit(astRoot);
+    }
+
+    std::unique_ptr<AST::ASTNode> ASTCache::deserialize(std::string_view data)
+    {
+        Reader reader(data);
+        return reader.run();
+    }
+
+    std::string ASTCache::key(const std::string &sourcePath, const std::string &grammarFilePath) const
+    {
+        std::string source;
+        if (!ReadFile(sourcePath, source))
+            return std::string();
+
+        std::string key = ToHex(llvm::xxHash64(source)) + ToHex(source.size());
+        if (grammarFilePath == "-")
+            return key + "-rd";
+
+        std::string grammar;
+        if (!ReadFile(grammarFilePath, grammar))
+            return std::string();
+        return key + "-lr1-" + ToHex(llvm::xxHash64(grammar));
+    }
+
+    std::unique_ptr<AST::Decl> ASTCache::load(const std::string &cacheDir, const std::string &key)
+    {
+        std::string data;
+        if (key.empty() || !ReadFile(cacheDir + "/" + key + ".ast", data))
+            return nullptr;
+
+        // header: magic, format version, key, hash of the serialized AST
+        std::string header(MAGIC, sizeof(MAGIC));
+        header += static_cast<char>(FORMAT_VERSION);
+        header += key;
+        if (data.size() < header.size() + 16 || data.compare(0, header.size(), header) != 0)
+            return nullptr;
+
+        std::string_view payload = std::string_view(data).substr(header.size() + 16);
+        std::unique_ptr<AST::ASTNode> astRoot = nullptr;
+        if (data.compare(header.size(), 16, ToHex(llvm::xxHash64(llvm::StringRef(payload.data(), payload.size())))) == 0)
+            astRoot = deserialize(payload);
+        if (astRoot == nullptr)
+        {
+            WARNING("Ignored corrupt AST cache entry " << key);
+            return nullptr;
+        }
+        return dynamic_pointer_cast<AST::Decl>(std::move(astRoot));
+    }
+
+    bool ASTCache::store(const std::string &cacheDir, const std::string &key, const AST::ASTNode *astRoot)
+    {
+        if (key.empty())
+            return false;
+
+        std::string data(MAGIC, sizeof(MAGIC));
+        data += static_cast<char>(FORMAT_VERSION);
+        data += key;
+        size_t hashOffset = data.size();
+        data.append(16, '0');
+        serialize(astRoot, data);
+        data.replace(hashOffset, 16, ToHex(llvm::xxHash64(llvm::StringRef(data).substr(hashOffset + 16))));
+
+        // written aside and renamed, so concurrent compilers never read a partial entry
+        std::error_code ec;
+        std::filesystem::create_directories(cacheDir, ec);
+        std::string path = cacheDir + "/" + key + ".ast";
+        std::string tmpPath = path + ".tmp" + std::to_string(std::random_device{}());
+        {
+            std::ofstream ofs(tmpPath, std::ios::binary);
+            ofs.write(data.data(), data.size());
+            if (!ofs)
+            {
+                WARNING("Failed to write AST cache entry " << path);
+                return false;
+            }
+        }
+        std::filesystem::rename(tmpPath, path, ec);
+        if (ec)
+        {
+            WARNING("Failed to write AST cache entry " << path);
+            std::filesystem::remove(tmpPath, ec);
+            return false;
+        }
+        return true;
+    }
+}
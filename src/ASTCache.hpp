@@ -0,0 +1,54 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "AST.hpp"
+#include "ASTVisitor.hpp"
+
+namespace lcc
+{
+    // Binary AST serialization and the on-disk AST cache built on it(ASTCache.cpp). Entries are
+    // keyed by the source text and the parser mode, so a rebuild that only changes codegen
+    // options skips lexing and parsing.
+    class ASTCache
+    {
+    public:
+        ~ASTCache() = default;
+        ASTCache(const ASTCache &) = delete;
+        ASTCache &operator=(const ASTCache &) = delete;
+
+    private:
+        ASTCache() = default;
+
+    public:
+        static ASTCache *getInstance()
+        {
+            if (_inst.get() == nullptr)
+                _inst.reset(new ASTCache);
+
+            return _inst.get();
+        }
+
+        // key of sourcePath parsed with the LR1 grammar at grammarFilePath("-" for the recursive
+        // descent parser), empty if either file can't be read
+        std::string key(const std::string &sourcePath, const std::string &grammarFilePath) const;
+
+        // nullptr on a miss, a stale entry or a corrupt one
+        std::unique_ptr<AST::Decl> load(const std::string &cacheDir, const std::string &key);
+        bool store(const std::string &cacheDir, const std::string &key, const AST::ASTNode *astRoot);
+
+        // Nodes are written children first, so reading them back is a single pass over the
+        // buffer with an explicit node stack. Deserialized nodes go to the active ASTContext.
+        static void serialize(const AST::ASTNode *astRoot, std::string &out);
+        static std::unique_ptr<AST::ASTNode> deserialize(std::string_view data);
+
+    private:
+        class Writer;
+        class Reader;
+
+        static std::unique_ptr<ASTCache> _inst;
+    };
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <memory>
+#include <type_traits>
+
+#include "AST.hpp"
+
+namespace lcc
+{
+    namespace AST
+    {
+        // Visitor base class, Derived implements gen(X *) for every concrete node class X in
+        // ASTNodeKind.inc (or for a base class of it). visit() switches on the node kind and
+        // calls the handler directly, so handlers can be inlined into the dispatch.
+        template <typename Derived, typename RetTy = bool, bool IsConst = false>
+        class ASTVisitor
+        {
+        private:
+            template <typename T>
+            using NodePtr = std::conditional_t<IsConst, const T *, T *>;
+
+        public:
+            RetTy visit(NodePtr<ASTNode> node)
+            {
+                switch (node->kind())
+                {
+#define AST_NODE(name)          \
+    case ASTNode::Kind::name: \
+        return static_cast<Derived *>(this)->gen(static_cast<NodePtr<name>>(node));
+#include "ASTNodeKind.inc"
+#undef AST_NODE
+                }
+
+                return RetTy();
+            }
+
+            template <typename T>
+            RetTy visit(const std::unique_ptr<T> &node)
+            {
+                return visit(node.get());
+            }
+        };
+    }
+}
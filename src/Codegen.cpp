@@ -2,7 +2,10 @@
 
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/ScopeExit.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/Analysis/TargetLibraryInfo.h"
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
 #include "llvm/CodeGen/CommandFlags.h"
 #include "llvm/CodeGen/LinkAllAsmWriterComponents.h"
 #include "llvm/CodeGen/LinkAllCodegenComponents.h"
@@ -22,6 +25,7 @@
 #include "llvm/IR/Verifier.h"
 #include "llvm/IRReader/IRReader.h"
 #include "llvm/InitializePasses.h"
+#include "llvm/MC/MCAsmInfo.h"
 #include "llvm/MC/MCTargetOptionsCommandFlags.h"
 #include "llvm/MC/SubtargetFeature.h"
 #include "llvm/MC/TargetRegistry.h"
@@ -35,6 +39,7 @@
 #include "llvm/Support/PluginLoader.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/TimeProfiler.h"
 #include "llvm/Support/ToolOutputFile.h"
 #include "llvm/Support/WithColor.h"
@@ -43,6 +48,7 @@
 #include "llvm/TargetParser/Host.h"
 #include "llvm/TargetParser/Triple.h"
 #include "llvm/Transforms/Utils/Cloning.h"
+#include "llvm/Transforms/Utils/SplitModule.h"
 #include <memory>
 #include <optional>
 
@@ -163,7 +169,7 @@
          return FDOut;
      }
 
-     int Codegen::compileModule(char **argv, llvm::LLVMContext &Context)
+     int Codegen::compileModule(char **argv, llvm::LLVMContext &Context, std::unique_ptr<llvm::Module> InputModule)
      {
          // Load the module to be compiled...
          llvm::SMDiagnostic Err;
@@ -184,6 +190,7 @@
          bool SkipModule = CPUStr == "help" || (!MAttrs.empty() && MAttrs.front() == "help");
 
          llvm::CodeGenOpt::Level OLvl = llvm::CodeGenOpt::Default;
+         llvm::OptimizationLevel IROptLevel = llvm::OptimizationLevel::O2;
          switch (Options::OptLevel)
          {
          default:
@@ -193,15 +200,19 @@
              break;
          case '0':
              OLvl = llvm::CodeGenOpt::None;
+             IROptLevel = llvm::OptimizationLevel::O0;
              break;
          case '1':
              OLvl = llvm::CodeGenOpt::Less;
+             IROptLevel = llvm::OptimizationLevel::O1;
              break;
          case '2':
              OLvl = llvm::CodeGenOpt::Default;
+             IROptLevel = llvm::OptimizationLevel::O2;
              break;
          case '3':
              OLvl = llvm::CodeGenOpt::Aggressive;
+             IROptLevel = llvm::OptimizationLevel::O3;
              break;
          }
 
@@ -292,7 +303,14 @@
 
              std::string irFileName = Options::IRDumpPath.getValue();
 
-             if (Options::InputLanguage == "mir" ||
+             if (InputModule)
+             {
+                 // handed over by the IR generator, the parser would have called this with its triple
+                 M = std::move(InputModule);
+                 if (std::optional<std::string> DL = SetDataLayout(M->getTargetTriple(), M->getDataLayoutStr()))
+                     M->setDataLayout(*DL);
+             }
+             else if (Options::InputLanguage == "mir" ||
                  (Options::InputLanguage == "" && llvm::StringRef(irFileName).endswith(".mir"))) {
                  MIR = createMIRParserFromFile(irFileName, Err, Context,
                      setMIRFunctionAttributes);
@@ -386,15 +404,33 @@
          // Verify module immediately to catch problems before doInitialization() is
          // called on any passes.
          if (!Options::NoVerify && verifyModule(*M, &llvm::errs()))
-             FATAL_ERROR("input module cannot be verified: " << Options::IRDumpPath);
+             FATAL_ERROR("input module cannot be verified: " << M->getModuleIdentifier());
 
          // Override function attributes based on CPUStr, FeaturesStr, and command line
          // flags.
          llvm::codegen::setFunctionAttributes(CPUStr, FeaturesStr, *M);
 
+         // only with an explicit -O, the default keeps build times of the codegen level alone. MIR is
+         // already past the middle end
+         if (!MIR && !Options::DisableIROptimizations && Options::OptLevel != ' ')
+             optimizeModule(*M, *Target, TLII, IROptLevel);
+
          if (llvm::mc::getExplicitRelaxAll() && llvm::codegen::getFileType() != llvm::CGFT_ObjectFile)
              WARNING("ignoring -mc-relax-all because filetype != obj");
 
+         // the assembly of the partitions can be appended into one file, their objects would need a linker
+         bool IsSplit = Options::CodegenThreads > 1 && !MIR && !DwoOut && !Options::CompileTwice &&
+                        llvm::codegen::getFileType() != llvm::CGFT_ObjectFile;
+         if (Options::CodegenThreads > 1 && !IsSplit)
+             WARNING("--codegen-threads only applies to assembly output of IR, ignored --codegen-threads");
+         if (IsSplit)
+         {
+             if (!splitCodegen(*M, *Target, TLII, Out->os()))
+                 return 1;
+             Out->keep();
+             return 0;
+         }
+
          {
              llvm::raw_pwrite_stream *OS = &Out->os();
 
@@ -508,7 +544,144 @@
          return 0;
      }
 
-     bool Codegen::run()
+     void Codegen::optimizeModule(llvm::Module &M, llvm::TargetMachine &TM, const llvm::TargetLibraryInfoImpl &TLII,
+                                  llvm::OptimizationLevel Level)
+     {
+         llvm::LoopAnalysisManager LAM;
+         llvm::FunctionAnalysisManager FAM;
+         llvm::CGSCCAnalysisManager CGAM;
+         llvm::ModuleAnalysisManager MAM;
+
+         llvm::PassBuilder PB(&TM);
+
+         // registered first so the default one doesn't replace it, -disable-simplify-libcalls holds here too
+         FAM.registerPass([&] { return llvm::TargetLibraryAnalysis(TLII); });
+
+         PB.registerModuleAnalyses(MAM);
+         PB.registerCGSCCAnalyses(CGAM);
+         PB.registerFunctionAnalyses(FAM);
+         PB.registerLoopAnalyses(LAM);
+         PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
+
+         llvm::ModulePassManager MPM = Level == llvm::OptimizationLevel::O0
+                                           ? PB.buildO0DefaultPipeline(Level)
+                                           : PB.buildPerModuleDefaultPipeline(Level);
+         MPM.run(M, MAM);
+     }
+
+     bool Codegen::splitCodegen(llvm::Module &M, const llvm::TargetMachine &TM, const llvm::TargetLibraryInfoImpl &TLII,
+                                llvm::raw_pwrite_stream &OS)
+     {
+         unsigned NumPartitions = Options::CodegenThreads;
+         std::vector<llvm::SmallVector<char, 0>> Bitcodes(NumPartitions);
+         std::vector<llvm::SmallVector<char, 0>> Outputs(NumPartitions);
+         std::vector<char> IsCompiled(NumPartitions, false); // the workers write it at the same time
+
+         llvm::ThreadPool Pool(llvm::hardware_concurrency(NumPartitions));
+         unsigned Partition = 0;
+
+         // locals stay in the partition of their users, so no symbol has to be made global. A partition
+         // is compiled as soon as it has been split off
+         llvm::SplitModule(
+             M, NumPartitions, [&](std::unique_ptr<llvm::Module> Part)
+             {
+                 // the partitions share the context of M, which codegen can't use from several threads
+                 llvm::raw_svector_ostream BCOS(Bitcodes[Partition]);
+                 llvm::WriteBitcodeToFile(*Part, BCOS);
+
+                 Pool.async([&, I = Partition]()
+                 {
+                     llvm::LLVMContext Context;
+                     Context.setDiscardValueNames(Options::DiscardValueNames);
+                     auto PartOrErr = llvm::parseBitcodeFile(
+                         llvm::MemoryBufferRef(llvm::StringRef(Bitcodes[I].data(), Bitcodes[I].size()), "partition"), Context);
+                     if (!PartOrErr)
+                     {
+                         llvm::consumeError(PartOrErr.takeError());
+                         return;
+                     }
+
+                     std::unique_ptr<llvm::TargetMachine> PartTarget(TM.getTarget().createTargetMachine(
+                         TM.getTargetTriple().str(), TM.getTargetCPU(), TM.getTargetFeatureString(), TM.Options,
+                         TM.getRelocationModel(), TM.getCodeModel(), TM.getOptLevel()));
+
+                     llvm::legacy::PassManager PM;
+                     PM.add(new llvm::TargetLibraryInfoWrapperPass(TLII));
+                     llvm::raw_svector_ostream PartOS(Outputs[I]);
+                     if (PartTarget->addPassesToEmitFile(PM, PartOS, nullptr, llvm::codegen::getFileType(), Options::NoVerify))
+                         return;
+
+                     PM.run(**PartOrErr);
+                     IsCompiled[I] = true;
+                 });
+                 Partition++;
+             },
+             true);
+         Pool.wait();
+
+         for (unsigned I = 0; I < NumPartitions; I++)
+         {
+             if (!IsCompiled[I])
+             {
+                 FATAL_ERROR("Can't generate code for partition " << I);
+                 return false;
+             }
+         }
+
+         if (llvm::codegen::getFileType() == llvm::CGFT_AssemblyFile)
+             for (unsigned I = 0; I < NumPartitions; I++)
+                 appendPartition(llvm::StringRef(Outputs[I].data(), Outputs[I].size()), I, *TM.getMCAsmInfo(), OS);
+         return true;
+     }
+
+     void Codegen::appendPartition(llvm::StringRef Asm, unsigned Partition, const llvm::MCAsmInfo &MAI,
+                                   llvm::raw_ostream &OS)
+     {
+         // the first partition keeps its labels, a single partition gives what serial codegen does
+         if (Partition == 0)
+         {
+             OS << Asm;
+             return;
+         }
+
+         // .LBB0_1 of the second partition becomes .L1_BB0_1, the prefix names no other symbols
+         llvm::StringRef Prefix = MAI.getPrivateGlobalPrefix();
+         llvm::StringRef Comment = MAI.getCommentString();
+         std::string Tag = std::to_string(Partition) + "_";
+         auto isSymbolChar = [](char C)
+         { return llvm::isAlnum(C) || C == '_' || C == '.' || C == '$'; };
+
+         size_t Begin = 0; // of the text not written yet
+         bool IsInString = false, IsInComment = false;
+         for (size_t I = 0; I < Asm.size(); I++)
+         {
+             char C = Asm[I];
+             if (C == '\n')
+                 IsInString = IsInComment = false;
+             else if (IsInComment)
+                 continue;
+             else if (IsInString)
+             {
+                 if (C == '\\')
+                     I++; // an escaped quote doesn't end the string
+                 else if (C == '"')
+                     IsInString = false;
+             }
+             else if (C == '"')
+                 IsInString = true;
+             else if (Asm.substr(I).startswith(Comment))
+                 IsInComment = true;
+             else if (Asm.substr(I).startswith(Prefix) && (I == 0 || !isSymbolChar(Asm[I - 1])))
+             {
+                 OS << Asm.slice(Begin, I + Prefix.size()) << Tag;
+                 Begin = I + Prefix.size();
+                 I = Begin - 1;
+             }
+         }
+         OS << Asm.substr(Begin);
+     }
+
+     bool Codegen::run(std::unique_ptr<llvm::Module> module)
      {
          llvm::InitLLVM X(Options::args, Options::argv);
 
@@ -546,7 +719,9 @@
          // Register the target printer for --version.
          llvm::cl::AddExtraVersionPrinter(llvm::TargetRegistry::printRegisteredTargetsForVersion);
 
-         llvm::LLVMContext Context;
+         // a module handed over in memory stays in the context it was generated in
+         std::unique_ptr<llvm::LLVMContext> OwnContext = module ? nullptr : std::make_unique<llvm::LLVMContext>();
+         llvm::LLVMContext &Context = module ? module->getContext() : *OwnContext;
          Context.setDiscardValueNames(Options::DiscardValueNames);
 
          // Set a diagnostic handler that doesn't exit on the first error
@@ -571,8 +746,12 @@
          // Compile the module TimeCompilations times to give better compile time
          // metrics.
          for (unsigned I = Options::TimeCompilations; I; --I)
-             if (int RetVal = compileModule(Options::argv, Context))
-                 return RetVal;
+         {
+             // codegen changes the module, every compilation but the last gets a copy
+             std::unique_ptr<llvm::Module> M = module && I > 1 ? llvm::CloneModule(*module) : std::move(module);
+             if (compileModule(Options::argv, Context, std::move(M)))
+                 return false;
+         }
 
          // if (RemarksFile)
          //     RemarksFile->keep();
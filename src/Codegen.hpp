@@ -2,7 +2,10 @@
 
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/ScopeExit.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/Analysis/TargetLibraryInfo.h"
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
 #include "llvm/CodeGen/CommandFlags.h"
 #include "llvm/CodeGen/LinkAllAsmWriterComponents.h"
 #include "llvm/CodeGen/LinkAllCodegenComponents.h"
@@ -22,10 +25,13 @@
 #include "llvm/IR/Verifier.h"
 #include "llvm/IRReader/IRReader.h"
 #include "llvm/InitializePasses.h"
+#include "llvm/MC/MCAsmInfo.h"
 #include "llvm/MC/MCTargetOptionsCommandFlags.h"
 #include "llvm/MC/SubtargetFeature.h"
 #include "llvm/MC/TargetRegistry.h"
 #include "llvm/Pass.h"
+#include "llvm/Passes/OptimizationLevel.h"
+#include "llvm/Passes/PassBuilder.h"
 #include "llvm/Remarks/HotnessThresholdParser.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
@@ -35,6 +41,7 @@
 // #include "llvm/Support/PluginLoader.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/TimeProfiler.h"
 #include "llvm/Support/ToolOutputFile.h"
 #include "llvm/Support/WithColor.h"
@@ -43,6 +50,7 @@
 #include "llvm/TargetParser/Host.h"
 #include "llvm/TargetParser/Triple.h"
 #include "llvm/Transforms/Utils/Cloning.h"
+#include "llvm/Transforms/Utils/SplitModule.h"
 
 #include <memory>
 #include <optional>
@@ -72,10 +80,11 @@ namespace lcc
             return _inst.get();
         }
 
-        bool run();
+        // compiles module, or the IR read back from Options::IRDumpPath when it is null
+        bool run(std::unique_ptr<llvm::Module> module = nullptr);
 
     private:
-        int compileModule(char **argv, llvm::LLVMContext &Context);
+        int compileModule(char **argv, llvm::LLVMContext &Context, std::unique_ptr<llvm::Module> InputModule);
 
         std::unique_ptr<llvm::ToolOutputFile> getOutputStream(const char *TargetName,
                                                               llvm::Triple::OSType OS,
@@ -85,5 +94,19 @@ namespace lcc
 
         bool addPass(llvm::PassManagerBase &PM, const char *argv0,
                      llvm::StringRef PassName, llvm::TargetPassConfig &TPC);
+
+        // the new pass manager's default module pipeline for Level, mem2reg, instcombine, GVN, LICM,
+        // inlining and the vectorizers among others, tuned by the target machine
+        void optimizeModule(llvm::Module &M, llvm::TargetMachine &TM, const llvm::TargetLibraryInfoImpl &TLII,
+                            llvm::OptimizationLevel Level);
+
+        // splits M into Options::CodegenThreads partitions, each compiled on a thread pool with its own
+        // context and target machine. The assembly of the partitions is appended to OS in partition order.
+        bool splitCodegen(llvm::Module &M, const llvm::TargetMachine &TM, const llvm::TargetLibraryInfoImpl &TLII,
+                          llvm::raw_pwrite_stream &OS);
+        // appends the assembly of a partition to OS, its private labels renamed apart from the other
+        // partitions' ones, which restart at the same numbers
+        static void appendPartition(llvm::StringRef Asm, unsigned Partition, const llvm::MCAsmInfo &MAI,
+                                    llvm::raw_ostream &OS);
     };
 }
\ No newline at end of file
@@ -0,0 +1,504 @@
+#include "lcc.hpp"
+#include <climits>
+
+namespace lcc
+{
+    std::unique_ptr<ConstEvaluator> ConstEvaluator::_inst;
+
+    namespace
+    {
+        // int arithmetic wraps around like the add/sub/mul the generators emit
+        int WrapAdd(int lhs, int rhs) { return static_cast<int>(static_cast<uint32_t>(lhs) + static_cast<uint32_t>(rhs)); }
+        int WrapSub(int lhs, int rhs) { return static_cast<int>(static_cast<uint32_t>(lhs) - static_cast<uint32_t>(rhs)); }
+        int WrapMul(int lhs, int rhs) { return static_cast<int>(static_cast<uint32_t>(lhs) * static_cast<uint32_t>(rhs)); }
+
+        // the operation a compound assignment applies before storing
+        AST::BinaryOpType CompoundOperation(AST::BinaryOpType op)
+        {
+            switch (op)
+            {
+            case AST::BinaryOpType::BO_MulAssign: return AST::BinaryOpType::BO_Mul;
+            case AST::BinaryOpType::BO_DivAssign: return AST::BinaryOpType::BO_Div;
+            case AST::BinaryOpType::BO_RemAssign: return AST::BinaryOpType::BO_Rem;
+            case AST::BinaryOpType::BO_AddAssign: return AST::BinaryOpType::BO_Add;
+            case AST::BinaryOpType::BO_SubAssign: return AST::BinaryOpType::BO_Sub;
+            case AST::BinaryOpType::BO_ShlAssign: return AST::BinaryOpType::BO_Shl;
+            case AST::BinaryOpType::BO_ShrAssign: return AST::BinaryOpType::BO_Shr;
+            case AST::BinaryOpType::BO_AndAssign: return AST::BinaryOpType::BO_And;
+            case AST::BinaryOpType::BO_XorAssign: return AST::BinaryOpType::BO_Xor;
+            case AST::BinaryOpType::BO_OrAssign: return AST::BinaryOpType::BO_Or;
+            default: return op;
+            }
+        }
+
+        // int, char and float, and arrays of them, are all a call can keep in its frame
+        bool IsScalar(const AST::Type *type)
+        {
+            return type->kind() == AST::Type::Kind::Char || type->kind() == AST::Type::Kind::Int || type->kind() == AST::Type::Kind::Float;
+        }
+    }
+
+    bool ConstEvaluator::foldBinary(AST::BinaryOpType op, const Constant &lhs, const Constant &rhs, Constant &result)
+    {
+        if (lhs.isFloat || rhs.isFloat)
+        {
+            float l = lhs.asFloat(), r = rhs.asFloat();
+            switch (op)
+            {
+            case AST::BinaryOpType::BO_Mul: result = Constant::makeFloat(l * r); return true;
+            case AST::BinaryOpType::BO_Div:
+                if (r == 0.0f)
+                    return false;
+                result = Constant::makeFloat(l / r);
+                return true;
+            case AST::BinaryOpType::BO_Add: result = Constant::makeFloat(l + r); return true;
+            case AST::BinaryOpType::BO_Sub: result = Constant::makeFloat(l - r); return true;
+            case AST::BinaryOpType::BO_LT: result = Constant::makeInt(l < r); return true;
+            case AST::BinaryOpType::BO_GT: result = Constant::makeInt(l > r); return true;
+            case AST::BinaryOpType::BO_LE: result = Constant::makeInt(l <= r); return true;
+            case AST::BinaryOpType::BO_GE: result = Constant::makeInt(l >= r); return true;
+            case AST::BinaryOpType::BO_EQ: result = Constant::makeInt(l == r); return true;
+            case AST::BinaryOpType::BO_NE: result = Constant::makeInt(l != r); return true;
+            case AST::BinaryOpType::BO_LAnd: result = Constant::makeInt(l != 0.0f && r != 0.0f); return true;
+            case AST::BinaryOpType::BO_LOr: result = Constant::makeInt(l != 0.0f || r != 0.0f); return true;
+            default:
+                return false;
+            }
+        }
+
+        int l = lhs.intValue, r = rhs.intValue;
+        switch (op)
+        {
+        case AST::BinaryOpType::BO_Mul: result = Constant::makeInt(WrapMul(l, r)); return true;
+        case AST::BinaryOpType::BO_Div:
+        case AST::BinaryOpType::BO_Rem:
+            if (r == 0 || (l == INT_MIN && r == -1))
+                return false;
+            result = Constant::makeInt(op == AST::BinaryOpType::BO_Div ? l / r : l % r);
+            return true;
+        case AST::BinaryOpType::BO_Add: result = Constant::makeInt(WrapAdd(l, r)); return true;
+        case AST::BinaryOpType::BO_Sub: result = Constant::makeInt(WrapSub(l, r)); return true;
+        case AST::BinaryOpType::BO_Shl:
+        case AST::BinaryOpType::BO_Shr:
+            if (r < 0 || r > 31)
+                return false;
+            result = Constant::makeInt(op == AST::BinaryOpType::BO_Shl ? static_cast<int>(static_cast<uint32_t>(l) << r) : l >> r);
+            return true;
+        case AST::BinaryOpType::BO_LT: result = Constant::makeInt(l < r); return true;
+        case AST::BinaryOpType::BO_GT: result = Constant::makeInt(l > r); return true;
+        case AST::BinaryOpType::BO_LE: result = Constant::makeInt(l <= r); return true;
+        case AST::BinaryOpType::BO_GE: result = Constant::makeInt(l >= r); return true;
+        case AST::BinaryOpType::BO_EQ: result = Constant::makeInt(l == r); return true;
+        case AST::BinaryOpType::BO_NE: result = Constant::makeInt(l != r); return true;
+        case AST::BinaryOpType::BO_And: result = Constant::makeInt(l & r); return true;
+        case AST::BinaryOpType::BO_Xor: result = Constant::makeInt(l ^ r); return true;
+        case AST::BinaryOpType::BO_Or: result = Constant::makeInt(l | r); return true;
+        case AST::BinaryOpType::BO_LAnd: result = Constant::makeInt(l && r); return true;
+        case AST::BinaryOpType::BO_LOr: result = Constant::makeInt(l || r); return true;
+        default:
+            return false;
+        }
+    }
+
+    bool ConstEvaluator::foldUnary(AST::UnaryOpType op, const Constant &body, Constant &result)
+    {
+        switch (op)
+        {
+        case AST::UnaryOpType::UO_Plus:
+            result = body;
+            return true;
+        case AST::UnaryOpType::UO_Minus:
+            result = body.isFloat ? Constant::makeFloat(-body.floatValue) : Constant::makeInt(WrapSub(0, body.intValue));
+            return true;
+        case AST::UnaryOpType::UO_Not:
+            if (body.isFloat)
+                return false;
+            result = Constant::makeInt(~body.intValue);
+            return true;
+        case AST::UnaryOpType::UO_LNot:
+            result = Constant::makeInt(!body.isTrue());
+            return true;
+        default: // increments and decrements need an lvalue
+            return false;
+        }
+    }
+
+    bool ConstEvaluator::convert(const Constant &value, const AST::Type *type, Constant &result)
+    {
+        if (type->kind() == AST::Type::Kind::Float)
+        {
+            result = Constant::makeFloat(value.asFloat());
+            return true;
+        }
+
+        int intValue = value.intValue;
+        if (value.isFloat)
+        {
+            if (!(value.floatValue > -2147483904.0f && value.floatValue < 2147483648.0f)) // also rejects NaN
+                return false;
+            intValue = static_cast<int>(value.floatValue);
+        }
+
+        switch (type->kind())
+        {
+        case AST::Type::Kind::Int:
+            result = Constant::makeInt(intValue);
+            return true;
+        case AST::Type::Kind::Char:
+            result = Constant::makeInt(static_cast<signed char>(intValue));
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    void ConstEvaluator::reset(AST::ASTNode *astRoot)
+    {
+        _definitions.clear();
+        if (astRoot->kind() != AST::ASTNode::Kind::TranslationUnitDecl)
+            return;
+
+        for (auto &decl : static_cast<AST::TranslationUnitDecl *>(astRoot)->_decls)
+        {
+            if (decl->kind() != AST::ASTNode::Kind::FunctionDecl)
+                continue;
+
+            auto functionDecl = static_cast<const AST::FunctionDecl *>(decl.get());
+            if (functionDecl->_body != nullptr)
+                _definitions[functionDecl->name()] = functionDecl;
+        }
+    }
+
+    bool ConstEvaluator::evaluate(const AST::CallExpr *callExpr, Constant &result)
+    {
+        if (Options::CTFEStepLimit == 0)
+            return false;
+
+        _frames.clear();
+        _isReturning = false;
+        _numSteps = 0;
+        if (!gen(const_cast<AST::CallExpr *>(callExpr))) // only the frames of the evaluation are written
+            return false;
+
+        result = _retVal;
+        return true;
+    }
+
+    bool ConstEvaluator::gen(AST::TranslationUnitDecl *translationUnitDecl)
+    {
+        return false;
+    }
+
+    bool ConstEvaluator::gen(AST::FunctionDecl *functionDecl)
+    {
+        return false;
+    }
+
+    bool ConstEvaluator::gen(AST::VarDecl *varDecl)
+    {
+        const AST::Type *type = varDecl->type();
+        Slot slot{type, {}};
+        if (IsScalar(type))
+            slot.values.resize(1);
+        else if (type->isArray() && IsScalar(type->elementType()))
+            slot.values.resize(type->length());
+        else
+            return false;
+
+        if (varDecl->_isInitialized)
+        {
+            if (type->isArray() || !visit(varDecl->_value) || !convert(_retVal, type, _retVal))
+                return false;
+            slot.values[0] = _retVal;
+        }
+
+        _frames.back()[varDecl] = std::move(slot); // a declaration in a loop starts over each iteration
+        return true;
+    }
+
+    bool ConstEvaluator::gen(AST::IntegerLiteral *integerLiteral)
+    {
+        _retVal = Constant::makeInt(integerLiteral->value());
+        return true;
+    }
+
+    bool ConstEvaluator::gen(AST::FloatingLiteral *floatingLiteral)
+    {
+        _retVal = Constant::makeFloat(floatingLiteral->value());
+        return true;
+    }
+
+    bool ConstEvaluator::gen(AST::CharacterLiteral *charLiteral)
+    {
+        _retVal = Constant::makeInt(charLiteral->value());
+        return true;
+    }
+
+    bool ConstEvaluator::gen(AST::StringLiteral *strLiteral)
+    {
+        return false;
+    }
+
+    bool ConstEvaluator::gen(AST::DeclRefExpr *declRefExpr)
+    {
+        auto value = lvalue(declRefExpr);
+        if (value == nullptr || !value->has_value())
+            return false;
+
+        _retVal = **value;
+        return true;
+    }
+
+    bool ConstEvaluator::gen(AST::CastExpr *castExpr)
+    {
+        return visit(castExpr->_subExpr);
+    }
+
+    bool ConstEvaluator::gen(AST::BinaryOperator *binaryOperator)
+    {
+        AST::BinaryOpType op = binaryOperator->type();
+        if (binaryOperator->isAssignment())
+        {
+            if (!visit(binaryOperator->_rhs))
+                return false;
+
+            Constant value = _retVal;
+            auto target = lvalue(binaryOperator->_lhs.get()); // after the rhs, a call in it may grow _frames
+            if (target == nullptr)
+                return false;
+
+            if (op != AST::BinaryOpType::BO_Assign)
+            {
+                if (!target->has_value() || !foldBinary(CompoundOperation(op), **target, value, value))
+                    return false;
+            }
+
+            if (!convert(value, binaryOperator->_lhs->_exprType, value))
+                return false;
+
+            *target = value;
+            _retVal = value;
+            return true;
+        }
+
+        if (!visit(binaryOperator->_lhs))
+            return false;
+
+        // && and || don't evaluate their rhs once the lhs decides
+        if (op == AST::BinaryOpType::BO_LAnd || op == AST::BinaryOpType::BO_LOr)
+        {
+            bool lhsValue = _retVal.isTrue();
+            if (lhsValue == (op == AST::BinaryOpType::BO_LOr))
+            {
+                _retVal = Constant::makeInt(lhsValue);
+                return true;
+            }
+
+            if (!visit(binaryOperator->_rhs))
+                return false;
+            _retVal = Constant::makeInt(_retVal.isTrue());
+            return true;
+        }
+
+        Constant lhs = _retVal;
+        if (!visit(binaryOperator->_rhs))
+            return false;
+
+        return foldBinary(op, lhs, _retVal, _retVal);
+    }
+
+    bool ConstEvaluator::gen(AST::UnaryOperator *unaryOperator)
+    {
+        AST::UnaryOpType op = unaryOperator->type();
+        bool isIncrement = op == AST::UnaryOpType::UO_PreInc || op == AST::UnaryOpType::UO_PostInc;
+        bool isDecrement = op == AST::UnaryOpType::UO_PreDec || op == AST::UnaryOpType::UO_PostDec;
+        if (isIncrement || isDecrement)
+        {
+            auto target = lvalue(unaryOperator->_body.get());
+            if (target == nullptr || !target->has_value())
+                return false;
+
+            Constant oldValue = **target, newValue;
+            if (!foldBinary(isIncrement ? AST::BinaryOpType::BO_Add : AST::BinaryOpType::BO_Sub, oldValue, Constant::makeInt(1), newValue) ||
+                !convert(newValue, unaryOperator->_body->_exprType, newValue))
+                return false;
+
+            *target = newValue;
+            _retVal = op == AST::UnaryOpType::UO_PreInc || op == AST::UnaryOpType::UO_PreDec ? newValue : oldValue;
+            return true;
+        }
+
+        if (!visit(unaryOperator->_body) || !foldUnary(op, _retVal, _retVal))
+            return false;
+
+        return convert(_retVal, unaryOperator->_exprType, _retVal);
+    }
+
+    bool ConstEvaluator::gen(AST::ParenExpr *parenExpr)
+    {
+        return visit(parenExpr->_subExpr);
+    }
+
+    bool ConstEvaluator::gen(AST::CompoundStmt *compoundStmt)
+    {
+        for (auto &stmt : compoundStmt->_body)
+        {
+            if (!visit(stmt))
+                return false;
+
+            if (_isReturning)
+                break;
+        }
+
+        return true;
+    }
+
+    bool ConstEvaluator::gen(AST::DeclStmt *declStmt)
+    {
+        if (!step())
+            return false;
+
+        for (auto &decl : declStmt->_decls)
+        {
+            if (!visit(decl))
+                return false;
+        }
+
+        return true;
+    }
+
+    bool ConstEvaluator::gen(AST::IfStmt *ifStmt)
+    {
+        if (!step() || !visit(ifStmt->_condition))
+            return false;
+
+        if (_retVal.isTrue())
+            return visit(ifStmt->_body);
+
+        return ifStmt->_elseBody == nullptr || visit(ifStmt->_elseBody);
+    }
+
+    bool ConstEvaluator::gen(AST::ValueStmt *valueStmt)
+    {
+        return step() && visit(valueStmt->_expr);
+    }
+
+    bool ConstEvaluator::gen(AST::ReturnStmt *returnStmt)
+    {
+        if (!step() || returnStmt->_value == nullptr || !visit(returnStmt->_value))
+            return false;
+
+        _isReturning = true;
+        return true;
+    }
+
+    bool ConstEvaluator::gen(AST::WhileStmt *whileStmt)
+    {
+        while (true)
+        {
+            if (!step() || !visit(whileStmt->_condition))
+                return false;
+
+            if (!_retVal.isTrue())
+                return true;
+
+            if (!visit(whileStmt->_body))
+                return false;
+
+            if (_isReturning)
+                return true;
+        }
+    }
+
+    bool ConstEvaluator::gen(AST::CallExpr *callExpr)
+    {
+        auto it = _definitions.find(callExpr->_functionExpr->name());
+        if (it == _definitions.end()) // extern, may have side effects
+            return false;
+
+        std::vector<Constant> args;
+        for (auto &param : callExpr->_params)
+        {
+            if (!visit(param))
+                return false;
+            args.push_back(_retVal);
+        }
+
+        return call(it->second, args);
+    }
+
+    bool ConstEvaluator::gen(AST::NullStmt *nullStmt)
+    {
+        return step();
+    }
+
+    bool ConstEvaluator::gen(AST::AsmStmt *asmStmt)
+    {
+        return false;
+    }
+
+    bool ConstEvaluator::gen(AST::ArraySubscriptExpr *arraySubscriptExpr)
+    {
+        auto value = lvalue(arraySubscriptExpr);
+        if (value == nullptr || !value->has_value())
+            return false;
+
+        _retVal = **value;
+        return true;
+    }
+
+    bool ConstEvaluator::call(const AST::FunctionDecl *functionDecl, const std::vector<Constant> &args)
+    {
+        if (_frames.size() >= Options::CTFEDepthLimit || !step() || !IsScalar(functionDecl->_type))
+            return false;
+
+        Frame frame;
+        for (size_t i = 0; i < args.size(); i++)
+        {
+            const AST::ParmVarDecl *param = functionDecl->_params[i].get();
+            Constant value;
+            if (!IsScalar(param->type()) || !convert(args[i], param->type(), value))
+                return false;
+            frame[param] = Slot{param->type(), {value}};
+        }
+
+        _frames.push_back(std::move(frame));
+        bool result = visit(functionDecl->_body) && _isReturning; // falling off the end returns garbage
+        _frames.pop_back();
+        _isReturning = false;
+
+        return result && convert(_retVal, functionDecl->_type, _retVal);
+    }
+
+    std::optional<Constant> *ConstEvaluator::lvalue(AST::Expr *expr)
+    {
+        if (_frames.empty() || (expr->kind() != AST::ASTNode::Kind::DeclRefExpr && expr->kind() != AST::ASTNode::Kind::ArraySubscriptExpr))
+            return nullptr;
+
+        int index = 0;
+        if (expr->kind() == AST::ASTNode::Kind::ArraySubscriptExpr)
+        {
+            auto arraySubscriptExpr = static_cast<AST::ArraySubscriptExpr *>(expr);
+            if (!visit(arraySubscriptExpr->_rhs) || _retVal.isFloat)
+                return nullptr;
+            index = _retVal.intValue;
+        }
+
+        Frame &frame = _frames.back();
+        auto it = frame.find(static_cast<AST::DeclRefExpr *>(expr)->decl());
+        if (it == frame.end()) // a global, its value at run time is unknown
+            return nullptr;
+
+        Slot &slot = it->second;
+        bool isSubscript = expr->kind() == AST::ASTNode::Kind::ArraySubscriptExpr;
+        if (isSubscript != slot.type->isArray() || index < 0 || static_cast<size_t>(index) >= slot.values.size())
+            return nullptr;
+
+        return &slot.values[index];
+    }
+
+    bool ConstEvaluator::step()
+    {
+        return ++_numSteps <= Options::CTFEStepLimit;
+    }
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "AST.hpp"
+#include "ASTVisitor.hpp"
+
+namespace lcc
+{
+    // A value computed at compile time, chars take part in arithmetic as ints
+    struct Constant
+    {
+        bool isFloat;
+        int intValue;
+        float floatValue;
+
+        static Constant makeInt(int value) { return {false, value, 0.0f}; };
+        static Constant makeFloat(float value) { return {true, 0, value}; };
+
+        float asFloat() const { return isFloat ? floatValue : static_cast<float>(intValue); };
+        bool isTrue() const { return isFloat ? floatValue != 0.0f : intValue != 0; };
+    };
+
+    // Compile time function evaluation(ConstEvaluator.cpp). An interpreter over the AST that runs a
+    // call with literal arguments to completion. Anything it can't prove has no effect outside the
+    // call, like touching a global, inline asm or calling an extern function, makes the evaluation
+    // fail, so does hitting the step or recursion limit.
+    class ConstEvaluator : public AST::ASTVisitor<ConstEvaluator>
+    {
+        // storage of a local variable, a scalar is an array of length 1
+        typedef struct _Slot
+        {
+            const AST::Type *type;
+            std::vector<std::optional<Constant>> values; // nullopt until assigned
+        } Slot;
+
+        typedef std::unordered_map<const AST::Decl *, Slot> Frame;
+
+    private:
+        ConstEvaluator() = default;
+        ConstEvaluator(const ConstEvaluator &) = delete;
+        ConstEvaluator &operator=(const ConstEvaluator &) = delete;
+
+    public:
+        static ConstEvaluator *getInstance()
+        {
+            if (_inst.get() == nullptr)
+                _inst.reset(new ConstEvaluator);
+
+            return _inst.get();
+        }
+
+    private:
+        static std::unique_ptr<ConstEvaluator> _inst;
+
+    public:
+        // arithmetic shared with ExprFolder, false if the operation can't be evaluated at compile time
+        static bool foldBinary(AST::BinaryOpType op, const Constant &lhs, const Constant &rhs, Constant &result);
+        static bool foldUnary(AST::UnaryOpType op, const Constant &body, Constant &result);
+        // converts value as a store to a variable of type does, false if it is out of range
+        static bool convert(const Constant &value, const AST::Type *type, Constant &result);
+
+        // collects the function definitions of the translation unit rooted at astRoot
+        void reset(AST::ASTNode *astRoot);
+        // evaluates callExpr, whose arguments must be literals already
+        bool evaluate(const AST::CallExpr *callExpr, Constant &result);
+
+        bool gen(AST::TranslationUnitDecl *translationUnitDecl);
+        bool gen(AST::FunctionDecl *functionDecl);
+        bool gen(AST::VarDecl *varDecl);
+        bool gen(AST::IntegerLiteral *integerLiteral);
+        bool gen(AST::FloatingLiteral *floatingLiteral);
+        bool gen(AST::CharacterLiteral *charLiteral);
+        bool gen(AST::StringLiteral *strLiteral);
+        bool gen(AST::DeclRefExpr *declRefExpr);
+        bool gen(AST::CastExpr *castExpr);
+        bool gen(AST::BinaryOperator *binaryOperator);
+        bool gen(AST::UnaryOperator *unaryOperator);
+        bool gen(AST::ParenExpr *parenExpr);
+        bool gen(AST::CompoundStmt *compoundStmt);
+        bool gen(AST::DeclStmt *declStmt);
+        bool gen(AST::IfStmt *ifStmt);
+        bool gen(AST::ValueStmt *valueStmt);
+        bool gen(AST::ReturnStmt *returnStmt);
+        bool gen(AST::WhileStmt *whileStmt);
+        bool gen(AST::CallExpr *callExpr);
+        bool gen(AST::NullStmt *nullStmt);
+        bool gen(AST::AsmStmt *asmStmt);
+        bool gen(AST::ArraySubscriptExpr *arraySubscriptExpr);
+
+    private:
+        bool call(const AST::FunctionDecl *functionDecl, const std::vector<Constant> &args);
+        // the storage an lvalue expression designates, nullptr if it isn't a local of this call
+        std::optional<Constant> *lvalue(AST::Expr *expr);
+        bool step();
+
+    private:
+        std::map<std::string, const AST::FunctionDecl *> _definitions;
+        std::vector<Frame> _frames;
+        Constant _retVal{};
+        bool _isReturning{false};
+        unsigned int _numSteps{0};
+    };
+}
@@ -0,0 +1,260 @@
+#include "lcc.hpp"
+#include <algorithm>
+
+namespace lcc
+{
+    std::unique_ptr<DeadCodeEliminator> DeadCodeEliminator::_inst;
+
+    namespace
+    {
+        // false if condition is not a literal, otherwise value tells whether it holds
+        bool GetConstantCondition(const AST::Expr *condition, bool &value)
+        {
+            switch (condition->kind())
+            {
+            case AST::ASTNode::Kind::IntegerLiteral:
+                value = static_cast<const AST::IntegerLiteral *>(condition)->value() != 0;
+                return true;
+            case AST::ASTNode::Kind::CharacterLiteral:
+                value = static_cast<const AST::CharacterLiteral *>(condition)->value() != 0;
+                return true;
+            case AST::ASTNode::Kind::FloatingLiteral:
+                value = static_cast<const AST::FloatingLiteral *>(condition)->value() != 0.0f;
+                return true;
+            default:
+                return false;
+            }
+        }
+    }
+
+    size_t DeadCodeEliminator::run(AST::ASTNode *astRoot)
+    {
+        _numRemoved = 0;
+        _currentFunction.clear();
+        _callGraph.clear();
+        visit(astRoot);
+        return _numRemoved;
+    }
+
+    void DeadCodeEliminator::gen(AST::TranslationUnitDecl *translationUnitDecl)
+    {
+        // bodies are pruned first, so calls from dead code don't keep their callee alive
+        for (auto &decl : translationUnitDecl->_decls)
+            visit(decl);
+
+        auto reachable = reachableFunctions(translationUnitDecl);
+        auto &decls = translationUnitDecl->_decls;
+        auto end = std::remove_if(decls.begin(), decls.end(), [&reachable](const std::unique_ptr<AST::Decl> &decl)
+                                  { return decl->kind() == AST::ASTNode::Kind::FunctionDecl &&
+                                           !reachable.count(static_cast<const AST::FunctionDecl *>(decl.get())->name()); });
+        _numRemoved += decls.end() - end;
+        decls.erase(end, decls.end());
+    }
+
+    void DeadCodeEliminator::gen(AST::FunctionDecl *functionDecl)
+    {
+        if (functionDecl->_body == nullptr)
+            return;
+
+        _currentFunction = functionDecl->name();
+        pruneBody(functionDecl->_body);
+        _currentFunction.clear();
+    }
+
+    void DeadCodeEliminator::gen(AST::VarDecl *varDecl)
+    {
+        if (varDecl->_isInitialized)
+            visit(varDecl->_value);
+    }
+
+    void DeadCodeEliminator::gen(AST::CastExpr *castExpr)
+    {
+        visit(castExpr->_subExpr);
+    }
+
+    void DeadCodeEliminator::gen(AST::BinaryOperator *binaryOperator)
+    {
+        visit(binaryOperator->_lhs);
+        visit(binaryOperator->_rhs);
+    }
+
+    void DeadCodeEliminator::gen(AST::UnaryOperator *unaryOperator)
+    {
+        visit(unaryOperator->_body);
+    }
+
+    void DeadCodeEliminator::gen(AST::ParenExpr *parenExpr)
+    {
+        visit(parenExpr->_subExpr);
+    }
+
+    void DeadCodeEliminator::gen(AST::CompoundStmt *compoundStmt)
+    {
+        auto &body = compoundStmt->_body;
+        for (auto it = body.begin(); it != body.end(); ++it)
+        {
+            prune(*it);
+            if (*it != nullptr && neverFallsThrough(it->get()))
+            {
+                _numRemoved += body.end() - (it + 1);
+                body.erase(it + 1, body.end());
+                break;
+            }
+        }
+
+        body.erase(std::remove(body.begin(), body.end(), nullptr), body.end());
+    }
+
+    void DeadCodeEliminator::gen(AST::DeclStmt *declStmt)
+    {
+        for (auto &decl : declStmt->_decls)
+            visit(decl);
+    }
+
+    void DeadCodeEliminator::gen(AST::IfStmt *ifStmt)
+    {
+        visit(ifStmt->_condition);
+        pruneBody(ifStmt->_body);
+        if (ifStmt->_elseBody != nullptr)
+            pruneBody(ifStmt->_elseBody);
+    }
+
+    void DeadCodeEliminator::gen(AST::ValueStmt *valueStmt)
+    {
+        visit(valueStmt->_expr);
+    }
+
+    void DeadCodeEliminator::gen(AST::ReturnStmt *returnStmt)
+    {
+        if (returnStmt->_value != nullptr)
+            visit(returnStmt->_value);
+    }
+
+    void DeadCodeEliminator::gen(AST::WhileStmt *whileStmt)
+    {
+        visit(whileStmt->_condition);
+        pruneBody(whileStmt->_body);
+    }
+
+    void DeadCodeEliminator::gen(AST::CallExpr *callExpr)
+    {
+        _callGraph[_currentFunction].insert(callExpr->_functionExpr->name());
+        for (auto &param : callExpr->_params)
+            visit(param);
+    }
+
+    void DeadCodeEliminator::gen(AST::AsmStmt *asmStmt)
+    {
+        for (auto &constraint : asmStmt->_outputConstraints)
+            visit(constraint.second);
+
+        for (auto &constraint : asmStmt->_inputConstraints)
+            visit(constraint.second);
+    }
+
+    void DeadCodeEliminator::gen(AST::ArraySubscriptExpr *arraySubscriptExpr)
+    {
+        visit(arraySubscriptExpr->_rhs);
+    }
+
+    void DeadCodeEliminator::prune(std::unique_ptr<AST::Stmt> &stmt)
+    {
+        bool condition = false;
+        if (stmt->kind() == AST::ASTNode::Kind::IfStmt)
+        {
+            auto ifStmt = static_cast<AST::IfStmt *>(stmt.get());
+            if (GetConstantCondition(ifStmt->_condition.get(), condition))
+            {
+                _numRemoved++;
+                std::unique_ptr<AST::Stmt> taken = condition ? std::move(ifStmt->_body) : std::move(ifStmt->_elseBody);
+                stmt = std::move(taken);
+                if (stmt != nullptr)
+                    prune(stmt);
+                return;
+            }
+        }
+        else if (stmt->kind() == AST::ASTNode::Kind::WhileStmt)
+        {
+            auto whileStmt = static_cast<AST::WhileStmt *>(stmt.get());
+            if (GetConstantCondition(whileStmt->_condition.get(), condition) && !condition)
+            {
+                _numRemoved++;
+                stmt = nullptr;
+                return;
+            }
+        }
+
+        visit(stmt);
+    }
+
+    void DeadCodeEliminator::pruneBody(std::unique_ptr<AST::Stmt> &stmt)
+    {
+        prune(stmt);
+        if (stmt == nullptr)
+            stmt = std::make_unique<AST::NullStmt>();
+    }
+
+    bool DeadCodeEliminator::neverFallsThrough(const AST::Stmt *stmt) const
+    {
+        bool condition = false;
+        switch (stmt->kind())
+        {
+        case AST::ASTNode::Kind::ReturnStmt:
+            return true;
+        case AST::ASTNode::Kind::CompoundStmt:
+        {
+            // pruned already, so only the last statement can end the block
+            auto &body = static_cast<const AST::CompoundStmt *>(stmt)->_body;
+            return !body.empty() && body.back() != nullptr && neverFallsThrough(body.back().get());
+        }
+        case AST::ASTNode::Kind::IfStmt:
+        {
+            auto ifStmt = static_cast<const AST::IfStmt *>(stmt);
+            return ifStmt->_elseBody != nullptr && neverFallsThrough(ifStmt->_body.get()) && neverFallsThrough(ifStmt->_elseBody.get());
+        }
+        case AST::ASTNode::Kind::WhileStmt:
+            // there is no break, a loop on a true constant only ends by returning
+            return GetConstantCondition(static_cast<const AST::WhileStmt *>(stmt)->_condition.get(), condition) && condition;
+        default:
+            return false;
+        }
+    }
+
+    std::set<std::string> DeadCodeEliminator::reachableFunctions(const AST::TranslationUnitDecl *translationUnitDecl) const
+    {
+        // a program is rooted at main, without one every defined function may be called from outside
+        std::vector<std::string> worklist;
+        bool hasMain = false;
+        for (auto &decl : translationUnitDecl->_decls)
+        {
+            if (decl->kind() != AST::ASTNode::Kind::FunctionDecl)
+                continue;
+
+            auto functionDecl = static_cast<const AST::FunctionDecl *>(decl.get());
+            if (functionDecl->_body == nullptr)
+                continue;
+
+            worklist.push_back(functionDecl->name());
+            hasMain |= functionDecl->name() == "main";
+        }
+
+        if (hasMain && !Options::ExportAllFunctions)
+            worklist = {"main"};
+        worklist.push_back(""); // calls in global initializers
+
+        std::set<std::string> reachable;
+        while (!worklist.empty())
+        {
+            std::string name = worklist.back();
+            worklist.pop_back();
+            if (!reachable.insert(name).second)
+                continue;
+
+            auto it = _callGraph.find(name);
+            if (it != _callGraph.end())
+                worklist.insert(worklist.end(), it->second.begin(), it->second.end());
+        }
+
+        return reachable;
+    }
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+
+#include "AST.hpp"
+#include "ASTVisitor.hpp"
+
+namespace lcc
+{
+    // Dead code elimination on the AST(DeadCodeEliminator.cpp), runs after ExprFolder so constant
+    // conditions are already literals. Statements that can never execute are pruned from function
+    // bodies, then functions that are not reachable in the call graph rooted at main are removed
+    // from the translation unit.
+    class DeadCodeEliminator : public AST::ASTVisitor<DeadCodeEliminator, void>
+    {
+    private:
+        DeadCodeEliminator() = default;
+        DeadCodeEliminator(const DeadCodeEliminator &) = delete;
+        DeadCodeEliminator &operator=(const DeadCodeEliminator &) = delete;
+
+    public:
+        static DeadCodeEliminator *getInstance()
+        {
+            if (_inst.get() == nullptr)
+                _inst.reset(new DeadCodeEliminator);
+
+            return _inst.get();
+        }
+
+    private:
+        static std::unique_ptr<DeadCodeEliminator> _inst;
+
+    public:
+        // returns the number of statements and function declarations that have been removed
+        size_t run(AST::ASTNode *astRoot);
+
+        void gen(AST::TranslationUnitDecl *translationUnitDecl);
+        void gen(AST::FunctionDecl *functionDecl);
+        void gen(AST::VarDecl *varDecl);
+        void gen(AST::IntegerLiteral *integerLiteral){};
+        void gen(AST::FloatingLiteral *floatingLiteral){};
+        void gen(AST::CharacterLiteral *charLiteral){};
+        void gen(AST::StringLiteral *strLiteral){};
+        void gen(AST::DeclRefExpr *declRefExpr){};
+        void gen(AST::CastExpr *castExpr);
+        void gen(AST::BinaryOperator *binaryOperator);
+        void gen(AST::UnaryOperator *unaryOperator);
+        void gen(AST::ParenExpr *parenExpr);
+        void gen(AST::CompoundStmt *compoundStmt);
+        void gen(AST::DeclStmt *declStmt);
+        void gen(AST::IfStmt *ifStmt);
+        void gen(AST::ValueStmt *valueStmt);
+        void gen(AST::ReturnStmt *returnStmt);
+        void gen(AST::WhileStmt *whileStmt);
+        void gen(AST::CallExpr *callExpr);
+        void gen(AST::NullStmt *nullStmt){};
+        void gen(AST::AsmStmt *asmStmt);
+        void gen(AST::ArraySubscriptExpr *arraySubscriptExpr);
+
+    private:
+        // replaces an if or while with a constant condition by the code that actually runs, which
+        // may be nothing at all, then prunes what is left of stmt
+        void prune(std::unique_ptr<AST::Stmt> &stmt);
+        // as prune, but keeps a NullStmt where a statement is required
+        void pruneBody(std::unique_ptr<AST::Stmt> &stmt);
+        // true if control never reaches the statement following stmt
+        bool neverFallsThrough(const AST::Stmt *stmt) const;
+        std::set<std::string> reachableFunctions(const AST::TranslationUnitDecl *translationUnitDecl) const;
+
+    private:
+        size_t _numRemoved{0};
+        std::string _currentFunction; // empty while visiting global declarations
+        std::map<std::string, std::set<std::string>> _callGraph; // caller -> callees
+    };
+}
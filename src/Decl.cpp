@@ -4,87 +4,84 @@ namespace lcc
 {
     namespace AST
     {
-        json TranslationUnitDecl::asJson() const
+        TranslationUnitDecl::~TranslationUnitDecl()
         {
-            json j;
-            j["type"] = "TranslationUnitDecl";
-            j["children"] = json::array();
-            for (const auto &decl : _decls)
-                j["children"].emplace_back(decl->asJson());
-            return j;
+            destroyLater(_decls);
         }
 
-        json NamedDecl::asJson() const
+        VarDecl::~VarDecl()
         {
-            json j;
-            j["type"] = "NamedDecl";
-            j["name"] = _name;
-            return j;
+            destroyLater(std::move(_value));
         }
 
-        json VarDecl::asJson() const
+        FunctionDecl::~FunctionDecl()
         {
-            json j;
-            j["type"] = "VarDecl";
-            j["valueType"] = _type;
-            j["name"] = _name;
+            destroyLater(_params);
+            destroyLater(std::move(_body));
+        }
+
+        void TranslationUnitDecl::dump(DumpWriter &writer) const
+        {
+            writer.beginObject();
+            writer.writeString("type", "TranslationUnitDecl");
+            dumpChildren(writer, "children", _decls);
+            writer.endObject();
+        }
+
+        void NamedDecl::dump(DumpWriter &writer) const
+        {
+            writer.beginObject();
+            writer.writeString("type", "NamedDecl");
+            writer.writeString("name", _name);
+            writer.endObject();
+        }
+
+        void VarDecl::dump(DumpWriter &writer) const
+        {
+            writer.beginObject();
+            writer.writeString("type", "VarDecl");
+            writer.writeString("valueType", _type->name());
+            writer.writeString("name", _name);
             if (_isInitialized)
-                j["init"] = json::array({_value->asJson()});
+                dumpChild(writer, "init", _value.get());
             else
-                j["init"] = false;
-            return j;
+                writer.writeBool("init", false);
+            writer.endObject();
         }
 
-        json ParmVarDecl::asJson() const
+        void ParmVarDecl::dump(DumpWriter &writer) const
         {
-            json j;
-            j["type"] = "ParmVarDecl";
-            j["name"] = _name;
-            return j;
+            writer.beginObject();
+            writer.writeString("type", "ParmVarDecl");
+            writer.writeString("name", _name);
+            writer.endObject();
         }
 
-        json FunctionDecl::asJson() const
+        void FunctionDecl::dump(DumpWriter &writer) const
         {
-            json j;
-            j["type"] = "FunctionDecl";
+            writer.beginObject();
+            writer.writeString("type", "FunctionDecl");
             std::string functionType;
-            functionType += _type; // ret value type
+            functionType += _type->name(); // ret value type
             functionType += '(';
             bool isBegin = true;
             for (const auto &param : _params)
             {
                 if (!isBegin)
                     functionType += ", ";
-                functionType += param->type();
+                functionType += param->type()->name();
                 isBegin = false;
             }
             functionType += ')';
-            j["functionType"] = functionType;
-            j["name"] = name();
-            j["params"] = json::array();
-            for (const auto &param : _params)
-                j["params"].emplace_back(param->asJson());
+            writer.writeString("functionType", functionType);
+            writer.writeString("name", _name);
+            dumpChildren(writer, "params", _params);
             if (_body != nullptr)
-                j["body"] = json::array({_body->asJson()});
+                dumpChild(writer, "body", _body.get());
             else
-                j["body"] = "empty";
-            j["extern"] = (_isExtern ? "true" : "false");
-            return j;
-        }
-
-        bool TranslationUnitDecl::gen(lcc::IRGeneratorBase* generator)
-        {
-            return generator->gen(this);
-        }
-
-        bool VarDecl::gen(lcc::IRGeneratorBase* generator)
-        {
-            return generator->gen(this);
-        }
-
-        bool FunctionDecl::gen(lcc::IRGeneratorBase* generator)
-        {
-            return generator->gen(this);
+                writer.writeString("body", "empty");
+            writer.writeString("extern", _isExtern ? "true" : "false");
+            writer.endObject();
         }
     }
 }
\ No newline at end of file
@@ -0,0 +1,228 @@
+#include "lcc.hpp"
+#include <algorithm>
+
+namespace lcc
+{
+    std::unique_ptr<DumpWriter> DumpWriter::open(const std::string &outPath, Format format)
+    {
+        std::ofstream ofs(outPath, std::ios::binary);
+        if (!ofs)
+        {
+            FATAL_ERROR("Failed to open dump file " << outPath);
+            return nullptr;
+        }
+
+        switch (format)
+        {
+        case Format::JSON:
+            return std::make_unique<JsonDumpWriter>(std::move(ofs));
+        case Format::CBOR:
+            return std::make_unique<CborDumpWriter>(std::move(ofs));
+        }
+
+        return nullptr;
+    }
+
+    JsonDumpWriter::~JsonDumpWriter()
+    {
+        _ofs << '\n';
+    }
+
+    // separator and indentation before a value, values after a key go on the key's line
+    void JsonDumpWriter::beginValue()
+    {
+        if (_isAfterKey)
+        {
+            _isAfterKey = false;
+            return;
+        }
+
+        if (_numElements.empty())
+            return;
+
+        _ofs << (_numElements.back()++ == 0 ? "\n" : ",\n");
+        writeIndent();
+    }
+
+    void JsonDumpWriter::endContainer(char close)
+    {
+        bool isEmpty = _numElements.back() == 0;
+        _numElements.pop_back();
+        if (!isEmpty)
+        {
+            _ofs << '\n';
+            writeIndent();
+        }
+        _ofs << close;
+    }
+
+    // two spaces per open container, written in chunks since deep ASTs are mostly indentation
+    void JsonDumpWriter::writeIndent()
+    {
+        static const std::string spaces(256, ' ');
+
+        size_t width = _numElements.size() * 2;
+        while (width > 0)
+        {
+            size_t chunk = std::min(width, spaces.size());
+            _ofs.write(spaces.data(), chunk);
+            width -= chunk;
+        }
+    }
+
+    void JsonDumpWriter::beginObject()
+    {
+        beginValue();
+        _ofs << '{';
+        _numElements.push_back(0);
+    }
+
+    void JsonDumpWriter::endObject()
+    {
+        endContainer('}');
+    }
+
+    void JsonDumpWriter::beginArray()
+    {
+        beginValue();
+        _ofs << '[';
+        _numElements.push_back(0);
+    }
+
+    void JsonDumpWriter::endArray()
+    {
+        endContainer(']');
+    }
+
+    void JsonDumpWriter::writeKey(std::string_view key)
+    {
+        beginValue();
+        writeEscaped(key);
+        _ofs << ": ";
+        _isAfterKey = true;
+    }
+
+    void JsonDumpWriter::writeString(std::string_view value)
+    {
+        beginValue();
+        writeEscaped(value);
+    }
+
+    void JsonDumpWriter::writeInt(int64_t value)
+    {
+        beginValue();
+        _ofs << value;
+    }
+
+    void JsonDumpWriter::writeBool(bool value)
+    {
+        beginValue();
+        _ofs << (value ? "true" : "false");
+    }
+
+    void JsonDumpWriter::writeEscaped(std::string_view str)
+    {
+        static const char *hexDigits = "0123456789abcdef";
+
+        _ofs << '"';
+        size_t begin = 0; // start of the pending run of characters that need no escaping
+        for (size_t i = 0; i < str.size(); i++)
+        {
+            unsigned char c = str[i];
+            if (c >= 0x20 && c != '"' && c != '\\')
+                continue;
+
+            _ofs.write(str.data() + begin, i - begin);
+            begin = i + 1;
+            switch (c)
+            {
+            case '"':
+                _ofs << "\\\"";
+                break;
+            case '\\':
+                _ofs << "\\\\";
+                break;
+            case '\b':
+                _ofs << "\\b";
+                break;
+            case '\f':
+                _ofs << "\\f";
+                break;
+            case '\n':
+                _ofs << "\\n";
+                break;
+            case '\r':
+                _ofs << "\\r";
+                break;
+            case '\t':
+                _ofs << "\\t";
+                break;
+            default:
+                _ofs << "\\u00" << hexDigits[c >> 4] << hexDigits[c & 0xf];
+                break;
+            }
+        }
+        _ofs.write(str.data() + begin, str.size() - begin);
+        _ofs << '"';
+    }
+
+    // major type in the high 3 bits, argument inline or in the following 1, 2, 4 or 8 bytes
+    void CborDumpWriter::writeHead(uint8_t majorType, uint64_t argument)
+    {
+        majorType <<= 5;
+        if (argument < 24)
+        {
+            _ofs.put(static_cast<char>(majorType | argument));
+            return;
+        }
+
+        int numBytes = argument <= 0xff ? 1 : argument <= 0xffff ? 2 : argument <= 0xffffffff ? 4 : 8;
+        _ofs.put(static_cast<char>(majorType | (numBytes == 1 ? 24 : numBytes == 2 ? 25 : numBytes == 4 ? 26 : 27)));
+        for (int i = numBytes - 1; i >= 0; i--)
+            _ofs.put(static_cast<char>((argument >> (i * 8)) & 0xff));
+    }
+
+    void CborDumpWriter::beginObject()
+    {
+        _ofs.put(static_cast<char>(0xbf)); // map, indefinite length
+    }
+
+    void CborDumpWriter::endObject()
+    {
+        _ofs.put(static_cast<char>(0xff)); // break
+    }
+
+    void CborDumpWriter::beginArray()
+    {
+        _ofs.put(static_cast<char>(0x9f)); // array, indefinite length
+    }
+
+    void CborDumpWriter::endArray()
+    {
+        _ofs.put(static_cast<char>(0xff)); // break
+    }
+
+    void CborDumpWriter::writeKey(std::string_view key)
+    {
+        writeString(key);
+    }
+
+    void CborDumpWriter::writeString(std::string_view value)
+    {
+        writeHead(3, value.size()); // text string
+        _ofs.write(value.data(), value.size());
+    }
+
+    void CborDumpWriter::writeInt(int64_t value)
+    {
+        if (value >= 0)
+            writeHead(0, value); // unsigned integer
+        else
+            writeHead(1, -(value + 1)); // negative integer
+    }
+
+    void CborDumpWriter::writeBool(bool value)
+    {
+        _ofs.put(static_cast<char>(value ? 0xf5 : 0xf4));
+    }
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace lcc
+{
+    // Streaming writer for token and AST dumps(Dumper.cpp). Values are written to the
+    // output as the caller walks its data, no document is built in memory.
+    class DumpWriter
+    {
+    public:
+        enum class Format : uint8_t
+        {
+            JSON = 0, // indented JSON text
+            CBOR      // RFC 8949 binary, objects and arrays use indefinite length encoding
+        };
+
+    protected:
+        DumpWriter(std::ofstream ofs) : _ofs(std::move(ofs)){};
+
+    public:
+        virtual ~DumpWriter() = default;
+
+        // opens outPath for writing, nullptr if it can't be created
+        static std::unique_ptr<DumpWriter> open(const std::string &outPath, Format format);
+
+        virtual void beginObject() = 0;
+        virtual void endObject() = 0;
+        virtual void beginArray() = 0;
+        virtual void endArray() = 0;
+        virtual void writeKey(std::string_view key) = 0;
+        virtual void writeString(std::string_view value) = 0;
+        virtual void writeInt(int64_t value) = 0;
+        virtual void writeBool(bool value) = 0;
+
+        // object members
+        void writeString(std::string_view key, std::string_view value)
+        {
+            writeKey(key);
+            writeString(value);
+        }
+
+        void writeInt(std::string_view key, int64_t value)
+        {
+            writeKey(key);
+            writeInt(value);
+        }
+
+        void writeBool(std::string_view key, bool value)
+        {
+            writeKey(key);
+            writeBool(value);
+        }
+
+    protected:
+        std::ofstream _ofs;
+    };
+
+    // Same layout as nlohmann::json::dump(2), so existing consumers of the dumps keep working
+    class JsonDumpWriter : public DumpWriter
+    {
+    public:
+        JsonDumpWriter(std::ofstream ofs) : DumpWriter(std::move(ofs)){};
+        ~JsonDumpWriter();
+
+        virtual void beginObject() override;
+        virtual void endObject() override;
+        virtual void beginArray() override;
+        virtual void endArray() override;
+        virtual void writeKey(std::string_view key) override;
+        virtual void writeString(std::string_view value) override;
+        virtual void writeInt(int64_t value) override;
+        virtual void writeBool(bool value) override;
+
+        using DumpWriter::writeBool;
+        using DumpWriter::writeInt;
+        using DumpWriter::writeString;
+
+    private:
+        void beginValue();
+        void endContainer(char close);
+        void writeIndent();
+        void writeEscaped(std::string_view str);
+
+    private:
+        std::vector<unsigned int> _numElements; // elements written so far in each open container
+        bool _isAfterKey{false};
+    };
+
+    class CborDumpWriter : public DumpWriter
+    {
+    public:
+        CborDumpWriter(std::ofstream ofs) : DumpWriter(std::move(ofs)){};
+
+        virtual void beginObject() override;
+        virtual void endObject() override;
+        virtual void beginArray() override;
+        virtual void endArray() override;
+        virtual void writeKey(std::string_view key) override;
+        virtual void writeString(std::string_view value) override;
+        virtual void writeInt(int64_t value) override;
+        virtual void writeBool(bool value) override;
+
+        using DumpWriter::writeBool;
+        using DumpWriter::writeInt;
+        using DumpWriter::writeString;
+
+    private:
+        void writeHead(uint8_t majorType, uint64_t argument);
+    };
+}
@@ -36,7 +36,7 @@ namespace lcc
             }
         }
 
-        BinaryOperator::BinaryOperator(BinaryOpType type, std::unique_ptr<Expr> lhs, std::unique_ptr<Expr> rhs) : _type(type)
+        BinaryOperator::BinaryOperator(BinaryOpType type, std::unique_ptr<Expr> lhs, std::unique_ptr<Expr> rhs) : Expr(Kind::BinaryOperator), _type(type)
         {
             if (!isAssignment() && lhs->isLValue())
                 lhs = std::make_unique<ImplicitCastExpr>(std::move(lhs), AST::CastExpr::CastType::LValueToRValue);
@@ -48,7 +48,7 @@ namespace lcc
         }
 
         ArraySubscriptExpr::ArraySubscriptExpr(const std::string& name, std::unique_ptr<Expr> lhs, std::unique_ptr<Expr> rhs) :
-            DeclRefExpr(name, false, true)
+            DeclRefExpr(name, false, true, Kind::ArraySubscriptExpr)
         {
             if (rhs->isLValue())
                 rhs = std::make_unique<ImplicitCastExpr>(std::move(rhs), AST::CastExpr::CastType::LValueToRValue);
@@ -56,6 +56,39 @@ namespace lcc
             _rhs = std::move(rhs);
         }
 
+        BinaryOperator::~BinaryOperator()
+        {
+            destroyLater(std::move(_lhs));
+            destroyLater(std::move(_rhs));
+        }
+
+        UnaryOperator::~UnaryOperator()
+        {
+            destroyLater(std::move(_body));
+        }
+
+        ParenExpr::~ParenExpr()
+        {
+            destroyLater(std::move(_subExpr));
+        }
+
+        CallExpr::~CallExpr()
+        {
+            destroyLater(std::move(_functionExpr));
+            destroyLater(_params);
+        }
+
+        CastExpr::~CastExpr()
+        {
+            destroyLater(std::move(_subExpr));
+        }
+
+        ArraySubscriptExpr::~ArraySubscriptExpr()
+        {
+            destroyLater(std::move(_lhs));
+            destroyLater(std::move(_rhs));
+        }
+
         bool BinaryOperator::isAssignment() const
         {
             switch (_type)
@@ -77,188 +110,126 @@ namespace lcc
             }
         }
 
-        json IntegerLiteral::asJson() const
+        void IntegerLiteral::dump(DumpWriter &writer) const
         {
-            json j;
-            j["type"] = "IntegerLiteral";
-            j["value"] = std::to_string(_value);
-            return j;
+            writer.beginObject();
+            writer.writeString("type", "IntegerLiteral");
+            writer.writeString("value", std::to_string(_value));
+            writer.endObject();
         }
 
-        json FloatingLiteral::asJson() const
+        void FloatingLiteral::dump(DumpWriter &writer) const
         {
-            json j;
-            j["type"] = "FloatingLiteral";
-            j["value"] = std::to_string(_value);
-            return j;
+            writer.beginObject();
+            writer.writeString("type", "FloatingLiteral");
+            writer.writeString("value", std::to_string(_value));
+            writer.endObject();
         }
 
-        json DeclRefExpr::asJson() const
+        void DeclRefExpr::dump(DumpWriter &writer) const
         {
-            json j;
-            j["type"] = "DeclRefExpr";
-            j["name"] = _name;
-            j["isCall"] = _isCall;
-            return j;
+            writer.beginObject();
+            writer.writeString("type", "DeclRefExpr");
+            writer.writeString("name", _name);
+            writer.writeBool("isCall", _isCall);
+            writer.endObject();
         }
 
-        json BinaryOperator::asJson() const
+        void BinaryOperator::dump(DumpWriter &writer) const
         {
-            json j;
-            j["type"] = "BinaryOperator";
-            j["opcode"] = BinaryOpTypeToStringDisc(_type);
-            j["lhs"] = json::array({_lhs->asJson()});
-            j["rhs"] = json::array({_rhs->asJson()});
-            return j;
+            writer.beginObject();
+            writer.writeString("type", "BinaryOperator");
+            writer.writeString("opcode", BinaryOpTypeToStringDisc(_type));
+            dumpChild(writer, "lhs", _lhs.get());
+            dumpChild(writer, "rhs", _rhs.get());
+            writer.endObject();
         }
 
-        json UnaryOperator::asJson() const
+        void UnaryOperator::dump(DumpWriter &writer) const
         {
-            json j;
-            j["type"] = "UnaryOperator";
-            j["opcode"] = UnaryOpTypeToStringDisc(_type);
-            j["body"] = json::array({_body->asJson()});
-            return j;
+            writer.beginObject();
+            writer.writeString("type", "UnaryOperator");
+            writer.writeString("opcode", UnaryOpTypeToStringDisc(_type));
+            dumpChild(writer, "body", _body.get());
+            writer.endObject();
         }
 
-        json ParenExpr::asJson() const
+        void ParenExpr::dump(DumpWriter &writer) const
         {
-            json j;
-            j["type"] = "ParenExpr";
-            j["expr"] = json::array({_subExpr->asJson()});
-            return j;
+            writer.beginObject();
+            writer.writeString("type", "ParenExpr");
+            dumpChild(writer, "expr", _subExpr.get());
+            writer.endObject();
         }
 
-        json CallExpr::asJson() const
+        void CallExpr::dump(DumpWriter &writer) const
         {
-            json j;
-            j["type"] = "CallExpr";
-            j["expr"] = json::array({_functionExpr->asJson()});
-            j["params"] = json::array();
-            for (const auto &param : _params)
-                j["params"].emplace_back(param->asJson());
-            return j;
+            writer.beginObject();
+            writer.writeString("type", "CallExpr");
+            dumpChild(writer, "expr", _functionExpr.get());
+            dumpChildren(writer, "params", _params);
+            writer.endObject();
         }
 
-        json CastExpr::asJson() const
+        void CastExpr::dump(DumpWriter &writer) const
         {
-            json j;
-            j["type"] = "CastExpr";
+            writer.beginObject();
+            writer.writeString("type", "CastExpr");
             switch (_type)
             {
             case CastExpr::CastType::LValueToRValue:
-                j["castType"] = "LValueToRValue";
+                writer.writeString("castType", "LValueToRValue");
                 break;
 
             default:
-                j["castType"] = "Undefined";
+                writer.writeString("castType", "Undefined");
                 break;
             }
-            j["expr"] = json::array({_subExpr->asJson()});
-            return j;
+            dumpChild(writer, "expr", _subExpr.get());
+            writer.endObject();
         }
 
-        json ImplicitCastExpr::asJson() const
+        void ImplicitCastExpr::dump(DumpWriter &writer) const
         {
-            json j;
-            j["type"] = "ImplicitCastExpr";
+            writer.beginObject();
+            writer.writeString("type", "ImplicitCastExpr");
             switch (_type)
             {
             case CastExpr::CastType::LValueToRValue:
-                j["castType"] = "LValueToRValue";
+                writer.writeString("castType", "LValueToRValue");
                 break;
 
             default:
-                j["castType"] = "Undefined";
+                writer.writeString("castType", "Undefined");
                 break;
             }
-            j["expr"] = json::array({_subExpr->asJson()});
-            return j;
-        }
-
-        json CharacterLiteral::asJson() const
-        {
-            json j;
-            j["type"] = "CharacterLiteral";
-            j["value"] = std::to_string(_value);
-            return j;
-        }
-
-        json StringLiteral::asJson() const
-        {
-            json j;
-            j["type"] = "StringLiteral";
-            j["value"] = _value;
-            return j;
-        }
-
-        json ArraySubscriptExpr::asJson() const
-        {
-            json j;
-            j["type"] = "ArraySubscriptExpr";
-            j["lhs"] = json::array({_lhs->asJson()});
-            j["rhs"] = json::array({_rhs->asJson()});
-            return j;
-        }
-
-        bool DeclRefExpr::gen(lcc::IRGeneratorBase *generator)
-        {
-            return generator->gen(this);
-        }
-
-        bool IntegerLiteral::gen(lcc::IRGeneratorBase *generator)
-        {
-            return generator->gen(this);
-        }
-
-        bool CharacterLiteral::gen(lcc::IRGeneratorBase *generator)
-        {
-            return generator->gen(this);
-        }
-
-        bool FloatingLiteral::gen(lcc::IRGeneratorBase *generator)
-        {
-            return generator->gen(this);
-        }
-
-        bool StringLiteral::gen(lcc::IRGeneratorBase *generator)
-        {
-            return generator->gen(this);
-        }
-
-        bool CastExpr::gen(lcc::IRGeneratorBase *generator)
-        {
-            return generator->gen(this);
-        }
-
-        bool ImplicitCastExpr::gen(lcc::IRGeneratorBase *generator)
-        {
-            return generator->gen(this);
-        }
-
-        bool BinaryOperator::gen(lcc::IRGeneratorBase *generator)
-        {
-            return generator->gen(this);
-        }
-
-        bool UnaryOperator::gen(lcc::IRGeneratorBase *generator)
-        {
-            return generator->gen(this);
+            dumpChild(writer, "expr", _subExpr.get());
+            writer.endObject();
         }
 
-        bool ParenExpr::gen(lcc::IRGeneratorBase *generator)
+        void CharacterLiteral::dump(DumpWriter &writer) const
         {
-            return generator->gen(this);
+            writer.beginObject();
+            writer.writeString("type", "CharacterLiteral");
+            writer.writeString("value", std::to_string(_value));
+            writer.endObject();
         }
 
-        bool CallExpr::gen(lcc::IRGeneratorBase *generator)
+        void StringLiteral::dump(DumpWriter &writer) const
         {
-            return generator->gen(this);
+            writer.beginObject();
+            writer.writeString("type", "StringLiteral");
+            writer.writeString("value", _value);
+            writer.endObject();
         }
 
-        bool ArraySubscriptExpr::gen(lcc::IRGeneratorBase *generator)
+        void ArraySubscriptExpr::dump(DumpWriter &writer) const
         {
-            return generator->gen(this);
+            writer.beginObject();
+            writer.writeString("type", "ArraySubscriptExpr");
+            dumpChild(writer, "lhs", _lhs.get());
+            dumpChild(writer, "rhs", _rhs.get());
+            writer.endObject();
         }
     }
 }
\ No newline at end of file
@@ -0,0 +1,303 @@
+#include "lcc.hpp"
+
+namespace lcc
+{
+    std::unique_ptr<ExprFolder> ExprFolder::_inst;
+
+    namespace
+    {
+        bool GetConstant(const AST::Expr *expr, Constant &constant)
+        {
+            switch (expr->kind())
+            {
+            case AST::ASTNode::Kind::IntegerLiteral:
+                constant = Constant::makeInt(static_cast<const AST::IntegerLiteral *>(expr)->value());
+                return true;
+            case AST::ASTNode::Kind::CharacterLiteral:
+                constant = Constant::makeInt(static_cast<const AST::CharacterLiteral *>(expr)->value());
+                return true;
+            case AST::ASTNode::Kind::FloatingLiteral:
+                constant = Constant::makeFloat(static_cast<const AST::FloatingLiteral *>(expr)->value());
+                return true;
+            default:
+                return false;
+            }
+        }
+
+        bool IsIntConstant(const AST::Expr *expr, int value)
+        {
+            Constant constant;
+            return GetConstant(expr, constant) && !constant.isFloat && constant.intValue == value;
+        }
+
+        // log2 of a positive power of two int constant greater than 1, 0 otherwise
+        int PowerOfTwoShift(const AST::Expr *expr)
+        {
+            Constant constant;
+            if (!GetConstant(expr, constant) || constant.isFloat || constant.intValue <= 1 || (constant.intValue & (constant.intValue - 1)) != 0)
+                return 0;
+
+            int shift = 0;
+            while ((1 << shift) != constant.intValue)
+                shift++;
+            return shift;
+        }
+
+        bool IsInt(const AST::Type *type)
+        {
+            return type->kind() == AST::Type::Kind::Int;
+        }
+    }
+
+    size_t ExprFolder::run(AST::ASTNode *astRoot)
+    {
+        _numRewrites = 0;
+        ConstEvaluator::getInstance()->reset(astRoot);
+        visit(astRoot);
+        return _numRewrites;
+    }
+
+    void ExprFolder::fold(std::unique_ptr<AST::Expr> &expr)
+    {
+        if (expr == nullptr)
+            return;
+
+        visit(expr); // children first, so simplify() only sees simplified operands
+        if (auto replacement = simplify(expr.get()))
+        {
+            expr = std::move(replacement);
+            _numRewrites++;
+        }
+    }
+
+    std::unique_ptr<AST::Expr> ExprFolder::simplify(AST::Expr *expr)
+    {
+        switch (expr->kind())
+        {
+        case AST::ASTNode::Kind::ParenExpr:
+            return std::move(static_cast<AST::ParenExpr *>(expr)->_subExpr);
+        case AST::ASTNode::Kind::ImplicitCastExpr:
+        {
+            auto castExpr = static_cast<AST::ImplicitCastExpr *>(expr);
+            if (castExpr->_subExpr->isLValue())
+                return nullptr;
+            return std::move(castExpr->_subExpr); // nothing to load from an rvalue
+        }
+        case AST::ASTNode::Kind::BinaryOperator:
+            return simplifyBinary(static_cast<AST::BinaryOperator *>(expr));
+        case AST::ASTNode::Kind::UnaryOperator:
+            return simplifyUnary(static_cast<AST::UnaryOperator *>(expr));
+        case AST::ASTNode::Kind::CallExpr:
+            return simplifyCall(static_cast<AST::CallExpr *>(expr));
+        default:
+            return nullptr;
+        }
+    }
+
+    std::unique_ptr<AST::Expr> ExprFolder::simplifyBinary(AST::BinaryOperator *binaryOperator)
+    {
+        if (binaryOperator->isAssignment())
+            return nullptr;
+
+        auto &lhs = binaryOperator->_lhs;
+        auto &rhs = binaryOperator->_rhs;
+        const AST::Type *type = binaryOperator->_exprType;
+
+        Constant lhsValue, rhsValue, result;
+        if (GetConstant(lhs.get(), lhsValue) && GetConstant(rhs.get(), rhsValue))
+        {
+            if (!ConstEvaluator::foldBinary(binaryOperator->type(), lhsValue, rhsValue, result))
+                return nullptr;
+
+            return makeLiteral(result, type);
+        }
+
+        // identities are only applied to ints, for floats x + 0 isn't x when x is -0.0
+        if (!IsInt(type))
+            return nullptr;
+        bool isLhsInt = IsInt(lhs->_exprType), isRhsInt = IsInt(rhs->_exprType);
+
+        switch (binaryOperator->type())
+        {
+        case AST::BinaryOpType::BO_Add:
+        case AST::BinaryOpType::BO_Or:
+        case AST::BinaryOpType::BO_Xor:
+            if (isLhsInt && IsIntConstant(rhs.get(), 0))
+                return std::move(lhs);
+            if (isRhsInt && IsIntConstant(lhs.get(), 0))
+                return std::move(rhs);
+            break;
+        case AST::BinaryOpType::BO_Sub:
+        case AST::BinaryOpType::BO_Shl:
+        case AST::BinaryOpType::BO_Shr:
+            if (isLhsInt && IsIntConstant(rhs.get(), 0))
+                return std::move(lhs);
+            break;
+        case AST::BinaryOpType::BO_Div:
+            if (isLhsInt && IsIntConstant(rhs.get(), 1))
+                return std::move(lhs);
+            break;
+        case AST::BinaryOpType::BO_Mul:
+        {
+            if (isLhsInt && IsIntConstant(rhs.get(), 1))
+                return std::move(lhs);
+            if (isRhsInt && IsIntConstant(lhs.get(), 1))
+                return std::move(rhs);
+
+            // x * 2^n -> x << n, both wrap around the same way
+            std::unique_ptr<AST::Expr> *operand = nullptr;
+            int shift = 0;
+            if (isLhsInt && (shift = PowerOfTwoShift(rhs.get())) != 0)
+                operand = &lhs;
+            else if (isRhsInt && (shift = PowerOfTwoShift(lhs.get())) != 0)
+                operand = &rhs;
+            else
+                break;
+
+            auto shiftAmount = std::make_unique<AST::IntegerLiteral>(shift);
+            shiftAmount->_exprType = type;
+            auto shl = std::make_unique<AST::BinaryOperator>(AST::BinaryOpType::BO_Shl, std::move(*operand), std::move(shiftAmount));
+            shl->_exprType = type;
+            return shl;
+        }
+        default:
+            break;
+        }
+
+        return nullptr;
+    }
+
+    std::unique_ptr<AST::Expr> ExprFolder::simplifyUnary(AST::UnaryOperator *unaryOperator)
+    {
+        Constant bodyValue, result;
+        if (!GetConstant(unaryOperator->_body.get(), bodyValue) || !ConstEvaluator::foldUnary(unaryOperator->type(), bodyValue, result))
+            return nullptr;
+
+        return makeLiteral(result, unaryOperator->_exprType);
+    }
+
+    std::unique_ptr<AST::Expr> ExprFolder::simplifyCall(AST::CallExpr *callExpr)
+    {
+        Constant result;
+        for (auto &param : callExpr->_params)
+        {
+            if (!GetConstant(param.get(), result))
+                return nullptr;
+        }
+
+        if (callExpr->_exprType->isVoid() || !ConstEvaluator::getInstance()->evaluate(callExpr, result))
+            return nullptr;
+
+        return makeLiteral(result, callExpr->_exprType);
+    }
+
+    std::unique_ptr<AST::Expr> ExprFolder::makeLiteral(const Constant &value, const AST::Type *type)
+    {
+        std::unique_ptr<AST::Expr> literal;
+        switch (type->kind())
+        {
+        case AST::Type::Kind::Float:
+            literal = std::make_unique<AST::FloatingLiteral>(value.asFloat());
+            break;
+        case AST::Type::Kind::Char: // keeps the width the generators give the operand
+            literal = std::make_unique<AST::CharacterLiteral>(static_cast<char>(value.intValue));
+            break;
+        default:
+            literal = std::make_unique<AST::IntegerLiteral>(value.isFloat ? static_cast<int>(value.floatValue) : value.intValue);
+            break;
+        }
+        literal->_exprType = type;
+        return literal;
+    }
+
+    void ExprFolder::gen(AST::TranslationUnitDecl *translationUnitDecl)
+    {
+        for (auto &decl : translationUnitDecl->_decls)
+            visit(decl);
+    }
+
+    void ExprFolder::gen(AST::FunctionDecl *functionDecl)
+    {
+        if (functionDecl->_body != nullptr)
+            visit(functionDecl->_body);
+    }
+
+    void ExprFolder::gen(AST::VarDecl *varDecl)
+    {
+        fold(varDecl->_value);
+    }
+
+    void ExprFolder::gen(AST::CastExpr *castExpr)
+    {
+        fold(castExpr->_subExpr);
+    }
+
+    void ExprFolder::gen(AST::BinaryOperator *binaryOperator)
+    {
+        fold(binaryOperator->_lhs);
+        fold(binaryOperator->_rhs);
+    }
+
+    void ExprFolder::gen(AST::UnaryOperator *unaryOperator)
+    {
+        fold(unaryOperator->_body);
+    }
+
+    void ExprFolder::gen(AST::ParenExpr *parenExpr)
+    {
+        fold(parenExpr->_subExpr);
+    }
+
+    void ExprFolder::gen(AST::CompoundStmt *compoundStmt)
+    {
+        for (auto &stmt : compoundStmt->_body)
+            visit(stmt);
+    }
+
+    void ExprFolder::gen(AST::DeclStmt *declStmt)
+    {
+        for (auto &decl : declStmt->_decls)
+            visit(decl);
+    }
+
+    void ExprFolder::gen(AST::IfStmt *ifStmt)
+    {
+        fold(ifStmt->_condition);
+        visit(ifStmt->_body);
+        if (ifStmt->_elseBody != nullptr)
+            visit(ifStmt->_elseBody);
+    }
+
+    void ExprFolder::gen(AST::ValueStmt *valueStmt)
+    {
+        fold(valueStmt->_expr);
+    }
+
+    void ExprFolder::gen(AST::ReturnStmt *returnStmt)
+    {
+        fold(returnStmt->_value);
+    }
+
+    void ExprFolder::gen(AST::WhileStmt *whileStmt)
+    {
+        fold(whileStmt->_condition);
+        visit(whileStmt->_body);
+    }
+
+    void ExprFolder::gen(AST::CallExpr *callExpr)
+    {
+        for (auto &param : callExpr->_params)
+            fold(param);
+    }
+
+    void ExprFolder::gen(AST::AsmStmt *asmStmt)
+    {
+        for (auto &constraint : asmStmt->_inputConstraints)
+            fold(constraint.second);
+    }
+
+    void ExprFolder::gen(AST::ArraySubscriptExpr *arraySubscriptExpr)
+    {
+        fold(arraySubscriptExpr->_rhs);
+    }
+}
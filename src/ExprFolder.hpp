@@ -0,0 +1,74 @@
+#pragma once
+
+#include <memory>
+
+#include "AST.hpp"
+#include "ASTVisitor.hpp"
+#include "ConstEvaluator.hpp"
+
+namespace lcc
+{
+    // Constant folding and algebraic simplification of expressions(ExprFolder.cpp). Runs after
+    // Sema and before any IR generator, rewriting subtrees in place. A folded literal takes the
+    // type Sema computed for the expression it replaces.
+    class ExprFolder : public AST::ASTVisitor<ExprFolder, void>
+    {
+    private:
+        ExprFolder() = default;
+        ExprFolder(const ExprFolder &) = delete;
+        ExprFolder &operator=(const ExprFolder &) = delete;
+
+    public:
+        static ExprFolder *getInstance()
+        {
+            if (_inst.get() == nullptr)
+                _inst.reset(new ExprFolder);
+
+            return _inst.get();
+        }
+
+    private:
+        static std::unique_ptr<ExprFolder> _inst;
+
+    public:
+        // returns the number of expressions that have been rewritten
+        size_t run(AST::ASTNode *astRoot);
+
+        void gen(AST::TranslationUnitDecl *translationUnitDecl);
+        void gen(AST::FunctionDecl *functionDecl);
+        void gen(AST::VarDecl *varDecl);
+        void gen(AST::IntegerLiteral *integerLiteral){};
+        void gen(AST::FloatingLiteral *floatingLiteral){};
+        void gen(AST::CharacterLiteral *charLiteral){};
+        void gen(AST::StringLiteral *strLiteral){};
+        void gen(AST::DeclRefExpr *declRefExpr){};
+        void gen(AST::CastExpr *castExpr);
+        void gen(AST::BinaryOperator *binaryOperator);
+        void gen(AST::UnaryOperator *unaryOperator);
+        void gen(AST::ParenExpr *parenExpr);
+        void gen(AST::CompoundStmt *compoundStmt);
+        void gen(AST::DeclStmt *declStmt);
+        void gen(AST::IfStmt *ifStmt);
+        void gen(AST::ValueStmt *valueStmt);
+        void gen(AST::ReturnStmt *returnStmt);
+        void gen(AST::WhileStmt *whileStmt);
+        void gen(AST::CallExpr *callExpr);
+        void gen(AST::NullStmt *nullStmt){};
+        void gen(AST::AsmStmt *asmStmt);
+        void gen(AST::ArraySubscriptExpr *arraySubscriptExpr);
+
+    private:
+        // simplifies the subtree owned by expr bottom up, replacing expr when it can
+        void fold(std::unique_ptr<AST::Expr> &expr);
+        std::unique_ptr<AST::Expr> simplify(AST::Expr *expr);
+        std::unique_ptr<AST::Expr> simplifyBinary(AST::BinaryOperator *binaryOperator);
+        std::unique_ptr<AST::Expr> simplifyUnary(AST::UnaryOperator *unaryOperator);
+        // evaluates a call with literal arguments by ConstEvaluator
+        std::unique_ptr<AST::Expr> simplifyCall(AST::CallExpr *callExpr);
+        // a literal of type holding value
+        std::unique_ptr<AST::Expr> makeLiteral(const Constant &value, const AST::Type *type);
+
+    private:
+        size_t _numRewrites{0};
+    };
+}
@@ -21,30 +21,30 @@ namespace lcc
     {
         std::string line;
 
-        // flush stringstream first
-        _ss.str("");
+        // flush current line first
+        _line.clear();
 
         // update positions
         _pos.line++;
         _pos.column = 1;
         _curIdx = 0;
         if (std::getline(_ifs, line))
-            _ss << line << '\n';
+            _line = line + '\n';
         else
-            _ss << (char)EOF;
+            _line = (char)EOF;
     }
 
     const std::string File::curLine()
     {
-        return _ss.str();
+        return _line;
     }
 
     const char File::nextChar()
     {
-        if (_curIdx >= _ss.str().size())
+        if (_curIdx >= _line.size())
             return EOF;
 
-        char c = _ss.str()[_curIdx++];
+        char c = _line[_curIdx++];
         _pos.column++;
 
         return c;
@@ -53,13 +53,13 @@ namespace lcc
     void File::retractChar()
     {
         _curIdx = (_curIdx <= 0) ? 0 : _curIdx - 1;
-        char c = _ss.str()[_curIdx];
+        char c = _line[_curIdx];
         // if(c == '\n')
         // {
         //     int i = _curIdx - 1;
-        //     for(; i >= 0 && _ss.str()[i] != '\n'; i--);
+        //     for(; i >= 0 && _line[i] != '\n'; i--);
         //     _pos.line--;
-        //     _pos.column = _curIdx - i + (_ss.str()[i] != '\n');
+        //     _pos.column = _curIdx - i + (_line[i] != '\n');
         // }
         // else _pos.column--;
         _pos.column = _curIdx + 1;
@@ -67,9 +67,9 @@ namespace lcc
 
     const char File::peekChar()
     {
-        if (_curIdx >= _ss.str().size())
+        if (_curIdx >= _line.size())
             return EOF;
 
-        return _ss.str()[_curIdx];
+        return _line[_curIdx];
     }
 }
\ No newline at end of file
@@ -34,7 +34,7 @@ namespace lcc
         const std::string path() const { return _path; };
 
     private:
-        std::stringstream _ss;
+        std::string _line; // current line, indexed directly to avoid copying it per character
         std::ifstream _ifs;
         std::string _path;
         Position _pos;
@@ -2,9 +2,20 @@
 
 #include <string>
 #include <memory>
+#include <ostream>
+#include <cstdint>
 #include <vector>
 #include <map>
-
+#include <unordered_map>
+#include <unordered_set>
+#include <thread>
+#include <fstream>
+
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallString.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/BasicBlock.h"
 #include "llvm/IR/IRBuilder.h"
@@ -14,8 +25,14 @@
 #include "llvm/IR/Type.h"
 #include "llvm/IR/Verifier.h"
 #include "llvm/IR/InlineAsm.h"
+#include "llvm/IR/ValueHandle.h"
+#include "llvm/Linker/Linker.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/raw_ostream.h"
 
 #include "AST.hpp"
+#include "ASTVisitor.hpp"
 
 #define GEN_METHOD_NO_IMPLEMENT return true;
 
@@ -25,110 +42,101 @@ namespace lcc
     class IRGeneratorBase
     {
     public:
-        virtual bool gen(AST::ASTNode *astNode) { return true; };
-        virtual bool gen(AST::TranslationUnitDecl *translationUnitDecl) = 0;
-        virtual bool gen(AST::FunctionDecl *functionDecl) = 0;
-        virtual bool gen(AST::VarDecl *varDecl) = 0;
-        virtual bool gen(AST::IntegerLiteral *integerLiteral) = 0;
-        virtual bool gen(AST::FloatingLiteral *floatingLiteral) = 0;
-        virtual bool gen(AST::CharacterLiteral *charLiteral) = 0;
-        virtual bool gen(AST::StringLiteral *strLiteral) = 0;
-        virtual bool gen(AST::DeclRefExpr *declRefExpr) = 0;
-        virtual bool gen(AST::CastExpr *castExpr) = 0;
-        virtual bool gen(AST::ImplicitCastExpr *implicitCastExpr) = 0;
-        virtual bool gen(AST::BinaryOperator *binaryOperator) = 0;
-        virtual bool gen(AST::UnaryOperator *unaryOperator) = 0;
-        virtual bool gen(AST::ParenExpr *parenExpr) = 0;
-        virtual bool gen(AST::CompoundStmt *compoundStmt) = 0;
-        virtual bool gen(AST::DeclStmt *declStmt) = 0;
-        virtual bool gen(AST::IfStmt *ifStmt) = 0;
-        virtual bool gen(AST::ValueStmt *valueStmt) = 0;
-        virtual bool gen(AST::ReturnStmt *returnStmt) = 0;
-        virtual bool gen(AST::WhileStmt *whileStmt) = 0;
-        virtual bool gen(AST::CallExpr *callExpr) = 0;
-        virtual bool gen(AST::AsmStmt *asmStmt) = 0;
-        virtual bool gen(AST::ArraySubscriptExpr *asmStmt) = 0;
+        // generates IR for a whole AST, node handlers are dispatched statically below this
+        virtual bool generate(AST::ASTNode *astNode) = 0;
 
-    public:
         virtual void printCode() const = 0;
         virtual void dumpCode(const std::string outPath) const = 0;
     };
 
     // Quaternion intermediate representation generator class(QuaternionIRGenerator.cpp)
-    class QuaternionIRGenerator : public IRGeneratorBase
+    class QuaternionOptimizer;
+    class QuaternionVM;
+    class QuaternionCodegen;
+
+    class QuaternionIRGenerator : public IRGeneratorBase, public AST::ASTVisitor<QuaternionIRGenerator>
     {
+        friend class QuaternionOptimizer;
+        friend class QuaternionVM;
+        friend class QuaternionCodegen;
+
         typedef struct _SymbolTableItem
         {
             std::string name;
             std::string type;
-            int offset;
-            _SymbolTableItem(std::string name, std::string type, int offset) : name(name), type(type), offset(offset){};
+            int offset; // from the start of its table, temps of a function may share one
+            int width;
+            _SymbolTableItem(std::string name, std::string type, int offset, int width) : name(name), type(type), offset(offset), width(width){};
         } SymbolTableItem;
 
         typedef struct _SymbolTable
         {
             _SymbolTable(std::shared_ptr<_SymbolTable> previous) : previous(previous){};
             std::shared_ptr<_SymbolTable> previous;
-            std::vector<std::shared_ptr<SymbolTableItem>> items;
+            std::vector<uint32_t> items; // indices into _symbols
             int totalWidth{0};
         } SymbolTable;
 
-        enum class ArgType
+        static constexpr uint32_t NoSymbol = UINT32_MAX;
+
+        enum class ArgType : uint32_t
         {
             NIL = 0,
             CODEADDR,
             ENTRY,
-            VALUE
-        };
-
-        class Arg
-        {
-        public:
-            virtual ArgType type() { return ArgType::NIL; };
-        };
-
-        class CodeAddr : public Arg
-        {
-        public:
-            virtual ArgType type() override { return ArgType::CODEADDR; };
-
-            int codeAddr;
-
-            CodeAddr(int codeAddr) : codeAddr(codeAddr){};
+            INTEGER,
+            FLOATING,
+            FUNCTION,
+            STRING
         };
 
-        class SymbTblEntry : public Arg
+        // an operand is a tag plus a payload, 8 bytes stored inline in the quaternion
+        typedef struct _Arg
         {
-        public:
-            virtual ArgType type() override { return ArgType::ENTRY; };
-
-            std::shared_ptr<SymbolTableItem> pEntry;
-
-            SymbTblEntry(std::shared_ptr<SymbolTableItem> pEntry) : pEntry(pEntry){};
-        };
-
-        class Value : public Arg
-        {
-        public:
-            enum class ValueType
-            {
-                INTEGER = 0,
-                FLOAT
-            };
-
-        public:
-            virtual ArgType type() override { return ArgType::VALUE; };
-
+            ArgType type;
             union
             {
-                float floatVal;
+                int codeAddr;
+                uint32_t symbol; // index into _symbols
                 int integerVal;
+                float floatVal;
+                uint32_t function; // index into _functionTable
+                uint32_t string;   // index into _strings
             };
 
-            ValueType valueType;
-            Value(float floatVal) : floatVal(floatVal), valueType(ValueType::FLOAT){};
-            Value(int integerVal) : integerVal(integerVal), valueType(ValueType::INTEGER){};
-        };
+            static _Arg nil() { return {ArgType::NIL, {0}}; };
+            static _Arg addr(int codeAddr) { return {ArgType::CODEADDR, {codeAddr}}; };
+            static _Arg entry(uint32_t symbol)
+            {
+                _Arg arg = {ArgType::ENTRY, {0}};
+                arg.symbol = symbol;
+                return arg;
+            };
+            static _Arg value(int integerVal)
+            {
+                _Arg arg = {ArgType::INTEGER, {0}};
+                arg.integerVal = integerVal;
+                return arg;
+            };
+            static _Arg value(float floatVal)
+            {
+                _Arg arg = {ArgType::FLOATING, {0}};
+                arg.floatVal = floatVal;
+                return arg;
+            };
+            static _Arg callee(uint32_t function)
+            {
+                _Arg arg = {ArgType::FUNCTION, {0}};
+                arg.function = function;
+                return arg;
+            };
+            static _Arg str(uint32_t string)
+            {
+                _Arg arg = {ArgType::STRING, {0}};
+                arg.string = string;
+                return arg;
+            };
+        } Arg;
 
         enum class QuaternionOperator
         {
@@ -139,18 +147,23 @@ namespace lcc
 #include "OperationType.inc"
 #undef UNARY_OPERATION
 #undef BINARY_OPERATION
-            Jnz,  // conditional jump
-            J,    // jump
-            Call, // TODO function call
-            Ret,  // function returns
+            Jnz,   // conditional jump
+            J,     // jump
+            Param, // passes arg1 to the Call that follows the Params
+            Call,  // calls arg1 with the arg2 Params right before it
+            Ret,   // function returns
+            Store, // arg1 to the element of array result at byte offset arg2, Subscript loads one the same way
+            AsmInput,  // passes arg1 to operand arg2 of the Asm that follows the operands
+            AsmOutput, // the Asm that follows writes its operand arg2 to result
+            Asm,       // inline asm with template arg1 and the arg2 AsmInputs and AsmOutputs right before it
         };
 
         typedef struct
         {
             QuaternionOperator op;
-            std::shared_ptr<Arg> arg1;
-            std::shared_ptr<Arg> arg2;
-            std::shared_ptr<Arg> result;
+            Arg arg1;
+            Arg arg2;
+            Arg result;
         } Quaternion;
 
         typedef struct
@@ -158,7 +171,11 @@ namespace lcc
             std::string name;
             std::string type;
             int entry;
+            int exit; // one past the last code of the body
             bool isInitialized;
+            std::vector<uint32_t> params; // symbols of the parameters in order
+            size_t firstTable;            // the function's tables are _tables[firstTable, endTable)
+            size_t endTable;
         } FunctionTableItem;
 
     private:
@@ -179,63 +196,80 @@ namespace lcc
         static std::unique_ptr<QuaternionIRGenerator> _inst;
 
     public:
+        virtual bool generate(AST::ASTNode *astNode) override;
+
         // gen methods implementations for QuaternionIRGenerator
-        virtual bool gen(AST::TranslationUnitDecl *translationUnitDecl) override;
-        virtual bool gen(AST::FunctionDecl *functionDecl) override;
-        virtual bool gen(AST::VarDecl *varDecl) override;
-        virtual bool gen(AST::IntegerLiteral *integerLiteral) override;
-        virtual bool gen(AST::FloatingLiteral *floatingLiteral) override;
-        virtual bool gen(AST::CharacterLiteral *charLiteral) override;
-        virtual bool gen(AST::StringLiteral *strLiteral) override;
-        virtual bool gen(AST::DeclRefExpr *declRefExpr) override;
-        virtual bool gen(AST::CastExpr *castExpr) override;
-        virtual bool gen(AST::ImplicitCastExpr *implicitCastExpr) override;
-        virtual bool gen(AST::BinaryOperator *binaryOperator) override;
-        virtual bool gen(AST::UnaryOperator *unaryOperator) override;
-        virtual bool gen(AST::ParenExpr *parenExpr) override;
-        virtual bool gen(AST::CompoundStmt *compoundStmt) override;
-        virtual bool gen(AST::DeclStmt *declStmt) override;
-        virtual bool gen(AST::IfStmt *ifStmt) override;
-        virtual bool gen(AST::ValueStmt *valueStmt) override;
-        virtual bool gen(AST::ReturnStmt *returnStmt) override;
-        virtual bool gen(AST::WhileStmt *whileStmt) override;
-        virtual bool gen(AST::CallExpr *callExpr) override;
-        virtual bool gen(AST::AsmStmt *asmStmt) override;
-        virtual bool gen(AST::ArraySubscriptExpr *arraySubscriptExpr) override;
+        bool gen(AST::TranslationUnitDecl *translationUnitDecl);
+        bool gen(AST::FunctionDecl *functionDecl);
+        bool gen(AST::VarDecl *varDecl);
+        bool gen(AST::IntegerLiteral *integerLiteral);
+        bool gen(AST::FloatingLiteral *floatingLiteral);
+        bool gen(AST::CharacterLiteral *charLiteral);
+        bool gen(AST::StringLiteral *strLiteral);
+        bool gen(AST::DeclRefExpr *declRefExpr);
+        bool gen(AST::CastExpr *castExpr);
+        bool gen(AST::ImplicitCastExpr *implicitCastExpr);
+        bool gen(AST::BinaryOperator *binaryOperator);
+        bool gen(AST::UnaryOperator *unaryOperator);
+        bool gen(AST::ParenExpr *parenExpr);
+        bool gen(AST::CompoundStmt *compoundStmt);
+        bool gen(AST::DeclStmt *declStmt);
+        bool gen(AST::IfStmt *ifStmt);
+        bool gen(AST::ValueStmt *valueStmt);
+        bool gen(AST::ReturnStmt *returnStmt);
+        bool gen(AST::WhileStmt *whileStmt);
+        bool gen(AST::CallExpr *callExpr);
+        bool gen(AST::NullStmt *nullStmt);
+        bool gen(AST::AsmStmt *asmStmt);
+        bool gen(AST::ArraySubscriptExpr *arraySubscriptExpr);
 
     private:
         std::shared_ptr<SymbolTable> mkTable(std::shared_ptr<SymbolTable> previous = nullptr);
         void changeTable(std::shared_ptr<SymbolTable> table);
-        bool enter(std::string name, std::string type, int width);
+        uint32_t enter(std::string name, std::string type, int width);
         bool registerFunc(std::string name, std::string type, int entry, bool isInitialized);
-        std::shared_ptr<SymbolTableItem> lookup(std::string name);
-        std::shared_ptr<SymbolTableItem> lookupCurrentTbl(std::string name);
-        void emit(QuaternionOperator op, std::shared_ptr<Arg> arg1, std::shared_ptr<Arg> arg2, std::shared_ptr<Arg> result);
-        std::shared_ptr<SymbolTableItem> newtemp(std::string type, int width);
+        void emit(QuaternionOperator op, Arg arg1, Arg arg2, Arg result);
+        uint32_t newtemp(std::string type, int width);
+        uint32_t newtemp(const AST::Type *type); // temp holding a value of an Expr's type
+        // visits the index of an element, offset becomes the temp holding its byte offset or NoSymbol
+        // when the array can't be lowered, which counts the element as unlowered
+        bool elementOffset(AST::ArraySubscriptExpr *element, uint32_t &offset);
+        // a[i] = v, a[i] op= v and increments of a[i] load the element when they read it and store the value back
+        bool genElementUpdate(AST::ArraySubscriptExpr *element, QuaternionOperator op, AST::Expr *rhs, AST::Expr *expr);
+        // moves the temps of a function into a pool at the end of its first table, temps whose live
+        // ranges don't overlap share a slot, so the frame grows with the temps live at once
+        void recycleTemps(size_t function);
+        uint32_t &place(const AST::ASTNode *node);
+        std::string argToString(const Arg &arg) const;
+        void writeCode(std::ostream &os) const; // shared by printCode and dumpCode
 
         static QuaternionOperator BinaryOpToQuaternionOp(AST::BinaryOpType op);
         static QuaternionOperator UnaryOpToQuaternionOp(AST::UnaryOpType op);
+        // array symbols keep the C spelling of their type, e.g. "int[10]", their elements are 4 bytes
+        static bool isArrayType(const std::string &type) { return !type.empty() && type.back() == ']'; }
+        static std::string elementType(const std::string &type) { return type.substr(0, type.find('[')); } // type itself for scalars
 
     public:
         virtual void printCode() const override;
         virtual void dumpCode(const std::string outPath) const override;
+        size_t numCodes() const { return _codes.size(); }
+        size_t numUnlowered() const { return _numUnlowered; } // nodes left without codes, their values are missing
 
     private:
         std::vector<std::shared_ptr<SymbolTable>> _tables;
         std::shared_ptr<SymbolTable> _currentSymbolTable;
         std::vector<FunctionTableItem> _functionTable;
+        std::unordered_map<std::string, uint32_t> _functionIds; // name -> index into _functionTable
+        std::vector<std::string> _strings;                      // string literals, STRING operands refer to them by index
+        std::vector<SymbolTableItem> _symbols; // entries of all tables, operands refer to them by index
         std::vector<Quaternion> _codes;
+        std::vector<uint32_t> _places; // node id -> symbol holding the node's value, a VarDecl's is the variable itself
+        size_t _numUnlowered{0};
+        int _numTemps{0}; // names the next temp, counted per function and separately for the globals
     };
 
-    class LLVMIRGenerator : public IRGeneratorBase
+    class LLVMIRGenerator : public IRGeneratorBase, public AST::ASTVisitor<LLVMIRGenerator>
     {
-        typedef struct _SymbolTable
-        {
-            _SymbolTable(std::shared_ptr<_SymbolTable> previous) : previous(previous){};
-            std::shared_ptr<_SymbolTable> previous;
-            std::map<std::string, llvm::AllocaInst *> symbls;
-        } SymbolTable;
-
         typedef struct _FuncContext
         {
             llvm::BasicBlock *entryBB{nullptr};
@@ -261,42 +295,105 @@ namespace lcc
         static std::unique_ptr<LLVMIRGenerator> _inst;
 
     public:
-        virtual bool gen(AST::TranslationUnitDecl *translationUnitDecl) override;
-        virtual bool gen(AST::FunctionDecl *functionDecl) override;
-        virtual bool gen(AST::VarDecl *varDecl) override;
-        virtual bool gen(AST::IntegerLiteral *integerLiteral) override;
-        virtual bool gen(AST::FloatingLiteral *floatingLiteral) override;
-        virtual bool gen(AST::CharacterLiteral *charLiteral) override;
-        virtual bool gen(AST::StringLiteral *strLiteral) override;
-        virtual bool gen(AST::DeclRefExpr *declRefExpr) override;
-        virtual bool gen(AST::CastExpr *castExpr) override;
-        virtual bool gen(AST::ImplicitCastExpr *implicitCastExpr) override;
-        virtual bool gen(AST::BinaryOperator *binaryOperator) override;
-        virtual bool gen(AST::UnaryOperator *unaryOperator) override;
-        virtual bool gen(AST::ParenExpr *parenExpr) override;
-        virtual bool gen(AST::CompoundStmt *compoundStmt) override;
-        virtual bool gen(AST::DeclStmt *declStmt) override;
-        virtual bool gen(AST::IfStmt *ifStmt) override;
-        virtual bool gen(AST::ValueStmt *valueStmt) override;
-        virtual bool gen(AST::ReturnStmt *returnStmt) override;
-        virtual bool gen(AST::WhileStmt *whileStmt) override;
-        virtual bool gen(AST::CallExpr *callExpr) override;
-        virtual bool gen(AST::AsmStmt *asmStmt) override;
-        virtual bool gen(AST::ArraySubscriptExpr *arraySubscriptExpr) override;
+        virtual bool generate(AST::ASTNode *astNode) override;
+
+        bool gen(AST::TranslationUnitDecl *translationUnitDecl);
+        bool gen(AST::FunctionDecl *functionDecl);
+        bool gen(AST::VarDecl *varDecl);
+        bool gen(AST::IntegerLiteral *integerLiteral);
+        bool gen(AST::FloatingLiteral *floatingLiteral);
+        bool gen(AST::CharacterLiteral *charLiteral);
+        bool gen(AST::StringLiteral *strLiteral);
+        bool gen(AST::DeclRefExpr *declRefExpr);
+        bool gen(AST::CastExpr *castExpr);
+        bool gen(AST::ImplicitCastExpr *implicitCastExpr);
+        bool gen(AST::BinaryOperator *binaryOperator);
+        bool gen(AST::UnaryOperator *unaryOperator);
+        bool gen(AST::ParenExpr *parenExpr);
+        bool gen(AST::CompoundStmt *compoundStmt);
+        bool gen(AST::DeclStmt *declStmt);
+        bool gen(AST::IfStmt *ifStmt);
+        bool gen(AST::ValueStmt *valueStmt);
+        bool gen(AST::ReturnStmt *returnStmt);
+        bool gen(AST::WhileStmt *whileStmt);
+        bool gen(AST::CallExpr *callExpr);
+        bool gen(AST::NullStmt *nullStmt);
+        bool gen(AST::AsmStmt *asmStmt);
+        bool gen(AST::ArraySubscriptExpr *arraySubscriptExpr);
 
     public:
+        ~LLVMIRGenerator() { waitForDump(); }
+
         virtual void printCode() const override;
         virtual void dumpCode(const std::string outPath) const override;
+        // snapshots the module as bitcode and prints it to outPath on a background thread with its own
+        // context, the module may be compiled meanwhile. waitForDump() joins the thread.
+        void dumpCodeInBackground(const std::string &outPath);
+        void waitForDump();
+
+        // hands the module to the code generator without a textual round trip, it keeps using the
+        // generator's context
+        std::unique_ptr<llvm::Module> takeModule() { return std::move(_module); }
+
+        // streaming, every function definition is printed to a temporary spool as soon as it is generated
+        // and only its declaration stays in the module. closeStream() writes the globals to outPath and
+        // then the declarations and spooled definitions in module order, the layout of dumpCode()
+        bool openStream(const std::string &outPath);
+        void closeStream();
 
     private:
-        std::shared_ptr<SymbolTable> mkTable(std::shared_ptr<SymbolTable> previous = nullptr);
-        llvm::Value *lookup(std::string name);
-        llvm::Value *lookupCurrentTbl(std::string name);
-        bool enter(std::string name, llvm::AllocaInst *alloca);
-        llvm::AllocaInst *createEntryBlockAlloca(llvm::Function *function, const std::string &name, const std::string type);
-        void changeTable(std::shared_ptr<SymbolTable> table);
+        // with Options::IRGenThreads > 1 the globals and prototypes are generated here and the function
+        // definitions in chunks of IRGEN_CHUNK_SIZE on a thread pool, each chunk by a generator with its
+        // own context and module. The chunks are linked back in order through bitcode, so the output
+        // doesn't depend on the thread count. A chunk whose IR doesn't verify can't go through bitcode and
+        // is generated again here, leaving the module as a serial run does.
+        bool genParallel(AST::TranslationUnitDecl *translationUnitDecl);
+        llvm::Function *declareFunction(const AST::FunctionDecl *functionDecl);
+
+        llvm::Value *&declValue(const AST::Decl *decl);
+        // declValue() of a referenced decl, a chunk declares the globals and functions it uses on first use
+        llvm::Value *referencedValue(const AST::Decl *decl);
+        llvm::AllocaInst *createEntryBlockAlloca(llvm::Function *function, const std::string &name, const AST::Type *type);
+        // an entry block alloca for arrays or with Options::UseEntryAllocas, a variable in SSA form otherwise
+        llvm::AllocaInst *createVariable(llvm::Function *function, const std::string &name, const AST::Type *type);
+        // the value of an lvalue, an alloca, global, array element or SSA variable. nullptr for other values
+        llvm::Value *load(llvm::Value *lvalue);
+        // returns the store, or the value converted to the variable's type for an SSA variable
+        llvm::Value *store(llvm::Value *value, llvm::Value *lvalue);
+        llvm::Value *convert(llvm::Value *value, llvm::Type *type);
+        llvm::Type *toLLVMType(const AST::Type *type);
         void updateFuncContext(llvm::BasicBlock *entryBB, llvm::BasicBlock *retBB, llvm::AllocaInst *retValAlloca);
 
+        // SSA construction on the fly(Braun et al., Simple and Efficient Construction of Static Single
+        // Assignment Form). Scalar locals and parameters can't have their address taken, each is a detached
+        // alloca that is never inserted and only identifies it. Writes record the current definition in the
+        // insertion block, reads look it up through the predecessors and place phis at joins. A block is
+        // sealed once all its predecessors are known, phis of unsealed blocks get their operands then.
+        // Lookups and phi removal loop over explicit worklists, chains of ifs are as long as the function.
+        typedef struct _PendingPhi
+        {
+            llvm::WeakVH phi; // null once removed
+            llvm::SmallVector<llvm::BasicBlock *, 4> preds;
+            size_t next; // index into preds of the next operand to read
+            // the operand read from preds[next - 1] is added once the phis its lookup pushed are done,
+            // an incomplete phi mustn't be retried when one of them is removed
+            bool isWaiting;
+            llvm::WeakTrackingVH operand;
+        } PendingPhi;
+
+        static bool isSSAVariable(const llvm::Value *value);
+        void writeVariable(llvm::AllocaInst *variable, llvm::BasicBlock *block, llvm::Value *value);
+        llvm::Value *readVariable(llvm::AllocaInst *variable, llvm::BasicBlock *block);
+        // walks up single predecessors to a definition or a phi, phis of sealed joins are pushed to pending
+        llvm::Value *lookupVariable(llvm::AllocaInst *variable, llvm::BasicBlock *block, std::vector<PendingPhi> &pending);
+        // reads the operands of the pending phis, the lookups may push more, each done phi is tried for removal
+        void addPhiOperands(llvm::AllocaInst *variable, std::vector<PendingPhi> &pending);
+        // a phi merging a single value besides itself is replaced by it, phis using it are retried
+        llvm::Value *tryRemoveTrivialPhi(llvm::PHINode *phi);
+        llvm::PHINode *createPhi(llvm::AllocaInst *variable, llvm::BasicBlock *block);
+        void sealBlock(llvm::BasicBlock *block);
+        void clearVariables(); // at the end of a function, deletes its SSA variables
+
         // some pasted methods for ir gen, thanks clang
     private:
         static std::string generateAsmString(AST::AsmStmt *asmStmt);
@@ -309,11 +406,23 @@ namespace lcc
         std::unique_ptr<llvm::IRBuilder<>> _builder;
         std::unique_ptr<llvm::Module> _module;
 
-        std::shared_ptr<SymbolTable> _currentSymbolTable;
-        std::vector<std::shared_ptr<SymbolTable>> _tables;
+        std::vector<llvm::Value *> _declValues; // decl node id -> its alloca, global or function, names are resolved by Sema
 
         FuncContext _fc;
+        std::vector<llvm::AllocaInst *> _variables; // SSA variables of the current function
+        llvm::DenseMap<std::pair<llvm::AllocaInst *, llvm::BasicBlock *>, llvm::WeakTrackingVH> _currentDefs; // follow trivial phi removal
+        llvm::DenseMap<llvm::BasicBlock *, std::vector<std::pair<llvm::AllocaInst *, llvm::PHINode *>>> _incompletePhis;
+        llvm::SmallPtrSet<llvm::BasicBlock *, 16> _sealedBlocks;
+        std::vector<llvm::Type *> _llvmTypes; // AST type id -> lowered type, filled on first use
 
         llvm::Value *_retVal{nullptr};
+
+        std::unique_ptr<llvm::raw_fd_ostream> _stream;
+        std::unique_ptr<llvm::raw_fd_ostream> _spool; // text of the streamed definitions
+        llvm::SmallString<128> _spoolPath;
+        std::unique_ptr<llvm::Module> _printModule; // holds a function while it is printed
+        std::unordered_map<const llvm::Function *, uint64_t> _streamedFunctions; // -> size of its text in _spool
+        std::thread _dumpThread;
+        bool _isChunk{false}; // generates some function definitions of a parallel run
     };
 }
\ No newline at end of file
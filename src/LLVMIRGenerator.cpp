@@ -1,5 +1,8 @@
 #include "lcc.hpp"
 
+// function definitions a worker of parallel generation puts into one module
+#define IRGEN_CHUNK_SIZE 64
+
 #define LLVMIRGEN_RET_TRUE(val) do\
     {                           \
         _retVal = (val);        \
@@ -20,8 +23,6 @@ namespace lcc
     {
         _builder = std::make_unique<llvm::IRBuilder<>>(_context);
         _module = std::make_unique<llvm::Module>("LCC_LLVMIRGenerator", _context);
-
-        changeTable(mkTable());
     }
 
     void LLVMIRGenerator::dumpCode(const std::string outPath) const
@@ -34,103 +35,434 @@ namespace lcc
         return;
     }
 
+    void LLVMIRGenerator::dumpCodeInBackground(const std::string &outPath)
+    {
+        waitForDump();
+
+        // the bitcode reader rejects broken modules, and those are the dumps worth reading
+        if (llvm::verifyModule(*_module))
+        {
+            dumpCode(outPath);
+            return;
+        }
+
+        // writing bitcode is cheaper than printing, and a module of its own lets the
+        // thread print while codegen changes this one
+        llvm::SmallVector<char, 0> bitcode;
+        llvm::raw_svector_ostream bitcodeOS(bitcode);
+        llvm::WriteBitcodeToFile(*_module, bitcodeOS);
+
+        _dumpThread = std::thread([outPath, id = _module->getModuleIdentifier(), bitcode = std::move(bitcode)]()
+        {
+            llvm::LLVMContext context;
+            auto module = llvm::parseBitcodeFile(llvm::MemoryBufferRef(llvm::StringRef(bitcode.data(), bitcode.size()), id), context);
+            if (!module)
+            {
+                WARNING("Can't dump IR to " << outPath << ": " << llvm::toString(module.takeError()));
+                return;
+            }
+
+            std::error_code err;
+            llvm::raw_fd_ostream os(outPath, err);
+            if (err)
+            {
+                WARNING("Can't open " << outPath << ": " << err.message());
+                return;
+            }
+            (*module)->print(os, nullptr, false, false);
+        });
+    }
+
+    void LLVMIRGenerator::waitForDump()
+    {
+        if (_dumpThread.joinable())
+            _dumpThread.join();
+    }
+
+    bool LLVMIRGenerator::openStream(const std::string &outPath)
+    {
+        std::error_code err;
+        _stream = std::make_unique<llvm::raw_fd_ostream>(outPath, err);
+        if (err)
+        {
+            FATAL_ERROR("Can't open " << outPath << ": " << err.message());
+            _stream = nullptr;
+            return false;
+        }
+
+        // the functions wait on disk until the globals they use have been written ahead of them
+        int fd = -1;
+        err = llvm::sys::fs::createTemporaryFile("lcc-stream", "ll", fd, _spoolPath);
+        if (err)
+        {
+            FATAL_ERROR("Can't create a temporary file: " << err.message());
+            _stream = nullptr;
+            return false;
+        }
+        _spool = std::make_unique<llvm::raw_fd_ostream>(fd, true);
+
+        _printModule = std::make_unique<llvm::Module>(_module->getModuleIdentifier(), _context);
+        _printModule->setDataLayout(_module->getDataLayout());
+        _streamedFunctions.clear();
+        _module->print(*_stream, nullptr); // module header, nothing has been generated yet
+        return true;
+    }
+
+    void LLVMIRGenerator::closeStream()
+    {
+        // laid out as a module prints, the globals first and then the functions in order
+        if (!_module->global_empty())
+            *_stream << "\n";
+        for (auto &global : _module->globals())
+        {
+            global.print(*_stream);
+            *_stream << "\n";
+        }
+
+        // the definitions are in the spool in module order, a copy needs one function in memory at a time
+        _spool->close();
+        std::ifstream spool(_spoolPath.c_str(), std::ios::binary);
+        std::vector<char> text;
+        for (auto &func : *_module)
+        {
+            *_stream << "\n";
+            auto it = _streamedFunctions.find(&func);
+            if (it == _streamedFunctions.end())
+            {
+                func.print(*_stream);
+                continue;
+            }
+
+            text.resize(it->second);
+            spool.read(text.data(), text.size());
+            _stream->write(text.data(), text.size());
+        }
+        spool.close();
+        llvm::sys::fs::remove(_spoolPath);
+
+        _spool = nullptr;
+        _printModule = nullptr;
+        _stream->close();
+        _stream = nullptr;
+    }
+
     void LLVMIRGenerator::printCode() const
     {
         // TODO debug print
         _module->print(llvm::outs(), nullptr);
     }
 
-    std::shared_ptr<LLVMIRGenerator::SymbolTable> LLVMIRGenerator::mkTable(std::shared_ptr<SymbolTable> previous)
+    llvm::Value *&LLVMIRGenerator::declValue(const AST::Decl *decl)
+    {
+        if (decl->id() >= _declValues.size()) // grow to cover the whole AST at once, returned references stay valid
+            _declValues.resize(std::max<size_t>(decl->id() + 1, AST::ASTContext::current()->numNodes()), nullptr);
+
+        return _declValues[decl->id()];
+    }
+
+    llvm::Value *LLVMIRGenerator::referencedValue(const AST::Decl *decl)
     {
-        auto tbl = std::make_shared<SymbolTable>(previous);
-        _tables.push_back(tbl);
-        return tbl;
+        llvm::Value *&value = declValue(decl);
+        if (value != nullptr || !_isChunk)
+            return value;
+
+        // locals are defined before their uses, what is missing belongs to the translation unit
+        if (decl->kind() == AST::ASTNode::Kind::FunctionDecl)
+            return declareFunction(static_cast<const AST::FunctionDecl *>(decl));
+        else if (decl->kind() == AST::ASTNode::Kind::VarDecl)
+        {
+            auto varDecl = static_cast<const AST::VarDecl *>(decl);
+            if (llvm::Type *varType = toLLVMType(varDecl->type()))
+                value = new llvm::GlobalVariable(*_module, varType, false, llvm::GlobalValue::ExternalLinkage, nullptr, varDecl->name());
+        }
+
+        return value;
     }
 
-    void LLVMIRGenerator::changeTable(std::shared_ptr<SymbolTable> table)
+    llvm::AllocaInst *LLVMIRGenerator::createEntryBlockAlloca(llvm::Function *function, const std::string &name, const AST::Type *type)
     {
-        _currentSymbolTable = table;
+        llvm::IRBuilder<> builder(&function->getEntryBlock(), function->getEntryBlock().begin());
+        llvm::Type *varType = toLLVMType(type);
+        if (varType == nullptr || type->isVoid())
+            return nullptr;
+
+        return builder.CreateAlloca(varType, 0, name.c_str());
     }
 
-    llvm::Value *LLVMIRGenerator::lookupCurrentTbl(std::string name)
+    llvm::AllocaInst *LLVMIRGenerator::createVariable(llvm::Function *function, const std::string &name, const AST::Type *type)
     {
-        if (_currentSymbolTable->symbls.find(name) == _currentSymbolTable->symbls.end())
+        if (Options::UseEntryAllocas || !type->isBuiltin())
+            return createEntryBlockAlloca(function, name, type);
+
+        llvm::Type *varType = toLLVMType(type);
+        if (varType == nullptr || type->isVoid())
             return nullptr;
 
-        return _currentSymbolTable->symbls[name];
+        // never inserted into a block, which the alignment would be looked up through
+        const llvm::DataLayout &dataLayout = _module->getDataLayout();
+        auto variable = new llvm::AllocaInst(varType, dataLayout.getAllocaAddrSpace(), nullptr, dataLayout.getPrefTypeAlign(varType),
+                                             name, static_cast<llvm::Instruction *>(nullptr));
+        _variables.push_back(variable);
+        return variable;
     }
 
-    llvm::Value *LLVMIRGenerator::lookup(std::string name)
+    llvm::Value *LLVMIRGenerator::load(llvm::Value *lvalue)
     {
-        auto currentTbl = _currentSymbolTable;
-        llvm::Value *pVal = nullptr;
-        for (_currentSymbolTable; _currentSymbolTable != nullptr; changeTable(_currentSymbolTable->previous))
+        if (auto alloca = llvm::dyn_cast<llvm::AllocaInst>(lvalue))
         {
-            pVal = lookupCurrentTbl(name);
-            if (pVal != nullptr)
+            if (isSSAVariable(alloca))
+                return readVariable(alloca, _builder->GetInsertBlock());
+            return _builder->CreateLoad(alloca->getAllocatedType(), alloca);
+        }
+        else if (auto glbVar = llvm::dyn_cast<llvm::GlobalVariable>(lvalue))
+            return _builder->CreateLoad(glbVar->getValueType(), glbVar);
+        else if (auto gepInst = llvm::dyn_cast<llvm::GetElementPtrInst>(lvalue))
+            return _builder->CreateLoad(gepInst->getResultElementType(), gepInst);
+
+        return nullptr;
+    }
+
+    llvm::Value *LLVMIRGenerator::store(llvm::Value *value, llvm::Value *lvalue)
+    {
+        if (isSSAVariable(lvalue))
+        {
+            auto variable = llvm::cast<llvm::AllocaInst>(lvalue);
+            value = convert(value, variable->getAllocatedType()); // phis need their operands to agree
+            writeVariable(variable, _builder->GetInsertBlock(), value);
+            return value;
+        }
+
+        return _builder->CreateStore(value, lvalue);
+    }
+
+    llvm::Value *LLVMIRGenerator::convert(llvm::Value *value, llvm::Type *type)
+    {
+        llvm::Type *valueType = value->getType();
+        if (valueType == type)
+            return value;
+
+        if (valueType->isIntegerTy() && type->isIntegerTy())
+            return _builder->CreateIntCast(value, type, true);
+        else if (valueType->isIntegerTy() && type->isFloatingPointTy())
+            return _builder->CreateSIToFP(value, type);
+        else if (valueType->isFloatingPointTy() && type->isIntegerTy())
+            return _builder->CreateFPToSI(value, type);
+        else if (valueType->isPointerTy() && type->isPointerTy())
+            return _builder->CreatePointerCast(value, type);
+
+        return value;
+    }
+
+    bool LLVMIRGenerator::isSSAVariable(const llvm::Value *value)
+    {
+        auto alloca = llvm::dyn_cast<llvm::AllocaInst>(value);
+        return alloca != nullptr && alloca->getParent() == nullptr;
+    }
+
+    void LLVMIRGenerator::writeVariable(llvm::AllocaInst *variable, llvm::BasicBlock *block, llvm::Value *value)
+    {
+        _currentDefs[{variable, block}] = value;
+    }
+
+    llvm::Value *LLVMIRGenerator::readVariable(llvm::AllocaInst *variable, llvm::BasicBlock *block)
+    {
+        std::vector<PendingPhi> pending;
+        llvm::WeakTrackingVH value(lookupVariable(variable, block, pending)); // follows the phi if it is removed
+        addPhiOperands(variable, pending);
+        return value;
+    }
+
+    llvm::Value *LLVMIRGenerator::lookupVariable(llvm::AllocaInst *variable, llvm::BasicBlock *block, std::vector<PendingPhi> &pending)
+    {
+        llvm::SmallVector<llvm::BasicBlock *, 8> path; // the blocks walked through take the value found
+        llvm::Value *value = nullptr;
+        while (value == nullptr)
+        {
+            auto it = _currentDefs.find({variable, block});
+            if (it != _currentDefs.end() && it->second != nullptr)
+            {
+                value = it->second;
                 break;
+            }
+
+            path.push_back(block);
+            if (!_sealedBlocks.count(block))
+            {
+                // more predecessors may come, the operands are added when the block is sealed
+                auto phi = createPhi(variable, block);
+                _incompletePhis[block].push_back({variable, phi});
+                value = phi;
+            }
+            else if (auto pred = block->getSinglePredecessor())
+                block = pred; // no phi needed
+            else if (llvm::pred_empty(block))
+                value = llvm::UndefValue::get(variable->getAllocatedType()); // read before any write
+            else
+            {
+                // the phi is the definition before its operands are read, which breaks cycles through loops
+                auto phi = createPhi(variable, block);
+                pending.push_back({phi, {llvm::pred_begin(block), llvm::pred_end(block)}, 0, false, nullptr});
+                value = phi;
+            }
         }
-        changeTable(currentTbl);
 
-        if (pVal != nullptr)
-            return pVal;
+        for (auto walked : path)
+            writeVariable(variable, walked, value);
+        return value;
+    }
 
-        pVal = _module->getGlobalVariable(name); // llvm::GlobalVariable is a pointer to the actual global var
+    void LLVMIRGenerator::addPhiOperands(llvm::AllocaInst *variable, std::vector<PendingPhi> &pending)
+    {
+        // the phis pushed by a lookup are done before the next operand of the one below, as recursion would
+        while (!pending.empty())
+        {
+            PendingPhi &top = pending.back();
+            auto phi = llvm::dyn_cast_or_null<llvm::PHINode>(top.phi);
+            if (top.isWaiting)
+            {
+                top.isWaiting = false;
+                if (phi != nullptr)
+                    phi->addIncoming(top.operand, top.preds[top.next - 1]);
+            }
+            if (phi == nullptr || top.next == top.preds.size())
+            {
+                pending.pop_back();
+                if (phi != nullptr)
+                    tryRemoveTrivialPhi(phi);
+                continue;
+            }
 
-        return pVal;
+            llvm::BasicBlock *pred = top.preds[top.next++];
+            size_t depth = pending.size();
+            llvm::Value *operand = lookupVariable(variable, pred, pending); // may push, top is stale then
+            if (pending.size() == depth)
+                phi->addIncoming(operand, pred);
+            else
+            {
+                pending[depth - 1].isWaiting = true;
+                pending[depth - 1].operand = operand;
+            }
+        }
     }
 
-    bool LLVMIRGenerator::enter(std::string name, llvm::AllocaInst *alloca)
+    llvm::Value *LLVMIRGenerator::tryRemoveTrivialPhi(llvm::PHINode *phi)
     {
-        if (lookupCurrentTbl(name) != nullptr)
-            return false;
+        llvm::WeakTrackingVH result(phi); // follows the replacements
+        llvm::SmallVector<llvm::WeakVH, 8> worklist{phi};
+        while (!worklist.empty())
+        {
+            auto candidate = llvm::dyn_cast_or_null<llvm::PHINode>(worklist.pop_back_val());
+            if (candidate == nullptr)
+                continue;
 
-        _currentSymbolTable->symbls.insert(std::make_pair(name, alloca));
-        return true;
+            llvm::Value *same = nullptr;
+            bool isTrivial = true;
+            for (auto &op : candidate->incoming_values())
+            {
+                if (op == same || op == candidate)
+                    continue;
+                if (same != nullptr)
+                {
+                    isTrivial = false; // merges at least two values
+                    break;
+                }
+                same = op;
+            }
+            if (!isTrivial)
+                continue;
+
+            if (same == nullptr)
+                same = llvm::UndefValue::get(candidate->getType()); // unreachable or in the entry block
+
+            // the users are retried in order, each with the phis it frees first
+            llvm::SmallVector<llvm::WeakVH, 8> phiUsers;
+            for (auto user : candidate->users())
+                if (user != candidate && llvm::isa<llvm::PHINode>(user))
+                    phiUsers.push_back(user);
+            worklist.append(phiUsers.rbegin(), phiUsers.rend());
+
+            candidate->replaceAllUsesWith(same); // the current definitions follow through their handles
+            candidate->eraseFromParent();
+        }
+
+        return result;
     }
 
-    llvm::AllocaInst *LLVMIRGenerator::createEntryBlockAlloca(llvm::Function *function, const std::string &name, const std::string type)
+    llvm::PHINode *LLVMIRGenerator::createPhi(llvm::AllocaInst *variable, llvm::BasicBlock *block)
     {
-        llvm::IRBuilder<> builder(&function->getEntryBlock(), function->getEntryBlock().begin());
-        std::string elemType = type;
-        size_t numElems = 0;
-        bool isArray = false;
+        if (auto first = block->getFirstNonPHI())
+            return llvm::PHINode::Create(variable->getAllocatedType(), 2, variable->getName(), first);
 
-        if (type[type.size() - 1] == ']') // is array type
+        return llvm::PHINode::Create(variable->getAllocatedType(), 2, variable->getName(), block);
+    }
+
+    void LLVMIRGenerator::sealBlock(llvm::BasicBlock *block)
+    {
+        if (!_sealedBlocks.insert(block).second)
+            return;
+
+        auto it = _incompletePhis.find(block);
+        if (it == _incompletePhis.end())
+            return;
+
+        auto phis = std::move(it->second);
+        _incompletePhis.erase(it);
+        std::vector<PendingPhi> pending;
+        for (auto &[variable, phi] : phis)
         {
-            isArray = true;
-            auto x = type.find('[');
-            elemType = type.substr(0, x);
-            numElems = std::stoi(type.substr(x + 1, type.size() - x - 2));
+            pending.push_back({phi, {llvm::pred_begin(block), llvm::pred_end(block)}, 0, false, nullptr});
+            addPhiOperands(variable, pending);
         }
+    }
 
-        llvm::Type* varType = nullptr;
-
-        if (elemType == "int")
-            varType = llvm::Type::getInt32Ty(_context);
-            // return builder.CreateAlloca(llvm::Type::getInt32Ty(_context), 0, name.c_str());
-        else if (elemType == "float")
-            varType = llvm::Type::getFloatTy(_context);
-            // return builder.CreateAlloca(llvm::Type::getFloatTy(_context), 0, name.c_str());
-        else if (elemType == "char")
-            varType = llvm::Type::getInt8Ty(_context);
-            // return builder.CreateAlloca(llvm::Type::getInt8Ty(_context), 0, name.c_str());
-        else if (elemType == "int*")
-            varType = llvm::Type::getInt32PtrTy(_context);
-            // return builder.CreateAlloca(llvm::Type::getInt32PtrTy(_context), 0, name.c_str());
-        else if (elemType == "float*")
-            varType = llvm::Type::getFloatPtrTy(_context);
-            // return builder.CreateAlloca(llvm::Type::getFloatPtrTy(_context), 0, name.c_str());
-        else if (elemType == "char*")
-            varType = llvm::Type::getInt8PtrTy(_context);
-            // return builder.CreateAlloca(llvm::Type::getInt8PtrTy(_context), 0, name.c_str());
-        else
-            return nullptr;
+    void LLVMIRGenerator::clearVariables()
+    {
+        _currentDefs.clear();
+        _incompletePhis.clear();
+        _sealedBlocks.clear();
 
-        if(isArray)
-            varType = llvm::ArrayType::get(varType, numElems);
+        for (auto variable : _variables)
+            variable->deleteValue();
+        _variables.clear();
+    }
 
-        return builder.CreateAlloca(varType, 0, name.c_str());
+    llvm::Type *LLVMIRGenerator::toLLVMType(const AST::Type *type)
+    {
+        if (type->id() < _llvmTypes.size() && _llvmTypes[type->id()] != nullptr)
+            return _llvmTypes[type->id()];
+
+        llvm::Type *llvmType = nullptr;
+        switch (type->kind())
+        {
+        case AST::Type::Kind::Void:
+            llvmType = llvm::Type::getVoidTy(_context);
+            break;
+        case AST::Type::Kind::Char:
+            llvmType = llvm::Type::getInt8Ty(_context);
+            break;
+        case AST::Type::Kind::Int:
+            llvmType = llvm::Type::getInt32Ty(_context);
+            break;
+        case AST::Type::Kind::Float:
+            llvmType = llvm::Type::getFloatTy(_context);
+            break;
+        case AST::Type::Kind::Pointer:
+            if (type->elementType()->isVoid()) // FIXME: support void*
+                llvmType = llvm::Type::getInt32PtrTy(_context);
+            else if (auto pointeeType = toLLVMType(type->elementType()))
+                llvmType = llvm::PointerType::getUnqual(pointeeType);
+            break;
+        case AST::Type::Kind::Array:
+            if (!type->elementType()->isVoid())
+                if (auto elementType = toLLVMType(type->elementType()))
+                    llvmType = llvm::ArrayType::get(elementType, type->length());
+            break;
+        }
+
+        if (type->id() >= _llvmTypes.size())
+            _llvmTypes.resize(AST::Type::numTypes(), nullptr);
+        _llvmTypes[type->id()] = llvmType;
+        return llvmType;
     }
 
     void LLVMIRGenerator::updateFuncContext(llvm::BasicBlock *entryBB, llvm::BasicBlock *retBB, llvm::AllocaInst *retValAlloca)
@@ -140,79 +472,177 @@ namespace lcc
         _fc.retValAlloca = retValAlloca;
     }
 
+    bool LLVMIRGenerator::generate(AST::ASTNode *astNode)
+    {
+        return visit(astNode);
+    }
+
     bool LLVMIRGenerator::gen(AST::TranslationUnitDecl *translationUnitDecl)
     {
+        if (Options::IRGenThreads > 1)
+        {
+            if (!genParallel(translationUnitDecl))
+                LLVMIRGEN_RET_FALSE();
+            LLVMIRGEN_RET_TRUE(nullptr);
+        }
+
         for (auto &decl : translationUnitDecl->_decls)
-            if (!decl->gen(this))
+            if (!visit(decl))
                 LLVMIRGEN_RET_FALSE();
 
         LLVMIRGEN_RET_TRUE(nullptr);
     }
 
-    bool LLVMIRGenerator::gen(AST::FunctionDecl *functionDecl)
+    bool LLVMIRGenerator::genParallel(AST::TranslationUnitDecl *translationUnitDecl)
     {
-        std::vector<llvm::Type *> params;
-        for (auto &param : functionDecl->_params)
+        // the globals are defined here, the chunks only declare them
+        std::vector<AST::FunctionDecl *> definitions;
+        for (auto &decl : translationUnitDecl->_decls)
         {
-            if (param->type() == "int")
-                params.push_back(llvm::Type::getInt32Ty(_context));
-            else if (param->type() == "char")
-                params.push_back(llvm::Type::getInt8Ty(_context));
-            else if (param->type() == "float")
-                params.push_back(llvm::Type::getFloatTy(_context));
-            else if (param->type() == "void*") // FIXME: support void*
-                params.push_back(llvm::PointerType::getInt32PtrTy(_context));
-            else if (param->type() == "int*")
-                params.push_back(llvm::PointerType::getInt32PtrTy(_context));
-            else if (param->type() == "char*")
-                params.push_back(llvm::PointerType::getInt8PtrTy(_context));
-            else if (param->type() == "float*")
-                params.push_back(llvm::PointerType::getFloatPtrTy(_context));
-            else
-                LLVMIRGEN_RET_FALSE();
+            if (decl->kind() != AST::ASTNode::Kind::FunctionDecl)
+            {
+                if (!visit(decl))
+                    return false;
+                continue;
+            }
+
+            auto functionDecl = static_cast<AST::FunctionDecl *>(decl.get());
+            if (declareFunction(functionDecl) == nullptr)
+                return false;
+            if (functionDecl->_body != nullptr)
+                definitions.push_back(functionDecl);
         }
 
-        llvm::FunctionType *ft = nullptr;
-        llvm::Type *funcRetType = nullptr;
-
-        if (functionDecl->_type == "void")
-            funcRetType = llvm::Type::getVoidTy(_context);
-        else if (functionDecl->_type == "int")
-            funcRetType = llvm::Type::getInt32Ty(_context);
-        else if (functionDecl->_type == "float")
-            funcRetType = llvm::Type::getFloatTy(_context);
-        else if (functionDecl->_type == "char")
-            funcRetType = llvm::Type::getInt8Ty(_context);
-        else if (functionDecl->_type == "int*")
-            funcRetType = llvm::PointerType::getInt32PtrTy(_context);
-        else if (functionDecl->_type == "float*")
-            funcRetType = llvm::PointerType::getFloatPtrTy(_context);
-        else if (functionDecl->_type == "char*")
-            funcRetType = llvm::PointerType::getInt8PtrTy(_context);
-        else
+        std::vector<std::string> functionNames; // in the order serial generation creates them
+        for (auto &func : *_module)
+            functionNames.push_back(func.getName().str());
+        std::vector<std::string> globalNames;
+        for (auto &var : _module->globals())
+            globalNames.push_back(var.getName().str());
+
+        // chunks don't depend on the thread count, neither does the output
+        size_t numChunks = (definitions.size() + IRGEN_CHUNK_SIZE - 1) / IRGEN_CHUNK_SIZE;
+        std::vector<llvm::SmallVector<char, 0>> bitcodes(numChunks); // empty when the IR is broken
+        std::vector<char> isGenerated(numChunks, false); // the workers write it at the same time
+        std::vector<std::shared_future<void>> chunks;
+        uint32_t numNodes = AST::ASTContext::current()->numNodes(); // the context is thread local
+
+        llvm::ThreadPool pool(llvm::hardware_concurrency(Options::IRGenThreads));
+        for (size_t i = 0; i < numChunks; i++)
         {
-            FATAL_ERROR("Unsupported return type for function " << functionDecl->name());
-            LLVMIRGEN_RET_FALSE();
+            chunks.push_back(pool.async([&, i]()
+            {
+                std::unique_ptr<LLVMIRGenerator> worker(new LLVMIRGenerator);
+                worker->_declValues.resize(numNodes, nullptr); // declValue() never grows it then
+                worker->_isChunk = true;
+
+                size_t end = std::min(definitions.size(), (i + 1) * IRGEN_CHUNK_SIZE);
+                for (size_t j = i * IRGEN_CHUNK_SIZE; j < end; j++)
+                    if (!worker->visit(definitions[j]))
+                        return;
+                isGenerated[i] = true;
+
+                // bitcode of a module that doesn't verify can't be read back
+                if (llvm::verifyModule(*worker->_module))
+                    return;
+                llvm::raw_svector_ostream os(bitcodes[i]);
+                llvm::WriteBitcodeToFile(*worker->_module, os);
+            }));
         }
 
-        ft = llvm::FunctionType::get(funcRetType, params, false);
-        auto func = _module->getFunction(functionDecl->name());
-
-        if (func != nullptr)
+        // contexts can't share values, each chunk comes over as bitcode. Linked in order while the
+        // later ones are still generated
+        bool isLinked = true;
+        for (size_t i = 0; i < numChunks; i++)
         {
-            if (!func->empty() || (functionDecl->_body != nullptr))
+            chunks[i].wait();
+            if (!isLinked || !isGenerated[i]) // the worker has reported why
             {
-                FATAL_ERROR("Redefinition function " << functionDecl->name());
-                LLVMIRGEN_RET_FALSE();
+                isLinked = false;
+                continue;
             }
-            else if (func->arg_size() != functionDecl->_params.size())
+
+            // generated again here, so the module is as broken as a serial run leaves it
+            if (bitcodes[i].empty())
             {
-                FATAL_ERROR("Function " << functionDecl->name() << "definition deosn't match with declaration");
-                LLVMIRGEN_RET_FALSE();
+                // linking replaced the declarations of the functions it defined
+                for (auto &decl : translationUnitDecl->_decls)
+                    if (decl->kind() == AST::ASTNode::Kind::FunctionDecl)
+                        declValue(decl.get()) = _module->getFunction(static_cast<AST::FunctionDecl *>(decl.get())->name());
+
+                size_t end = std::min(definitions.size(), (i + 1) * IRGEN_CHUNK_SIZE);
+                for (size_t j = i * IRGEN_CHUNK_SIZE; j < end && isLinked; j++)
+                    isLinked = visit(definitions[j]);
+                continue;
+            }
+
+            auto chunk = llvm::parseBitcodeFile(llvm::MemoryBufferRef(llvm::StringRef(bitcodes[i].data(), bitcodes[i].size()), "chunk"), _context);
+            if (!chunk)
+            {
+                FATAL_ERROR("Can't read the IR of chunk " << i << ": " << llvm::toString(chunk.takeError()));
+                isLinked = false;
+                continue;
+            }
+            if (llvm::Linker::linkModules(*_module, std::move(*chunk)))
+            {
+                FATAL_ERROR("Can't link the IR of chunk " << i);
+                isLinked = false;
             }
+            llvm::SmallVector<char, 0>().swap(bitcodes[i]);
         }
-        else
+        pool.wait();
+
+        if (!isLinked)
+            return false;
+
+        // the linker appends a definition in place of its declaration
+        for (auto &name : functionNames)
+        {
+            auto func = _module->getFunction(name);
+            func->removeFromParent();
+            _module->getFunctionList().push_back(func);
+        }
+
+        // so do the globals it resolves, the ones defined here go ahead of the chunks' string literals again
+        std::vector<llvm::GlobalVariable *> globals;
+        for (auto &name : globalNames)
+            globals.push_back(_module->getNamedGlobal(name));
+        std::unordered_set<const llvm::GlobalVariable *> definedHere(globals.begin(), globals.end());
+        for (auto &var : _module->globals())
+            if (definedHere.count(&var) == 0)
+                globals.push_back(&var);
+        for (auto var : globals)
+        {
+            var->removeFromParent();
+            _module->insertGlobalVariable(var);
+        }
+
+        return true;
+    }
+
+    llvm::Function *LLVMIRGenerator::declareFunction(const AST::FunctionDecl *functionDecl)
+    {
+        std::vector<llvm::Type *> params;
+        for (auto &param : functionDecl->_params)
+        {
+            if (param->type()->isVoid() || param->type()->isArray())
+                return nullptr;
+            params.push_back(toLLVMType(param->type()));
+        }
+
+        if (functionDecl->_type->isArray() || (functionDecl->_type->isPointer() && functionDecl->_type->elementType()->isVoid()))
+        {
+            FATAL_ERROR("Unsupported return type for function " << functionDecl->name());
+            return nullptr;
+        }
+        llvm::Type *funcRetType = toLLVMType(functionDecl->_type);
+
+        llvm::FunctionType *ft = llvm::FunctionType::get(funcRetType, params, false);
+        auto func = _module->getFunction(functionDecl->name()); // redeclaration, Sema has checked it matches
+
+        if (func == nullptr)
             func = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, functionDecl->name(), _module.get());
+        declValue(functionDecl) = func;
 
         unsigned int idx = 0;
         for (auto &arg : func->args())
@@ -220,6 +650,15 @@ namespace lcc
             arg.setName(functionDecl->_params[idx++]->name());
         }
 
+        return func;
+    }
+
+    bool LLVMIRGenerator::gen(AST::FunctionDecl *functionDecl)
+    {
+        auto func = declareFunction(functionDecl);
+        if (func == nullptr)
+            LLVMIRGEN_RET_FALSE();
+
         if (functionDecl->_body == nullptr)
             LLVMIRGEN_RET_TRUE(func);
 
@@ -227,16 +666,14 @@ namespace lcc
         llvm::BasicBlock *retBB = llvm::BasicBlock::Create(_context, "return", func);
         llvm::AllocaInst *retValAlloca = nullptr;
 
-        _builder->SetInsertPoint(retBB);
+        sealBlock(entryBB);
+        _builder->SetInsertPoint(entryBB);
 
-        if (functionDecl->_type == "void")
+        if (functionDecl->_type->isVoid())
             retValAlloca = nullptr;
-        else if (
-            functionDecl->_type == "int" ||
-            functionDecl->_type == "float" ||
-            functionDecl->_type == "char")
+        else if (functionDecl->_type->isBuiltin())
         {
-            retValAlloca = createEntryBlockAlloca(func, "retVal", functionDecl->_type);
+            retValAlloca = createVariable(func, "retVal", functionDecl->_type);
         }
         else
         {
@@ -244,27 +681,15 @@ namespace lcc
             LLVMIRGEN_RET_FALSE();
         }
 
-        if (retValAlloca)
-        {
-            auto retVal = _builder->CreateLoad(funcRetType, retValAlloca);
-            _builder->CreateRet(retVal);
-        }
-        else
-            _builder->CreateRetVoid(); // emit ret void
-
-        _builder->SetInsertPoint(entryBB);
-
-        auto previousTable = _currentSymbolTable;
-        changeTable(mkTable(previousTable)); // create a new scope for function params
-
         // Alloc space for function params
+        unsigned int idx = 0;
         for (auto &arg : func->args())
         {
             llvm::AllocaInst *alloca = nullptr;
-            if (arg.getType()->isIntegerTy())
-                alloca = createEntryBlockAlloca(func, arg.getName().str(), "int");
-            else if (arg.getType()->isFloatTy())
-                alloca = createEntryBlockAlloca(func, arg.getName().str(), "float");
+            const AST::ParmVarDecl *param = functionDecl->_params[idx++].get();
+            const AST::Type *paramType = param->type();
+            if (paramType->isBuiltin())
+                alloca = createVariable(func, arg.getName().str(), paramType);
             else
             {
                 FATAL_ERROR("Unsupported param type in function " << func->getName().str());
@@ -272,42 +697,61 @@ namespace lcc
                 LLVMIRGEN_RET_FALSE();
             }
 
-            _builder->CreateStore(&arg, alloca);
-            enter(arg.getName().str(), alloca);
+            store(&arg, alloca);
+            declValue(param) = alloca;
         }
 
         updateFuncContext(entryBB, retBB, retValAlloca);
 
-        functionDecl->_body->gen(this);
+        visit(functionDecl->_body);
 
         _builder->CreateBr(retBB); // unconditional jump to return bb after function body
 
+        // the return value is read once every path to the return block is known
+        sealBlock(retBB);
+        _builder->SetInsertPoint(retBB);
+        if (retValAlloca)
+        {
+            auto retVal = load(retValAlloca);
+            _builder->CreateRet(retVal);
+        }
+        else
+            _builder->CreateRetVoid(); // emit ret void
+        clearVariables();
+
         std::string err;
         llvm::raw_ostream *out = new llvm::raw_string_ostream(err);
-        if (llvm::verifyFunction(*func, out))
+        // a chunk with a broken function is generated again by the main generator, which reports it
+        if (!_isChunk && llvm::verifyFunction(*func, out))
         {
             FATAL_ERROR(err);
             // LLVMIRGEN_RET_FALSE();
         }
 
-        changeTable(previousTable);
+        if (_stream)
+        {
+            // printed from a module of its own, the writer scans every global of the parent module
+            // otherwise and prints addrspace(0) for a function without one
+            func->removeFromParent();
+            _printModule->getFunctionList().push_back(func);
+            uint64_t offset = _spool->tell();
+            func->print(*_spool);
+            _streamedFunctions[func] = _spool->tell() - offset;
+
+            func->removeFromParent();
+            func->deleteBody(); // callers only need the declaration
+            _module->getFunctionList().push_back(func);
+        }
+
         LLVMIRGEN_RET_TRUE(nullptr);
     }
 
     bool LLVMIRGenerator::gen(AST::VarDecl *varDecl)
     {
-        if (lookupCurrentTbl(varDecl->name()) != nullptr)
-        {
-            FATAL_ERROR("Redefinition " << varDecl->type() << " " << varDecl->name());
-            LLVMIRGEN_RET_FALSE();
-        }
-
-        varDecl->place = varDecl->name();
-
         llvm::Value *initVal = nullptr;
         if (varDecl->_isInitialized)
         {
-            if (!varDecl->_value->gen(this))
+            if (!visit(varDecl->_value))
                 LLVMIRGEN_RET_FALSE();
 
             initVal = _retVal;
@@ -317,56 +761,28 @@ namespace lcc
         if (ib)
         {
             auto function = ib->getParent();
-            auto alloca = createEntryBlockAlloca(function, varDecl->name(), varDecl->type());
-            enter(varDecl->name(), alloca);
+            auto alloca = createVariable(function, varDecl->name(), varDecl->type());
+            declValue(varDecl) = alloca;
             if (initVal != nullptr)
             {
-                auto store = _builder->CreateStore(initVal, alloca);
-                LLVMIRGEN_RET_TRUE(store);
+                auto stored = store(initVal, alloca);
+                LLVMIRGEN_RET_TRUE(stored);
             }
         }
         else
         {
-            if (_module->getGlobalVariable(varDecl->name()))
-            {
-                FATAL_ERROR("Redeclaration global variable" << varDecl->type() << " " << varDecl->name());
+            if (!varDecl->type()->isBuiltin() || varDecl->type()->isVoid())
                 LLVMIRGEN_RET_FALSE();
-            }
-
-            if (varDecl->type() == "int")
-            {
-                llvm::GlobalVariable *gVar = new llvm::GlobalVariable(
-                    *_module, llvm::Type::getInt32Ty(_context), false,
-                    llvm::GlobalValue::ExternalLinkage,
-                    _builder->getInt32(0),
-                    varDecl->name());
-
-                LLVMIRGEN_RET_TRUE(gVar);
-            }
-            else if (varDecl->type() == "float")
-            {
-                llvm::GlobalVariable *gVar = new llvm::GlobalVariable(
-                    *_module, llvm::Type::getFloatTy(_context), false,
-                    llvm::GlobalValue::ExternalLinkage,
-                    llvm::ConstantFP::get(_context, llvm::APFloat(0.0)),
-                    varDecl->name());
 
-                LLVMIRGEN_RET_TRUE(gVar);
-            }
-            else if (varDecl->type() == "char")
-            {
-                llvm::GlobalVariable *gVar = new llvm::GlobalVariable(
-                    *_module, llvm::Type::getInt8Ty(_context), false,
-                    llvm::GlobalValue::ExternalLinkage,
-                    _builder->getInt8(0),
-                    varDecl->name());
+            llvm::Type *varType = toLLVMType(varDecl->type());
+            llvm::GlobalVariable *gVar = new llvm::GlobalVariable(
+                *_module, varType, false,
+                llvm::GlobalValue::ExternalLinkage,
+                llvm::Constant::getNullValue(varType),
+                varDecl->name());
+            declValue(varDecl) = gVar;
 
-                LLVMIRGEN_RET_TRUE(gVar);
-            }
-            else
-            {
-                LLVMIRGEN_RET_FALSE();
-            }
+            LLVMIRGEN_RET_TRUE(gVar);
         }
 
         return true;
@@ -410,7 +826,7 @@ namespace lcc
 
     bool LLVMIRGenerator::gen(AST::DeclRefExpr *declRefExpr)
     {
-        auto var = lookup(declRefExpr->name());
+        auto var = referencedValue(declRefExpr->decl());
 
         if (var == nullptr)
         {
@@ -418,52 +834,32 @@ namespace lcc
             LLVMIRGEN_RET_FALSE();
         }
 
-        declRefExpr->place = declRefExpr->name();
-
         LLVMIRGEN_RET_TRUE(var);
     }
 
     bool LLVMIRGenerator::gen(AST::CastExpr *castExpr)
     {
-        if (!castExpr->_subExpr->gen(this))
+        if (!visit(castExpr->_subExpr))
             LLVMIRGEN_RET_FALSE();
 
         auto ld = _builder->CreateLoad(_retVal->getType(), _retVal);
 
-        castExpr->place = castExpr->_subExpr->place;
-
         LLVMIRGEN_RET_TRUE(ld);
     }
 
     bool LLVMIRGenerator::gen(AST::ImplicitCastExpr *implicitCastExpr)
     {
-        if (!implicitCastExpr->_subExpr->gen(this))
+        if (!visit(implicitCastExpr->_subExpr))
             LLVMIRGEN_RET_FALSE();
 
         if (implicitCastExpr->_type == AST::CastExpr::CastType::LValueToRValue)
         {
-            if (auto alloca = llvm::dyn_cast<llvm::AllocaInst>(_retVal))
-            {
-                auto ld = _builder->CreateLoad(alloca->getAllocatedType(), alloca);
-                LLVMIRGEN_RET_TRUE(ld);
-            }
-            else if (auto glbVar = llvm::dyn_cast<llvm::GlobalVariable>(_retVal))
-            {
-                auto ld = _builder->CreateLoad(glbVar->getValueType(), glbVar);
-                LLVMIRGEN_RET_TRUE(ld);
-            }
-            else if (auto gepInst = llvm::dyn_cast<llvm::GetElementPtrInst>(_retVal))
-            {
-                auto ld = _builder->CreateLoad(gepInst->getResultElementType(), gepInst);
+            if (auto ld = load(_retVal))
                 LLVMIRGEN_RET_TRUE(ld);
-            }
             else
-            {
                 LLVMIRGEN_RET_FALSE();
-            }
         }
 
-        implicitCastExpr->place = implicitCastExpr->_subExpr->place;
         LLVMIRGEN_RET_TRUE(_retVal);
     }
 
@@ -471,20 +867,14 @@ namespace lcc
     {
         if (binaryOperator->isAssignment())
         {
-            auto lhs = dynamic_pointer_cast<AST::DeclRefExpr>(std::move(binaryOperator->_lhs));
+            auto lhs = static_cast<AST::DeclRefExpr *>(binaryOperator->_lhs.get()); // or an ArraySubscriptExpr, checked by Sema
 
-            if (lhs == nullptr)
-            {
-                FATAL_ERROR("Invalid lhs expression for an assignment");
-                LLVMIRGEN_RET_FALSE();
-            }
-
-            if (!lhs->gen(this))
+            if (!visit(lhs))
                 LLVMIRGEN_RET_FALSE();
 
             llvm::Value* lhsVar = _retVal;
 
-            if (!binaryOperator->_rhs->gen(this))
+            if (!visit(binaryOperator->_rhs))
                 LLVMIRGEN_RET_FALSE();
 
             llvm::Value *rhsVal = _retVal;
@@ -498,13 +888,8 @@ namespace lcc
             llvm::Value *lhsVal = nullptr;
             if (binaryOperator->type() != AST::BinaryOpType::BO_Assign)
             {
-                if (llvm::AllocaInst* alloca = llvm::dyn_cast<llvm::AllocaInst>(lhsVar))
-                    lhsVal = _builder->CreateLoad(alloca->getAllocatedType(), alloca);
-                else if (llvm::GlobalVariable* glbVar = llvm::dyn_cast<llvm::GlobalVariable>(lhsVar))
-                    lhsVal = _builder->CreateLoad(glbVar->getValueType(), glbVar);
-                else if (llvm::GetElementPtrInst* gepInst = llvm::dyn_cast<llvm::GetElementPtrInst>(lhsVar))
-                    lhsVal = _builder->CreateLoad(gepInst->getResultElementType(), gepInst);
-                else
+                lhsVal = load(lhsVar);
+                if (!lhsVal)
                     LLVMIRGEN_RET_FALSE();
             }
 
@@ -572,17 +957,17 @@ namespace lcc
                 LLVMIRGEN_RET_FALSE();
             }
 
-            _builder->CreateStore(exprVal, lhsVar);
+            store(exprVal, lhsVar);
             LLVMIRGEN_RET_TRUE(exprVal);
         }
         else
         {
-            if (!binaryOperator->_lhs->gen(this))
+            if (!visit(binaryOperator->_lhs))
                 LLVMIRGEN_RET_FALSE();
 
             llvm::Value *lhsVal = _retVal;
 
-            if (!binaryOperator->_rhs->gen(this))
+            if (!visit(binaryOperator->_rhs))
                 LLVMIRGEN_RET_FALSE();
 
             llvm::Value *rhsVal = _retVal;
@@ -681,14 +1066,14 @@ namespace lcc
 
     bool LLVMIRGenerator::gen(AST::UnaryOperator *unaryOperator)
     {
-        if (!unaryOperator->_body->gen(this))
+        if (!visit(unaryOperator->_body))
             LLVMIRGEN_RET_FALSE();
 
         llvm::Value *bodyStore = _retVal;
 
-        if (llvm::AllocaInst *alloca = llvm::dyn_cast<llvm::AllocaInst>(bodyStore))
+        if (llvm::isa<llvm::AllocaInst>(bodyStore))
         {
-            bodyStore = _builder->CreateLoad(alloca->getAllocatedType(), alloca);
+            bodyStore = load(bodyStore);
         }
 
         switch (unaryOperator->type())
@@ -708,7 +1093,7 @@ namespace lcc
                 LLVMIRGEN_RET_FALSE();
             }
 
-            llvm::Value *addStore = _builder->CreateStore(addVal, _retVal);
+            llvm::Value *addStore = store(addVal, _retVal);
             LLVMIRGEN_RET_TRUE(addStore);
         }
         case AST::UnaryOpType::UO_PreDec:
@@ -726,7 +1111,7 @@ namespace lcc
                 LLVMIRGEN_RET_FALSE();
             }
 
-            llvm::Value *subStore = _builder->CreateStore(subVal, _retVal);
+            llvm::Value *subStore = store(subVal, _retVal);
             LLVMIRGEN_RET_TRUE(subStore);
         }
         case AST::UnaryOpType::UO_PostInc:
@@ -744,7 +1129,7 @@ namespace lcc
                 LLVMIRGEN_RET_FALSE();
             }
 
-            llvm::Value *addStore = _builder->CreateStore(addVal, _retVal);
+            llvm::Value *addStore = store(addVal, _retVal);
             LLVMIRGEN_RET_TRUE(addVal);
         }
         case AST::UnaryOpType::UO_PostDec:
@@ -762,7 +1147,7 @@ namespace lcc
                 LLVMIRGEN_RET_FALSE();
             }
 
-            llvm::Value *subStore = _builder->CreateStore(subVal, _retVal);
+            llvm::Value *subStore = store(subVal, _retVal);
             LLVMIRGEN_RET_TRUE(subVal);
         }
         case AST::UnaryOpType::UO_Not:
@@ -793,24 +1178,20 @@ namespace lcc
 
     bool LLVMIRGenerator::gen(AST::ParenExpr *parenExpr)
     {
-        if (!parenExpr->_subExpr->gen(this))
+        if (!visit(parenExpr->_subExpr))
             LLVMIRGEN_RET_FALSE();
 
-        parenExpr->place = parenExpr->_subExpr->place;
         LLVMIRGEN_RET_TRUE(_retVal);
     }
 
     bool LLVMIRGenerator::gen(AST::CompoundStmt *compoundStmt)
     {
-        auto previousTable = _currentSymbolTable;
-        changeTable(mkTable(previousTable));
         for (auto &stmt : compoundStmt->_body)
         {
-            if (!stmt->gen(this))
+            if (!visit(stmt))
                 LLVMIRGEN_RET_FALSE();
         }
 
-        changeTable(previousTable);
         LLVMIRGEN_RET_TRUE(_retVal);
     }
 
@@ -818,7 +1199,7 @@ namespace lcc
     {
         for (auto &decl : declStmt->_decls)
         {
-            if (!decl->gen(this))
+            if (!visit(decl))
                 LLVMIRGEN_RET_FALSE();
         }
 
@@ -827,19 +1208,15 @@ namespace lcc
 
     bool LLVMIRGenerator::gen(AST::IfStmt *ifStmt)
     {
-        if (!ifStmt->_condition->gen(this))
+        if (!visit(ifStmt->_condition))
             LLVMIRGEN_RET_FALSE();
 
         llvm::Type *type = nullptr;
         llvm::Value *condVal = _retVal;
 
-        if (llvm::AllocaInst *alloca = llvm::dyn_cast<llvm::AllocaInst>(condVal))
-        {
-            type = alloca->getAllocatedType();
-            condVal = _builder->CreateLoad(type, alloca, "");
-        }
-        else
-            type = condVal->getType();
+        if (llvm::isa<llvm::AllocaInst>(condVal))
+            condVal = load(condVal);
+        type = condVal->getType();
 
         if (type != llvm::Type::getInt1Ty(_context))
             condVal = _builder->CreateICmpNE(condVal, llvm::ConstantInt::get(_context, llvm::APInt(32, 0)), "ifcond");
@@ -855,10 +1232,13 @@ namespace lcc
         llvm::BasicBlock *bodyBB = llvm::BasicBlock::Create(_context, "if.body", func, elseBB);
 
         _builder->CreateCondBr(condVal, bodyBB, elseBB);
+        sealBlock(bodyBB);
+        if (elseBB != endBB)
+            sealBlock(elseBB);
 
         _builder->SetInsertPoint(bodyBB); // gen body ir
 
-        if (!ifStmt->_body->gen(this))
+        if (!visit(ifStmt->_body))
             LLVMIRGEN_RET_FALSE();
 
         _builder->CreateBr(endBB);
@@ -866,11 +1246,12 @@ namespace lcc
         if (ifStmt->_elseBody != nullptr)
         {
             _builder->SetInsertPoint(elseBB);
-            if (!ifStmt->_elseBody->gen(this))
+            if (!visit(ifStmt->_elseBody))
                 LLVMIRGEN_RET_FALSE();
             _builder->CreateBr(endBB);
         }
 
+        sealBlock(endBB);
         _builder->SetInsertPoint(endBB);
 
         LLVMIRGEN_RET_TRUE(_retVal);
@@ -878,7 +1259,7 @@ namespace lcc
 
     bool LLVMIRGenerator::gen(AST::ValueStmt *valueStmt)
     {
-        if (!valueStmt->_expr->gen(this))
+        if (!visit(valueStmt->_expr))
             LLVMIRGEN_RET_FALSE();
 
         LLVMIRGEN_RET_TRUE(_retVal);
@@ -894,10 +1275,10 @@ namespace lcc
         }
         else
         {
-            if (!returnStmt->_value->gen(this))
+            if (!visit(returnStmt->_value))
                 LLVMIRGEN_RET_FALSE();
 
-            _builder->CreateStore(_retVal, _fc.retValAlloca);
+            store(_retVal, _fc.retValAlloca);
         }
 
         LLVMIRGEN_RET_TRUE(_retVal);
@@ -914,30 +1295,29 @@ namespace lcc
         _builder->CreateBr(condBB);
 
         _builder->SetInsertPoint(condBB);
-        if (!whileStmt->_condition->gen(this))
+        if (!visit(whileStmt->_condition))
             LLVMIRGEN_RET_FALSE();
 
         llvm::Type *type = nullptr;
         llvm::Value *condVal = _retVal;
 
-        if (llvm::AllocaInst *alloca = llvm::dyn_cast<llvm::AllocaInst>(condVal))
-        {
-            type = alloca->getAllocatedType();
-            condVal = _builder->CreateLoad(type, alloca, "");
-        }
-        else
-            type = condVal->getType();
+        if (llvm::isa<llvm::AllocaInst>(condVal))
+            condVal = load(condVal);
+        type = condVal->getType();
 
         if (type != llvm::Type::getInt1Ty(_context))
             condVal = _builder->CreateICmpNE(condVal, llvm::ConstantInt::get(_context, llvm::APInt(32, 0)), "whilecond");
 
         _builder->CreateCondBr(condVal, bodyBB, endBB);
+        sealBlock(bodyBB);
+        sealBlock(endBB);
 
         _builder->SetInsertPoint(bodyBB);
-        if (!whileStmt->_body->gen(this))
+        if (!visit(whileStmt->_body))
             LLVMIRGEN_RET_FALSE();
 
         _builder->CreateBr(condBB);
+        sealBlock(condBB); // the back edge was its last predecessor
 
         _builder->SetInsertPoint(endBB);
 
@@ -946,26 +1326,13 @@ namespace lcc
 
     bool LLVMIRGenerator::gen(AST::CallExpr *callExpr)
     {
-        std::string funcName = callExpr->_functionExpr->name();
-        llvm::Function *func = _module->getFunction(funcName);
-
-        if (func == nullptr)
-        {
-            FATAL_ERROR("Referencing undefined function " << funcName);
-            LLVMIRGEN_RET_FALSE();
-        }
-
-        if (callExpr->_params.size() != func->arg_size())
-        {
-            FATAL_ERROR("Function " << funcName << " required for " << std::to_string(func->arg_size()) << " arguments, but " << std::to_string(callExpr->_params.size()) << " were given");
-            LLVMIRGEN_RET_FALSE();
-        }
+        auto func = llvm::cast<llvm::Function>(referencedValue(callExpr->_functionExpr->decl()));
 
         std::vector<llvm::Value *> argVals;
 
         for (auto &param : callExpr->_params)
         {
-            if (!param->gen(this))
+            if (!visit(param))
                 LLVMIRGEN_RET_FALSE();
             argVals.push_back(_retVal);
         }
@@ -1232,6 +1599,11 @@ namespace lcc
         return result;
     }
 
+    bool LLVMIRGenerator::gen(AST::NullStmt *nullStmt)
+    {
+        LLVMIRGEN_RET_TRUE(nullptr);
+    }
+
     bool LLVMIRGenerator::gen(AST::AsmStmt *asmStmt)
     {
         std::string asmString = generateAsmString(asmStmt);
@@ -1260,8 +1632,8 @@ namespace lcc
             std::string curConstraintStr = generateConstraintString(constraint.first);
             constraintStr.append(curConstraintStr); // add constraint to constraint string
             constraintStr += ",";
-            outputLVal = lookup(constraint.second->name());
-            if (llvm::AllocaInst *alloca = llvm::dyn_cast<llvm::AllocaInst>(outputLVal))
+            outputLVal = referencedValue(constraint.second->decl());
+            if (llvm::AllocaInst *alloca = llvm::dyn_cast_or_null<llvm::AllocaInst>(outputLVal))
                 asmStmtRetType = alloca->getAllocatedType();
             else if (llvm::GlobalVariable *glbVar = llvm::dyn_cast<llvm::GlobalVariable>(outputLVal))
                 asmStmtRetType = glbVar->getValueType();
@@ -1278,7 +1650,7 @@ namespace lcc
         // Gen IR for input params
         for (auto &constraint : asmStmt->_inputConstraints)
         {
-            if (!constraint.second->gen(this))
+            if (!visit(constraint.second))
                 LLVMIRGEN_RET_FALSE();
 
             auto rval = _retVal;
@@ -1315,40 +1687,25 @@ namespace lcc
 
         auto callInst = _builder->CreateCall(ia, params, "asmcalltmp");
 
-        auto asmRetVal = _builder->CreateStore(callInst, outputLVal);
+        auto asmRetVal = store(callInst, outputLVal);
 
         LLVMIRGEN_RET_TRUE(asmRetVal);
     }
 
     bool LLVMIRGenerator::gen(AST::ArraySubscriptExpr *arraySubscriptExpr)
     {
-        auto lhs = dynamic_pointer_cast<AST::DeclRefExpr>(std::move(arraySubscriptExpr->_lhs));
-
-        if (lhs == nullptr)
-        {
-            FATAL_ERROR("Invalid lhs expression for an array subscript expression");
-            LLVMIRGEN_RET_FALSE();
-        }
-
-        if (!arraySubscriptExpr->_rhs->gen(this))
+        if (!visit(arraySubscriptExpr->_rhs))
             LLVMIRGEN_RET_FALSE();
 
         llvm::Value *rhsVal = _retVal;
-        llvm::Value *lhsVar = lookup(lhs->name());
+        llvm::Value *lhsVar = declValue(arraySubscriptExpr->decl());
 
         if (!lhsVar)
         {
-            FATAL_ERROR("Referencing undefined symbol " << lhs->name());
+            FATAL_ERROR("Referencing undefined symbol " << arraySubscriptExpr->name());
             LLVMIRGEN_RET_FALSE();
         }
 
-        if (!rhsVal->getType()->isIntegerTy())
-        {
-            FATAL_ERROR("Expecting integer type for array index " << lhs->name());
-            LLVMIRGEN_RET_FALSE();
-        }
-
-
         if (llvm::AllocaInst* alloca = llvm::dyn_cast<llvm::AllocaInst>(lhsVar))
         {
             auto ptr = _builder->CreateGEP(alloca->getAllocatedType(), alloca, { llvm::ConstantInt::get(llvm::Type::getInt64Ty(_context), 0),  rhsVal });
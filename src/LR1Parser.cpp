@@ -193,6 +193,50 @@ namespace lcc
         }
     };
 
+    namespace
+    {
+        // Nesting level of LR1Parser::nextExpression, operands and binary operators
+        // are kept per frame and reduced by precedence
+        struct ExprParseFrame
+        {
+            enum class Kind
+            {
+                Root,
+                Paren,
+                Call
+            } kind{Kind::Root};
+            std::string name;                              // callee name
+            std::vector<std::unique_ptr<AST::Expr>> params; // finished call params
+            std::vector<std::unique_ptr<AST::Expr>> operands;
+            std::vector<std::pair<AST::BinaryOpType, AST::BinaryOperator::Precedence>> operators;
+            std::vector<AST::UnaryOpType> prefixOps; // prefix operators of the operand being parsed
+            bool isFirstOperand{true};
+        };
+    }
+
+    static void ReduceBinaryOperator(ExprParseFrame &frame)
+    {
+        std::unique_ptr<AST::Expr> rhs = std::move(frame.operands.back());
+        frame.operands.pop_back();
+        std::unique_ptr<AST::Expr> lhs = std::move(frame.operands.back());
+        frame.operands.pop_back();
+        frame.operands.push_back(std::make_unique<AST::BinaryOperator>(frame.operators.back().first, std::move(lhs), std::move(rhs)));
+        frame.operators.pop_back();
+    }
+
+    // Right recursive list rules append each reduced element to the list of the rest,
+    // so the elements are collected last first and reversed here.
+    template <typename T>
+    static std::vector<std::unique_ptr<T>> TakeNodeList(std::vector<std::unique_ptr<AST::ASTNode>> &nodes)
+    {
+        std::vector<std::unique_ptr<T>> list;
+        list.reserve(nodes.size());
+        for (auto it = nodes.rbegin(); it != nodes.rend(); it++)
+            list.push_back(std::unique_ptr<T>(static_cast<T *>(it->release())));
+        nodes.clear();
+        return list;
+    }
+
     LR1Parser::LR1Parser()
     {
         // for rn item, use function _productionFuncMap[n] to reduce
@@ -280,7 +324,7 @@ namespace lcc
 
         do
         {
-            auto actionTableRow = _actionTable[stateStack.top()];
+            auto &actionTableRow = _actionTable[stateStack.top()];
             std::string symbolName = TokenTypeToSymbolName(_pCurToken->type);
             if (actionTableRow.find(symbolName) == actionTableRow.end())
             {
@@ -377,7 +421,11 @@ namespace lcc
             case ActionType::ACC:
             {
                 auto result = dynamic_pointer_cast<NonTerminal>(symbolStack.top());
-                return std::move(dynamic_pointer_cast<AST::Decl>(std::move(result->_node)));
+                auto translationUnitDecl = dynamic_pointer_cast<AST::TranslationUnitDecl>(std::move(result->_node));
+                if (translationUnitDecl == nullptr)
+                    return nullptr;
+                std::reverse(translationUnitDecl->_decls.begin(), translationUnitDecl->_decls.end()); // restore source order
+                return std::move(translationUnitDecl);
             }
             default:
                 return nullptr;
@@ -433,12 +481,9 @@ namespace lcc
         if (translationUnitDecl->name() != "TranslationUnitDecl" || decl->name() != "Decl")
             return nullptr;
 
-        auto lastTranslationUnitDecl = dynamic_pointer_cast<AST::TranslationUnitDecl>(std::move(translationUnitDecl->_node));
-        std::vector<std::unique_ptr<AST::Decl>> decls;
-        decls.push_back(dynamic_pointer_cast<AST::Decl>(std::move(decl->_node))); // push new decl
-        for (auto &decl : lastTranslationUnitDecl->_decls)
-            decls.push_back(std::move(decl));
-        auto curTranslationUnitDeclNode = std::make_unique<AST::TranslationUnitDecl>(decls);
+        // decls are reduced right to left, append here and reverse once on accept
+        auto curTranslationUnitDeclNode = dynamic_pointer_cast<AST::TranslationUnitDecl>(std::move(translationUnitDecl->_node));
+        curTranslationUnitDeclNode->_decls.push_back(dynamic_pointer_cast<AST::Decl>(std::move(decl->_node))); // push new decl
         return std::make_shared<NonTerminal>("TranslationUnitDecl", std::move(curTranslationUnitDeclNode));
     }
 
@@ -477,7 +522,7 @@ namespace lcc
         if (semi->name() != ";" || rparen->name() != ")" || lparen->name() != "(" || identifier->name() != "TOKEN_IDENTIFIER" || kwvartype->name() != "TOKEN_VARTYPE")
             return nullptr;
 
-        std::string type = kwvartype->_token->content;
+        const AST::Type *type = AST::Type::getBuiltin(kwvartype->_token->content);
         std::string name = identifier->_token->content;
         std::vector<std::unique_ptr<AST::ParmVarDecl>> params;
 
@@ -507,17 +552,9 @@ namespace lcc
         if (semi->name() != ";" || rparen->name() != ")" || parmVarDecl->name() != "ParmVarDecl" || lparen->name() != "(" || identifier->name() != "TOKEN_IDENTIFIER" || kwvartype->name() != "TOKEN_VARTYPE")
             return nullptr;
 
-        std::string type = kwvartype->_token->content;
+        const AST::Type *type = AST::Type::getBuiltin(kwvartype->_token->content);
         std::string name = identifier->_token->content;
-        std::vector<std::unique_ptr<AST::ParmVarDecl>> params;
-
-        auto curParmVarDeclNode = dynamic_pointer_cast<AST::ParmVarDecl>(std::move(parmVarDecl->_node));
-
-        while (curParmVarDeclNode != nullptr)
-        {
-            params.push_back(std::move(curParmVarDeclNode));
-            curParmVarDeclNode = std::move(params.back()->_nextParmVarDecl);
-        }
+        std::vector<std::unique_ptr<AST::ParmVarDecl>> params = TakeNodeList<AST::ParmVarDecl>(parmVarDecl->_nodes);
 
         auto functionDecl = std::make_unique<AST::FunctionDecl>(name, type, params, nullptr);
         return std::make_shared<NonTerminal>("FunctionDecl", std::move(functionDecl));
@@ -537,11 +574,12 @@ namespace lcc
         if (identifier->name() != "TOKEN_IDENTIFIER" || kwvartype->name() != "TOKEN_VARTYPE")
             return nullptr;
 
-        std::string type = kwvartype->_token->content;
+        const AST::Type *type = AST::Type::getBuiltin(kwvartype->_token->content);
         std::string name = identifier->_token->content;
 
-        auto parmVarDecl = std::make_unique<AST::ParmVarDecl>(name, type);
-        return std::make_shared<NonTerminal>("ParmVarDecl", std::move(parmVarDecl));
+        auto parmVarDeclList = std::make_shared<NonTerminal>("ParmVarDecl");
+        parmVarDeclList->_nodes.push_back(std::make_unique<AST::ParmVarDecl>(name, type));
+        return parmVarDeclList;
     }
 
     // ParmVarDecl -> TOKEN_VARTYPE TOKEN_IDENTIFIER , ParmVarDecl
@@ -562,12 +600,10 @@ namespace lcc
         if (identifier->name() != "TOKEN_IDENTIFIER" || kwvartype->name() != "TOKEN_VARTYPE" || comma->name() != "," || nextParmVarDecl->name() != "ParmVarDecl")
             return nullptr;
 
-        std::string type = kwvartype->_token->content;
+        const AST::Type *type = AST::Type::getBuiltin(kwvartype->_token->content);
         std::string name = identifier->_token->content;
-        auto nextParmVarDeclNode = dynamic_pointer_cast<AST::ParmVarDecl>(std::move(nextParmVarDecl->_node));
-
-        auto parmVarDecl = std::make_unique<AST::ParmVarDecl>(name, type, std::move(nextParmVarDeclNode));
-        return std::make_shared<NonTerminal>("ParmVarDecl", std::move(parmVarDecl));
+        nextParmVarDecl->_nodes.push_back(std::make_unique<AST::ParmVarDecl>(name, type));
+        return nextParmVarDecl;
     }
 
     // FunctionDecl -> TOKEN_VARTYPE TOKEN_IDENTIFIER ( ) CompoundStmt
@@ -590,7 +626,7 @@ namespace lcc
         if (compoundStmt->name() != "CompoundStmt" || rparen->name() != ")" || lparen->name() != "(" || identifier->name() != "TOKEN_IDENTIFIER" || kwvartype->name() != "TOKEN_VARTYPE")
             return nullptr;
 
-        std::string type = kwvartype->_token->content;
+        const AST::Type *type = AST::Type::getBuiltin(kwvartype->_token->content);
         std::string name = identifier->_token->content;
         std::vector<std::unique_ptr<AST::ParmVarDecl>> params;
         auto body = dynamic_pointer_cast<AST::CompoundStmt>(std::move(compoundStmt->_node));
@@ -639,17 +675,9 @@ namespace lcc
         if (parmVarDecl->name() != "ParmVarDecl" || rparen->name() != ")" || parmVarDecl->name() != "ParmVarDecl" || lparen->name() != "(" || identifier->name() != "TOKEN_IDENTIFIER" || kwvartype->name() != "TOKEN_VARTYPE")
             return nullptr;
 
-        std::string type = kwvartype->_token->content;
+        const AST::Type *type = AST::Type::getBuiltin(kwvartype->_token->content);
         std::string name = identifier->_token->content;
-        std::vector<std::unique_ptr<AST::ParmVarDecl>> params;
-
-        auto curParmVarDeclNode = dynamic_pointer_cast<AST::ParmVarDecl>(std::move(parmVarDecl->_node));
-
-        while (curParmVarDeclNode != nullptr)
-        {
-            params.push_back(std::move(curParmVarDeclNode));
-            curParmVarDeclNode = std::move(params.back()->_nextParmVarDecl);
-        }
+        std::vector<std::unique_ptr<AST::ParmVarDecl>> params = TakeNodeList<AST::ParmVarDecl>(parmVarDecl->_nodes);
         auto body = dynamic_pointer_cast<AST::CompoundStmt>(std::move(compoundStmt->_node));
         auto functionDecl = std::make_unique<AST::FunctionDecl>(name, type, params, std::move(body));
 
@@ -676,7 +704,7 @@ namespace lcc
         if (semi->name() != ";" || rparen->name() != ")" || lparen->name() != "(" || identifier->name() != "TOKEN_IDENTIFIER" || kwvoid->name() != "TOKEN_KWVOID")
             return nullptr;
 
-        std::string type = kwvoid->_token->content;
+        const AST::Type *type = AST::Type::getBuiltin(kwvoid->_token->content);
         std::string name = identifier->_token->content;
         std::vector<std::unique_ptr<AST::ParmVarDecl>> params;
 
@@ -706,17 +734,9 @@ namespace lcc
         if (semi->name() != ";" || rparen->name() != ")" || parmVarDecl->name() != "ParmVarDecl" || lparen->name() != "(" || identifier->name() != "TOKEN_IDENTIFIER" || kwvoid->name() != "TOKEN_KWVOID")
             return nullptr;
 
-        std::string type = kwvoid->_token->content;
+        const AST::Type *type = AST::Type::getBuiltin(kwvoid->_token->content);
         std::string name = identifier->_token->content;
-        std::vector<std::unique_ptr<AST::ParmVarDecl>> params;
-
-        auto curParmVarDeclNode = dynamic_pointer_cast<AST::ParmVarDecl>(std::move(parmVarDecl->_node));
-
-        while (curParmVarDeclNode != nullptr)
-        {
-            params.push_back(std::move(curParmVarDeclNode));
-            curParmVarDeclNode = std::move(params.back()->_nextParmVarDecl);
-        }
+        std::vector<std::unique_ptr<AST::ParmVarDecl>> params = TakeNodeList<AST::ParmVarDecl>(parmVarDecl->_nodes);
 
         auto functionDecl = std::make_unique<AST::FunctionDecl>(name, type, params, nullptr);
         return std::make_shared<NonTerminal>("FunctionDecl", std::move(functionDecl));
@@ -742,7 +762,7 @@ namespace lcc
         if (compoundStmt->name() != "CompoundStmt" || rparen->name() != ")" || lparen->name() != "(" || identifier->name() != "TOKEN_IDENTIFIER" || kwvoid->name() != "TOKEN_KWVOID")
             return nullptr;
 
-        std::string type = kwvoid->_token->content;
+        const AST::Type *type = AST::Type::getBuiltin(kwvoid->_token->content);
         std::string name = identifier->_token->content;
         std::vector<std::unique_ptr<AST::ParmVarDecl>> params;
         auto body = dynamic_pointer_cast<AST::CompoundStmt>(std::move(compoundStmt->_node));
@@ -772,17 +792,9 @@ namespace lcc
         if (parmVarDecl->name() != "ParmVarDecl" || rparen->name() != ")" || parmVarDecl->name() != "ParmVarDecl" || lparen->name() != "(" || identifier->name() != "TOKEN_IDENTIFIER" || kwvoid->name() != "TOKEN_KWVOID")
             return nullptr;
 
-        std::string type = kwvoid->_token->content;
+        const AST::Type *type = AST::Type::getBuiltin(kwvoid->_token->content);
         std::string name = identifier->_token->content;
-        std::vector<std::unique_ptr<AST::ParmVarDecl>> params;
-
-        auto curParmVarDeclNode = dynamic_pointer_cast<AST::ParmVarDecl>(std::move(parmVarDecl->_node));
-
-        while (curParmVarDeclNode != nullptr)
-        {
-            params.push_back(std::move(curParmVarDeclNode));
-            curParmVarDeclNode = std::move(params.back()->_nextParmVarDecl);
-        }
+        std::vector<std::unique_ptr<AST::ParmVarDecl>> params = TakeNodeList<AST::ParmVarDecl>(parmVarDecl->_nodes);
         auto body = dynamic_pointer_cast<AST::CompoundStmt>(std::move(compoundStmt->_node));
         auto functionDecl = std::make_unique<AST::FunctionDecl>(name, type, params, std::move(body));
 
@@ -805,7 +817,7 @@ namespace lcc
         if (semi->name() != ";" || identifier->name() != "TOKEN_IDENTIFIER" || kwvartype->name() != "TOKEN_VARTYPE")
             return nullptr;
 
-        std::string type = kwvartype->_token->content;
+        const AST::Type *type = AST::Type::getBuiltin(kwvartype->_token->content);
         std::string name = identifier->_token->content;
 
         auto varDecl = std::make_unique<AST::VarDecl>(name, type);
@@ -832,7 +844,7 @@ namespace lcc
         if (semi->name() != ";" || expr->name() != "Expr" || eq->name() != "=" || identifier->name() != "TOKEN_IDENTIFIER" || kwvartype->name() != "TOKEN_VARTYPE")
             return nullptr;
 
-        std::string type = kwvartype->_token->content;
+        const AST::Type *type = AST::Type::getBuiltin(kwvartype->_token->content);
         std::string name = identifier->_token->content;
         auto exprNode = dynamic_pointer_cast<AST::Expr>(std::move(expr->_node));
 
@@ -856,13 +868,7 @@ namespace lcc
         if (rbrace->name() != "}" || lbrace->name() != "{" || stmts->name() != "Stmts")
             return nullptr;
 
-        std::vector<std::unique_ptr<AST::Stmt>> body;
-        auto curStmtNode = dynamic_pointer_cast<AST::Stmt>(std::move(stmts->_node));
-        while (curStmtNode != nullptr)
-        {
-            body.push_back(std::move(curStmtNode));
-            curStmtNode = std::move(body.back()->_nextStmt);
-        }
+        std::vector<std::unique_ptr<AST::Stmt>> body = TakeNodeList<AST::Stmt>(stmts->_nodes);
 
         auto CompoundStmt = std::make_unique<AST::CompoundStmt>(body);
         return std::make_shared<NonTerminal>("CompoundStmt", std::move(CompoundStmt));
@@ -879,7 +885,9 @@ namespace lcc
         if (stmt->name() != "Stmt")
             return nullptr;
 
-        return std::make_shared<NonTerminal>("Stmts", std::move(stmt->_node));
+        auto stmtList = std::make_shared<NonTerminal>("Stmts");
+        stmtList->_nodes.push_back(std::move(stmt->_node));
+        return stmtList;
     }
 
     // Stmts -> Stmt Stmts
@@ -895,11 +903,9 @@ namespace lcc
 
         if (stmt->name() != "Stmt" || stmts->name() != "Stmts")
             return nullptr;
-        auto curStmtNode = dynamic_pointer_cast<AST::Stmt>(std::move(stmt->_node));
-        auto nextStmtsNode = dynamic_pointer_cast<AST::Stmt>(std::move(stmts->_node));
 
-        curStmtNode->_nextStmt = std::move(nextStmtsNode);
-        return std::make_shared<NonTerminal>("Stmts", std::move(curStmtNode));
+        stmts->_nodes.push_back(std::move(stmt->_node));
+        return stmts;
     }
 
     // Stmt -> CompoundStmt
@@ -1161,7 +1167,7 @@ namespace lcc
             return nullptr;
         }
 
-        std::string type = varTypeOrVoid->_token->content;
+        const AST::Type *type = AST::Type::getBuiltin(varTypeOrVoid->_token->content);
         std::string name = identifier->_token->content;
         std::vector<std::unique_ptr<AST::ParmVarDecl>> params;
 
@@ -1209,17 +1215,9 @@ namespace lcc
             return nullptr;
         }
 
-        std::string type = varTypeOrVoid->_token->content;
+        const AST::Type *type = AST::Type::getBuiltin(varTypeOrVoid->_token->content);
         std::string name = identifier->_token->content;
-        std::vector<std::unique_ptr<AST::ParmVarDecl>> params;
-
-        auto curParmVarDeclNode = dynamic_pointer_cast<AST::ParmVarDecl>(std::move(parmVarDecl->_node));
-
-        while (curParmVarDeclNode != nullptr)
-        {
-            params.push_back(std::move(curParmVarDeclNode));
-            curParmVarDeclNode = std::move(params.back()->_nextParmVarDecl);
-        }
+        std::vector<std::unique_ptr<AST::ParmVarDecl>> params = TakeNodeList<AST::ParmVarDecl>(parmVarDecl->_nodes);
 
         auto functionDecl = std::make_unique<AST::FunctionDecl>(name, type, params, nullptr, true);
         return std::make_shared<NonTerminal>("FunctionDecl", std::move(functionDecl));
@@ -1253,7 +1251,7 @@ namespace lcc
             kwextern->name() != "TOKEN_KWEXTERN")
             return nullptr;
 
-        std::string type = varTypeOrVoid->_token->content;
+        const AST::Type *type = AST::Type::getBuiltin(varTypeOrVoid->_token->content);
 
         // FIXME: Need convertion from C symbol name to CPP symbol name
         std::string name = identifier->_token->content;
@@ -1294,18 +1292,10 @@ namespace lcc
             kwextern->name() != "TOKEN_KWEXTERN")
             return nullptr;
 
-        std::string type = varTypeOrVoid->_token->content;
+        const AST::Type *type = AST::Type::getBuiltin(varTypeOrVoid->_token->content);
         // FIXME: Need convertion from C symbol name to CPP symbol name
         std::string name = identifier->_token->content;
-        std::vector<std::unique_ptr<AST::ParmVarDecl>> params;
-
-        auto curParmVarDeclNode = dynamic_pointer_cast<AST::ParmVarDecl>(std::move(parmVarDecl->_node));
-
-        while (curParmVarDeclNode != nullptr)
-        {
-            params.push_back(std::move(curParmVarDeclNode));
-            curParmVarDeclNode = std::move(params.back()->_nextParmVarDecl);
-        }
+        std::vector<std::unique_ptr<AST::ParmVarDecl>> params = TakeNodeList<AST::ParmVarDecl>(parmVarDecl->_nodes);
 
         auto functionDecl = std::make_unique<AST::FunctionDecl>(name, type, params, nullptr, true);
         return std::make_shared<NonTerminal>("FunctionDecl", std::move(functionDecl));
@@ -1321,87 +1311,168 @@ namespace lcc
         return std::make_shared<NonTerminal>("Expr", std::move(exprNode));
     }
 
+    // Expr
+    // ::= UnaryOperator (BinaryOp PrimaryExpr)*
+    // UnaryOperator
+    // ::= UnaryOp UnaryOperator
+    // ::= PrimaryExpr ('++' | '--')?
+    // PrimaryExpr
+    // ::= CallExpr '(' params ')'
+    // ::= DeclRefExpr
+    // ::= Number
+    // ::= '(' Expr ')'
+    // Paren expressions and call arguments push a frame instead of recursing,
+    // binary operators are reduced by precedence on the frame's operator stack.
     std::unique_ptr<AST::Expr> LR1Parser::nextExpression()
     {
-        std::unique_ptr<AST::Expr> lhs = nextUnaryOperator();
-        if (lhs == nullptr)
-            return nullptr;
+        std::vector<ExprParseFrame> frames(1);
+        std::unique_ptr<AST::Expr> operand = nullptr; // finished primary expression of the innermost frame
 
-        return nextRHSExpr(std::move(lhs), AST::BinaryOperator::Precedence::COMMA);
-    }
-
-    std::unique_ptr<AST::Expr> LR1Parser::nextRHSExpr(std::unique_ptr<AST::Expr> lhs, AST::BinaryOperator::Precedence lastBiOpPrec)
-    {
-        do
+        while (true)
         {
-            AST::BinaryOperator::Precedence curBiOpPrec = TokenTypeToBinaryOpPrecedence(_pCurToken->type);
-            if (curBiOpPrec < lastBiOpPrec)
-                return lhs;
-
-            AST::BinaryOpType opType = TokenTypeToBinaryOpType(_pCurToken->type);
-            nextToken(); // eat current biOp
-            std::unique_ptr<AST::Expr> rhs = nextPrimaryExpr();
-            if (rhs == nullptr)
-                return nullptr;
+            if (operand == nullptr)
+            {
+                // prefix unary operators are only accepted on the leading operand
+                while (frames.back().isFirstOperand)
+                {
+                    AST::UnaryOpType opType;
+                    switch (_pCurToken->type)
+                    {
+                    case TokenType::TOKEN_PLUSPLUS:
+                        opType = AST::UnaryOpType::UO_PreInc;
+                        break;
+                    case TokenType::TOKEN_MINUSMINUS:
+                        opType = AST::UnaryOpType::UO_PreDec;
+                        break;
+                    default:
+                        opType = TokenTypeToUnaryOpType(_pCurToken->type);
+                        break;
+                    }
 
-            AST::BinaryOperator::Precedence nextBiOpPrec = TokenTypeToBinaryOpPrecedence(_pCurToken->type);
+                    if (opType == AST::UnaryOpType::UO_UNDEFINED)
+                        break;
+                    frames.back().prefixOps.push_back(opType);
+                    nextToken(); // eat current operator
+                }
 
-            if (curBiOpPrec < nextBiOpPrec || (curBiOpPrec == AST::BinaryOperator::Precedence::ASSIGNMENT && curBiOpPrec == nextBiOpPrec))
-                rhs = nextRHSExpr(std::move(rhs), (AST::BinaryOperator::Precedence)((int)curBiOpPrec + !(curBiOpPrec == AST::BinaryOperator::Precedence::ASSIGNMENT)));
-            lhs = std::make_unique<AST::BinaryOperator>(opType, std::move(lhs), std::move(rhs));
-        } while (true);
+                switch (_pCurToken->type)
+                {
+                case TokenType::TOKEN_IDENTIFIER:
+                {
+                    std::string name = _pCurToken->content;
+                    nextToken(); // eat name
+                    if (_pCurToken->type != TokenType::TOKEN_LPAREN)
+                    {
+                        operand = std::make_unique<AST::DeclRefExpr>(name);
+                        break;
+                    }
 
-        return nullptr;
-    }
+                    nextToken(); // eat '('
+                    if (_pCurToken->type == TokenType::TOKEN_RPAREN)
+                    {
+                        nextToken(); // eat ')'
+                        std::vector<std::unique_ptr<AST::Expr>> params;
+                        operand = std::make_unique<AST::CallExpr>(std::make_unique<AST::DeclRefExpr>(name, true), params);
+                        break;
+                    }
+                    ExprParseFrame frame;
+                    frame.kind = ExprParseFrame::Kind::Call;
+                    frame.name = name;
+                    frames.push_back(std::move(frame));
+                    continue;
+                }
+                case TokenType::TOKEN_INTEGER:
+                case TokenType::TOKEN_FLOAT:
+                case TokenType::TOKEN_CHAR:
+                    operand = nextNumber();
+                    if (operand == nullptr)
+                        return nullptr;
+                    break;
+                case TokenType::TOKEN_LPAREN:
+                {
+                    ExprParseFrame frame;
+                    frame.kind = ExprParseFrame::Kind::Paren;
+                    frames.push_back(std::move(frame));
+                    nextToken(); // eat '('
+                    continue;
+                }
+                default:
+                    return nullptr;
+                }
+            }
 
-    std::unique_ptr<AST::Expr> LR1Parser::nextUnaryOperator()
-    {
-        switch (_pCurToken->type)
-        {
-        case TokenType::TOKEN_EXCLAIM:
-        case TokenType::TOKEN_TILDE:
-        case TokenType::TOKEN_PLUS:
-        case TokenType::TOKEN_MINUS:
-        case TokenType::TOKEN_PLUSPLUS:
-        case TokenType::TOKEN_MINUSMINUS:
-        {
-            AST::UnaryOpType opType;
-            switch (_pCurToken->type)
+            ExprParseFrame &frame = frames.back();
+            if (frame.isFirstOperand)
             {
-            case TokenType::TOKEN_PLUSPLUS:
-                opType = AST::UnaryOpType::UO_PreInc;
-                break;
-            case TokenType::TOKEN_MINUSMINUS:
-                opType = AST::UnaryOpType::UO_PreDec;
-                break;
-            default:
-                opType = TokenTypeToUnaryOpType(_pCurToken->type);
-                break;
+                switch (_pCurToken->type)
+                {
+                case TokenType::TOKEN_PLUSPLUS:
+                    nextToken(); // eat '++'
+                    operand = std::make_unique<AST::UnaryOperator>(AST::UnaryOpType::UO_PostInc, std::move(operand));
+                    break;
+                case TokenType::TOKEN_MINUSMINUS:
+                    nextToken(); // eat '--'
+                    operand = std::make_unique<AST::UnaryOperator>(AST::UnaryOpType::UO_PostDec, std::move(operand));
+                    break;
+                default:
+                    break;
+                }
+            }
+            while (!frame.prefixOps.empty())
+            {
+                operand = std::make_unique<AST::UnaryOperator>(frame.prefixOps.back(), std::move(operand));
+                frame.prefixOps.pop_back();
             }
+            frame.operands.push_back(std::move(operand));
+            frame.isFirstOperand = false;
 
-            if (opType == AST::UnaryOpType::UO_UNDEFINED) // unary op type check
+            AST::BinaryOperator::Precedence curBiOpPrec = TokenTypeToBinaryOpPrecedence(_pCurToken->type);
+            if (curBiOpPrec != AST::BinaryOperator::Precedence::UNDEFINED)
             {
-                return nullptr;
+                // assignment is right associative, all other binary operators are left associative
+                while (!frame.operators.empty() && (frame.operators.back().second > curBiOpPrec || (frame.operators.back().second == curBiOpPrec && curBiOpPrec != AST::BinaryOperator::Precedence::ASSIGNMENT)))
+                    ReduceBinaryOperator(frame);
+                frame.operators.push_back(std::make_pair(TokenTypeToBinaryOpType(_pCurToken->type), curBiOpPrec));
+                nextToken(); // eat current biOp
+                continue;
             }
 
-            nextToken(); // eat current operator
-            return std::make_unique<AST::UnaryOperator>(opType, nextUnaryOperator());
-        }
-        default:
-        {
-            std::unique_ptr<AST::Expr> body = nextPrimaryExpr();
-            switch (_pCurToken->type)
+            // no more binary operators, the expression of the innermost frame is complete
+            while (!frame.operators.empty())
+                ReduceBinaryOperator(frame);
+            std::unique_ptr<AST::Expr> expr = std::move(frame.operands.back());
+            frame.operands.pop_back();
+
+            switch (frame.kind)
             {
-            case TokenType::TOKEN_PLUSPLUS:
-                nextToken(); // eat '++'
-                return std::make_unique<AST::UnaryOperator>(AST::UnaryOpType::UO_PostInc, std::move(body));
-            case TokenType::TOKEN_MINUSMINUS:
-                nextToken(); // eat '--'
-                return std::make_unique<AST::UnaryOperator>(AST::UnaryOpType::UO_PostDec, std::move(body));
-            default:
-                return std::move(body);
+            case ExprParseFrame::Kind::Root:
+                return expr;
+            case ExprParseFrame::Kind::Paren:
+                if (_pCurToken->type != TokenType::TOKEN_RPAREN)
+                    return nullptr;
+                nextToken(); // eat ')'
+                operand = std::make_unique<AST::ParenExpr>(std::move(expr));
+                break;
+            case ExprParseFrame::Kind::Call:
+                if (expr->isLValue())
+                    expr = std::make_unique<AST::ImplicitCastExpr>(std::move(expr), AST::CastExpr::CastType::LValueToRValue);
+                frame.params.push_back(std::move(expr));
+                if (_pCurToken->type == TokenType::TOKEN_COMMA)
+                {
+                    nextToken(); // eat ','
+                    if (_pCurToken->type != TokenType::TOKEN_RPAREN) // parse next param in the same frame
+                    {
+                        frame.isFirstOperand = true;
+                        continue;
+                    }
+                }
+                if (_pCurToken->type != TokenType::TOKEN_RPAREN)
+                    return nullptr;
+                nextToken(); // eat ')'
+                operand = std::make_unique<AST::CallExpr>(std::make_unique<AST::DeclRefExpr>(frame.name, true), frame.params);
+                break;
             }
-        }
+            frames.pop_back();
         }
     }
 
@@ -1418,66 +1489,6 @@ namespace lcc
         return expr;
     }
 
-    // PrimaryExpr
-    // ::= VarRefOrFuncCall
-    // ::= Number
-    // ::= ParenExpr
-    std::unique_ptr<AST::Expr> LR1Parser::nextPrimaryExpr()
-    {
-        switch (_pCurToken->type)
-        {
-        case TokenType::TOKEN_IDENTIFIER:
-            return nextVarRefOrFuncCall();
-        case TokenType::TOKEN_INTEGER:
-        case TokenType::TOKEN_FLOAT:
-        case TokenType::TOKEN_CHAR:
-            return nextNumber();
-        case TokenType::TOKEN_LPAREN:
-            return nextParenExpr();
-        default:
-            return nullptr;
-        }
-    }
-
-    // VarRefOrFuncCall
-    // ::= CallExpr '(' params ')'
-    // ::= DeclRefExpr
-    // params
-    // ::= Expr
-    // ::= Expr ',' params
-    std::unique_ptr<AST::Expr> LR1Parser::nextVarRefOrFuncCall()
-    {
-        std::string name = _pCurToken->content;
-        nextToken(); // eat name
-        switch (_pCurToken->type)
-        {
-        case TokenType::TOKEN_LPAREN:
-        {
-            std::shared_ptr<Token> pLParen = _pCurToken;
-            nextToken(); // eat '('
-            std::vector<std::unique_ptr<AST::Expr>> params;
-            while (_pCurToken->type != TokenType::TOKEN_RPAREN)
-            {
-                params.push_back(nextRValue());
-                switch (_pCurToken->type)
-                {
-                case TokenType::TOKEN_COMMA:
-                    nextToken(); // eat ','
-                case TokenType::TOKEN_RPAREN:
-                    break;
-                default:
-                    return nullptr;
-                }
-            }
-
-            nextToken(); // eat ')'
-            return std::make_unique<AST::CallExpr>(std::make_unique<AST::DeclRefExpr>(name, true), params);
-        }
-        default:
-            return std::make_unique<AST::DeclRefExpr>(name);
-        }
-    }
-
     std::unique_ptr<AST::Expr> LR1Parser::nextNumber()
     {
         std::string number = _pCurToken->content;
@@ -1502,23 +1513,6 @@ namespace lcc
         }
     }
 
-    std::unique_ptr<AST::Expr> LR1Parser::nextParenExpr()
-    {
-        std::shared_ptr<Token> pLParen = _pCurToken;
-        nextToken(); // eat '('
-        std::unique_ptr<AST::Expr> subExpr = nextExpression();
-        if (subExpr == nullptr)
-            return nullptr;
-        switch (_pCurToken->type)
-        {
-        case TokenType::TOKEN_RPAREN:
-            nextToken(); // eat ')'
-            return std::make_unique<AST::ParenExpr>(std::move(subExpr));
-        default:
-            return nullptr;
-        }
-    }
-
     std::shared_ptr<LR1Parser::NonTerminal> LR1Parser::nextAsmStmt()
     {
         // Fixed: Need to add support for basic asm syntax, which doesn't have any colon.
@@ -1602,7 +1596,7 @@ namespace lcc
                 return nullptr;
             }
 
-            auto tmpLValue = nextVarRefOrFuncCall();
+            auto tmpLValue = nextExpression();
             auto referencedLValue = dynamic_pointer_cast<AST::DeclRefExpr>(std::move(tmpLValue));
 
             auto rparen = _pCurToken;
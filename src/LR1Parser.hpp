@@ -5,6 +5,7 @@
 #include <set>
 #include <stack>
 #include <queue>
+#include <algorithm>
 
 #include "AST.hpp"
 #include "lexer.hpp"
@@ -63,12 +64,13 @@ namespace lcc
         private:
             std::string _name;
             std::unique_ptr<AST::ASTNode> _node;
+            std::vector<std::unique_ptr<AST::ASTNode>> _nodes; // element list of right recursive rules, last element first
 
         public:
             virtual SymbolType type() const override { return SymbolType::NonTerminal; };
             virtual std::string name() const override { return _name; };
             NonTerminal(const std::string &name, std::unique_ptr<AST::ASTNode> node = nullptr) : _name(name), _node(std::move(node)){};
-            NonTerminal(NonTerminal &&nonTerminal) : _name(nonTerminal.name()), _node(std::move(nonTerminal._node)){};
+            NonTerminal(NonTerminal &&nonTerminal) : _name(nonTerminal.name()), _node(std::move(nonTerminal._node)), _nodes(std::move(nonTerminal._nodes)){};
         };
 
         typedef struct _SharedPtrComp
@@ -238,12 +240,7 @@ namespace lcc
         // expression parsers
         std::shared_ptr<NonTerminal> nextExpr(); // expr parser implemented with OperatorPrecedence Parse
         std::unique_ptr<AST::Expr> nextExpression();
-        std::unique_ptr<AST::Expr> nextRHSExpr(std::unique_ptr<AST::Expr> lhs, AST::BinaryOperator::Precedence lastBiOpPrec);
-        std::unique_ptr<AST::Expr> nextUnaryOperator();
-        std::unique_ptr<AST::Expr> nextPrimaryExpr();
-        std::unique_ptr<AST::Expr> nextVarRefOrFuncCall();
         std::unique_ptr<AST::Expr> nextNumber();
-        std::unique_ptr<AST::Expr> nextParenExpr();
         std::unique_ptr<AST::Expr> nextRValue();
 
         // AsmStmt parser
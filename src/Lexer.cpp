@@ -22,62 +22,44 @@ namespace lcc
 #undef keyword
     }
 
-    json Lexer::jsonifyTokens(const std::vector<std::shared_ptr<Token>> &tokens)
+    void Lexer::dumpTokens(const std::vector<std::shared_ptr<Token>> &tokens, DumpWriter &writer)
     {
-        json arr = json::array();
+        writer.beginArray();
         for (auto &token : tokens)
         {
-            json j;
+            const char *type = nullptr;
+            std::string_view content = token->content;
             switch (token->type)
             {
             case TokenType::TOKEN_NEWLINE:
                 break;
             case TokenType::TOKEN_IDENTIFIER:
-                j["id"] = token->count;
-                j["type"] = "TOKEN_IDENTIFIER";
-                j["content"] = token->content;
-                j["position"] = {token->pos.line, token->pos.column};
+                type = "TOKEN_IDENTIFIER";
                 break;
             case TokenType::TOKEN_EOF:
-                j["id"] = token->count;
-                j["type"] = "TOKEN_EOF";
-                j["content"] = "EOF";
-                j["position"] = {token->pos.line, token->pos.column};
+                type = "TOKEN_EOF";
+                content = "EOF";
                 break;
             case TokenType::TOKEN_WHITESPACE:
                 break;
             case TokenType::TOKEN_INVALID:
                 break;
             case TokenType::TOKEN_STRING:
-                j["id"] = token->count;
-                j["type"] = "TOKEN_STRING";
-                j["content"] = token->content;
-                j["position"] = {token->pos.line, token->pos.column};
+                type = "TOKEN_STRING";
                 break;
             case TokenType::TOKEN_INTEGER:
-                j["id"] = token->count;
-                j["type"] = "TOKEN_INTEGER";
-                j["content"] = token->content;
-                j["position"] = {token->pos.line, token->pos.column};
+                type = "TOKEN_INTEGER";
                 break;
             case TokenType::TOKEN_FLOAT:
-                j["id"] = token->count;
-                j["type"] = "TOKEN_FLOAT";
-                j["content"] = token->content;
-                j["position"] = {token->pos.line, token->pos.column};
+                type = "TOKEN_FLOAT";
                 break;
             case TokenType::TOKEN_CHAR:
-                j["id"] = token->count;
-                j["type"] = "TOKEN_CHAR";
-                j["content"] = token->content;
-                j["position"] = {token->pos.line, token->pos.column};
+                type = "TOKEN_CHAR";
                 break;
-#define keyword(name, disc)                                   \
-    case TokenType::name:                                     \
-        j["id"] = token->count;                               \
-        j["type"] = #name;                                    \
-        j["content"] = disc;                                  \
-        j["position"] = {token->pos.line, token->pos.column}; \
+#define keyword(name, disc) \
+    case TokenType::name:   \
+        type = #name;       \
+        content = disc;     \
         break;
 #define punctuator(name, disc) keyword(name, disc)
 #include "TokenType.inc"
@@ -87,10 +69,21 @@ namespace lcc
             default:
                 break;
             }
-            if (!j.empty())
-                arr.emplace_back(j);
+            if (type == nullptr)
+                continue;
+
+            writer.beginObject();
+            writer.writeInt("id", token->count);
+            writer.writeString("type", type);
+            writer.writeString("content", content);
+            writer.writeKey("position");
+            writer.beginArray();
+            writer.writeInt(token->pos.line);
+            writer.writeInt(token->pos.column);
+            writer.endArray();
+            writer.endObject();
         }
-        return arr;
+        writer.endArray();
     }
 
     void Lexer::nextLine()
@@ -170,26 +163,40 @@ namespace lcc
 
     std::vector<std::shared_ptr<Token>> Lexer::run(std::shared_ptr<File> file)
     {
-        _file = file;
-        _tokenCnt = 0;
-        _curTokenPos = _file->getPosition();
-        nextLine();
+        begin(file);
 
         std::vector<std::shared_ptr<Token>> tokens;
         std::shared_ptr<Token> token = nullptr;
 
         do
         {
-            token = nextToken();
-            if (token->type == TokenType::TOKEN_INVALID)
-                WARNING("Find invalid token at " << token->pos.line << ", " << token->pos.column);
-            else if (token->type != TokenType::TOKEN_WHITESPACE && token->type != TokenType::TOKEN_NEWLINE)
-                tokens.push_back(token);
+            token = next();
+            tokens.push_back(token);
         } while (token->type != TokenType::TOKEN_EOF);
 
         return tokens;
     }
 
+    void Lexer::begin(std::shared_ptr<File> file)
+    {
+        _file = file;
+        _tokenCnt = 0;
+        _curTokenPos = _file->getPosition();
+        nextLine();
+    }
+
+    std::shared_ptr<Token> Lexer::next()
+    {
+        while (true)
+        {
+            std::shared_ptr<Token> token = nextToken();
+            if (token->type == TokenType::TOKEN_INVALID)
+                WARNING("Find invalid token at " << token->pos.line << ", " << token->pos.column);
+            else if (token->type != TokenType::TOKEN_WHITESPACE && token->type != TokenType::TOKEN_NEWLINE)
+                return token;
+        }
+    }
+
     std::shared_ptr<Token> Lexer::makeGeneralToken(const Token &token) const
     {
         std::shared_ptr<Token> pToken = std::make_shared<Token>(token);
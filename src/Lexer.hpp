@@ -5,6 +5,7 @@
 #include <vector>
 #include <unordered_map>
 
+#include "Dumper.hpp"
 #include "File.hpp"
 
 namespace lcc
@@ -60,7 +61,12 @@ namespace lcc
 
         std::vector<std::shared_ptr<Token>> run(std::shared_ptr<File> file);
 
-        static json jsonifyTokens(const std::vector<std::shared_ptr<Token>> &tokens);
+        // pulls the tokens of file one at a time instead, whitespace and newlines are skipped
+        // and TOKEN_EOF is the last one
+        void begin(std::shared_ptr<File> file);
+        std::shared_ptr<Token> next();
+
+        static void dumpTokens(const std::vector<std::shared_ptr<Token>> &tokens, DumpWriter &writer);
         
     private:
         static std::unique_ptr<Lexer> _inst;
@@ -10,16 +10,84 @@ namespace lcc
     llvm::cl::opt<std::string>
         Options::ASTDumpPath("ast", llvm::cl::desc("AST dump file"), llvm::cl::init("-"));
 
+    llvm::cl::opt<DumpWriter::Format>
+        Options::TokenDumpFormat("token-format", llvm::cl::desc("Token dump format"),
+                                 llvm::cl::values(clEnumValN(DumpWriter::Format::JSON, "json", "Indented JSON text"),
+                                                  clEnumValN(DumpWriter::Format::CBOR, "cbor", "Binary CBOR")),
+                                 llvm::cl::init(DumpWriter::Format::JSON));
+
+    llvm::cl::opt<DumpWriter::Format>
+        Options::ASTDumpFormat("ast-format", llvm::cl::desc("AST dump format"),
+                               llvm::cl::values(clEnumValN(DumpWriter::Format::JSON, "json", "Indented JSON text"),
+                                                clEnumValN(DumpWriter::Format::CBOR, "cbor", "Binary CBOR")),
+                               llvm::cl::init(DumpWriter::Format::JSON));
+
     llvm::cl::opt<std::string>
         Options::LR1GrammarFilePath("lr1", llvm::cl::desc("LR1 grammar file path"),
                                     llvm::cl::init("-"));
 
     llvm::cl::opt<std::string>
-        Options::IRDumpPath("ir", llvm::cl::desc("IR dump file"),
+        Options::ASTCacheDir("ast-cache", llvm::cl::desc("Directory of cached ASTs, reused while the source and parser are unchanged"),
+                             llvm::cl::init("-"));
+
+    llvm::cl::opt<std::string>
+        Options::IRDumpPath("ir", llvm::cl::desc("IR dump file, the IR is handed to the code generator in memory and only written when this is given"),
                             llvm::cl::init("-"));
 
     llvm::cl::opt<bool>
-        Options::ShouldPrintLog("log", llvm::cl::desc("Print log"), llvm::cl::init(false));
+        Options::DumpIRInBackground("ir-async", llvm::cl::desc("Write the IR dump on a background thread while the target assembly is generated"),
+                                    llvm::cl::init(true));
+
+    llvm::cl::opt<bool>
+        Options::UseEntryAllocas("ir-allocas", llvm::cl::desc("Keep every local of the LLVM IR in an entry block alloca instead of building SSA values directly"),
+                                 llvm::cl::init(false));
+
+    llvm::cl::opt<unsigned>
+        Options::IRGenThreads("ir-threads", llvm::cl::desc("Generate the LLVM IR of function definitions on N threads"),
+                              llvm::cl::value_desc("N"), llvm::cl::init(1));
+
+    llvm::cl::opt<std::string>
+        Options::QuaternionDumpPath("quat", llvm::cl::desc("Quaternion IR dump file"),
+                                    llvm::cl::init("-"));
+
+    llvm::cl::opt<bool>
+        Options::OptimizeQuaternions("quat-opt", llvm::cl::desc("Optimize the quaternion IR before dumping it"),
+                                     llvm::cl::init(true));
+
+    llvm::cl::opt<unsigned>
+        Options::QuaternionInlineLimit("quat-inline-limit", llvm::cl::desc("Codes the body of a leaf function may have to be inlined by the quaternion optimizer, 0 disables inlining"),
+                                       llvm::cl::value_desc("N"), llvm::cl::init(24));
+
+    llvm::cl::opt<bool>
+        Options::RunQuaternions("quat-run", llvm::cl::desc("Run main on the quaternion VM instead of generating code, its return value becomes the exit code"),
+                                llvm::cl::init(false));
+
+    llvm::cl::opt<bool>
+        Options::UseQuaternionCodegen("quat-codegen", llvm::cl::desc("Generate x86-64 assembly straight from the quaternion IR instead of through LLVM, "
+                                                                     "fails when the quaternion IR can't express the source"),
+                                      llvm::cl::init(false));
+
+    llvm::cl::opt<bool>
+        Options::ShouldPrintLog("log", llvm::cl::desc("Print statistics of the passes, and the parsing log of --lr1"), llvm::cl::init(false));
+
+    llvm::cl::opt<bool>
+        Options::ExportAllFunctions("export-all", llvm::cl::desc("Keep functions that are unreachable from main, e.g. when linking with other objects"),
+                                    llvm::cl::init(false));
+
+    llvm::cl::opt<bool>
+        Options::StreamDecls("stream", llvm::cl::desc("Parse and lower one top level declaration at a time, freeing each function's AST once its IR is written"),
+                             llvm::cl::init(false));
+
+    llvm::cl::opt<bool>
+        Options::ParseOnly("parse-only", llvm::cl::desc("Stop once the source is parsed and its AST is freed again"), llvm::cl::init(false));
+
+    llvm::cl::opt<unsigned>
+        Options::CTFEStepLimit("ctfe-step-limit", llvm::cl::desc("Statements a call with constant arguments may execute to be evaluated at compile time, 0 disables it"),
+                               llvm::cl::value_desc("N"), llvm::cl::init(100000));
+
+    llvm::cl::opt<unsigned>
+        Options::CTFEDepthLimit("ctfe-depth-limit", llvm::cl::desc("Nested calls allowed in a compile time evaluation"),
+                                llvm::cl::value_desc("N"), llvm::cl::init(64));
 
     llvm::cl::opt<std::string>
         Options::InputFilename(llvm::cl::Positional, llvm::cl::desc("<input source file>"), llvm::cl::init("-"));
@@ -90,6 +158,14 @@ namespace lcc
     llvm::cl::opt<bool>
         Options::NoVerify("disable-verify", llvm::cl::Hidden, llvm::cl::desc("Do not verify input module"));
 
+    llvm::cl::opt<bool>
+        Options::DisableIROptimizations("disable-ir-opt", llvm::cl::desc("Do not run the middle end pipeline of an explicit -O level before code generation"),
+                                        llvm::cl::init(false));
+
+    llvm::cl::opt<unsigned>
+        Options::CodegenThreads("codegen-threads", llvm::cl::desc("Split the module into N partitions whose assembly is generated in parallel"),
+                                llvm::cl::value_desc("N"), llvm::cl::init(1));
+
     llvm::cl::opt<bool>
         Options::DisableSimplifyLibCalls("disable-simplify-libcalls", llvm::cl::desc("Disable simplify-libcalls"));
 
@@ -167,30 +243,38 @@ namespace lcc
             return false;
         }
 
-        if (ShouldPrintLog && LR1GrammarFilePath == "-")
+        if (ParseOnly && StreamDecls)
         {
-            WARNING("--log option must be used with --LR1 option, ignored --log");
+            WARNING("--stream option can't be used with --parse-only, ignored --stream");
+            StreamDecls = false;
         }
 
-        if (TokenDumpPath == "-")
+        // streaming lowers each function as soon as it is parsed
+        if (StreamDecls && IRGenThreads > 1)
         {
-            TokenDumpPath = DEFAULT_TOKEN_DUMP_PATH;
-            WARNING("Token dump path not set, assuming " << DEFAULT_TOKEN_DUMP_PATH);
+            WARNING("--ir-threads option can't be used with --stream, ignored --ir-threads");
+            IRGenThreads = 1;
         }
 
-        if (ASTDumpPath == "-")
+        // the other modes need the whole token vector or AST at once
+        if (StreamDecls && (LR1GrammarFilePath != "-" || ASTCacheDir != "-" || TokenDumpPath != "-" || ASTDumpPath != "-" || QuaternionDumpPath != "-" || RunQuaternions || UseQuaternionCodegen))
         {
-            ASTDumpPath = DEFAULT_AST_DUMP_PATH;
-            WARNING("AST dump path not set, assuming " << DEFAULT_AST_DUMP_PATH);
+            WARNING("--stream option can't be used with --lr1, --ast-cache, --token, --ast, --quat, --quat-run or --quat-codegen, ignored --stream");
+            StreamDecls = false;
         }
 
+        // both need the whole translation unit
+        if (StreamDecls)
+            WARNING("--stream skips compile time evaluation of calls and elimination of unreachable functions");
+
         //if (OutputFilename == "-")
         //{
         //    OutputFilename = DEFAULT_ASM_FILENAME;
         //    WARNING("ASM filename not set, assuming " << DEFAULT_ASM_FILENAME);
         //}
 
-        if (IRDumpPath == "-")
+        // streaming writes the functions out as they are generated and compiles the file afterwards
+        if (StreamDecls && IRDumpPath == "-")
         {
             IRDumpPath = DEFAULT_IR_DUMP_PATH;
             WARNING("IR dump path not set, assuming " << DEFAULT_IR_DUMP_PATH);
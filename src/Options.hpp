@@ -6,8 +6,8 @@
 #include "llvm/Remarks/HotnessThresholdParser.h"
 #include "llvm/CodeGen/CommandFlags.h"
 
-#define DEFAULT_TOKEN_DUMP_PATH "tokens.json"
-#define DEFAULT_AST_DUMP_PATH "ast.json"
+#include "Dumper.hpp"
+
 #define DEFAULT_IR_DUMP_PATH "ir.ll"
 #define DEFAULT_ASM_FILENAME "ir.s"
 
@@ -41,12 +41,44 @@ namespace lcc
 
         static llvm::cl::opt<std::string> ASTDumpPath;
 
+        static llvm::cl::opt<DumpWriter::Format> TokenDumpFormat;
+
+        static llvm::cl::opt<DumpWriter::Format> ASTDumpFormat;
+
         static llvm::cl::opt<std::string> IRDumpPath;
 
+        static llvm::cl::opt<bool> DumpIRInBackground;
+
+        static llvm::cl::opt<bool> UseEntryAllocas;
+
+        static llvm::cl::opt<unsigned> IRGenThreads;
+
+        static llvm::cl::opt<std::string> QuaternionDumpPath;
+
+        static llvm::cl::opt<bool> OptimizeQuaternions;
+
+        static llvm::cl::opt<unsigned> QuaternionInlineLimit;
+
+        static llvm::cl::opt<bool> RunQuaternions;
+
+        static llvm::cl::opt<bool> UseQuaternionCodegen;
+
         static llvm::cl::opt<std::string> LR1GrammarFilePath;
 
+        static llvm::cl::opt<std::string> ASTCacheDir;
+
         static llvm::cl::opt<bool> ShouldPrintLog;
 
+        static llvm::cl::opt<bool> ExportAllFunctions;
+
+        static llvm::cl::opt<bool> StreamDecls;
+
+        static llvm::cl::opt<bool> ParseOnly;
+
+        static llvm::cl::opt<unsigned> CTFEStepLimit;
+
+        static llvm::cl::opt<unsigned> CTFEDepthLimit;
+
         static llvm::cl::opt<std::string> OutputFilename;
 
         static llvm::cl::opt<std::string> SplitDwarfOutputFile;
@@ -74,6 +106,10 @@ namespace lcc
 
         static llvm::cl::opt<bool> NoVerify;
 
+        static llvm::cl::opt<bool> DisableIROptimizations;
+
+        static llvm::cl::opt<unsigned> CodegenThreads;
+
         static llvm::cl::opt<bool> DisableSimplifyLibCalls;
 
         static llvm::cl::opt<bool> ShowMCEncoding;
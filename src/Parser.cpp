@@ -137,10 +137,65 @@ namespace lcc
         }
     };
 
+    namespace
+    {
+        // Nesting level of Parser::nextStmt
+        struct StmtParseFrame
+        {
+            enum class Kind
+            {
+                Compound,
+                If,
+                While
+            } kind{Kind::Compound};
+            std::shared_ptr<Token> pOpenToken{nullptr};     // '{' of a compound statement
+            std::vector<std::unique_ptr<AST::Stmt>> body;   // compound statement body
+            std::unique_ptr<AST::Expr> condition{nullptr};  // if/while condition
+            std::unique_ptr<AST::Stmt> thenBody{nullptr};   // if body, set while parsing the else branch
+        };
+
+        // Nesting level of Parser::nextExpression, operands and binary operators
+        // are kept per frame and reduced by precedence
+        struct ExprParseFrame
+        {
+            enum class Kind
+            {
+                Root,
+                Paren,
+                Call,
+                Subscript
+            } kind{Kind::Root};
+            std::shared_ptr<Token> pOpenToken{nullptr};    // '(' or '['
+            std::string name;                              // callee or array name
+            std::vector<std::unique_ptr<AST::Expr>> params; // finished call params
+            std::vector<std::unique_ptr<AST::Expr>> operands;
+            std::vector<std::pair<AST::BinaryOpType, AST::BinaryOperator::Precedence>> operators;
+            std::vector<AST::UnaryOpType> prefixOps; // prefix operators of the operand being parsed
+            bool isFirstOperand{true};
+        };
+    }
+
+    static void ReduceBinaryOperator(ExprParseFrame &frame)
+    {
+        std::unique_ptr<AST::Expr> rhs = std::move(frame.operands.back());
+        frame.operands.pop_back();
+        std::unique_ptr<AST::Expr> lhs = std::move(frame.operands.back());
+        frame.operands.pop_back();
+        frame.operands.push_back(std::make_unique<AST::BinaryOperator>(frame.operators.back().first, std::move(lhs), std::move(rhs)));
+        frame.operators.pop_back();
+    }
+
     std::unique_ptr<Parser> Parser::_inst;
 
     void Parser::nextToken()
     {
+        if (_isStreaming)
+        {
+            if (_pCurToken->type != TokenType::TOKEN_EOF)
+                _pCurToken = Lexer::getInstance()->next();
+            return;
+        }
+
         if (_curTokenIdx + 1 < _tokens.size())
             _curTokenIdx++;
         _pCurToken = _tokens[_curTokenIdx];
@@ -148,6 +203,7 @@ namespace lcc
 
     std::unique_ptr<AST::Decl> Parser::run(const std::vector<std::shared_ptr<Token>> &tokens)
     {
+        _isStreaming = false;
         _tokens = tokens;
         _curTokenIdx = 0;
         _pCurToken = _tokens[_curTokenIdx];
@@ -177,12 +233,45 @@ namespace lcc
         return std::make_unique<AST::TranslationUnitDecl>(topLevelDecls);
     }
 
+    void Parser::begin(std::shared_ptr<File> file)
+    {
+        _isStreaming = true;
+        _tokens.clear();
+        _curTokenIdx = 0;
+        Lexer::getInstance()->begin(file);
+        _pCurToken = Lexer::getInstance()->next();
+    }
+
+    std::unique_ptr<AST::Decl> Parser::next()
+    {
+        switch (_pCurToken->type)
+        {
+        case TokenType::TOKEN_EOF:
+            return nullptr;
+        case TokenType::TOKEN_KWINT:
+        case TokenType::TOKEN_KWVOID:
+        case TokenType::TOKEN_KWFLOAT:
+        case TokenType::TOKEN_KWCHAR:
+        case TokenType::TOKEN_KWEXTERN:
+            return nextTopLevelDecl();
+        default:
+            FATAL_ERROR("Parsing failed, abort...");
+            return nullptr;
+        }
+    }
+
+    void Parser::releaseBody(AST::FunctionDecl *functionDecl)
+    {
+        functionDecl->_body.reset();
+        AST::ASTContext::current()->rewind(_bodyMark);
+    }
+
     // FunctionDecl
     // ::= type name '(' params ')'
     // ::= type name '(' params ')' '{' CompoundStmt '}'
     // params
     // ::= ParmVarDecl, params
-    std::unique_ptr<AST::Decl> Parser::nextFunctionDecl(const std::string name, const std::string type, const bool isExtern)
+    std::unique_ptr<AST::Decl> Parser::nextFunctionDecl(const std::string name, const AST::Type *type, const bool isExtern)
     {
         std::shared_ptr<Token> pLParen = _pCurToken;
         nextToken(); // eat '('
@@ -203,14 +292,14 @@ namespace lcc
                 return nullptr;
             }
 
-            std::string paramType = _pCurToken->content;
+            const AST::Type *paramType = AST::Type::getBuiltin(_pCurToken->content);
             std::string paramName;
             nextToken(); // eat type
             
             // pointer type
             if(_pCurToken->type == TokenType::TOKEN_STAR)
             {
-                paramType += '*'; 
+                paramType = AST::Type::getPointer(paramType);
                 nextToken(); // eat *
             }
 
@@ -239,13 +328,16 @@ namespace lcc
         }
 
         nextToken(); // eat ')'
+        // the declaration is allocated ahead of its body, so the body can be released on its own
+        auto functionDecl = std::make_unique<AST::FunctionDecl>(name, type, params, nullptr, isExtern);
+        _bodyMark = AST::ASTContext::current()->mark();
+
         // parse top level function body
-        std::unique_ptr<AST::Stmt> body = nullptr;
         switch (_pCurToken->type)
         {
         case TokenType::TOKEN_LBRACE: // function definition
-            body = nextCompoundStmt();
-            if (body == nullptr)
+            functionDecl->_body = nextCompoundStmt();
+            if (functionDecl->_body == nullptr)
                 return nullptr;
             if (_pCurToken->type == TokenType::TOKEN_SEMI)
             {
@@ -261,12 +353,12 @@ namespace lcc
             return nullptr;
         }
 
-        return std::make_unique<AST::FunctionDecl>(name, type, params, std::move(body), isExtern);
+        return functionDecl;
     }
 
     // VarDecl
     // ::= '=' BinaryOperator ';'
-    std::unique_ptr<AST::Decl> Parser::nextVarDecl(const std::string name, const std::string type)
+    std::unique_ptr<AST::Decl> Parser::nextVarDecl(const std::string name, const AST::Type *type)
     {
         nextToken(); // eat '='
         std::unique_ptr<AST::Expr> val = nextExpression();
@@ -312,12 +404,17 @@ namespace lcc
             }
         }
 
-        std::string type = _pCurToken->content; // function return value type or var type
-        nextToken();                            // eat type
+        const AST::Type *type = AST::Type::getBuiltin(_pCurToken->content); // function return value type or var type
+        if (type == nullptr)
+        {
+            FATAL_ERROR(TOKEN_INFO(_pCurToken) << "Unknown type name " << _pCurToken->content);
+            return nullptr;
+        }
+        nextToken(); // eat type
         
         if(_pCurToken->type == TokenType::TOKEN_STAR) // pointer type
         {
-            type += '*';
+            type = AST::Type::getPointer(type);
             nextToken(); // eat *
         }
 
@@ -349,27 +446,11 @@ namespace lcc
         return nullptr;
     }
 
+    // CompoundStmt
+    // ::= '{' Stmts '}'
     std::unique_ptr<AST::Stmt> Parser::nextCompoundStmt()
     {
-        std::shared_ptr<Token> pLBrace = _pCurToken;
-        nextToken(); // eat '{'
-
-        std::vector<std::unique_ptr<AST::Stmt>> body;
-        while (_pCurToken->type != TokenType::TOKEN_RBRACE)
-        {
-            std::unique_ptr<AST::Stmt> stmt = nextStmt();
-            if (stmt == nullptr)
-                break;
-            body.push_back(std::move(stmt));
-        }
-
-        if (_pCurToken->type != TokenType::TOKEN_RBRACE)
-        {
-            FATAL_ERROR(TOKEN_INFO(_pCurToken) << "No matching rbrace found for lbrace at " << pLBrace->pos.line << ", " << pLBrace->pos.column);
-            return nullptr;
-        }
-        nextToken(); // eat '}'
-        return std::make_unique<AST::CompoundStmt>(body);
+        return nextStmt(); // current token is '{', nested blocks are handled by the statement frame stack
     }
 
     std::unique_ptr<AST::Stmt> Parser::nextDeclStmt()
@@ -396,12 +477,17 @@ namespace lcc
             }
         }
 
-        std::string type = _pCurToken->content; // function return value type or var type
-        nextToken();                            // eat type
+        const AST::Type *type = AST::Type::getBuiltin(_pCurToken->content); // function return value type or var type
+        if (type == nullptr)
+        {
+            FATAL_ERROR(TOKEN_INFO(_pCurToken) << "Unknown type name " << _pCurToken->content);
+            return nullptr;
+        }
+        nextToken(); // eat type
 
         if(_pCurToken->type == TokenType::TOKEN_STAR) // pointer type
         {
-            type += '*';
+            type = AST::Type::getPointer(type);
             nextToken(); // eat *
         }
 
@@ -423,7 +509,7 @@ namespace lcc
                 FATAL_ERROR(TOKEN_INFO(_pCurToken) << "Expected array size");
                 return nullptr;
             }
-            type += '[' + _pCurToken->content + ']';
+            type = AST::Type::getArray(type, std::stoi(_pCurToken->content));
             nextToken(); // eat arr size integer
             if(_pCurToken->type != TokenType::TOKEN_RSQUARE)
             {
@@ -518,35 +604,121 @@ namespace lcc
         }
     }
 
+    // Stmt
+    // ::= CompoundStmt
+    // ::= IfStmt
+    // ::= WhileStmt
+    // ::= ReturnStmt
+    // ::= NullStmt
+    // ::= DeclStmt
+    // ::= ValueStmt
+    // ::= AsmStmt
+    // Compound, if and while statements push a frame instead of recursing,
+    // so the nesting depth is only bounded by the heap.
     std::unique_ptr<AST::Stmt> Parser::nextStmt()
     {
-        switch (_pCurToken->type)
+        std::vector<StmtParseFrame> frames;
+        std::unique_ptr<AST::Stmt> stmt = nullptr; // finished statement, handed to the innermost frame
+
+        while (true)
         {
-        case TokenType::TOKEN_LBRACE:
-            return nextCompoundStmt();
-        case TokenType::TOKEN_KWWHILE:
-            return nextWhileStmt();
-        case TokenType::TOKEN_KWIF:
-            return nextIfStmt();
-        case TokenType::TOKEN_KWRETURN:
-            return nextReturnStmt();
-        case TokenType::TOKEN_SEMI:
-            return nextNullStmt();
-        case TokenType::TOKEN_KWINT:
-        case TokenType::TOKEN_KWVOID:
-        case TokenType::TOKEN_KWFLOAT:
-        case TokenType::TOKEN_KWCHAR:
-            return nextDeclStmt();
-        case TokenType::TOKEN_INTEGER:
-        case TokenType::TOKEN_FLOAT:
-        case TokenType::TOKEN_LPAREN:
-        case TokenType::TOKEN_IDENTIFIER:
-            return nextValueStmt();
-        case TokenType::TOKEN_KWASM: // only GCC asm dialect syntax is supported
-            return nextAsmStmt();
-        default:
-            FATAL_ERROR(TOKEN_INFO(_pCurToken) << "Unexpected statement");
-            return nullptr;
+            if (stmt == nullptr && !frames.empty() && frames.back().kind == StmtParseFrame::Kind::Compound && _pCurToken->type == TokenType::TOKEN_RBRACE)
+            {
+                nextToken(); // eat '}'
+                stmt = std::make_unique<AST::CompoundStmt>(frames.back().body);
+                frames.pop_back();
+            }
+
+            if (stmt == nullptr)
+            {
+                switch (_pCurToken->type)
+                {
+                case TokenType::TOKEN_LBRACE:
+                {
+                    StmtParseFrame frame;
+                    frame.kind = StmtParseFrame::Kind::Compound;
+                    frame.pOpenToken = _pCurToken;
+                    frames.push_back(std::move(frame));
+                    nextToken(); // eat '{'
+                    continue;
+                }
+                case TokenType::TOKEN_KWWHILE:
+                case TokenType::TOKEN_KWIF:
+                {
+                    StmtParseFrame frame;
+                    frame.kind = _pCurToken->type == TokenType::TOKEN_KWIF ? StmtParseFrame::Kind::If : StmtParseFrame::Kind::While;
+                    std::string keyword = _pCurToken->content;
+                    nextToken(); // eat 'if' or 'while'
+                    frame.condition = nextCondition(keyword);
+                    if (frame.condition == nullptr)
+                        return nullptr;
+                    frames.push_back(std::move(frame));
+                    continue;
+                }
+                case TokenType::TOKEN_KWRETURN:
+                    stmt = nextReturnStmt();
+                    break;
+                case TokenType::TOKEN_SEMI:
+                    stmt = nextNullStmt();
+                    break;
+                case TokenType::TOKEN_KWINT:
+                case TokenType::TOKEN_KWVOID:
+                case TokenType::TOKEN_KWFLOAT:
+                case TokenType::TOKEN_KWCHAR:
+                    stmt = nextDeclStmt();
+                    break;
+                case TokenType::TOKEN_INTEGER:
+                case TokenType::TOKEN_FLOAT:
+                case TokenType::TOKEN_LPAREN:
+                case TokenType::TOKEN_IDENTIFIER:
+                    stmt = nextValueStmt();
+                    break;
+                case TokenType::TOKEN_KWASM: // only GCC asm dialect syntax is supported
+                    stmt = nextAsmStmt();
+                    break;
+                default:
+                    FATAL_ERROR(TOKEN_INFO(_pCurToken) << "Unexpected statement");
+                    break;
+                }
+
+                if (stmt == nullptr)
+                {
+                    if (!frames.empty() && frames.back().kind == StmtParseFrame::Kind::Compound && _pCurToken->type != TokenType::TOKEN_RBRACE)
+                    {
+                        std::shared_ptr<Token> pLBrace = frames.back().pOpenToken;
+                        FATAL_ERROR(TOKEN_INFO(_pCurToken) << "No matching rbrace found for lbrace at " << pLBrace->pos.line << ", " << pLBrace->pos.column);
+                    }
+                    return nullptr;
+                }
+            }
+
+            if (frames.empty())
+                return stmt;
+
+            StmtParseFrame &frame = frames.back();
+            switch (frame.kind)
+            {
+            case StmtParseFrame::Kind::Compound:
+                frame.body.push_back(std::move(stmt));
+                break;
+            case StmtParseFrame::Kind::While:
+                stmt = std::make_unique<AST::WhileStmt>(std::move(frame.condition), std::move(stmt));
+                frames.pop_back();
+                break;
+            case StmtParseFrame::Kind::If:
+                if (frame.thenBody == nullptr)
+                {
+                    frame.thenBody = std::move(stmt);
+                    if (_pCurToken->type == TokenType::TOKEN_KWELSE)
+                    {
+                        nextToken(); // eat 'else', the next statement is the else body
+                        break;
+                    }
+                }
+                stmt = std::make_unique<AST::IfStmt>(std::move(frame.condition), std::move(frame.thenBody), std::move(stmt));
+                frames.pop_back();
+                break;
+            }
         }
     }
 
@@ -558,12 +730,10 @@ namespace lcc
         return std::make_unique<AST::NullStmt>();
     }
 
-    // IfStmt
-    // ::= 'if' '(' Expr ')' Stmt
-    // ::= 'if' '(' Expr ')' Stmt 'else' Stmt
-    std::unique_ptr<AST::Stmt> Parser::nextIfStmt()
+    // Condition of IfStmt and WhileStmt
+    // ::= '(' Expr ')'
+    std::unique_ptr<AST::Expr> Parser::nextCondition(const std::string &keyword)
     {
-        nextToken(); // eat 'if'
         std::shared_ptr<Token> pLParen = _pCurToken;
         switch (_pCurToken->type) // lparen check
         {
@@ -571,7 +741,7 @@ namespace lcc
             nextToken(); // eat '('
             break;
         default:
-            FATAL_ERROR(TOKEN_INFO(pLParen) << "Unexpected token after if");
+            FATAL_ERROR(TOKEN_INFO(pLParen) << "Unexpected token after " << keyword);
             return nullptr;
         }
 
@@ -589,105 +759,7 @@ namespace lcc
             return nullptr;
         }
 
-        std::unique_ptr<AST::Stmt> body = nextStmt();
-        if (body == nullptr)
-            return nullptr;
-
-        std::unique_ptr<AST::Stmt> elseBody = nullptr;
-        if (_pCurToken->type == TokenType::TOKEN_KWELSE) // parse else body
-        {
-            nextToken(); // eat 'else'
-            elseBody = nextStmt();
-        }
-
-        return std::make_unique<AST::IfStmt>(std::move(condition), std::move(body), std::move(elseBody));
-    }
-
-    // WhileStmt
-    // ::= 'while' '(' Expr ')' Stmt
-    std::unique_ptr<AST::Stmt> Parser::nextWhileStmt()
-    {
-        nextToken(); // eat 'while'
-        std::shared_ptr<Token> pLParen = _pCurToken;
-        switch (_pCurToken->type) // lparen check
-        {
-        case TokenType::TOKEN_LPAREN:
-            nextToken(); // eat '('
-            break;
-        default:
-            FATAL_ERROR(TOKEN_INFO(pLParen) << "Unexpected token after if");
-            return nullptr;
-        }
-        std::unique_ptr<AST::Expr> condition = nextRValue();
-        switch (_pCurToken->type) // rparen check
-        {
-        case TokenType::TOKEN_RPAREN:
-            nextToken(); // eat ')'
-            break;
-        default:
-            FATAL_ERROR(TOKEN_INFO(_pCurToken) << "No matching ) for ( at " << pLParen->pos.line << ", " << pLParen->pos.column);
-            return nullptr;
-        }
-        std::unique_ptr<AST::Stmt> body = nextStmt();
-        if (body == nullptr)
-            return nullptr;
-
-        return std::make_unique<AST::WhileStmt>(std::move(condition), std::move(body));
-    }
-
-    // VarRefOrFuncCall
-    // ::= CallExpr '(' params ')'
-    // ::= DeclRefExpr
-    // ::= DeclRefExpr '[' Expr ']'
-    // params
-    // ::= Expr
-    // ::= Expr ',' params
-    std::unique_ptr<AST::Expr> Parser::nextVarRefOrFuncCall()
-    {
-        std::string name = _pCurToken->content;
-        nextToken(); // eat name
-        switch (_pCurToken->type)
-        {
-        case TokenType::TOKEN_LPAREN: // function call
-        {
-            std::shared_ptr<Token> pLParen = _pCurToken;
-            nextToken(); // eat '('
-            std::vector<std::unique_ptr<AST::Expr>> params;
-            while (_pCurToken->type != TokenType::TOKEN_RPAREN)
-            {
-                params.push_back(nextRValue());
-                switch (_pCurToken->type)
-                {
-                case TokenType::TOKEN_COMMA:
-                    nextToken(); // eat ','
-                case TokenType::TOKEN_RPAREN:
-                    break;
-                default:
-                    FATAL_ERROR(TOKEN_INFO(_pCurToken) << "Expected ) to match ( at " << pLParen->pos.line << ", " << pLParen->pos.column);
-                    return nullptr;
-                }
-            }
-
-            nextToken(); // eat ')'
-            return std::make_unique<AST::CallExpr>(std::make_unique<AST::DeclRefExpr>(name, true), params);
-        }
-        case TokenType::TOKEN_LSQUARE:
-        {
-            nextToken(); // eat '['
-            std::unique_ptr<AST::Expr> index = nextRValue();
-            switch (_pCurToken->type)
-            {
-            case TokenType::TOKEN_RSQUARE:
-                nextToken(); // eat ']'
-                return std::make_unique<AST::ArraySubscriptExpr>(name, std::make_unique<AST::DeclRefExpr>(name), std::move(index));
-            default:
-                FATAL_ERROR(TOKEN_INFO(_pCurToken) << "Expected ] to match [ at " << _pCurToken->pos.line << ", " << _pCurToken->pos.column);
-                return nullptr;
-            }
-        }
-        default:
-            return std::make_unique<AST::DeclRefExpr>(name);
-        }
+        return condition;
     }
 
     std::unique_ptr<AST::Expr> Parser::nextNumber()
@@ -720,148 +792,210 @@ namespace lcc
         }
     }
 
-    std::unique_ptr<AST::Expr> Parser::nextParenExpr()
-    {
-        std::shared_ptr<Token> pLParen = _pCurToken;
-        nextToken(); // eat '('
-        std::unique_ptr<AST::Expr> subExpr = nextExpression();
-        if (subExpr == nullptr)
-            return nullptr;
-        switch (_pCurToken->type)
-        {
-        case TokenType::TOKEN_RPAREN:
-            nextToken(); // eat ')'
-            return std::make_unique<AST::ParenExpr>(std::move(subExpr));
-        default:
-            FATAL_ERROR(TOKEN_INFO(_pCurToken) << "Expected ) to match ( at " << pLParen->pos.line << ", " << pLParen->pos.column);
-            return nullptr;
-        }
-    }
-
+    // Expr
+    // ::= UnaryOperator (BinaryOp PrimaryExpr)*
+    // UnaryOperator
+    // ::= UnaryOp UnaryOperator
+    // ::= PrimaryExpr ('++' | '--')?
     // PrimaryExpr
-    // ::= VarRefOrFuncCall
+    // ::= CallExpr '(' params ')'
+    // ::= DeclRefExpr
+    // ::= DeclRefExpr '[' Expr ']'
     // ::= Number
-    // ::= ParenExpr
-    std::unique_ptr<AST::Expr> Parser::nextPrimaryExpr()
+    // ::= '(' Expr ')'
+    // ::= UnaryOperator
+    // Paren expressions, call arguments and array subscripts push a frame instead of
+    // recursing, binary operators are reduced by precedence on the frame's operator stack.
+    std::unique_ptr<AST::Expr> Parser::nextExpression()
     {
-        switch (_pCurToken->type)
-        {
-        case TokenType::TOKEN_IDENTIFIER:
-            return nextVarRefOrFuncCall();
-        case TokenType::TOKEN_INTEGER:
-        case TokenType::TOKEN_FLOAT:
-        case TokenType::TOKEN_CHAR:
-        case TokenType::TOKEN_STRING:
-            return nextNumber();
-        case TokenType::TOKEN_LPAREN:
-            return nextParenExpr();
-        case TokenType::TOKEN_MINUS:
-        case TokenType::TOKEN_PLUS:
-        case TokenType::TOKEN_EXCLAIM:
-        case TokenType::TOKEN_TILDE:
-        case TokenType::TOKEN_PLUSPLUS:
-        case TokenType::TOKEN_MINUSMINUS:
-            return nextUnaryOperator();
+        std::vector<ExprParseFrame> frames(1);
+        std::unique_ptr<AST::Expr> operand = nullptr; // finished primary expression of the innermost frame
 
-        default:
-            FATAL_ERROR(TOKEN_INFO(_pCurToken) << "Unsupported expression");
-            return nullptr;
-        }
-    }
-
-    std::unique_ptr<AST::Expr> Parser::nextUnaryOperator()
-    {
-        switch (_pCurToken->type)
-        {
-        case TokenType::TOKEN_EXCLAIM:
-        case TokenType::TOKEN_TILDE:
-        case TokenType::TOKEN_PLUS:
-        case TokenType::TOKEN_MINUS:
-        case TokenType::TOKEN_PLUSPLUS:
-        case TokenType::TOKEN_MINUSMINUS:
+        while (true)
         {
-            AST::UnaryOpType opType;
-            switch (_pCurToken->type)
+            if (operand == nullptr)
             {
-            case TokenType::TOKEN_PLUSPLUS:
-                opType = AST::UnaryOpType::UO_PreInc;
-                break;
-            case TokenType::TOKEN_MINUSMINUS:
-                opType = AST::UnaryOpType::UO_PreDec;
-                break;
-            default:
-                opType = TokenTypeToUnaryOpType(_pCurToken->type);
-                break;
+                // prefix unary operators apply to the operand being parsed
+                while (true)
+                {
+                    AST::UnaryOpType opType;
+                    switch (_pCurToken->type)
+                    {
+                    case TokenType::TOKEN_PLUSPLUS:
+                        opType = AST::UnaryOpType::UO_PreInc;
+                        break;
+                    case TokenType::TOKEN_MINUSMINUS:
+                        opType = AST::UnaryOpType::UO_PreDec;
+                        break;
+                    default:
+                        opType = TokenTypeToUnaryOpType(_pCurToken->type);
+                        break;
+                    }
+
+                    if (opType == AST::UnaryOpType::UO_UNDEFINED)
+                        break;
+                    frames.back().prefixOps.push_back(opType);
+                    nextToken(); // eat current operator
+                }
+
+                switch (_pCurToken->type)
+                {
+                case TokenType::TOKEN_IDENTIFIER:
+                {
+                    std::string name = _pCurToken->content;
+                    nextToken(); // eat name
+                    if (_pCurToken->type == TokenType::TOKEN_LPAREN) // function call
+                    {
+                        std::shared_ptr<Token> pLParen = _pCurToken;
+                        nextToken(); // eat '('
+                        if (_pCurToken->type == TokenType::TOKEN_RPAREN)
+                        {
+                            nextToken(); // eat ')'
+                            std::vector<std::unique_ptr<AST::Expr>> params;
+                            operand = std::make_unique<AST::CallExpr>(std::make_unique<AST::DeclRefExpr>(name, true), params);
+                            break;
+                        }
+                        ExprParseFrame frame;
+                        frame.kind = ExprParseFrame::Kind::Call;
+                        frame.pOpenToken = pLParen;
+                        frame.name = name;
+                        frames.push_back(std::move(frame));
+                        continue;
+                    }
+                    if (_pCurToken->type == TokenType::TOKEN_LSQUARE) // array subscript
+                    {
+                        ExprParseFrame frame;
+                        frame.kind = ExprParseFrame::Kind::Subscript;
+                        frame.pOpenToken = _pCurToken;
+                        frame.name = name;
+                        frames.push_back(std::move(frame));
+                        nextToken(); // eat '['
+                        continue;
+                    }
+                    operand = std::make_unique<AST::DeclRefExpr>(name);
+                    break;
+                }
+                case TokenType::TOKEN_INTEGER:
+                case TokenType::TOKEN_FLOAT:
+                case TokenType::TOKEN_CHAR:
+                case TokenType::TOKEN_STRING:
+                    operand = nextNumber();
+                    if (operand == nullptr)
+                        return nullptr;
+                    break;
+                case TokenType::TOKEN_LPAREN:
+                {
+                    ExprParseFrame frame;
+                    frame.kind = ExprParseFrame::Kind::Paren;
+                    frame.pOpenToken = _pCurToken;
+                    frames.push_back(std::move(frame));
+                    nextToken(); // eat '('
+                    continue;
+                }
+                default:
+                    FATAL_ERROR(TOKEN_INFO(_pCurToken) << "Unsupported expression");
+                    return nullptr;
+                }
             }
 
-            if (opType == AST::UnaryOpType::UO_UNDEFINED) // unary op type check
+            ExprParseFrame &frame = frames.back();
+            // only the leading operand of an expression, or a prefixed one, takes a postfix operator
+            if (frame.isFirstOperand || !frame.prefixOps.empty())
             {
-                FATAL_ERROR(TOKEN_INFO(_pCurToken) << "Undefined unary operator");
-                return nullptr;
+                switch (_pCurToken->type)
+                {
+                case TokenType::TOKEN_PLUSPLUS:
+                    nextToken(); // eat '++'
+                    operand = std::make_unique<AST::UnaryOperator>(AST::UnaryOpType::UO_PostInc, std::move(operand));
+                    break;
+                case TokenType::TOKEN_MINUSMINUS:
+                    nextToken(); // eat '--'
+                    operand = std::make_unique<AST::UnaryOperator>(AST::UnaryOpType::UO_PostDec, std::move(operand));
+                    break;
+                default:
+                    break;
+                }
             }
-
-            nextToken(); // eat current operator
-            return std::make_unique<AST::UnaryOperator>(opType, nextUnaryOperator());
-        }
-        default:
-        {
-            std::unique_ptr<AST::Expr> body = nextPrimaryExpr();
-            switch (_pCurToken->type)
+            while (!frame.prefixOps.empty())
             {
-            case TokenType::TOKEN_PLUSPLUS:
-                nextToken(); // eat '++'
-                return std::make_unique<AST::UnaryOperator>(AST::UnaryOpType::UO_PostInc, std::move(body));
-            case TokenType::TOKEN_MINUSMINUS:
-                nextToken(); // eat '--'
-                return std::make_unique<AST::UnaryOperator>(AST::UnaryOpType::UO_PostDec, std::move(body));
-            default:
-                return std::move(body);
+                operand = std::make_unique<AST::UnaryOperator>(frame.prefixOps.back(), std::move(operand));
+                frame.prefixOps.pop_back();
             }
-        }
-        }
-    }
+            frame.operands.push_back(std::move(operand));
+            frame.isFirstOperand = false;
 
-    std::unique_ptr<AST::Expr> Parser::nextRHSExpr(std::unique_ptr<AST::Expr> lhs, AST::BinaryOperator::Precedence lastBiOpPrec)
-    {
-        do
-        {
             AST::BinaryOperator::Precedence curBiOpPrec = TokenTypeToBinaryOpPrecedence(_pCurToken->type);
-            if (curBiOpPrec < lastBiOpPrec)
-                return lhs;
-
-            AST::BinaryOpType opType = TokenTypeToBinaryOpType(_pCurToken->type);
-            nextToken(); // eat current biOp
-            std::unique_ptr<AST::Expr> rhs = nextPrimaryExpr();
-            if (rhs == nullptr)
-                return nullptr;
-
-            AST::BinaryOperator::Precedence nextBiOpPrec = TokenTypeToBinaryOpPrecedence(_pCurToken->type);
-
-            if (curBiOpPrec < nextBiOpPrec || (curBiOpPrec == AST::BinaryOperator::Precedence::ASSIGNMENT && curBiOpPrec == nextBiOpPrec))
-                rhs = nextRHSExpr(std::move(rhs), (AST::BinaryOperator::Precedence)((int)curBiOpPrec + !(curBiOpPrec == AST::BinaryOperator::Precedence::ASSIGNMENT)));
-            lhs = std::make_unique<AST::BinaryOperator>(opType, std::move(lhs), std::move(rhs));
-        } while (true);
-
-        return nullptr;
-    }
-
-    std::unique_ptr<AST::Expr> Parser::nextBinaryOperator()
-    {
-        std::unique_ptr<AST::Expr> lhs = nextUnaryOperator();
-        if (lhs == nullptr)
-            return nullptr;
+            if (curBiOpPrec != AST::BinaryOperator::Precedence::UNDEFINED)
+            {
+                // assignment is right associative, all other binary operators are left associative
+                while (!frame.operators.empty() && (frame.operators.back().second > curBiOpPrec || (frame.operators.back().second == curBiOpPrec && curBiOpPrec != AST::BinaryOperator::Precedence::ASSIGNMENT)))
+                    ReduceBinaryOperator(frame);
+                frame.operators.push_back(std::make_pair(TokenTypeToBinaryOpType(_pCurToken->type), curBiOpPrec));
+                nextToken(); // eat current biOp
+                continue;
+            }
 
-        return nextRHSExpr(std::move(lhs), AST::BinaryOperator::Precedence::COMMA);
-    }
+            // no more binary operators, the expression of the innermost frame is complete
+            while (!frame.operators.empty())
+                ReduceBinaryOperator(frame);
+            std::unique_ptr<AST::Expr> expr = std::move(frame.operands.back());
+            frame.operands.pop_back();
 
-    std::unique_ptr<AST::Expr> Parser::nextExpression()
-    {
-        return nextBinaryOperator();
+            switch (frame.kind)
+            {
+            case ExprParseFrame::Kind::Root:
+                return expr;
+            case ExprParseFrame::Kind::Paren:
+                if (_pCurToken->type != TokenType::TOKEN_RPAREN)
+                {
+                    FATAL_ERROR(TOKEN_INFO(_pCurToken) << "Expected ) to match ( at " << frame.pOpenToken->pos.line << ", " << frame.pOpenToken->pos.column);
+                    return nullptr;
+                }
+                nextToken(); // eat ')'
+                operand = std::make_unique<AST::ParenExpr>(std::move(expr));
+                break;
+            case ExprParseFrame::Kind::Subscript:
+                if (_pCurToken->type != TokenType::TOKEN_RSQUARE)
+                {
+                    FATAL_ERROR(TOKEN_INFO(_pCurToken) << "Expected ] to match [ at " << frame.pOpenToken->pos.line << ", " << frame.pOpenToken->pos.column);
+                    return nullptr;
+                }
+                nextToken(); // eat ']'
+                if (expr->isLValue())
+                    expr = std::make_unique<AST::ImplicitCastExpr>(std::move(expr), AST::CastExpr::CastType::LValueToRValue);
+                operand = std::make_unique<AST::ArraySubscriptExpr>(frame.name, std::make_unique<AST::DeclRefExpr>(frame.name), std::move(expr));
+                break;
+            case ExprParseFrame::Kind::Call:
+                if (expr->isLValue())
+                    expr = std::make_unique<AST::ImplicitCastExpr>(std::move(expr), AST::CastExpr::CastType::LValueToRValue);
+                frame.params.push_back(std::move(expr));
+                if (_pCurToken->type == TokenType::TOKEN_COMMA)
+                {
+                    nextToken(); // eat ','
+                    if (_pCurToken->type != TokenType::TOKEN_RPAREN) // parse next param in the same frame
+                    {
+                        frame.isFirstOperand = true;
+                        continue;
+                    }
+                }
+                if (_pCurToken->type != TokenType::TOKEN_RPAREN)
+                {
+                    FATAL_ERROR(TOKEN_INFO(_pCurToken) << "Expected ) to match ( at " << frame.pOpenToken->pos.line << ", " << frame.pOpenToken->pos.column);
+                    return nullptr;
+                }
+                nextToken(); // eat ')'
+                operand = std::make_unique<AST::CallExpr>(std::make_unique<AST::DeclRefExpr>(frame.name, true), frame.params);
+                break;
+            }
+            frames.pop_back();
+        }
     }
 
     std::unique_ptr<AST::Expr> Parser::nextRValue()
     {
         std::unique_ptr<AST::Expr> expr = nextExpression();
+        if (expr == nullptr)
+            return nullptr;
         if (expr->isLValue())
             expr = std::make_unique<AST::ImplicitCastExpr>(std::move(expr), AST::CastExpr::CastType::LValueToRValue);
 
@@ -949,7 +1083,7 @@ namespace lcc
                 return nullptr;
             }
 
-            auto tmpLValue = nextVarRefOrFuncCall();
+            auto tmpLValue = nextExpression();
             auto referencedLValue = dynamic_pointer_cast<AST::DeclRefExpr>(std::move(tmpLValue));
 
             auto rparen = _pCurToken;
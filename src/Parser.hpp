@@ -30,38 +30,42 @@ namespace lcc
     public:
         std::unique_ptr<AST::Decl> run(const std::vector<std::shared_ptr<Token>> &tokens);
 
+        // streaming, tokens are pulled from the Lexer as they are needed and top level
+        // declarations are returned one at a time, nullptr on a parse error or at the end
+        void begin(std::shared_ptr<File> file);
+        std::unique_ptr<AST::Decl> next();
+        bool atEnd() const { return _pCurToken->type == TokenType::TOKEN_EOF; };
+        // frees the body of the function definition last returned by next(), the FunctionDecl
+        // and its params were allocated before the body and stay valid
+        void releaseBody(AST::FunctionDecl *functionDecl);
+
     private:
         void nextToken();
 
     private:
         // decl parsers
         std::unique_ptr<AST::Decl> nextTopLevelDecl();
-        std::unique_ptr<AST::Decl> nextFunctionDecl(const std::string name, const std::string type, const bool isExtern);
-        std::unique_ptr<AST::Decl> nextVarDecl(const std::string name, const std::string type);
+        std::unique_ptr<AST::Decl> nextFunctionDecl(const std::string name, const AST::Type *type, const bool isExtern);
+        std::unique_ptr<AST::Decl> nextVarDecl(const std::string name, const AST::Type *type);
         // stmt parsers
         std::unique_ptr<AST::Stmt> nextCompoundStmt();
         std::unique_ptr<AST::Stmt> nextStmt();
         std::unique_ptr<AST::Stmt> nextNullStmt();
-        std::unique_ptr<AST::Stmt> nextWhileStmt();
-        std::unique_ptr<AST::Stmt> nextIfStmt();
+        std::unique_ptr<AST::Expr> nextCondition(const std::string &keyword);
         std::unique_ptr<AST::Stmt> nextReturnStmt();
         std::unique_ptr<AST::Stmt> nextDeclStmt();
         std::unique_ptr<AST::Stmt> nextValueStmt();
         std::unique_ptr<AST::Stmt> nextAsmStmt();
         // expr parsers
         std::unique_ptr<AST::Expr> nextExpression();
-        std::unique_ptr<AST::Expr> nextUnaryOperator();
-        std::unique_ptr<AST::Expr> nextBinaryOperator();
         std::unique_ptr<AST::Expr> nextRValue();
-        std::unique_ptr<AST::Expr> nextPrimaryExpr();
-        std::unique_ptr<AST::Expr> nextVarRefOrFuncCall();
         std::unique_ptr<AST::Expr> nextNumber();
-        std::unique_ptr<AST::Expr> nextParenExpr();
-        std::unique_ptr<AST::Expr> nextRHSExpr(std::unique_ptr<AST::Expr> lhs, AST::BinaryOperator::Precedence lastBiOpPrec);
 
     private:
         std::vector<std::shared_ptr<Token>> _tokens;
         int _curTokenIdx{0};
         std::shared_ptr<Token> _pCurToken{nullptr};
+        bool _isStreaming{false};
+        AST::ASTContext::Mark _bodyMark{}; // start of the last function body
     };
 }
\ No newline at end of file
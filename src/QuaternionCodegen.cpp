@@ -0,0 +1,1440 @@
+#include "lcc.hpp"
+#include <algorithm>
+#include <cctype>
+#include <climits>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace lcc
+{
+    std::unique_ptr<QuaternionCodegen> QuaternionCodegen::_inst;
+
+    namespace
+    {
+        // registers the linear scan hands out, the callee saved ones first
+        const char *const Registers64[] = {"%rbx", "%r12", "%r13", "%r14", "%r15", "%rsi", "%rdi", "%r8", "%r9", "%r10", "%r11"};
+        const char *const Registers32[] = {"%ebx", "%r12d", "%r13d", "%r14d", "%r15d", "%esi", "%edi", "%r8d", "%r9d", "%r10d", "%r11d"};
+        constexpr int NumRegisters = 11;
+
+        const char *const IntArgs64[] = {"%rdi", "%rsi", "%rdx", "%rcx", "%r8", "%r9"};
+        const char *const IntArgs32[] = {"%edi", "%esi", "%edx", "%ecx", "%r8d", "%r9d"};
+        constexpr size_t NumIntArgs = 6;
+        constexpr size_t NumFloatArgs = 8;
+
+        // operands of inline asm by number, scratch registers hold nothing from one code to the next
+        const char *const AsmRegisters64[] = {"%rax", "%rcx", "%rdx"};
+        const char *const AsmRegisters32[] = {"%eax", "%ecx", "%edx"};
+        constexpr size_t NumAsmRegisters = 3;
+
+        // NaN and out of range values become INT_MIN, as cvttss2si does
+        int32_t FloatToInt(float value)
+        {
+            if (!(value > -2147483904.0f && value < 2147483648.0f))
+                return INT32_MIN;
+            return static_cast<int32_t>(value);
+        }
+
+        int32_t FloatBits(float value)
+        {
+            int32_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            return bits;
+        }
+
+        // %eax -> %rax, %r8d -> %r8
+        std::string Register64(const std::string &reg)
+        {
+            if (reg.back() == 'd')
+                return reg.substr(0, reg.size() - 1);
+            return "%r" + reg.substr(2);
+        }
+
+        std::string Escape(const std::string &str)
+        {
+            std::string escaped;
+            for (unsigned char c : str)
+            {
+                if (c == '\\' || c == '"')
+                    escaped += '\\';
+                if (c >= 0x20 && c < 0x7f)
+                {
+                    escaped += static_cast<char>(c);
+                    continue;
+                }
+
+                char octal[5];
+                std::snprintf(octal, sizeof(octal), "\\%03o", c);
+                escaped += octal;
+            }
+            return escaped;
+        }
+    }
+
+    bool QuaternionCodegen::run(const QuaternionIRGenerator *generator, const std::string &outPath)
+    {
+        if (generator->numUnlowered() != 0)
+        {
+            WARNING("The quaternion IR has no codes for " << generator->numUnlowered() << " pointer subscripts or asm statements with operands other than registers");
+            return false;
+        }
+
+        _generator = generator;
+        auto &codes = generator->_codes;
+        auto &symbols = generator->_symbols;
+        auto &tables = generator->_tables;
+        auto &functionTable = generator->_functionTable;
+
+        _out.str("");
+        _out.clear();
+        _floatConstants.clear();
+        _numSpilled = 0;
+
+        _kinds.resize(symbols.size());
+        _isArray.resize(symbols.size());
+        for (size_t symbol = 0; symbol < symbols.size(); symbol++)
+        {
+            _isArray[symbol] = QuaternionIRGenerator::isArrayType(symbols[symbol].type);
+            _kinds[symbol] = kindOf(QuaternionIRGenerator::elementType(symbols[symbol].type));
+        }
+        widenPointers();
+        _registers.assign(symbols.size(), NoRegister);
+        _offsets.assign(symbols.size(), 0);
+        _intervalIds.assign(symbols.size(), UINT32_MAX);
+        _intervals.clear();
+
+        // the tables no function owns are the globals
+        _owners.assign(symbols.size(), NoFunction);
+        std::vector<bool> isLocal(tables.size(), false);
+        for (size_t id = 0; id < functionTable.size(); id++)
+            for (size_t table = functionTable[id].firstTable; table < functionTable[id].endTable; table++)
+            {
+                isLocal[table] = true;
+                for (auto symbol : tables[table]->items)
+                    _owners[symbol] = id;
+            }
+        _globals.assign(symbols.size(), "");
+        for (size_t table = 0; table < tables.size(); table++)
+        {
+            if (isLocal[table])
+                continue;
+            for (auto symbol : tables[table]->items)
+            {
+                _owners[symbol] = GlobalOwner;
+                _globals[symbol] = symbols[symbol].name[0] == '@' ? ".LG" + std::to_string(symbol) : symbols[symbol].name;
+            }
+        }
+
+        _isJumpTarget.assign(codes.size() + 1, false);
+        for (auto &code : codes)
+            if ((code.op == QuaternionOperator::J || code.op == QuaternionOperator::Jnz) && code.result.type == ArgType::CODEADDR &&
+                code.result.codeAddr >= 0 && static_cast<size_t>(code.result.codeAddr) <= codes.size())
+                _isJumpTarget[code.result.codeAddr] = true;
+
+        _out << "\t.text\n";
+        bool isSucceeded = true;
+        for (size_t id = 0; id < functionTable.size() && isSucceeded; id++)
+            if (functionTable[id].isInitialized)
+                isSucceeded = genFunction(id);
+        isSucceeded = isSucceeded && genInitializers();
+
+        if (isSucceeded)
+        {
+            _out << "\t.bss\n";
+            for (size_t table = 0; table < tables.size(); table++)
+            {
+                if (isLocal[table])
+                    continue;
+                for (auto symbol : tables[table]->items)
+                {
+                    int align = _kinds[symbol] == ValueKind::Pointer ? 8 : 4;
+                    int size = _isArray[symbol] ? symbols[symbol].width : align;
+                    const std::string &name = _globals[symbol];
+                    if (name[0] != '.')
+                        _out << "\t.globl " << name << "\n\t.type " << name << ", @object\n\t.size " << name << ", " << size << '\n';
+                    _out << "\t.align " << align << '\n' << name << ":\n\t.zero " << size << '\n';
+                }
+            }
+
+            // asm templates have been pasted into the text already
+            std::vector<bool> isTemplate(generator->_strings.size(), false);
+            for (auto &code : codes)
+                if (code.op == QuaternionOperator::Asm)
+                    isTemplate[code.arg1.string] = true;
+            _out << "\t.section .rodata\n";
+            for (size_t id = 0; id < generator->_strings.size(); id++)
+                if (!isTemplate[id])
+                    _out << ".LS" << id << ":\n\t.string \"" << Escape(generator->_strings[id]) << "\"\n";
+            _out << "\t.align 4\n";
+            for (auto &constant : _floatConstants)
+                _out << ".LCF" << constant.second << ":\n\t.long " << static_cast<int32_t>(constant.first) << '\n';
+            _out << "\t.section .note.GNU-stack,\"\",@progbits\n";
+        }
+
+        _generator = nullptr;
+        if (!isSucceeded)
+            return false;
+
+        if (outPath == "-")
+        {
+            std::cout << _out.str();
+            return true;
+        }
+
+        std::ofstream ofs(outPath);
+        if (!ofs)
+        {
+            FATAL_ERROR("Can't open " << outPath);
+            return false;
+        }
+        ofs << _out.str();
+        return true;
+    }
+
+    bool QuaternionCodegen::genFunction(size_t id)
+    {
+        auto &codes = _generator->_codes;
+        auto &item = _generator->_functionTable[id];
+        size_t entry = item.entry, exit = item.exit;
+
+        _context.id = id;
+        _context.exitLabel = ".LR" + std::to_string(id);
+        _context.returnKind = kindOf(item.type);
+        _context.isVoid = item.type == "void";
+        allocate(entry, exit, item.params);
+
+        _out << "\t.globl " << item.name << "\n\t.type " << item.name << ", @function\n" << item.name << ":\n";
+        genPrologue(item.params);
+        if (!genBody({{entry, exit}}))
+            return false;
+
+        // falling off the end of a body returns 0 as on the VM
+        if (entry == exit || codes[exit - 1].op != QuaternionOperator::Ret || _isJumpTarget[exit])
+            line("xorl %eax, %eax");
+        genEpilogue();
+        _out << "\t.size " << item.name << ", .-" << item.name << '\n';
+        return true;
+    }
+
+    bool QuaternionCodegen::genInitializers()
+    {
+        auto &codes = _generator->_codes;
+        std::vector<std::pair<size_t, size_t>> ranges;
+
+        // they sit in the gaps between function bodies
+        size_t addr = 0;
+        for (auto &item : _generator->_functionTable)
+        {
+            if (addr < static_cast<size_t>(item.entry))
+                ranges.emplace_back(addr, item.entry);
+            addr = std::max(addr, static_cast<size_t>(item.entry));
+            if (item.isInitialized)
+                addr = std::max(addr, static_cast<size_t>(item.exit));
+        }
+        if (addr < codes.size())
+            ranges.emplace_back(addr, codes.size());
+        if (ranges.empty())
+            return true;
+
+        _context.id = GlobalOwner;
+        _context.exitLabel = ".LRI";
+        _context.returnKind = ValueKind::Int;
+        _context.isVoid = true;
+        size_t begin = ranges.front().first, end = ranges.back().second;
+        allocate(begin, end, {});
+
+        _out << ".Linit:\n";
+        genPrologue({});
+        if (!genBody(ranges))
+            return false;
+        genEpilogue();
+        _out << "\t.section .init_array,\"aw\"\n\t.align 8\n\t.quad .Linit\n\t.text\n";
+        return true;
+    }
+
+    bool QuaternionCodegen::genBody(const std::vector<std::pair<size_t, size_t>> &ranges)
+    {
+        size_t labeled = SIZE_MAX;
+        for (auto &range : ranges)
+        {
+            _context.end = range.second;
+            for (size_t addr = range.first; addr < range.second;)
+            {
+                if (_isJumpTarget[addr] && addr != labeled)
+                    _out << label(addr) << ":\n";
+                size_t next = addr + 1;
+                if (!genCode(addr, next))
+                    return false;
+                addr = next;
+            }
+
+            if (_isJumpTarget[range.second])
+            {
+                _out << label(range.second) << ":\n";
+                labeled = range.second;
+            }
+        }
+        return true;
+    }
+
+    bool QuaternionCodegen::genCode(size_t addr, size_t &next)
+    {
+        const Quaternion &code = _generator->_codes[addr];
+        QuaternionOperator op = code.op;
+
+        if (!isValid(code.arg1) || !isValid(code.arg2) || !isValid(code.result))
+        {
+            WARNING("Code " << addr << " refers to an expression the quaternion IR doesn't support");
+            return false;
+        }
+
+        switch (op)
+        {
+        case QuaternionOperator::DefineEqual:
+        case QuaternionOperator::Plus:
+            if (code.result.type == ArgType::ENTRY)
+                copy(place(code.result), code.arg1);
+            return true;
+        case QuaternionOperator::Minus:
+        case QuaternionOperator::Not:
+        case QuaternionOperator::LNot:
+            unary(op, code.result, code.arg1);
+            return true;
+        case QuaternionOperator::Jnz:
+            genBranch(addr, next);
+            return true;
+        case QuaternionOperator::J:
+            if (static_cast<size_t>(code.result.codeAddr) != addr + 1)
+                line("jmp " + label(code.result.codeAddr));
+            return true;
+        case QuaternionOperator::Param:
+            return genParam(addr);
+        case QuaternionOperator::Call:
+            return genCall(code);
+        case QuaternionOperator::Subscript:
+        case QuaternionOperator::Store:
+        {
+            const Arg &array = op == QuaternionOperator::Store ? code.result : code.arg1;
+            if (array.type != ArgType::ENTRY || !_isArray[array.symbol])
+            {
+                WARNING("Code " << addr << " subscripts no array");
+                return false;
+            }
+
+            Place element = {elementOperand(array, code.arg2), "", false, _kinds[array.symbol]};
+            if (op == QuaternionOperator::Store)
+                copy(element, code.arg1);
+            else if (code.result.type == ArgType::ENTRY)
+                convert(place(code.result), element);
+            return true;
+        }
+        case QuaternionOperator::AsmInput:
+        case QuaternionOperator::AsmOutput:
+            return true; // the Asm after them passes the operands
+        case QuaternionOperator::Asm:
+            return genAsm(addr);
+        case QuaternionOperator::Ret:
+            if (code.result.type != ArgType::NIL && !_context.isVoid)
+            {
+                if (_context.returnKind == ValueKind::Float)
+                    loadFloat(code.result, "%xmm0");
+                else
+                    copy(registerPlace("%eax", "%rax", _context.returnKind), code.result);
+            }
+            // the last code of a body needs no jump unless the falling off code sits in between
+            if (addr + 1 != _context.end || _isJumpTarget[addr + 1] || _context.id == GlobalOwner)
+                line("jmp " + _context.exitLabel);
+            return true;
+        default:
+            break;
+        }
+
+        bool isPureBinary = op >= QuaternionOperator::Mul && op <= QuaternionOperator::LOr;
+        bool isUpdate = op >= QuaternionOperator::PostInc && op <= QuaternionOperator::PreDec;
+        bool isAssignment = op >= QuaternionOperator::Assign && op <= QuaternionOperator::OrAssign;
+        if (isPureBinary)
+        {
+            if (!genCompareJump(addr, next))
+                binary(op, code.result, code.arg1, code.arg2);
+            return true;
+        }
+        if (!isUpdate && !isAssignment)
+        {
+            WARNING("Code " << addr << " can't be lowered to x86-64");
+            return false;
+        }
+
+        // the rest writes a variable
+        if (code.arg1.type != ArgType::ENTRY)
+        {
+            WARNING("Code " << addr << " stores to an unsupported place");
+            return false;
+        }
+
+        Arg one = isFloat(code.arg1) ? Arg::value(1.0f) : Arg::value(1);
+        switch (op)
+        {
+        case QuaternionOperator::Assign:
+            copy(place(code.arg1), code.arg2);
+            break;
+        case QuaternionOperator::PreInc:
+        case QuaternionOperator::PreDec:
+            binary(op == QuaternionOperator::PreInc ? QuaternionOperator::Add : QuaternionOperator::Sub, code.arg1, code.arg1, one);
+            break;
+        case QuaternionOperator::PostInc:
+        case QuaternionOperator::PostDec:
+            // the result is the old value
+            if (code.result.type == ArgType::ENTRY)
+                copy(place(code.result), code.arg1);
+            binary(op == QuaternionOperator::PostInc ? QuaternionOperator::Add : QuaternionOperator::Sub, code.arg1, code.arg1, one);
+            return true;
+        default:
+            binary(op, code.arg1, code.arg1, code.arg2);
+            break;
+        }
+
+        if (code.result.type == ArgType::ENTRY)
+            copy(place(code.result), code.arg1);
+        return true;
+    }
+
+    bool QuaternionCodegen::genParam(size_t addr)
+    {
+        auto &codes = _generator->_codes;
+        size_t call = addr;
+        while (call < codes.size() && codes[call].op == QuaternionOperator::Param)
+            call++;
+        if (call == codes.size() || codes[call].op != QuaternionOperator::Call || codes[call].arg1.type != ArgType::FUNCTION || codes[call].arg2.type != ArgType::INTEGER)
+        {
+            WARNING("Code " << addr << " passes an argument to no matching call");
+            return false;
+        }
+
+        auto &params = _generator->_functionTable[codes[call].arg1.function].params;
+        size_t numArgs = codes[call].arg2.integerVal;
+        if (numArgs != params.size() || call - addr > numArgs)
+        {
+            WARNING("Code " << addr << " passes an argument to no matching call");
+            return false;
+        }
+
+        // staged in the frame, the call loads the argument registers at once
+        size_t index = numArgs - (call - addr);
+        copy(slotPlace(stagingOffset(index), _kinds[params[index]]), codes[addr].arg1);
+        return true;
+    }
+
+    bool QuaternionCodegen::genCall(const Quaternion &code)
+    {
+        auto &callee = _generator->_functionTable[code.arg1.function];
+        if (code.arg2.type != ArgType::INTEGER || static_cast<size_t>(code.arg2.integerVal) != callee.params.size())
+        {
+            WARNING("Function " << callee.name << " is called with a wrong number of arguments");
+            return false;
+        }
+
+        std::vector<size_t> stackArgs;
+        size_t numInts = 0, numFloats = 0;
+        for (size_t index = 0; index < callee.params.size(); index++)
+        {
+            bool isFloatParam = _kinds[callee.params[index]] == ValueKind::Float;
+            if (isFloatParam ? numFloats++ >= NumFloatArgs : numInts++ >= NumIntArgs)
+                stackArgs.push_back(index);
+        }
+
+        // the stack arguments are pushed last to first with rsp kept 16 byte aligned
+        size_t stackBytes = 8 * stackArgs.size();
+        if (stackArgs.size() % 2 != 0)
+        {
+            line("subq $8, %rsp");
+            stackBytes += 8;
+        }
+        for (auto it = stackArgs.rbegin(); it != stackArgs.rend(); ++it)
+            line("pushq " + std::to_string(stagingOffset(*it)) + "(%rbp)");
+
+        numInts = numFloats = 0;
+        for (size_t index = 0; index < callee.params.size(); index++)
+        {
+            ValueKind kind = _kinds[callee.params[index]];
+            std::string staged = std::to_string(stagingOffset(index)) + "(%rbp)";
+            if (kind == ValueKind::Float && numFloats < NumFloatArgs)
+                line("movss " + staged + ", %xmm" + std::to_string(numFloats++));
+            else if (kind == ValueKind::Pointer && numInts < NumIntArgs)
+                line("movq " + staged + ", " + IntArgs64[numInts++]);
+            else if (kind == ValueKind::Int && numInts < NumIntArgs)
+                line("movl " + staged + ", " + IntArgs32[numInts++]);
+        }
+
+        if (callee.isInitialized)
+            line("call " + callee.name);
+        else
+        {
+            // al holds the number of vector registers for variadic callees
+            line("movl $" + std::to_string(numFloats) + ", %eax");
+            line("call " + callee.name + "@PLT");
+        }
+        if (stackBytes != 0)
+            line("addq $" + std::to_string(stackBytes) + ", %rsp");
+
+        if (code.result.type != ArgType::ENTRY || callee.type == "void")
+            return true;
+
+        Place dest = place(code.result);
+        ValueKind kind = kindOf(callee.type);
+        if (kind == ValueKind::Float)
+            storeFloat("%xmm0", dest);
+        else if (dest.kind == ValueKind::Float)
+            storeInt("%eax", dest);
+        else
+            move(dest, registerPlace("%eax", "%rax", kind));
+        return true;
+    }
+
+    bool QuaternionCodegen::genAsm(size_t addr)
+    {
+        auto &codes = _generator->_codes;
+        const Quaternion &code = codes[addr];
+        size_t numOperands = code.arg2.type == ArgType::INTEGER && code.arg2.integerVal >= 0 ? code.arg2.integerVal : SIZE_MAX;
+        if (code.arg1.type != ArgType::STRING || numOperands > addr)
+        {
+            WARNING("Code " << addr << " is an asm statement without its operands");
+            return false;
+        }
+        if (numOperands > NumAsmRegisters)
+        {
+            WARNING("Inline asm at code " << addr << " has more than " << NumAsmRegisters << " operands");
+            return false;
+        }
+
+        std::vector<const Quaternion *> operands(numOperands, nullptr);
+        std::vector<ValueKind> kinds(numOperands);
+        for (size_t operandAddr = addr - numOperands; operandAddr < addr; operandAddr++)
+        {
+            const Quaternion &operand = codes[operandAddr];
+            bool isInput = operand.op == QuaternionOperator::AsmInput;
+            size_t number = operand.arg2.type == ArgType::INTEGER && operand.arg2.integerVal >= 0 ? operand.arg2.integerVal : SIZE_MAX;
+            if ((!isInput && operand.op != QuaternionOperator::AsmOutput) || number >= numOperands || operands[number] != nullptr ||
+                (!isInput && operand.result.type != ArgType::ENTRY))
+            {
+                WARNING("Code " << addr << " is an asm statement without its operands");
+                return false;
+            }
+
+            const Arg &value = isInput ? operand.arg1 : operand.result;
+            operands[number] = &operand;
+            kinds[number] = value.type == ArgType::ENTRY    ? _kinds[value.symbol]
+                            : value.type == ArgType::STRING ? ValueKind::Pointer
+                            : isFloat(value)                ? ValueKind::Float
+                                                            : ValueKind::Int;
+        }
+
+        // the bits of an input go to the register of its number, copies to registers need no scratch
+        for (size_t number = 0; number < numOperands; number++)
+            if (operands[number]->op == QuaternionOperator::AsmInput)
+                copy(registerPlace(AsmRegisters32[number], AsmRegisters64[number], kinds[number]), operands[number]->arg1);
+
+        // %N names the register of operand N, %% is a %, a template without operands is taken as is
+        const std::string &asmString = _generator->_strings[code.arg1.string];
+        std::string text;
+        for (size_t i = 0; i < asmString.size(); i++)
+        {
+            if (asmString[i] != '%' || numOperands == 0)
+            {
+                text += asmString[i];
+                continue;
+            }
+            if (i + 1 < asmString.size() && asmString[i + 1] == '%')
+            {
+                text += '%';
+                i++;
+                continue;
+            }
+
+            size_t number = 0, end = i + 1;
+            for (; end < asmString.size() && std::isdigit(static_cast<unsigned char>(asmString[end])) && number < numOperands; end++)
+                number = number * 10 + (asmString[end] - '0');
+            if (end == i + 1 || number >= numOperands)
+            {
+                WARNING("Inline asm at code " << addr << " refers to an operand it can't lower at \"" << asmString.substr(i, 3) << "\"");
+                return false;
+            }
+            text += kinds[number] == ValueKind::Pointer ? AsmRegisters64[number] : AsmRegisters32[number];
+            i = end - 1;
+        }
+        line(text);
+
+        for (size_t number = 0; number < numOperands; number++)
+            if (operands[number]->op == QuaternionOperator::AsmOutput)
+                move(place(operands[number]->result), registerPlace(AsmRegisters32[number], AsmRegisters64[number], kinds[number]));
+        return true;
+    }
+
+    void QuaternionCodegen::genPrologue(const std::vector<uint32_t> &params)
+    {
+        line("pushq %rbp");
+        line("movq %rsp, %rbp");
+        for (int reg = 0; reg < NumCalleeSaved; reg++)
+            if (_context.isSaved[reg])
+                line(std::string("pushq ") + Registers64[reg]);
+
+        // rsp is 16 byte aligned once rbp and an even number of 8 byte slots are pushed
+        int frameBytes = 8 * (_context.numSlots + (_context.numSaved + _context.numSlots) % 2);
+        if (frameBytes != 0)
+            line("subq $" + std::to_string(frameBytes) + ", %rsp");
+
+        // parameters on the stack stay there unless they got a register
+        size_t numInts = 0, numFloats = 0;
+        int stackOffset = 16;
+        for (auto param : params)
+        {
+            Place dest = place(Arg::entry(param));
+            if (_kinds[param] == ValueKind::Float && numFloats < NumFloatArgs)
+                storeFloat(("%xmm" + std::to_string(numFloats++)).c_str(), dest);
+            else if (_kinds[param] != ValueKind::Float && numInts < NumIntArgs)
+            {
+                move(dest, registerPlace(IntArgs32[numInts], IntArgs64[numInts], _kinds[param]));
+                numInts++;
+            }
+            else
+            {
+                if (dest.isRegister)
+                    move(dest, slotPlace(stackOffset, _kinds[param]));
+                stackOffset += 8;
+            }
+        }
+    }
+
+    void QuaternionCodegen::genEpilogue()
+    {
+        _out << _context.exitLabel << ":\n";
+        if (_context.numSaved == 0)
+            line("movq %rbp, %rsp");
+        else
+            line("leaq " + std::to_string(-8 * _context.numSaved) + "(%rbp), %rsp");
+        for (int reg = NumCalleeSaved - 1; reg >= 0; reg--)
+            if (_context.isSaved[reg])
+                line(std::string("popq ") + Registers64[reg]);
+        line("popq %rbp");
+        line("ret");
+    }
+
+    void QuaternionCodegen::allocate(size_t begin, size_t end, const std::vector<uint32_t> &params)
+    {
+        auto &codes = _generator->_codes;
+
+        for (auto &interval : _intervals)
+            _intervalIds[interval.symbol] = UINT32_MAX;
+        _intervals.clear();
+
+        // the interval of a local symbol of the function, created on first sight
+        auto intervalOf = [this](const Arg &arg) -> Interval *
+        {
+            if (arg.type != ArgType::ENTRY || arg.symbol >= _owners.size() || _owners[arg.symbol] != _context.id || _isArray[arg.symbol])
+                return nullptr;
+
+            uint32_t &id = _intervalIds[arg.symbol];
+            if (id == UINT32_MAX)
+            {
+                id = _intervals.size();
+                _intervals.push_back({arg.symbol, LONG_MAX, LONG_MIN, false, false, false, NoRegister});
+            }
+            return &_intervals[id];
+        };
+        auto extend = [](Interval *interval, long pos)
+        {
+            if (interval == nullptr)
+                return;
+            interval->start = std::min(interval->start, pos);
+            interval->end = std::max(interval->end, pos);
+        };
+
+        for (auto param : params)
+        {
+            Interval *interval = intervalOf(Arg::entry(param));
+            extend(interval, static_cast<long>(begin) - 1);
+            if (interval != nullptr)
+                interval->isParam = true;
+        }
+
+        // every local symbol a code touches gets an interval, the calls and asms it may cross are noted
+        std::vector<long> calls;
+        std::vector<long> asms;
+        std::vector<const Arg *> asmInputs; // read by the Asm that follows
+        int numStagingSlots = 0;
+        for (size_t addr = begin; addr < end; addr++)
+        {
+            auto &code = codes[addr];
+            intervalOf(code.arg1);
+            intervalOf(code.arg2);
+            intervalOf(code.result);
+
+            if (code.op == QuaternionOperator::AsmInput)
+                asmInputs.push_back(&code.arg1);
+            else if (code.op == QuaternionOperator::Asm)
+            {
+                for (const Arg *input : asmInputs)
+                    extend(intervalOf(*input), addr);
+                asmInputs.clear();
+                asms.push_back(addr);
+            }
+            else if (code.op == QuaternionOperator::Call)
+            {
+                calls.push_back(addr);
+                if (code.arg2.type == ArgType::INTEGER)
+                    numStagingSlots = std::max(numStagingSlots, code.arg2.integerVal);
+            }
+        }
+
+        // an interval is the hull of the codes that touch its symbol and the blocks it is live through
+        auto ranges = QuaternionOptimizer::liveRanges(codes, begin, end, _intervals.size(), [this](const Arg &arg)
+                                                      { return arg.type == ArgType::ENTRY && arg.symbol < _intervalIds.size() ? _intervalIds[arg.symbol] : UINT32_MAX; });
+        for (size_t id = 0; id < _intervals.size(); id++)
+        {
+            if (ranges[id].first > ranges[id].second) // a parameter the body never touches
+                continue;
+            extend(&_intervals[id], ranges[id].first);
+            extend(&_intervals[id], ranges[id].second);
+        }
+        for (auto &interval : _intervals)
+        {
+            auto call = std::upper_bound(calls.begin(), calls.end(), interval.start);
+            interval.isCrossingCall = call != calls.end() && *call < interval.end;
+            auto asmAt = std::upper_bound(asms.begin(), asms.end(), interval.start);
+            interval.isCrossingAsm = asmAt != asms.end() && *asmAt < interval.end;
+        }
+
+        std::sort(_intervals.begin(), _intervals.end(), [](const Interval &lhs, const Interval &rhs)
+                  { return lhs.start < rhs.start || (lhs.start == rhs.start && lhs.symbol < rhs.symbol); });
+        for (size_t id = 0; id < _intervals.size(); id++)
+            _intervalIds[_intervals[id].symbol] = id;
+
+        // linear scan, a register is reused once the interval holding it has ended before the next starts
+        bool isFree[NumRegisters];
+        std::fill(isFree, isFree + NumRegisters, true);
+        std::vector<size_t> active;
+        for (size_t id = 0; id < _intervals.size(); id++)
+        {
+            Interval &interval = _intervals[id];
+            if (interval.isCrossingAsm) // the asm may clobber any register
+                continue;
+            for (size_t i = 0; i < active.size();)
+            {
+                if (_intervals[active[i]].end < interval.start)
+                {
+                    isFree[_intervals[active[i]].reg] = true;
+                    active[i] = active.back();
+                    active.pop_back();
+                }
+                else
+                    i++;
+            }
+
+            // parameters are moved out of the argument registers, which are caller saved, on entry
+            bool needsCalleeSaved = interval.isCrossingCall || interval.isParam;
+            int reg = NoRegister;
+            if (!needsCalleeSaved)
+                for (int candidate = NumCalleeSaved; candidate < NumRegisters && reg == NoRegister; candidate++)
+                    if (isFree[candidate])
+                        reg = candidate;
+            for (int candidate = 0; candidate < NumCalleeSaved && reg == NoRegister; candidate++)
+                if (isFree[candidate])
+                    reg = candidate;
+
+            if (reg == NoRegister)
+            {
+                // the interval ending last gives its register up
+                size_t victim = SIZE_MAX;
+                for (size_t i = 0; i < active.size(); i++)
+                {
+                    const Interval &other = _intervals[active[i]];
+                    if ((!needsCalleeSaved || other.reg < NumCalleeSaved) && (victim == SIZE_MAX || other.end > _intervals[active[victim]].end))
+                        victim = i;
+                }
+                if (victim == SIZE_MAX || _intervals[active[victim]].end <= interval.end)
+                    continue;
+
+                reg = _intervals[active[victim]].reg;
+                _intervals[active[victim]].reg = NoRegister;
+                active[victim] = active.back();
+                active.pop_back();
+            }
+
+            interval.reg = reg;
+            isFree[reg] = false;
+            active.push_back(id);
+        }
+
+        _context.numSaved = 0;
+        std::fill(_context.isSaved, _context.isSaved + NumCalleeSaved, false);
+        for (auto &interval : _intervals)
+            if (interval.reg != NoRegister && interval.reg < NumCalleeSaved && !_context.isSaved[interval.reg])
+            {
+                _context.isSaved[interval.reg] = true;
+                _context.numSaved++;
+            }
+        if (!asms.empty()) // nor does it declare the callee saved registers it clobbers
+        {
+            std::fill(_context.isSaved, _context.isSaved + NumCalleeSaved, true);
+            _context.numSaved = NumCalleeSaved;
+        }
+
+        // the staging slots of arguments come first, then the spilled symbols
+        size_t numInts = 0, numFloats = 0;
+        int stackOffset = 16;
+        for (size_t index = 0; index < params.size(); index++)
+        {
+            if (_kinds[params[index]] == ValueKind::Float ? numFloats++ >= NumFloatArgs : numInts++ >= NumIntArgs)
+            {
+                _offsets[params[index]] = stackOffset;
+                stackOffset += 8;
+            }
+        }
+
+        _context.numSlots = numStagingSlots;
+        for (auto &interval : _intervals)
+        {
+            _registers[interval.symbol] = interval.reg;
+            if (interval.reg != NoRegister || _offsets[interval.symbol] > 0)
+                continue;
+
+            _offsets[interval.symbol] = -8 * (_context.numSaved + ++_context.numSlots);
+            _numSpilled++;
+        }
+
+        // the arrays of the function go below, the slot of one holds its first element
+        if (_context.id == GlobalOwner)
+            return;
+        auto &item = _generator->_functionTable[_context.id];
+        for (size_t table = item.firstTable; table < item.endTable; table++)
+            for (auto symbol : _generator->_tables[table]->items)
+                if (_isArray[symbol])
+                {
+                    _context.numSlots += (_generator->_symbols[symbol].width + 7) / 8;
+                    _offsets[symbol] = -8 * (_context.numSaved + _context.numSlots);
+                }
+    }
+
+    QuaternionCodegen::Place QuaternionCodegen::place(const Arg &arg) const
+    {
+        uint32_t symbol = arg.symbol;
+        ValueKind kind = _kinds[symbol];
+        if (_owners[symbol] == GlobalOwner)
+        {
+            std::string op = _globals[symbol] + "(%rip)";
+            return {op, kind == ValueKind::Pointer ? op : "", false, kind};
+        }
+        if (_registers[symbol] != NoRegister)
+            return registerPlace(Registers32[_registers[symbol]], Registers64[_registers[symbol]], kind);
+        return slotPlace(_offsets[symbol], kind);
+    }
+
+    QuaternionCodegen::Place QuaternionCodegen::slotPlace(int offset, ValueKind kind) const
+    {
+        std::string op = std::to_string(offset) + "(%rbp)";
+        return {op, op, false, kind};
+    }
+
+    QuaternionCodegen::Place QuaternionCodegen::registerPlace(const char *op32, const char *op64, ValueKind kind) const
+    {
+        return {op32, op64, true, kind};
+    }
+
+    int QuaternionCodegen::stagingOffset(size_t index) const
+    {
+        return -8 * (_context.numSaved + static_cast<int>(index) + 1);
+    }
+
+    std::string QuaternionCodegen::intOperand(const Arg &arg, const char *scratch)
+    {
+        switch (arg.type)
+        {
+        case ArgType::ENTRY:
+        {
+            Place src = place(arg);
+            if (src.kind != ValueKind::Float)
+                return src.op32;
+            if (src.isRegister)
+            {
+                line("movd " + src.op32 + ", %xmm2");
+                line(std::string("cvttss2si %xmm2, ") + scratch);
+            }
+            else
+                line("cvttss2si " + src.op32 + ", " + scratch);
+            return scratch;
+        }
+        case ArgType::INTEGER:
+            return "$" + std::to_string(arg.integerVal);
+        case ArgType::FLOATING:
+            return "$" + std::to_string(FloatToInt(arg.floatVal));
+        case ArgType::STRING:
+            line("leaq .LS" + std::to_string(arg.string) + "(%rip), " + Register64(scratch));
+            return scratch;
+        default:
+            return "$0";
+        }
+    }
+
+    std::string QuaternionCodegen::floatOperand(const Arg &arg, const char *scratch)
+    {
+        switch (arg.type)
+        {
+        case ArgType::ENTRY:
+        {
+            Place src = place(arg);
+            if (src.kind != ValueKind::Float)
+                line("cvtsi2ssl " + src.op32 + ", " + scratch);
+            else if (src.isRegister)
+                line("movd " + src.op32 + ", " + scratch);
+            else
+                return src.op32;
+            return scratch;
+        }
+        case ArgType::INTEGER:
+            return floatConstant(static_cast<float>(arg.integerVal));
+        case ArgType::FLOATING:
+            return floatConstant(arg.floatVal);
+        default:
+            return floatConstant(0.0f);
+        }
+    }
+
+    void QuaternionCodegen::loadInt(const Arg &arg, const std::string &reg)
+    {
+        std::string src = intOperand(arg, reg.c_str());
+        if (src != reg)
+            line("movl " + src + ", " + reg);
+    }
+
+    void QuaternionCodegen::loadFloat(const Arg &arg, const char *xmm)
+    {
+        std::string src = floatOperand(arg, xmm);
+        if (src != xmm)
+            line("movss " + src + ", " + xmm);
+    }
+
+    void QuaternionCodegen::storeInt(const char *reg, const Place &dest)
+    {
+        if (dest.kind == ValueKind::Float)
+        {
+            line(std::string("cvtsi2ssl ") + reg + ", %xmm2");
+            storeFloat("%xmm2", dest);
+        }
+        else if (dest.op32 != reg)
+            line(std::string("movl ") + reg + ", " + dest.op32);
+    }
+
+    void QuaternionCodegen::storeFloat(const char *xmm, const Place &dest)
+    {
+        if (dest.kind != ValueKind::Float)
+        {
+            line(std::string("cvttss2si ") + xmm + ", %eax");
+            storeInt("%eax", dest);
+        }
+        else if (dest.isRegister)
+            line(std::string("movd ") + xmm + ", " + dest.op32);
+        else
+            line(std::string("movss ") + xmm + ", " + dest.op32);
+    }
+
+    std::string QuaternionCodegen::elementOperand(const Arg &array, const Arg &offset)
+    {
+        uint32_t symbol = array.symbol;
+        bool isGlobal = _owners[symbol] == GlobalOwner;
+        if (offset.type == ArgType::INTEGER) // folded into the displacement
+        {
+            if (!isGlobal)
+                return std::to_string(_offsets[symbol] + offset.integerVal) + "(%rbp)";
+            return _globals[symbol] + (offset.integerVal < 0 ? "" : "+") + std::to_string(offset.integerVal) + "(%rip)";
+        }
+
+        std::string index = intOperand(offset, "%ecx");
+        line((index[0] == '$' ? "movq " : "movslq ") + index + ", %rcx");
+        if (!isGlobal)
+            return std::to_string(_offsets[symbol]) + "(%rbp,%rcx)";
+        line("leaq " + _globals[symbol] + "(%rip), %rdx");
+        return "(%rdx,%rcx)";
+    }
+
+    void QuaternionCodegen::move(const Place &dest, const Place &src)
+    {
+        // locals are 8 bytes, so a string literal's address survives the int temps it passes through
+        bool isWide = !dest.op64.empty() && !src.op64.empty();
+        const std::string &from = isWide ? src.op64 : src.op32;
+        const std::string &to = isWide ? dest.op64 : dest.op32;
+        std::string mov = isWide ? "movq " : "movl ";
+        if (from == to)
+            return;
+
+        if (!src.isRegister && !dest.isRegister)
+        {
+            std::string scratch = isWide ? "%rax" : "%eax";
+            line(mov + from + ", " + scratch);
+            line(mov + scratch + ", " + to);
+        }
+        else
+            line(mov + from + ", " + to);
+    }
+
+    void QuaternionCodegen::convert(const Place &dest, const Place &src)
+    {
+        if ((src.kind == ValueKind::Float) == (dest.kind == ValueKind::Float))
+            move(dest, src);
+        else if (dest.kind == ValueKind::Float)
+        {
+            line("cvtsi2ssl " + src.op32 + ", %xmm0");
+            storeFloat("%xmm0", dest);
+        }
+        else
+        {
+            if (src.isRegister)
+            {
+                line("movd " + src.op32 + ", %xmm2");
+                line("cvttss2si %xmm2, %eax");
+            }
+            else
+                line("cvttss2si " + src.op32 + ", %eax");
+            storeInt("%eax", dest);
+        }
+    }
+
+    void QuaternionCodegen::copy(const Place &dest, const Arg &src)
+    {
+        switch (src.type)
+        {
+        case ArgType::ENTRY:
+            convert(dest, place(src));
+            return;
+        case ArgType::INTEGER:
+        case ArgType::FLOATING:
+        {
+            int32_t value;
+            if (dest.kind == ValueKind::Float)
+                value = FloatBits(src.type == ArgType::INTEGER ? static_cast<float>(src.integerVal) : src.floatVal);
+            else
+                value = src.type == ArgType::INTEGER ? src.integerVal : FloatToInt(src.floatVal);
+
+            if (dest.kind == ValueKind::Pointer && !dest.op64.empty())
+                line("movq $" + std::to_string(value) + ", " + dest.op64);
+            else
+                line("movl $" + std::to_string(value) + ", " + dest.op32);
+            return;
+        }
+        case ArgType::STRING:
+        {
+            std::string address = ".LS" + std::to_string(src.string) + "(%rip)";
+            if (dest.isRegister)
+                line("leaq " + address + ", " + dest.op64);
+            else
+            {
+                line("leaq " + address + ", %rax");
+                line(dest.op64.empty() ? "movl %eax, " + dest.op32 : "movq %rax, " + dest.op64);
+            }
+            return;
+        }
+        default:
+            return;
+        }
+    }
+
+    void QuaternionCodegen::binary(QuaternionOperator op, const Arg &result, const Arg &lhs, const Arg &rhs)
+    {
+        if (result.type != ArgType::ENTRY)
+            return;
+
+        Place dest = place(result);
+        QuaternionOperator base = baseOperator(op);
+        bool isIntOnly = base == QuaternionOperator::Rem || base == QuaternionOperator::Shl || base == QuaternionOperator::Shr ||
+                         base == QuaternionOperator::And || base == QuaternionOperator::Xor || base == QuaternionOperator::Or;
+
+        if ((isFloat(lhs) || isFloat(rhs)) && !isIntOnly)
+        {
+            switch (base)
+            {
+            case QuaternionOperator::Add:
+            case QuaternionOperator::Sub:
+            case QuaternionOperator::Mul:
+            case QuaternionOperator::Div:
+            {
+                static const char *const mnemonics[] = {"mulss ", "divss ", "", "addss ", "subss "};
+                std::string src = floatOperand(rhs, "%xmm1");
+                loadFloat(lhs, "%xmm0");
+                line(mnemonics[static_cast<int>(base) - static_cast<int>(QuaternionOperator::Mul)] + src + ", %xmm0");
+                storeFloat("%xmm0", dest);
+                return;
+            }
+            case QuaternionOperator::LAnd:
+            case QuaternionOperator::LOr:
+                // a float is true unless it equals zero, NaN included
+                loadFloat(lhs, "%xmm0");
+                line("xorps %xmm2, %xmm2");
+                line("ucomiss %xmm2, %xmm0");
+                line("setne %al");
+                line("setp %cl");
+                line("orb %cl, %al");
+                loadFloat(rhs, "%xmm0");
+                line("ucomiss %xmm2, %xmm0");
+                line("setne %dl");
+                line("setp %cl");
+                line("orb %cl, %dl");
+                line(base == QuaternionOperator::LAnd ? "andb %dl, %al" : "orb %dl, %al");
+                break;
+            default:
+            {
+                // ucomiss sets the flags of an unsigned compare, unordered operands set ZF, PF and CF
+                bool isSwapped = base == QuaternionOperator::LT || base == QuaternionOperator::LE;
+                std::string src = floatOperand(isSwapped ? lhs : rhs, "%xmm1");
+                loadFloat(isSwapped ? rhs : lhs, "%xmm0");
+                line("ucomiss " + src + ", %xmm0");
+                if (base == QuaternionOperator::EQ || base == QuaternionOperator::NE)
+                {
+                    line(base == QuaternionOperator::EQ ? "sete %al" : "setne %al");
+                    line(base == QuaternionOperator::EQ ? "setnp %cl" : "setp %cl");
+                    line(base == QuaternionOperator::EQ ? "andb %cl, %al" : "orb %cl, %al");
+                }
+                else
+                    line(base == QuaternionOperator::LT || base == QuaternionOperator::GT ? "seta %al" : "setae %al");
+                break;
+            }
+            }
+
+            line("movzbl %al, %eax");
+            storeInt("%eax", dest);
+            return;
+        }
+
+        switch (base)
+        {
+        case QuaternionOperator::Add:
+        case QuaternionOperator::Sub:
+        case QuaternionOperator::Mul:
+        case QuaternionOperator::And:
+        case QuaternionOperator::Xor:
+        case QuaternionOperator::Or:
+        {
+            // computed in the register of the result when it is one that rhs isn't in
+            std::string src = intOperand(rhs, "%ecx");
+            std::string target = dest.isRegister && dest.kind != ValueKind::Float && src != dest.op32 ? dest.op32 : "%eax";
+            loadInt(lhs, target);
+            std::string mnemonic = base == QuaternionOperator::Add   ? "addl "
+                                   : base == QuaternionOperator::Sub ? "subl "
+                                   : base == QuaternionOperator::Mul ? "imull "
+                                   : base == QuaternionOperator::And ? "andl "
+                                   : base == QuaternionOperator::Xor ? "xorl "
+                                                                     : "orl ";
+            line(mnemonic + src + ", " + target);
+            if (target == "%eax")
+                storeInt("%eax", dest);
+            return;
+        }
+        case QuaternionOperator::Div:
+        case QuaternionOperator::Rem:
+        {
+            loadInt(lhs, "%eax");
+            std::string src = intOperand(rhs, "%ecx");
+            if (src[0] == '$')
+            {
+                line("movl " + src + ", %ecx");
+                src = "%ecx";
+            }
+            line("cltd");
+            line("idivl " + src);
+            storeInt(base == QuaternionOperator::Div ? "%eax" : "%edx", dest);
+            return;
+        }
+        case QuaternionOperator::Shl:
+        case QuaternionOperator::Shr:
+        {
+            std::string mnemonic = base == QuaternionOperator::Shl ? "sall " : "sarl ";
+            if (rhs.type == ArgType::INTEGER || rhs.type == ArgType::FLOATING)
+            {
+                int32_t count = rhs.type == ArgType::INTEGER ? rhs.integerVal : FloatToInt(rhs.floatVal);
+                loadInt(lhs, "%eax");
+                line(mnemonic + "$" + std::to_string(count & 31) + ", %eax");
+            }
+            else
+            {
+                loadInt(rhs, "%ecx");
+                loadInt(lhs, "%eax");
+                line(mnemonic + "%cl, %eax");
+            }
+            storeInt("%eax", dest);
+            return;
+        }
+        case QuaternionOperator::LAnd:
+        case QuaternionOperator::LOr:
+            loadInt(lhs, "%eax");
+            loadInt(rhs, "%ecx");
+            line("testl %eax, %eax");
+            line("setne %al");
+            line("testl %ecx, %ecx");
+            line("setne %cl");
+            line(base == QuaternionOperator::LAnd ? "andb %cl, %al" : "orb %cl, %al");
+            break;
+        default:
+            genCompare(lhs, rhs);
+            line(std::string("set") + conditionCode(base, false) + " %al");
+            break;
+        }
+
+        line("movzbl %al, %eax");
+        storeInt("%eax", dest);
+    }
+
+    void QuaternionCodegen::unary(QuaternionOperator op, const Arg &result, const Arg &body)
+    {
+        if (result.type != ArgType::ENTRY)
+            return;
+
+        Place dest = place(result);
+        if (op == QuaternionOperator::LNot)
+        {
+            if (isFloat(body))
+            {
+                loadFloat(body, "%xmm0");
+                line("xorps %xmm1, %xmm1");
+                line("ucomiss %xmm1, %xmm0");
+                line("sete %al");
+                line("setnp %cl");
+                line("andb %cl, %al");
+            }
+            else
+            {
+                genCompare(body, Arg::value(0));
+                line("sete %al");
+            }
+            line("movzbl %al, %eax");
+            storeInt("%eax", dest);
+            return;
+        }
+
+        if (op == QuaternionOperator::Minus && isFloat(body))
+        {
+            // flips the sign bit
+            if (body.type == ArgType::ENTRY)
+                line("movl " + place(body).op32 + ", %eax");
+            else
+                line("movl $" + std::to_string(FloatBits(body.floatVal)) + ", %eax");
+            line("xorl $-2147483648, %eax");
+            if (dest.kind == ValueKind::Float)
+                line("movl %eax, " + dest.op32);
+            else
+            {
+                line("movd %eax, %xmm0");
+                storeFloat("%xmm0", dest);
+            }
+            return;
+        }
+
+        std::string target = dest.isRegister && dest.kind != ValueKind::Float ? dest.op32 : "%eax";
+        loadInt(body, target);
+        line((op == QuaternionOperator::Minus ? "negl " : "notl ") + target);
+        if (target == "%eax")
+            storeInt("%eax", dest);
+    }
+
+    void QuaternionCodegen::genCompare(const Arg &lhs, const Arg &rhs)
+    {
+        std::string src = intOperand(rhs, "%ecx");
+        std::string target = intOperand(lhs, "%eax");
+        bool isMemory = target[0] != '%' && target[0] != '$';
+        bool isSrcMemory = src[0] != '%' && src[0] != '$';
+        if (target[0] == '$' || (isMemory && isSrcMemory))
+        {
+            line("movl " + target + ", %eax");
+            target = "%eax";
+        }
+
+        if (src == "$0" && target[0] == '%')
+            line("testl " + target + ", " + target);
+        else
+            line("cmpl " + src + ", " + target);
+    }
+
+    bool QuaternionCodegen::genCompareJump(size_t addr, size_t &next)
+    {
+        auto &codes = _generator->_codes;
+        const Quaternion &code = codes[addr];
+        size_t jnz = addr + 1;
+        if (code.op < QuaternionOperator::LT || code.op > QuaternionOperator::NE || isFloat(code.arg1) || isFloat(code.arg2) ||
+            code.result.type != ArgType::ENTRY || _owners[code.result.symbol] != _context.id || jnz >= _context.end || _isJumpTarget[jnz])
+            return false;
+
+        const Quaternion &branch = codes[jnz];
+        if (branch.op != QuaternionOperator::Jnz || branch.arg1.type != ArgType::ENTRY || branch.arg1.symbol != code.result.symbol)
+            return false;
+        const Interval &interval = _intervals[_intervalIds[code.result.symbol]];
+        if (interval.start != static_cast<long>(addr) || interval.end != static_cast<long>(jnz))
+            return false;
+
+        genCompare(code.arg1, code.arg2);
+        if (isInvertible(jnz))
+        {
+            line(std::string("j") + conditionCode(code.op, true) + " " + label(codes[jnz + 1].result.codeAddr));
+            next = jnz + 2;
+        }
+        else
+        {
+            line(std::string("j") + conditionCode(code.op, false) + " " + label(branch.result.codeAddr));
+            next = jnz + 1;
+        }
+        return true;
+    }
+
+    void QuaternionCodegen::genBranch(size_t addr, size_t &next)
+    {
+        auto &codes = _generator->_codes;
+        const Quaternion &code = codes[addr];
+        const Arg &cond = code.arg1;
+        bool isInverted = isInvertible(addr);
+        std::string target = label(isInverted ? codes[addr + 1].result.codeAddr : code.result.codeAddr);
+        if (isInverted)
+            next = addr + 2;
+
+        if (cond.type == ArgType::INTEGER || cond.type == ArgType::FLOATING || cond.type == ArgType::STRING)
+        {
+            bool isTaken = cond.type == ArgType::STRING || (cond.type == ArgType::INTEGER ? cond.integerVal != 0 : cond.floatVal != 0.0f);
+            if (isTaken != isInverted)
+                line("jmp " + target);
+            return;
+        }
+
+        if (isFloat(cond))
+        {
+            loadFloat(cond, "%xmm0");
+            line("xorps %xmm1, %xmm1");
+            line("ucomiss %xmm1, %xmm0");
+            if (isInverted)
+            {
+                // zero unless unordered or not equal
+                std::string skip = label(addr) + "_nz";
+                line("jp " + skip);
+                line("je " + target);
+                _out << skip << ":\n";
+            }
+            else
+            {
+                line("jne " + target);
+                line("jp " + target);
+            }
+            return;
+        }
+
+        genCompare(cond, Arg::value(0));
+        line((isInverted ? "je " : "jne ") + target);
+    }
+
+    bool QuaternionCodegen::isInvertible(size_t jnz) const
+    {
+        // Jnz c L; J M; L: jumps to M unless c
+        auto &codes = _generator->_codes;
+        return jnz + 1 < _context.end && codes[jnz].result.codeAddr == static_cast<int>(jnz + 2) &&
+               codes[jnz + 1].op == QuaternionOperator::J && !_isJumpTarget[jnz + 1];
+    }
+
+    bool QuaternionCodegen::isFloat(const Arg &arg) const
+    {
+        if (arg.type == ArgType::ENTRY)
+            return _kinds[arg.symbol] == ValueKind::Float;
+        return arg.type == ArgType::FLOATING;
+    }
+
+    bool QuaternionCodegen::isValid(const Arg &arg) const
+    {
+        switch (arg.type)
+        {
+        case ArgType::ENTRY:
+            return arg.symbol < _owners.size() && (_owners[arg.symbol] == GlobalOwner || _owners[arg.symbol] == _context.id);
+        case ArgType::FUNCTION:
+            return arg.function < _generator->_functionTable.size();
+        case ArgType::STRING:
+            return arg.string < _generator->_strings.size();
+        case ArgType::CODEADDR:
+            return arg.codeAddr >= 0 && static_cast<size_t>(arg.codeAddr) <= _generator->_codes.size();
+        default:
+            return true;
+        }
+    }
+
+    void QuaternionCodegen::widenPointers()
+    {
+        auto &codes = _generator->_codes;
+        auto &symbols = _generator->_symbols;
+        auto widen = [&](const Arg &arg) {
+            if (arg.type != ArgType::ENTRY || symbols[arg.symbol].name[0] != '@' || _kinds[arg.symbol] != ValueKind::Int)
+                return false;
+            _kinds[arg.symbol] = ValueKind::Pointer;
+            return true;
+        };
+        auto isPointer = [&](const Arg &arg) {
+            return arg.type == ArgType::STRING || (arg.type == ArgType::ENTRY && _kinds[arg.symbol] == ValueKind::Pointer);
+        };
+
+        // copies only run forward in the codes, but a loop may copy back, so repeat until nothing changes
+        bool isChanged = true;
+        while (isChanged)
+        {
+            isChanged = false;
+            for (auto &code : codes)
+            {
+                if (code.op == QuaternionOperator::DefineEqual && isPointer(code.arg1))
+                    isChanged |= widen(code.result);
+                else if (code.op == QuaternionOperator::Assign && isPointer(code.arg2))
+                    isChanged |= widen(code.arg1) | widen(code.result);
+                else if (code.op == QuaternionOperator::Call && code.arg1.type == ArgType::FUNCTION &&
+                         kindOf(_generator->_functionTable[code.arg1.function].type) == ValueKind::Pointer)
+                    isChanged |= widen(code.result);
+            }
+        }
+    }
+
+    QuaternionCodegen::ValueKind QuaternionCodegen::kindOf(const std::string &type) const
+    {
+        if (type == "float")
+            return ValueKind::Float;
+        if (type.find('*') != std::string::npos)
+            return ValueKind::Pointer;
+        return ValueKind::Int;
+    }
+
+    std::string QuaternionCodegen::label(size_t addr) const
+    {
+        return ".LQ" + (_context.id == GlobalOwner ? std::string("I") : std::to_string(_context.id)) + "_" + std::to_string(addr);
+    }
+
+    std::string QuaternionCodegen::floatConstant(float value)
+    {
+        auto it = _floatConstants.emplace(static_cast<uint32_t>(FloatBits(value)), _floatConstants.size()).first;
+        return ".LCF" + std::to_string(it->second) + "(%rip)";
+    }
+
+    const char *QuaternionCodegen::conditionCode(QuaternionOperator op, bool isInverted)
+    {
+        switch (op)
+        {
+        case QuaternionOperator::LT: return isInverted ? "ge" : "l";
+        case QuaternionOperator::GT: return isInverted ? "le" : "g";
+        case QuaternionOperator::LE: return isInverted ? "g" : "le";
+        case QuaternionOperator::GE: return isInverted ? "l" : "ge";
+        case QuaternionOperator::EQ: return isInverted ? "ne" : "e";
+        default: return isInverted ? "e" : "ne";
+        }
+    }
+
+    QuaternionCodegen::QuaternionOperator QuaternionCodegen::baseOperator(QuaternionOperator op)
+    {
+        switch (op)
+        {
+        case QuaternionOperator::MulAssign: return QuaternionOperator::Mul;
+        case QuaternionOperator::DivAssign: return QuaternionOperator::Div;
+        case QuaternionOperator::RemAssign: return QuaternionOperator::Rem;
+        case QuaternionOperator::AddAssign: return QuaternionOperator::Add;
+        case QuaternionOperator::SubAssign: return QuaternionOperator::Sub;
+        case QuaternionOperator::ShlAssign: return QuaternionOperator::Shl;
+        case QuaternionOperator::ShrAssign: return QuaternionOperator::Shr;
+        case QuaternionOperator::AndAssign: return QuaternionOperator::And;
+        case QuaternionOperator::XorAssign: return QuaternionOperator::Xor;
+        case QuaternionOperator::OrAssign: return QuaternionOperator::Or;
+        default: return op;
+        }
+    }
+}
@@ -0,0 +1,175 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "IRGenerator.hpp"
+
+namespace lcc
+{
+    // x86-64 System V assembly straight from the quaternion IR(QuaternionCodegen.cpp), a fast path for
+    // unoptimized builds that skips LLVM. The local symbols of each function get a live interval, the
+    // hull of the codes using them and the basic blocks they are live through, and a linear scan
+    // assigns them general purpose registers, floats included as their bits. Intervals that cross a call or
+    // hold a parameter only get callee saved registers, the rest are spilled to 8 byte frame slots.
+    // Arrays live in the frame below the slots or in .bss and are never allocated. Every code is then
+    // lowered on its own through the eax/ecx/edx and xmm0-xmm2 scratch registers, inline asm gets its
+    // operands in eax/ecx/edx and may clobber anything, so nothing stays in a register across it.
+    // Global initializers become a function run from .init_array.
+    class QuaternionCodegen
+    {
+        typedef QuaternionIRGenerator::Quaternion Quaternion;
+        typedef QuaternionIRGenerator::QuaternionOperator QuaternionOperator;
+        typedef QuaternionIRGenerator::Arg Arg;
+        typedef QuaternionIRGenerator::ArgType ArgType;
+
+        static constexpr int NoRegister = -1;
+        static constexpr int NumCalleeSaved = 5; // rbx and r12-r15
+        static constexpr size_t NoFunction = SIZE_MAX;       // owner of symbols no table holds
+        static constexpr size_t GlobalOwner = SIZE_MAX - 1; // owner of the globals, the initializers' id
+
+        enum class ValueKind : uint8_t
+        {
+            Int, // chars too, 32 bits
+            Float,
+            Pointer // 64 bits, string literals are these
+        };
+
+        // where a value is read from or written to
+        typedef struct _Place
+        {
+            std::string op32; // operand naming the low 32 bits
+            std::string op64; // operand naming all the bits, empty when the place only has 32
+            bool isRegister;
+            ValueKind kind;
+        } Place;
+
+        typedef struct _Interval
+        {
+            uint32_t symbol;
+            long start; // code addresses, parameters start right before the entry
+            long end;
+            bool isParam;
+            bool isCrossingCall;
+            bool isCrossingAsm;
+            int reg; // NoRegister when spilled
+        } Interval;
+
+        // the function being lowered, the global initializers are one too
+        typedef struct _FunctionContext
+        {
+            size_t id; // index into the function table, GlobalOwner for the initializers
+            size_t end; // end of the code range being lowered
+            std::string exitLabel;
+            ValueKind returnKind;
+            bool isVoid;
+            bool isSaved[NumCalleeSaved]; // callee saved register -> pushed after rbp
+            int numSaved;
+            int numSlots; // 8 byte slots below the saved registers, the staging slots of arguments come first
+        } FunctionContext;
+
+    private:
+        QuaternionCodegen() = default;
+        QuaternionCodegen(const QuaternionCodegen &) = delete;
+        QuaternionCodegen &operator=(const QuaternionCodegen &) = delete;
+
+    public:
+        static QuaternionCodegen *getInstance()
+        {
+            if (_inst.get() == nullptr)
+                _inst.reset(new QuaternionCodegen);
+
+            return _inst.get();
+        }
+
+    private:
+        static std::unique_ptr<QuaternionCodegen> _inst;
+
+    public:
+        // writes the assembly to outPath, "-" for stdout. Returns false without writing anything when
+        // some code can't be lowered, e.g. the generator left a pointer subscript out.
+        bool run(const QuaternionIRGenerator *generator, const std::string &outPath);
+        size_t numSpilled() const { return _numSpilled; } // symbols of the last run that got no register
+
+    private:
+        bool genFunction(size_t id);
+        bool genInitializers();
+        // ranges of code addresses, the function's codes in order
+        bool genBody(const std::vector<std::pair<size_t, size_t>> &ranges);
+        // next is the address of the code to lower after addr
+        bool genCode(size_t addr, size_t &next);
+        bool genParam(size_t addr);
+        bool genCall(const Quaternion &code);
+        // the Asm at addr with the operand codes right before it
+        bool genAsm(size_t addr);
+        void genPrologue(const std::vector<uint32_t> &params);
+        void genEpilogue();
+
+        // assigns registers and frame slots to the symbols of the function in [begin, end)
+        void allocate(size_t begin, size_t end, const std::vector<uint32_t> &params);
+
+        Place place(const Arg &arg) const;
+        Place slotPlace(int offset, ValueKind kind) const; // offset from rbp
+        Place registerPlace(const char *op32, const char *op64, ValueKind kind) const;
+        int stagingOffset(size_t index) const; // of the index-th argument of a call
+        // an operand holding arg as an int, converted into scratch when needed
+        std::string intOperand(const Arg &arg, const char *scratch);
+        // an operand holding arg as a float, an xmm register or memory
+        std::string floatOperand(const Arg &arg, const char *scratch);
+        void loadInt(const Arg &arg, const std::string &reg);
+        void loadFloat(const Arg &arg, const char *xmm);
+        void storeInt(const char *reg, const Place &dest);
+        void storeFloat(const char *xmm, const Place &dest);
+        // the memory operand of the element of array at byte offset, the index goes through rcx and a
+        // global's address through rdx
+        std::string elementOperand(const Arg &array, const Arg &offset);
+        // moves the bits of src to dest, both ints or both floats
+        void move(const Place &dest, const Place &src);
+        // dest = src converted to the kind of dest
+        void convert(const Place &dest, const Place &src);
+        void copy(const Place &dest, const Arg &src);
+        // result = lhs op rhs, op may be a compound assignment too
+        void binary(QuaternionOperator op, const Arg &result, const Arg &lhs, const Arg &rhs);
+        void unary(QuaternionOperator op, const Arg &result, const Arg &body);
+        // sets the flags of lhs - rhs as ints
+        void genCompare(const Arg &lhs, const Arg &rhs);
+        // a compare of ints whose only reader is the Jnz right after it becomes a cmp and a jcc
+        bool genCompareJump(size_t addr, size_t &next);
+        void genBranch(size_t addr, size_t &next);
+        bool isInvertible(size_t jnz) const;
+
+        // the generator types temps of string literals and pointer calls as ints, they get 64 bits here
+        void widenPointers();
+        bool isFloat(const Arg &arg) const;
+        bool isValid(const Arg &arg) const;
+        ValueKind kindOf(const std::string &type) const;
+        std::string label(size_t addr) const;
+        std::string floatConstant(float value); // a memory operand
+        void line(const std::string &text) { _out << '\t' << text << '\n'; }
+
+        static const char *conditionCode(QuaternionOperator op, bool isInverted);
+        // the operator a compound assignment applies, op itself otherwise
+        static QuaternionOperator baseOperator(QuaternionOperator op);
+
+    private:
+        const QuaternionIRGenerator *_generator{nullptr}; // only while running
+        std::ostringstream _out;
+
+        std::vector<ValueKind> _kinds;       // symbol -> kind of its values, of its elements for arrays
+        std::vector<bool> _isArray;          // symbol -> holds elements in place
+        std::vector<size_t> _owners;         // symbol -> function whose tables hold it or GlobalOwner
+        std::vector<std::string> _globals;   // symbol -> label of a global
+        std::vector<Interval> _intervals;    // of the current function, by start
+        std::vector<uint32_t> _intervalIds;  // symbol -> index into _intervals, UINT32_MAX when none
+        std::vector<int> _registers;         // symbol -> register, NoRegister when in memory
+        std::vector<int> _offsets;           // symbol -> offset of its frame slot from rbp, 0 when none
+        std::vector<bool> _isJumpTarget;     // code address -> needs a label
+        std::unordered_map<uint32_t, size_t> _floatConstants; // bits -> label index
+        FunctionContext _context;
+        size_t _numSpilled{0};
+    };
+}
@@ -2,18 +2,21 @@
 // Codegen methods for new features will only be implemented in LLVMIRGenerator.cpp.
 
 #include "lcc.hpp"
+#include <algorithm>
+#include <climits>
+#include <iomanip>
+#include <iostream>
 
 #define EMIT(op, arg1, arg2, result) emit(op, arg1, arg2, result)
-#define INVALID_SYMBOLTBL_ENTRY(entry) (entry == nullptr)
 #define INT32_WIDTH sizeof(uint32_t)
 #define FLOAT_WIDTH sizeof(float)
 #define INT "int"
 #define FLOAT "float"
 // #define VOID "void"
-#define MAKE_NIL_ARG() std::make_shared<Arg>()
-#define MAKE_VALUE_ARG(val) std::make_shared<Value>(val)
-#define MAKE_ENTRY_ARG(entry) std::make_shared<SymbTblEntry>(entry)
-#define MAKE_ADDR_ARG(codeAddr) std::make_shared<CodeAddr>(codeAddr)
+#define MAKE_NIL_ARG() Arg::nil()
+#define MAKE_VALUE_ARG(val) Arg::value(val)
+#define MAKE_ENTRY_ARG(symbol) Arg::entry(symbol)
+#define MAKE_ADDR_ARG(codeAddr) Arg::addr(codeAddr)
 
 namespace lcc
 {
@@ -58,10 +61,15 @@ namespace lcc
         changeTable(mkTable());
     }
 
+    bool QuaternionIRGenerator::generate(AST::ASTNode *astNode)
+    {
+        return visit(astNode);
+    }
+
     bool QuaternionIRGenerator::gen(AST::TranslationUnitDecl *translationUnitDecl)
     {
         for (auto &decl : translationUnitDecl->_decls)
-            if (!decl->gen(this))
+            if (!visit(decl))
                 return false;
 
         return true;
@@ -69,19 +77,18 @@ namespace lcc
 
     bool QuaternionIRGenerator::gen(AST::VarDecl *varDecl)
     {
-        bool result = enter(varDecl->name(), varDecl->type(), 4);
-        if (!result)
-        {
-            FATAL_ERROR("Redeclaration " << varDecl->type() << " " << varDecl->name());
-            return false;
-        }
+        // an array holds its elements in place, an array parameter is a pointer as in C
+        auto type = varDecl->type();
+        if (type->isArray() && varDecl->kind() == AST::ASTNode::Kind::ParmVarDecl)
+            type = AST::Type::getPointer(type->elementType());
+        place(varDecl) = enter(varDecl->name(), type->name(), type->isArray() ? static_cast<int>(INT32_WIDTH * type->length()) : INT32_WIDTH);
 
         if (varDecl->_isInitialized)
         {
-            if (!varDecl->_value->gen(this))
+            if (!visit(varDecl->_value))
                 return false;
-            auto arg1Entry = lookup(varDecl->_value->place);
-            auto resultEntry = lookup(varDecl->name());
+            auto arg1Entry = place(varDecl->_value.get());
+            auto resultEntry = place(varDecl);
             EMIT(QuaternionOperator::DefineEqual, MAKE_ENTRY_ARG(arg1Entry), MAKE_NIL_ARG(), MAKE_ENTRY_ARG(resultEntry));
         }
 
@@ -90,38 +97,45 @@ namespace lcc
 
     bool QuaternionIRGenerator::gen(AST::FunctionDecl *functionDecl)
     {
-        if (!registerFunc(functionDecl->name(), functionDecl->_type, _codes.size(), false))
+        if (!registerFunc(functionDecl->name(), functionDecl->_type->name(), _codes.size(), false))
         {
             FATAL_ERROR("Function " << functionDecl->name() << " redeclaration.");
             return false;
         }
 
         auto previousTable = _currentSymbolTable;
+        int numGlobalTemps = _numTemps;
+        _numTemps = 0;
+        _functionTable.back().firstTable = _tables.size();
         changeTable(mkTable(previousTable));
 
         for (auto &param : functionDecl->_params)
         {
-            if (!param->gen(this))
+            if (!visit(param))
                 return false;
+            _functionTable.back().params.push_back(place(param.get()));
         }
 
         if (functionDecl->_body != nullptr)
         {
             _functionTable.back().isInitialized = true;
-            if (!functionDecl->_body->gen(this))
+            if (!visit(functionDecl->_body))
                 return false;
+            _functionTable.back().exit = _codes.size();
         }
 
+        _functionTable.back().endTable = _tables.size();
+        if (_functionTable.back().isInitialized)
+            recycleTemps(_functionTable.size() - 1);
         changeTable(previousTable);
+        _numTemps = numGlobalTemps;
         return true;
     }
 
     bool QuaternionIRGenerator::gen(AST::IntegerLiteral *integerLiteral)
     {
         auto newTmpEntry = newtemp(INT, INT32_WIDTH);
-        if (INVALID_SYMBOLTBL_ENTRY(newTmpEntry))
-            return false;
-        integerLiteral->place = newTmpEntry->name;
+        place(integerLiteral) = newTmpEntry;
 
         EMIT(QuaternionOperator::DefineEqual, MAKE_VALUE_ARG(integerLiteral->value()), MAKE_NIL_ARG(), MAKE_ENTRY_ARG(newTmpEntry));
         return true;
@@ -130,9 +144,7 @@ namespace lcc
     bool QuaternionIRGenerator::gen(AST::FloatingLiteral *floatingLiteral)
     {
         auto newTmpEntry = newtemp(FLOAT, FLOAT_WIDTH);
-        if (INVALID_SYMBOLTBL_ENTRY(newTmpEntry))
-            return false;
-        floatingLiteral->place = newTmpEntry->name;
+        place(floatingLiteral) = newTmpEntry;
 
         EMIT(QuaternionOperator::DefineEqual, MAKE_VALUE_ARG(floatingLiteral->value()), MAKE_NIL_ARG(), MAKE_ENTRY_ARG(newTmpEntry));
         return true;
@@ -140,16 +152,9 @@ namespace lcc
 
     bool QuaternionIRGenerator::gen(AST::DeclRefExpr *declRefExpr)
     {
-        if (!declRefExpr->_isCall) // referencing a param
+        if (!declRefExpr->_isCall) // referencing a variable, Sema has bound it to its VarDecl
         {
-            auto tblEntry = lookup(declRefExpr->name());
-            if (INVALID_SYMBOLTBL_ENTRY(tblEntry)) // symbol not declared
-            {
-                FATAL_ERROR("Symbol " << declRefExpr->name() << " not declared.");
-                return false;
-            }
-
-            declRefExpr->place = tblEntry->name;
+            place(declRefExpr) = place(declRefExpr->decl());
             return true;
         }
 
@@ -160,10 +165,10 @@ namespace lcc
     bool QuaternionIRGenerator::gen(AST::CastExpr *castExpr)
     {
         // CURRENTLY TYPE CAST DOES NOTHING AT ALL!
-        if (!castExpr->_subExpr->gen(this))
+        if (!visit(castExpr->_subExpr))
             return false;
 
-        castExpr->place = castExpr->_subExpr->place;
+        place(castExpr) = place(castExpr->_subExpr.get());
         return true;
     }
 
@@ -176,45 +181,32 @@ namespace lcc
 
     bool QuaternionIRGenerator::gen(AST::BinaryOperator *binaryOperator)
     {
-        if (!binaryOperator->_lhs->gen(this))
-            return false;
-        if (!binaryOperator->_rhs->gen(this))
-            return false;
-
-        auto arg1Entry = lookup(binaryOperator->_lhs->place);
-        auto arg2Entry = lookup(binaryOperator->_rhs->place);
-
-        std::string resultType;
-        int resultWidth;
-        if (arg1Entry->type == FLOAT || arg2Entry->type == FLOAT)
-        {
-            resultType = FLOAT;
-            resultWidth = FLOAT_WIDTH;
-        }
-        else
-        {
-            resultType = INT;
-            resultWidth = INT32_WIDTH;
-        }
+        QuaternionOperator op = BinaryOpToQuaternionOp(binaryOperator->type());
+        bool isAssignment = op >= QuaternionOperator::Assign && op <= QuaternionOperator::OrAssign;
+        if (isAssignment && binaryOperator->_lhs->kind() == AST::ASTNode::Kind::ArraySubscriptExpr)
+            return genElementUpdate(static_cast<AST::ArraySubscriptExpr *>(binaryOperator->_lhs.get()), op, binaryOperator->_rhs.get(), binaryOperator);
 
-        auto newTmpEntry = newtemp(resultType, resultWidth);
-        if (INVALID_SYMBOLTBL_ENTRY(newTmpEntry))
+        if (!visit(binaryOperator->_lhs))
+            return false;
+        if (!visit(binaryOperator->_rhs))
             return false;
 
-        binaryOperator->place = newTmpEntry->name;
+        auto arg1Entry = place(binaryOperator->_lhs.get());
+        auto arg2Entry = place(binaryOperator->_rhs.get());
 
-        auto resultEntry = lookup(newTmpEntry->name);
+        auto resultEntry = newtemp(binaryOperator->exprType());
+        place(binaryOperator) = resultEntry;
 
-        EMIT(BinaryOpToQuaternionOp(binaryOperator->type()), MAKE_ENTRY_ARG(arg1Entry), MAKE_ENTRY_ARG(arg2Entry), MAKE_ENTRY_ARG(resultEntry));
+        EMIT(op, MAKE_ENTRY_ARG(arg1Entry), MAKE_ENTRY_ARG(arg2Entry), MAKE_ENTRY_ARG(resultEntry));
         return true;
     }
 
     bool QuaternionIRGenerator::gen(AST::ParenExpr *parenExpr)
     {
-        if (!parenExpr->_subExpr->gen(this))
+        if (!visit(parenExpr->_subExpr))
             return false;
 
-        parenExpr->place = parenExpr->_subExpr->place;
+        place(parenExpr) = place(parenExpr->_subExpr.get());
         return true;
     }
 
@@ -224,7 +216,7 @@ namespace lcc
         changeTable(mkTable(previousTable));
         for (auto &stmt : compoundStmt->_body)
         {
-            if (!stmt->gen(this))
+            if (!visit(stmt))
                 return false;
         }
 
@@ -236,7 +228,7 @@ namespace lcc
     {
         for (auto &decl : declStmt->_decls)
         {
-            if (!decl->gen(this))
+            if (!visit(decl))
                 return false;
         }
 
@@ -246,17 +238,17 @@ namespace lcc
     bool QuaternionIRGenerator::gen(AST::IfStmt *ifStmt)
     {
         // currently all conditional jumps are implemented with jnz
-        if (!ifStmt->_condition->gen(this))
+        if (!visit(ifStmt->_condition))
             return false; // gen ir for condition first
         int bodyCodeEntryAddr = _codes.size() + 2;
         int elseBodyEntryAddr = 0; // this will be filled in after if body is generated
-        auto conditionExprResultEntry = lookup(ifStmt->_condition->place);
+        auto conditionExprResultEntry = place(ifStmt->_condition.get());
         EMIT(QuaternionOperator::Jnz, MAKE_ENTRY_ARG(conditionExprResultEntry), MAKE_NIL_ARG(), MAKE_ADDR_ARG(bodyCodeEntryAddr)); // if condition is true, jump to if body
         EMIT(QuaternionOperator::J, MAKE_NIL_ARG(), MAKE_NIL_ARG(), MAKE_ADDR_ARG(elseBodyEntryAddr));
 
         auto jumpToElseBodyCodeAddr = _codes.size() - 1;
 
-        if (!ifStmt->_body->gen(this))
+        if (!visit(ifStmt->_body))
             return false;
 
         elseBodyEntryAddr = _codes.size();
@@ -266,7 +258,7 @@ namespace lcc
             elseBodyEntryAddr += 1;
             EMIT(QuaternionOperator::J, MAKE_NIL_ARG(), MAKE_NIL_ARG(), MAKE_ADDR_ARG(0)); // jump over else body
             auto jumpOverElseBodyCodeAddr = _codes.size() - 1;
-            if (!ifStmt->_elseBody->gen(this))
+            if (!visit(ifStmt->_elseBody))
                 return false;
             auto elseBodyExitAddr = _codes.size();
             _codes[jumpOverElseBodyCodeAddr].result = MAKE_ADDR_ARG(elseBodyExitAddr); // replace 0 with correct else body exit addr
@@ -279,7 +271,7 @@ namespace lcc
 
     bool QuaternionIRGenerator::gen(AST::ValueStmt *valueStmt)
     {
-        if (!valueStmt->_expr->gen(this))
+        if (!visit(valueStmt->_expr))
             return false;
 
         return true;
@@ -292,10 +284,10 @@ namespace lcc
             EMIT(QuaternionOperator::Ret, MAKE_NIL_ARG(), MAKE_NIL_ARG(), MAKE_NIL_ARG());
         else
         {
-            if (!returnStmt->_value->gen(this))
+            if (!visit(returnStmt->_value))
                 return false;
 
-            auto returnValueEntry = lookup(returnStmt->_value->place);
+            auto returnValueEntry = place(returnStmt->_value.get());
             EMIT(QuaternionOperator::Ret, MAKE_NIL_ARG(), MAKE_NIL_ARG(), MAKE_ENTRY_ARG(returnValueEntry));
         }
 
@@ -304,21 +296,23 @@ namespace lcc
 
     bool QuaternionIRGenerator::gen(AST::UnaryOperator *unaryOperator)
     {
-        if (!unaryOperator->_body->gen(this))
-            return false;
-
-        auto bodyResultEntry = lookup(unaryOperator->_body->place);
+        QuaternionOperator op = UnaryOpToQuaternionOp(unaryOperator->type());
+        bool isIncDec = op >= QuaternionOperator::PostInc && op <= QuaternionOperator::PreDec;
+        AST::Expr *body = unaryOperator->_body.get();
+        while (isIncDec && body->kind() == AST::ASTNode::Kind::ParenExpr)
+            body = static_cast<AST::ParenExpr *>(body)->_subExpr.get();
+        if (isIncDec && body->kind() == AST::ASTNode::Kind::ArraySubscriptExpr)
+            return genElementUpdate(static_cast<AST::ArraySubscriptExpr *>(body), op, nullptr, unaryOperator);
 
-        std::shared_ptr<SymbolTableItem> newTempResult = nullptr;
+        if (!visit(unaryOperator->_body))
+            return false;
 
-        if (bodyResultEntry->type == INT)
-            newTempResult = newtemp(bodyResultEntry->type, INT32_WIDTH);
-        else
-            newTempResult = newtemp(bodyResultEntry->type, FLOAT_WIDTH);
+        auto bodyResultEntry = place(unaryOperator->_body.get());
+        auto newTempResult = newtemp(unaryOperator->exprType());
 
-        EMIT(UnaryOpToQuaternionOp(unaryOperator->type()), MAKE_ENTRY_ARG(bodyResultEntry), MAKE_NIL_ARG(), MAKE_ENTRY_ARG(newTempResult));
+        EMIT(op, MAKE_ENTRY_ARG(bodyResultEntry), MAKE_NIL_ARG(), MAKE_ENTRY_ARG(newTempResult));
 
-        unaryOperator->place = newTempResult->name;
+        place(unaryOperator) = newTempResult;
 
         return true;
     }
@@ -326,10 +320,10 @@ namespace lcc
     bool QuaternionIRGenerator::gen(AST::WhileStmt *whileStmt)
     {
         int whileConditionEntryAddr = _codes.size();
-        if (!whileStmt->_condition->gen(this))
+        if (!visit(whileStmt->_condition))
             return false;
 
-        auto conditionExprResultEntry = lookup(whileStmt->_condition->place);
+        auto conditionExprResultEntry = place(whileStmt->_condition.get());
         int whileBodyEntryAddr = _codes.size() + 2;
         int whileExitAddr = 0; // this will be filled in after body codes are emitted
         EMIT(QuaternionOperator::Jnz, MAKE_ENTRY_ARG(conditionExprResultEntry), MAKE_NIL_ARG(), MAKE_ADDR_ARG(whileBodyEntryAddr));
@@ -337,7 +331,7 @@ namespace lcc
 
         auto jumpToWhileExitCodeAddr = _codes.size() - 1;
 
-        if (!whileStmt->_body->gen(this))
+        if (!visit(whileStmt->_body))
             return false;
 
         EMIT(QuaternionOperator::J, MAKE_NIL_ARG(), MAKE_NIL_ARG(), MAKE_ADDR_ARG(whileConditionEntryAddr)); // go back to while condition entry to calculate loop condition again
@@ -350,267 +344,387 @@ namespace lcc
 
     bool QuaternionIRGenerator::gen(AST::CallExpr *callExpr)
     {
-        // TODO IR Generation for call expr will be implemented later;
-        auto newTempResult = newtemp(INT, INT32_WIDTH);
+        auto callee = _functionIds.find(callExpr->_functionExpr->name());
+        if (callee == _functionIds.end())
+        {
+            FATAL_ERROR("Function " << callExpr->_functionExpr->name() << " undeclared.");
+            return false;
+        }
+
+        // all arguments are evaluated first, so the Params of a call are never split by a nested one
+        for (auto &param : callExpr->_params)
+        {
+            if (!visit(param))
+                return false;
+        }
+        for (auto &param : callExpr->_params)
+            EMIT(QuaternionOperator::Param, MAKE_ENTRY_ARG(place(param.get())), MAKE_NIL_ARG(), MAKE_NIL_ARG());
 
-        EMIT(QuaternionOperator::Call, MAKE_NIL_ARG(), MAKE_NIL_ARG(), MAKE_ENTRY_ARG(newTempResult));
+        Arg result = MAKE_NIL_ARG();
+        if (!callExpr->exprType()->isVoid())
+        {
+            place(callExpr) = newtemp(callExpr->exprType());
+            result = MAKE_ENTRY_ARG(place(callExpr));
+        }
 
-        callExpr->place = newTempResult->name;
+        EMIT(QuaternionOperator::Call, Arg::callee(callee->second), MAKE_VALUE_ARG(static_cast<int>(callExpr->_params.size())), result);
+        return true;
+    }
 
+    bool QuaternionIRGenerator::gen(AST::NullStmt *nullStmt)
+    {
         return true;
     }
 
     bool QuaternionIRGenerator::gen(AST::AsmStmt *asmStmt)
     {
-        GEN_METHOD_NO_IMPLEMENT
+        // only register operands, the backends pick the registers
+        for (auto &output : asmStmt->_outputConstraints)
+        {
+            if (output.first != "=r")
+            {
+                _numUnlowered++;
+                return true;
+            }
+        }
+        for (auto &input : asmStmt->_inputConstraints)
+        {
+            if (input.first != "r")
+            {
+                _numUnlowered++;
+                return true;
+            }
+        }
+
+        // elements written by the asm are stored once it has run, the offsets are computed before
+        std::vector<uint32_t> offsets;
+        for (auto &output : asmStmt->_outputConstraints)
+        {
+            uint32_t offset = NoSymbol;
+            if (output.second->kind() == AST::ASTNode::Kind::ArraySubscriptExpr)
+            {
+                if (!elementOffset(static_cast<AST::ArraySubscriptExpr *>(output.second.get()), offset))
+                    return false;
+                if (offset == NoSymbol)
+                    return true;
+            }
+            else if (!visit(output.second))
+                return false;
+            offsets.push_back(offset);
+        }
+        for (auto &input : asmStmt->_inputConstraints)
+        {
+            if (!visit(input.second))
+                return false;
+        }
+
+        // operands are numbered as in the template, outputs first
+        int numOutputs = asmStmt->_outputConstraints.size();
+        for (size_t index = 0; index < asmStmt->_inputConstraints.size(); index++)
+            EMIT(QuaternionOperator::AsmInput, MAKE_ENTRY_ARG(place(asmStmt->_inputConstraints[index].second.get())), MAKE_VALUE_ARG(numOutputs + static_cast<int>(index)), MAKE_NIL_ARG());
+
+        std::vector<uint32_t> values;
+        for (int index = 0; index < numOutputs; index++)
+        {
+            AST::DeclRefExpr *output = asmStmt->_outputConstraints[index].second.get();
+            values.push_back(offsets[index] == NoSymbol ? place(output) : newtemp(output->exprType()));
+            EMIT(QuaternionOperator::AsmOutput, MAKE_NIL_ARG(), MAKE_VALUE_ARG(index), MAKE_ENTRY_ARG(values.back()));
+        }
+
+        _strings.push_back(asmStmt->_asmString);
+        EMIT(QuaternionOperator::Asm, Arg::str(_strings.size() - 1), MAKE_VALUE_ARG(numOutputs + static_cast<int>(asmStmt->_inputConstraints.size())), MAKE_NIL_ARG());
+
+        for (int index = 0; index < numOutputs; index++)
+        {
+            if (offsets[index] != NoSymbol)
+                EMIT(QuaternionOperator::Store, MAKE_ENTRY_ARG(values[index]), MAKE_ENTRY_ARG(offsets[index]), MAKE_ENTRY_ARG(place(asmStmt->_outputConstraints[index].second->decl())));
+        }
+
+        return true;
     }
 
     bool QuaternionIRGenerator::gen(AST::CharacterLiteral *charLiteral)
     {
-        GEN_METHOD_NO_IMPLEMENT
+        auto newTmpEntry = newtemp(INT, INT32_WIDTH);
+        place(charLiteral) = newTmpEntry;
+
+        EMIT(QuaternionOperator::DefineEqual, MAKE_VALUE_ARG(static_cast<int>(charLiteral->value())), MAKE_NIL_ARG(), MAKE_ENTRY_ARG(newTmpEntry));
+        return true;
     }
 
     bool QuaternionIRGenerator::gen(AST::StringLiteral *strLiteral)
     {
-        GEN_METHOD_NO_IMPLEMENT
+        // the temp holds the literal's index, only host functions such as puts look into it
+        auto newTmpEntry = newtemp(INT, INT32_WIDTH);
+        place(strLiteral) = newTmpEntry;
+        _strings.push_back(strLiteral->value());
+
+        EMIT(QuaternionOperator::DefineEqual, Arg::str(_strings.size() - 1), MAKE_NIL_ARG(), MAKE_ENTRY_ARG(newTmpEntry));
+        return true;
     }
 
     bool QuaternionIRGenerator::gen(AST::ArraySubscriptExpr *arraySubscriptExpr)
     {
-        GEN_METHOD_NO_IMPLEMENT
-    }
+        uint32_t offset;
+        if (!elementOffset(arraySubscriptExpr, offset))
+            return false;
+        if (offset == NoSymbol)
+            return true;
 
-    std::shared_ptr<QuaternionIRGenerator::SymbolTable> QuaternionIRGenerator::mkTable(std::shared_ptr<SymbolTable> previous)
-    {
-        auto tbl = std::make_shared<SymbolTable>(previous);
-        _tables.push_back(tbl);
-        return tbl;
-    }
+        auto resultEntry = newtemp(arraySubscriptExpr->exprType());
+        place(arraySubscriptExpr) = resultEntry;
 
-    void QuaternionIRGenerator::changeTable(std::shared_ptr<SymbolTable> table)
-    {
-        _currentSymbolTable = table;
+        EMIT(QuaternionOperator::Subscript, MAKE_ENTRY_ARG(place(arraySubscriptExpr->decl())), MAKE_ENTRY_ARG(offset), MAKE_ENTRY_ARG(resultEntry));
+        return true;
     }
 
-    std::shared_ptr<QuaternionIRGenerator::SymbolTableItem> QuaternionIRGenerator::lookupCurrentTbl(std::string name)
+    bool QuaternionIRGenerator::elementOffset(AST::ArraySubscriptExpr *element, uint32_t &offset)
     {
-        for (auto &item : _currentSymbolTable->items)
+        // elements are only addressable in arrays held in place, not through pointers or parameters
+        offset = NoSymbol;
+        uint32_t array = place(element->decl());
+        if (array == NoSymbol || !isArrayType(_symbols[array].type) || !element->exprType()->isBuiltin())
         {
-            if (item->name == name)
-                return item;
+            _numUnlowered++;
+            return true;
         }
 
-        return nullptr;
+        if (!visit(element->_rhs))
+            return false;
+
+        offset = newtemp(INT, INT32_WIDTH);
+        EMIT(QuaternionOperator::Mul, MAKE_ENTRY_ARG(place(element->_rhs.get())), MAKE_VALUE_ARG(static_cast<int>(INT32_WIDTH)), MAKE_ENTRY_ARG(offset));
+        return true;
     }
 
-    std::shared_ptr<QuaternionIRGenerator::SymbolTableItem> QuaternionIRGenerator::lookup(std::string name)
+    bool QuaternionIRGenerator::genElementUpdate(AST::ArraySubscriptExpr *element, QuaternionOperator op, AST::Expr *rhs, AST::Expr *expr)
     {
-        auto currentTbl = _currentSymbolTable;
-        std::shared_ptr<SymbolTableItem> tblEntry = nullptr;
-        for (_currentSymbolTable; _currentSymbolTable != nullptr; changeTable(_currentSymbolTable->previous))
-        {
-            tblEntry = lookupCurrentTbl(name);
-            if (!(INVALID_SYMBOLTBL_ENTRY(tblEntry)))
-                break;
-        }
-        changeTable(currentTbl);
+        uint32_t offset;
+        if (!elementOffset(element, offset))
+            return false;
+        if (offset == NoSymbol)
+            return true;
+        if (rhs != nullptr && !visit(rhs))
+            return false;
 
-        return tblEntry;
+        // the element is updated in a temp as a variable would be, so every operator keeps its conversions
+        auto array = MAKE_ENTRY_ARG(place(element->decl()));
+        auto valueEntry = newtemp(element->exprType());
+        if (op != QuaternionOperator::Assign)
+            EMIT(QuaternionOperator::Subscript, array, MAKE_ENTRY_ARG(offset), MAKE_ENTRY_ARG(valueEntry));
+
+        auto resultEntry = newtemp(expr->exprType());
+        place(expr) = resultEntry;
+        EMIT(op, MAKE_ENTRY_ARG(valueEntry), rhs != nullptr ? MAKE_ENTRY_ARG(place(rhs)) : MAKE_NIL_ARG(), MAKE_ENTRY_ARG(resultEntry));
+        EMIT(QuaternionOperator::Store, MAKE_ENTRY_ARG(valueEntry), MAKE_ENTRY_ARG(offset), array);
+        return true;
     }
 
-    bool QuaternionIRGenerator::enter(std::string name, std::string type, int width)
+    std::shared_ptr<QuaternionIRGenerator::SymbolTable> QuaternionIRGenerator::mkTable(std::shared_ptr<SymbolTable> previous)
     {
-        auto entry = lookupCurrentTbl(name);
-        if (!INVALID_SYMBOLTBL_ENTRY(entry)) // redefinition check
-            return false;
+        auto tbl = std::make_shared<SymbolTable>(previous);
+        _tables.push_back(tbl);
+        return tbl;
+    }
+
+    void QuaternionIRGenerator::changeTable(std::shared_ptr<SymbolTable> table)
+    {
+        _currentSymbolTable = table;
+    }
 
-        _currentSymbolTable->items.push_back(std::make_shared<SymbolTableItem>(name, type, _currentSymbolTable->totalWidth));
+    uint32_t QuaternionIRGenerator::enter(std::string name, std::string type, int width)
+    {
+        uint32_t symbol = _symbols.size();
+        _symbols.emplace_back(std::move(name), std::move(type), _currentSymbolTable->totalWidth, width);
+        _currentSymbolTable->items.push_back(symbol);
         _currentSymbolTable->totalWidth += width;
 
-        return true;
+        return symbol;
     }
 
-    void QuaternionIRGenerator::emit(QuaternionOperator op, std::shared_ptr<Arg> arg1, std::shared_ptr<Arg> arg2, std::shared_ptr<Arg> result)
+    void QuaternionIRGenerator::emit(QuaternionOperator op, Arg arg1, Arg arg2, Arg result)
     {
-        Quaternion code = {op, arg1, arg2, result};
-        _codes.push_back(code);
+        _codes.push_back({op, arg1, arg2, result});
     }
 
-    std::shared_ptr<QuaternionIRGenerator::SymbolTableItem> QuaternionIRGenerator::newtemp(std::string type, int width)
+    uint32_t QuaternionIRGenerator::newtemp(std::string type, int width)
     {
-        static int id = 0;
-        std::string name = "@T" + std::to_string(id);
-        id++;
-
-        if (!enter(name, type, width))
-        {
-            FATAL_ERROR("Internal error.");
-            return nullptr;
-        }
+        std::string name = "@T" + std::to_string(_numTemps);
+        _numTemps++;
 
-        return lookup(name);
+        return enter(name, type, width);
     }
 
-    bool QuaternionIRGenerator::registerFunc(std::string name, std::string type, int entry, bool isInitialized)
+    uint32_t QuaternionIRGenerator::newtemp(const AST::Type *type)
     {
-        for (auto &item : _functionTable)
-        {
-            if (item.name == name)
-                return false;
-        }
+        if (type->kind() == AST::Type::Kind::Float)
+            return newtemp(FLOAT, FLOAT_WIDTH);
 
-        _functionTable.push_back({name, type, entry, isInitialized});
-        return true;
+        return newtemp(INT, INT32_WIDTH);
     }
 
-    void QuaternionIRGenerator::printCode() const
+    void QuaternionIRGenerator::recycleTemps(size_t function)
     {
-        int id = 0;
-        std::string op;
-        std::string arg1;
-        std::string arg2;
-        std::string result;
-        for (auto &code : _codes)
+        auto &item = _functionTable[function];
+        auto isTemp = [this](uint32_t symbol)
+        { return _symbols[symbol].name.compare(0, 2, "@T") == 0; };
+
+        // the temps leave the tables, the items left are packed again
+        std::vector<uint32_t> temps;
+        std::unordered_map<uint32_t, uint32_t> tempIds; // symbol -> index into temps
+        for (size_t table = item.firstTable; table < item.endTable; table++)
         {
-            for (auto &item : _functionTable)
+            auto &items = _tables[table]->items;
+            std::vector<uint32_t> kept;
+            int offset = 0;
+            for (auto symbol : items)
             {
-                if (item.isInitialized && (id == item.entry))
-                    printf("%s:\n", item.name.c_str());
+                if (isTemp(symbol))
+                {
+                    tempIds.emplace(symbol, temps.size());
+                    temps.push_back(symbol);
+                    continue;
+                }
+                _symbols[symbol].offset = offset;
+                offset += _symbols[symbol].width;
+                kept.push_back(symbol);
             }
+            items = std::move(kept);
+            _tables[table]->totalWidth = offset;
+        }
+        if (temps.empty() || item.firstTable >= item.endTable)
+            return;
 
-            switch (code.op)
-            {
-#define BINARY_OPERATION(name, disc) \
-    case QuaternionOperator::name:   \
-        op = disc;                   \
-        break;
-#define UNARY_OPERATION(name, disc) BINARY_OPERATION(name, disc)
-#include "OperationType.inc"
-#undef UNARY_OPERATION
-#undef BINARY_OPERATION
-            case QuaternionOperator::DefineEqual:
-                op = ":=";
-                break;
-            case QuaternionOperator::Jnz:
-                op = "Jnz";
-                break;
-            case QuaternionOperator::J:
-                op = "J";
-                break;
-            case QuaternionOperator::Call:
-                op = "Call";
-                break;
-            case QuaternionOperator::Ret:
-                op = "Return";
-                break;
-            default:
-                op = "_";
-                break;
-            }
+        size_t begin = item.entry, end = item.exit;
+        auto tempOf = [&](const Arg &arg)
+        {
+            if (arg.type != ArgType::ENTRY)
+                return UINT32_MAX;
+            auto id = tempIds.find(arg.symbol);
+            return id == tempIds.end() ? UINT32_MAX : id->second;
+        };
+
+        // a live range is the hull of the codes touching the temp and the blocks it is live through,
+        // the Params of a call are read by the Call and the AsmInputs of an asm by the Asm
+        auto ranges = QuaternionOptimizer::liveRanges(_codes, begin, end, temps.size(), tempOf);
+        size_t call = end, asmAddr = end;
+        for (size_t addr = end; addr-- > begin;)
+        {
+            auto &code = _codes[addr];
+            if (code.op == QuaternionOperator::Call)
+                call = addr;
+            else if (code.op == QuaternionOperator::Asm)
+                asmAddr = addr;
+            else if (code.op != QuaternionOperator::Param && code.op != QuaternionOperator::AsmInput)
+                continue;
+
+            uint32_t temp = tempOf(code.arg1);
+            if (temp != UINT32_MAX)
+                ranges[temp].second = std::max(ranges[temp].second, static_cast<long>(code.op == QuaternionOperator::Param ? call : asmAddr));
+        }
 
-            switch (code.arg1->type())
-            {
-            case ArgType::NIL:
-                arg1 = "_";
-                break;
-            case ArgType::ENTRY:
-            {
-                auto pArg1 = std::dynamic_pointer_cast<SymbTblEntry>(code.arg1);
-                arg1 = pArg1->pEntry->name;
-                break;
-            }
-            case ArgType::VALUE:
+        // linear scan over the ranges, a slot is free again once the range holding it has ended,
+        // temps no code touches get none
+        std::vector<uint32_t> order;
+        for (uint32_t temp = 0; temp < temps.size(); temp++)
+            if (ranges[temp].second >= 0)
+                order.push_back(temp);
+        std::sort(order.begin(), order.end(), [&](uint32_t lhs, uint32_t rhs)
+                  { return ranges[lhs] < ranges[rhs]; });
+
+        auto &pool = *_tables[item.firstTable];
+        std::vector<int> slotOffsets;
+        std::unordered_map<int, std::vector<int>> freeSlots; // width -> slots
+        std::vector<std::pair<long, int>> active;            // end of the range holding a slot, the slot
+        std::vector<uint32_t> pooled;
+        for (auto temp : order)
+        {
+            for (size_t i = 0; i < active.size();)
             {
-                auto pArg1 = std::dynamic_pointer_cast<Value>(code.arg1);
-                if (pArg1->valueType == Value::ValueType::INTEGER)
-                    arg1 = std::to_string(pArg1->integerVal);
+                if (active[i].first < ranges[temp].first)
+                {
+                    int slot = active[i].second;
+                    freeSlots[_symbols[pooled[slot]].width].push_back(slot);
+                    active[i] = active.back();
+                    active.pop_back();
+                }
                 else
-                    arg1 = std::to_string(pArg1->floatVal);
-                break;
-            }
-            case ArgType::CODEADDR:
-            {
-                auto pArg1 = std::dynamic_pointer_cast<CodeAddr>(code.arg1);
-                arg1 = std::to_string(pArg1->codeAddr);
-                break;
-            }
+                    i++;
             }
 
-            switch (code.arg2->type())
-            {
-            case ArgType::NIL:
-                arg2 = "_";
-                break;
-            case ArgType::ENTRY:
-            {
-                auto pArg2 = std::dynamic_pointer_cast<SymbTblEntry>(code.arg2);
-                arg2 = pArg2->pEntry->name;
-                break;
-            }
-            case ArgType::VALUE:
+            auto &symbol = _symbols[temps[temp]];
+            auto &free = freeSlots[symbol.width];
+            int slot;
+            if (free.empty())
             {
-                auto pArg2 = std::dynamic_pointer_cast<Value>(code.arg2);
-                if (pArg2->valueType == Value::ValueType::INTEGER)
-                    arg2 = std::to_string(pArg2->integerVal);
-                else
-                    arg2 = std::to_string(pArg2->floatVal);
-                break;
+                slot = slotOffsets.size();
+                slotOffsets.push_back(pool.totalWidth);
+                pool.totalWidth += symbol.width;
+                pooled.push_back(temps[temp]);
             }
-            case ArgType::CODEADDR:
+            else
             {
-                auto pArg2 = std::dynamic_pointer_cast<CodeAddr>(code.arg2);
-                arg2 = std::to_string(pArg2->codeAddr);
-                break;
-            }
+                slot = free.back();
+                free.pop_back();
             }
 
-            switch (code.result->type())
-            {
-            case ArgType::NIL:
-                result = "_";
-                break;
-            case ArgType::ENTRY:
-            {
-                auto pResult = std::dynamic_pointer_cast<SymbTblEntry>(code.result);
-                result = pResult->pEntry->name;
-                break;
-            }
-            case ArgType::VALUE:
-            {
-                auto pResult = std::dynamic_pointer_cast<Value>(code.result);
-                if (pResult->valueType == Value::ValueType::INTEGER)
-                    result = std::to_string(pResult->integerVal);
-                else
-                    result = std::to_string(pResult->floatVal);
-                break;
-            }
-            case ArgType::CODEADDR:
-            {
-                auto pResult = std::dynamic_pointer_cast<CodeAddr>(code.result);
-                result = std::to_string(pResult->codeAddr);
-                break;
-            }
-            }
+            symbol.name = "@T" + std::to_string(slot);
+            symbol.offset = slotOffsets[slot];
+            active.emplace_back(ranges[temp].second, slot);
+            pool.items.push_back(temps[temp]);
+        }
+    }
+
+    uint32_t &QuaternionIRGenerator::place(const AST::ASTNode *node)
+    {
+        if (node->id() >= _places.size()) // grow to cover the whole AST at once, returned references stay valid
+            _places.resize(std::max<size_t>(node->id() + 1, AST::ASTContext::current()->numNodes()), NoSymbol);
 
-            printf("%4d: (%-10s, %-10s, %-10s, %-10s)\n", id, op.c_str(), arg1.c_str(), arg2.c_str(), result.c_str());
-            id++;
+        return _places[node->id()];
+    }
+
+    bool QuaternionIRGenerator::registerFunc(std::string name, std::string type, int entry, bool isInitialized)
+    {
+        if (!_functionIds.emplace(name, _functionTable.size()).second)
+            return false;
+
+        _functionTable.push_back({name, type, entry, entry, isInitialized});
+        return true;
+    }
+
+    std::string QuaternionIRGenerator::argToString(const Arg &arg) const
+    {
+        switch (arg.type)
+        {
+        case ArgType::CODEADDR:
+            return std::to_string(arg.codeAddr);
+        case ArgType::ENTRY:
+            return arg.symbol < _symbols.size() ? _symbols[arg.symbol].name : "_";
+        case ArgType::INTEGER:
+            return std::to_string(arg.integerVal);
+        case ArgType::FLOATING:
+            return std::to_string(arg.floatVal);
+        case ArgType::FUNCTION:
+            return arg.function < _functionTable.size() ? _functionTable[arg.function].name : "_";
+        case ArgType::STRING:
+            return arg.string < _strings.size() ? "\"" + _strings[arg.string] + "\"" : "_";
+        default:
+            return "_";
         }
     }
 
-    void QuaternionIRGenerator::dumpCode(const std::string outPath) const
+    void QuaternionIRGenerator::writeCode(std::ostream &os) const
     {
-        std::ofstream ofs(outPath);
-        int id = 0;
+        // entries of the function table are in code order, so labels are found in a single pass
+        auto item = _functionTable.begin();
         std::string op;
-        std::string arg1;
-        std::string arg2;
-        std::string result;
-        for (auto &code : _codes)
+        for (size_t id = 0; id < _codes.size(); id++)
         {
-            for (auto &item : _functionTable)
+            const Quaternion &code = _codes[id];
+            for (; item != _functionTable.end() && item->entry <= static_cast<int>(id); ++item)
             {
-                if (item.isInitialized && (id == item.entry))
-                    ofs << item.name << ":\n";
+                if (item->isInitialized && item->entry == static_cast<int>(id))
+                    os << item->name << ":\n";
             }
 
             switch (code.op)
@@ -632,106 +746,49 @@ namespace lcc
             case QuaternionOperator::J:
                 op = "J";
                 break;
+            case QuaternionOperator::Param:
+                op = "Param";
+                break;
             case QuaternionOperator::Call:
                 op = "Call";
                 break;
             case QuaternionOperator::Ret:
                 op = "Return";
                 break;
-            default:
-                op = "_";
-                break;
-            }
-
-            switch (code.arg1->type())
-            {
-            case ArgType::NIL:
-                arg1 = "_";
-                break;
-            case ArgType::ENTRY:
-            {
-                auto pArg1 = std::dynamic_pointer_cast<SymbTblEntry>(code.arg1);
-                arg1 = pArg1->pEntry->name;
+            case QuaternionOperator::Store:
+                op = "[]=";
                 break;
-            }
-            case ArgType::VALUE:
-            {
-                auto pArg1 = std::dynamic_pointer_cast<Value>(code.arg1);
-                if (pArg1->valueType == Value::ValueType::INTEGER)
-                    arg1 = std::to_string(pArg1->integerVal);
-                else
-                    arg1 = std::to_string(pArg1->floatVal);
+            case QuaternionOperator::AsmInput:
+                op = "AsmIn";
                 break;
-            }
-            case ArgType::CODEADDR:
-            {
-                auto pArg1 = std::dynamic_pointer_cast<CodeAddr>(code.arg1);
-                arg1 = std::to_string(pArg1->codeAddr);
+            case QuaternionOperator::AsmOutput:
+                op = "AsmOut";
                 break;
-            }
-            }
-
-            switch (code.arg2->type())
-            {
-            case ArgType::NIL:
-                arg2 = "_";
+            case QuaternionOperator::Asm:
+                op = "Asm";
                 break;
-            case ArgType::ENTRY:
-            {
-                auto pArg2 = std::dynamic_pointer_cast<SymbTblEntry>(code.arg2);
-                arg2 = pArg2->pEntry->name;
-                break;
-            }
-            case ArgType::VALUE:
-            {
-                auto pArg2 = std::dynamic_pointer_cast<Value>(code.arg2);
-                if (pArg2->valueType == Value::ValueType::INTEGER)
-                    arg2 = std::to_string(pArg2->integerVal);
-                else
-                    arg2 = std::to_string(pArg2->floatVal);
-                break;
-            }
-            case ArgType::CODEADDR:
-            {
-                auto pArg2 = std::dynamic_pointer_cast<CodeAddr>(code.arg2);
-                arg2 = std::to_string(pArg2->codeAddr);
+            default:
+                op = "_";
                 break;
             }
-            }
 
-            switch (code.result->type())
-            {
-            case ArgType::NIL:
-                result = "_";
-                break;
-            case ArgType::ENTRY:
-            {
-                auto pResult = std::dynamic_pointer_cast<SymbTblEntry>(code.result);
-                result = pResult->pEntry->name;
-                break;
-            }
-            case ArgType::VALUE:
-            {
-                auto pResult = std::dynamic_pointer_cast<Value>(code.result);
-                if (pResult->valueType == Value::ValueType::INTEGER)
-                    result = std::to_string(pResult->integerVal);
-                else
-                    result = std::to_string(pResult->floatVal);
-                break;
-            }
-            case ArgType::CODEADDR:
-            {
-                auto pResult = std::dynamic_pointer_cast<CodeAddr>(code.result);
-                result = std::to_string(pResult->codeAddr);
-                break;
-            }
-            }
-            char buf[256];
-            sprintf(buf, "%4d: (%-10s, %-10s, %-10s, %-10s)\n", id, op.c_str(), arg1.c_str(), arg2.c_str(), result.c_str());
-            ofs << buf;
-            id++;
+            os << std::right << std::setw(4) << id << ": (" << std::left
+               << std::setw(10) << op << ", "
+               << std::setw(10) << argToString(code.arg1) << ", "
+               << std::setw(10) << argToString(code.arg2) << ", "
+               << std::setw(10) << argToString(code.result) << ")\n";
         }
+    }
 
+    void QuaternionIRGenerator::printCode() const
+    {
+        writeCode(std::cout);
+    }
+
+    void QuaternionIRGenerator::dumpCode(const std::string outPath) const
+    {
+        std::ofstream ofs(outPath);
+        writeCode(ofs);
         ofs.close();
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,1919 @@
+#include "lcc.hpp"
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <map>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+
+#define MAX_ITERATIONS 8
+#define MAX_JUMP_HOPS 16
+#define MAX_INLINE_GROWTH 2
+
+namespace lcc
+{
+    std::unique_ptr<QuaternionOptimizer> QuaternionOptimizer::_inst;
+
+    namespace
+    {
+        // key of a constant, floats are compared by their bits so -0.0 and 0.0 stay apart
+        std::pair<bool, uint32_t> ConstantKey(const Constant &constant)
+        {
+            if (!constant.isFloat)
+                return {false, static_cast<uint32_t>(constant.intValue)};
+
+            uint32_t bits = 0;
+            std::memcpy(&bits, &constant.floatValue, sizeof(bits));
+            return {true, bits};
+        }
+
+        bool IsSameConstant(const Constant &lhs, const Constant &rhs)
+        {
+            return ConstantKey(lhs) == ConstantKey(rhs);
+        }
+    }
+
+    size_t QuaternionOptimizer::run(QuaternionIRGenerator *generator)
+    {
+        _generator = generator;
+        auto &codes = generator->_codes;
+        inlineCalls();
+        size_t numCodes = codes.size();
+
+        _isGlobal.assign(generator->_symbols.size(), false);
+        if (!generator->_tables.empty()) // the first table is the file scope
+        {
+            for (auto symbol : generator->_tables.front()->items)
+                _isGlobal[symbol] = true;
+        }
+        _isChar.assign(generator->_symbols.size(), false);
+        for (size_t symbol = 0; symbol < generator->_symbols.size(); symbol++)
+            _isChar[symbol] = generator->_symbols[symbol].type == "char";
+        _nameIds.assign(generator->_symbols.size(), NoSymbol);
+
+        for (int iteration = 0; iteration < MAX_ITERATIONS; iteration++)
+        {
+            _removed.assign(codes.size(), false);
+            bool changed = false;
+            for (auto &func : generator->_functionTable)
+            {
+                if (!func.isInitialized || func.entry >= func.exit)
+                    continue;
+
+                // passes only mark codes as removed, so the CFG stays valid until compact(), the
+                // edges a pass makes impossible only make the later analyses more conservative
+                CFG cfg = buildCFG(generator->_codes, func.entry, func.exit);
+                numberNames(cfg);
+                bool isChanged = removeUnreachable(cfg);
+                isChanged |= numberValues(cfg);
+                isChanged |= propagateConstants(cfg);
+                isChanged |= coalesceCopies(cfg);
+                isChanged |= eliminateDeadCode(cfg);
+                isChanged |= simplifyJumps(cfg);
+                if (!isChanged) // loops need dominators, so only an unchanged CFG will do
+                    isChanged = optimizeLoops(cfg);
+                changed |= isChanged;
+            }
+
+            compact();
+            if (!changed)
+                break;
+        }
+
+        eliminateDeadTemps();
+        return numCodes - codes.size();
+    }
+
+    void QuaternionOptimizer::inlineCalls()
+    {
+        auto &codes = _generator->_codes;
+        auto &functionTable = _generator->_functionTable;
+        _numInlined = 0;
+        size_t limit = Options::QuaternionInlineLimit;
+        if (limit == 0)
+            return;
+
+        // a leaf's copies have no calls left, so inlining stops after one round
+        std::vector<bool> isInlinable(functionTable.size(), false);
+        for (size_t id = 0; id < functionTable.size(); id++)
+        {
+            auto &func = functionTable[id];
+            // a return copied into the caller wouldn't narrow the value of a char function
+            if (!func.isInitialized || func.type == "char" || func.entry >= func.exit || static_cast<size_t>(func.exit - func.entry) > limit)
+                continue;
+            isInlinable[id] = std::none_of(codes.begin() + func.entry, codes.begin() + func.exit, [](const Quaternion &code)
+                                           { return code.op == QuaternionOperator::Call; });
+        }
+
+        // calls in address order with the function holding each
+        std::vector<std::pair<size_t, size_t>> calls;
+        size_t budget = codes.size() * (MAX_INLINE_GROWTH - 1);
+        for (size_t id = 0; id < functionTable.size(); id++)
+        {
+            auto &func = functionTable[id];
+            if (!func.isInitialized)
+                continue;
+            for (size_t addr = func.entry; addr < static_cast<size_t>(func.exit); addr++)
+            {
+                auto &code = codes[addr];
+                if (code.op != QuaternionOperator::Call || code.arg1.type != ArgType::FUNCTION || !isInlinable[code.arg1.function])
+                    continue;
+
+                auto &callee = functionTable[code.arg1.function];
+                size_t numArgs = callee.params.size();
+                if (code.arg2.type != ArgType::INTEGER || static_cast<size_t>(code.arg2.integerVal) != numArgs ||
+                    addr < func.entry + numArgs)
+                    continue;
+                bool hasParams = std::all_of(codes.begin() + addr - numArgs, codes.begin() + addr, [](const Quaternion &param)
+                                             { return param.op == QuaternionOperator::Param; });
+                size_t growth = callee.exit - callee.entry + 1; // at most, a return may become a copy and a jump
+                if (!hasParams || growth > budget)
+                    continue;
+
+                budget -= growth;
+                calls.emplace_back(id, addr);
+            }
+        }
+        if (calls.empty())
+            return;
+
+        // the Params and the Call of an inlined call all map to the start of the copy
+        std::vector<Quaternion> inlined;
+        inlined.reserve(codes.size() + codes.size() * (MAX_INLINE_GROWTH - 1) - budget);
+        std::vector<size_t> newAddr(codes.size() + 1);
+        std::vector<size_t> relocations; // jumps in inlined still naming old addresses
+        auto copyUntil = [&](size_t &addr, size_t end)
+        {
+            for (; addr < end; addr++)
+            {
+                newAddr[addr] = inlined.size();
+                if (codes[addr].op == QuaternionOperator::J || codes[addr].op == QuaternionOperator::Jnz)
+                    relocations.push_back(inlined.size());
+                inlined.push_back(codes[addr]);
+            }
+        };
+
+        size_t addr = 0;
+        for (auto [caller, call] : calls)
+        {
+            copyUntil(addr, call - codes[call].arg2.integerVal);
+            for (; addr <= call; addr++)
+                newAddr[addr] = inlined.size();
+            inlineCall(caller, call, inlined);
+            _numInlined++;
+        }
+        copyUntil(addr, codes.size());
+        newAddr[codes.size()] = inlined.size();
+
+        for (auto index : relocations)
+        {
+            auto &target = inlined[index].result;
+            if (target.type == ArgType::CODEADDR && target.codeAddr >= 0 && static_cast<size_t>(target.codeAddr) < newAddr.size())
+                target = Arg::addr(newAddr[target.codeAddr]);
+        }
+        for (auto &func : functionTable)
+        {
+            func.entry = newAddr[func.entry];
+            func.exit = newAddr[func.exit];
+        }
+        codes = std::move(inlined);
+    }
+
+    void QuaternionOptimizer::inlineCall(size_t caller, size_t addr, std::vector<Quaternion> &codes)
+    {
+        auto &oldCodes = _generator->_codes;
+        auto &symbols = _generator->_symbols;
+        const Quaternion &call = oldCodes[addr];
+        auto &callee = _generator->_functionTable[call.arg1.function];
+
+        auto previousTable = _generator->_currentSymbolTable;
+        _generator->changeTable(_generator->_tables[_generator->_functionTable[caller].firstTable]);
+        std::unordered_map<uint32_t, uint32_t> copies;
+        for (size_t table = callee.firstTable; table < callee.endTable; table++)
+        {
+            for (auto symbol : _generator->_tables[table]->items)
+            {
+                std::string name = symbols[symbol].name, type = symbols[symbol].type; // enter may move symbols
+                int width = symbols[symbol].width;
+                copies[symbol] = name.compare(0, 2, "@T") == 0 ? _generator->newtemp(type, width) : _generator->enter(name, type, width);
+            }
+        }
+        _generator->changeTable(previousTable);
+        auto copyOf = [&](Arg arg)
+        {
+            if (arg.type == ArgType::ENTRY)
+            {
+                auto copy = copies.find(arg.symbol);
+                if (copy != copies.end())
+                    arg.symbol = copy->second;
+            }
+            return arg;
+        };
+
+        size_t numArgs = callee.params.size();
+        for (size_t index = 0; index < numArgs; index++)
+            codes.push_back({QuaternionOperator::DefineEqual, oldCodes[addr - numArgs + index].arg1, Arg::nil(), Arg::entry(copies[callee.params[index]])});
+
+        // a return becomes a copy to the call's result and a jump past the body, falling off the end
+        // gives 0 like a call does
+        size_t entry = callee.entry, exit = callee.exit;
+        bool hasResult = call.result.type == ArgType::ENTRY;
+        std::vector<size_t> offsets(exit - entry + 1);
+        size_t size = 0;
+        for (size_t old = entry; old < exit; old++)
+        {
+            offsets[old - entry] = size;
+            const Quaternion &code = oldCodes[old];
+            if (code.op == QuaternionOperator::Ret)
+                size += (hasResult && code.result.type != ArgType::NIL) + (old + 1 < exit);
+            else
+                size++;
+        }
+        offsets[exit - entry] = size;
+        QuaternionOperator lastOp = oldCodes[exit - 1].op;
+        bool isFallingOff = hasResult && lastOp != QuaternionOperator::Ret && lastOp != QuaternionOperator::J;
+
+        size_t base = codes.size();
+        Arg end = Arg::addr(base + size + isFallingOff);
+        for (size_t old = entry; old < exit; old++)
+        {
+            const Quaternion &code = oldCodes[old];
+            if (code.op == QuaternionOperator::Ret)
+            {
+                if (hasResult && code.result.type != ArgType::NIL)
+                    codes.push_back({QuaternionOperator::DefineEqual, copyOf(code.result), Arg::nil(), call.result});
+                if (old + 1 < exit)
+                    codes.push_back({QuaternionOperator::J, Arg::nil(), Arg::nil(), end});
+                continue;
+            }
+
+            Quaternion copy = {code.op, copyOf(code.arg1), copyOf(code.arg2), copyOf(code.result)};
+            if ((code.op == QuaternionOperator::J || code.op == QuaternionOperator::Jnz) && code.result.type == ArgType::CODEADDR &&
+                code.result.codeAddr >= static_cast<int>(entry) && code.result.codeAddr <= static_cast<int>(exit))
+                copy.result = Arg::addr(base + offsets[code.result.codeAddr - entry]);
+            codes.push_back(copy);
+        }
+        if (isFallingOff)
+            codes.push_back({QuaternionOperator::DefineEqual, Arg::value(0), Arg::nil(), call.result});
+    }
+
+    void QuaternionOptimizer::solve(const CFG &cfg, DataflowProblem &problem)
+    {
+        size_t numBlocks = cfg.blocks.size();
+        unsigned width = problem.boundary.size();
+        problem.in.assign(numBlocks, llvm::BitVector(width));
+        problem.out.assign(numBlocks, llvm::BitVector(width));
+
+        std::vector<size_t> order = postOrder(cfg);
+        if (problem.isForward)
+            std::reverse(order.begin(), order.end());
+
+        llvm::BitVector meet(width), result(width); // reused, the vectors are as wide as the domain
+        bool changed = true;
+        while (changed)
+        {
+            changed = false;
+            for (size_t block : order)
+            {
+                const BasicBlock &bb = cfg.blocks[block];
+                meet.reset();
+                if (problem.isForward)
+                {
+                    if (block == 0)
+                        meet |= problem.boundary;
+                    for (size_t pred : bb.preds)
+                        meet |= problem.out[pred];
+                }
+                else
+                {
+                    if (bb.isExit)
+                        meet |= problem.boundary;
+                    for (size_t succ : bb.succs)
+                        meet |= problem.in[succ];
+                }
+
+                result = meet;
+                result.reset(problem.kill[block]);
+                result |= problem.gen[block];
+
+                auto &input = problem.isForward ? problem.in[block] : problem.out[block];
+                auto &output = problem.isForward ? problem.out[block] : problem.in[block];
+                input = meet;
+                if (result != output)
+                {
+                    output = result;
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    std::vector<size_t> QuaternionOptimizer::postOrder(const CFG &cfg)
+    {
+        size_t numBlocks = cfg.blocks.size();
+        std::vector<size_t> order;
+        std::vector<bool> isVisited(numBlocks, false);
+        std::vector<std::pair<size_t, size_t>> stack = {{0, 0}};
+        isVisited[0] = true;
+        while (!stack.empty())
+        {
+            auto &[block, next] = stack.back();
+            if (next < cfg.blocks[block].succs.size())
+            {
+                size_t succ = cfg.blocks[block].succs[next++];
+                if (!isVisited[succ])
+                {
+                    isVisited[succ] = true;
+                    stack.push_back({succ, 0});
+                }
+                continue;
+            }
+
+            order.push_back(block);
+            stack.pop_back();
+        }
+
+        return order;
+    }
+
+    QuaternionOptimizer::DominatorTree QuaternionOptimizer::dominators(const CFG &cfg)
+    {
+        std::vector<size_t> order = postOrder(cfg);
+        std::vector<size_t> postNumber(cfg.blocks.size(), 0);
+        for (size_t i = 0; i < order.size(); i++)
+            postNumber[order[i]] = i;
+
+        // the iterative algorithm of Cooper, Harvey and Kennedy
+        std::vector<size_t> idoms(cfg.blocks.size(), SIZE_MAX);
+        idoms[0] = 0;
+        auto intersect = [&](size_t lhs, size_t rhs)
+        {
+            while (lhs != rhs)
+            {
+                while (postNumber[lhs] < postNumber[rhs])
+                    lhs = idoms[lhs];
+                while (postNumber[rhs] < postNumber[lhs])
+                    rhs = idoms[rhs];
+            }
+            return lhs;
+        };
+
+        bool changed = true;
+        while (changed)
+        {
+            changed = false;
+            for (auto it = order.rbegin(); it != order.rend(); it++)
+            {
+                if (*it == 0)
+                    continue;
+
+                size_t idom = SIZE_MAX;
+                for (size_t pred : cfg.blocks[*it].preds)
+                {
+                    if (idoms[pred] != SIZE_MAX)
+                        idom = idom == SIZE_MAX ? pred : intersect(pred, idom);
+                }
+                if (idoms[*it] != idom)
+                {
+                    idoms[*it] = idom;
+                    changed = true;
+                }
+            }
+        }
+
+        // number the tree depth first, so a dominance query doesn't walk up the idoms
+        size_t numBlocks = cfg.blocks.size();
+        std::vector<std::vector<size_t>> children(numBlocks);
+        for (size_t block = 1; block < numBlocks; block++)
+        {
+            if (idoms[block] != SIZE_MAX)
+                children[idoms[block]].push_back(block);
+        }
+
+        DominatorTree tree{std::move(idoms), std::vector<size_t>(numBlocks, 0), std::vector<size_t>(numBlocks, 0)};
+        size_t number = 0;
+        std::vector<std::pair<size_t, size_t>> stack = {{0, 0}};
+        tree.enter[0] = number++;
+        while (!stack.empty())
+        {
+            auto &[block, next] = stack.back();
+            if (next < children[block].size())
+            {
+                size_t child = children[block][next++];
+                tree.enter[child] = number++;
+                stack.push_back({child, 0});
+                continue;
+            }
+
+            tree.leave[block] = number++;
+            stack.pop_back();
+        }
+
+        return tree;
+    }
+
+    std::vector<QuaternionOptimizer::Loop> QuaternionOptimizer::findLoops(const CFG &cfg, const DominatorTree &dominatorTree)
+    {
+        auto &idoms = dominatorTree.idoms;
+        size_t numBlocks = cfg.blocks.size();
+        std::vector<Loop> loops;
+        std::vector<size_t> loopOf(numBlocks, SIZE_MAX); // header -> index into loops
+        for (size_t block = 0; block < numBlocks; block++)
+        {
+            if (idoms[block] == SIZE_MAX)
+                continue;
+
+            for (size_t header : cfg.blocks[block].succs)
+            {
+                if (!dominatorTree.dominates(header, block)) // not a back edge
+                    continue;
+
+                if (loopOf[header] == SIZE_MAX)
+                {
+                    loopOf[header] = loops.size();
+                    loops.push_back({header, {header}, std::vector<bool>(numBlocks, false)});
+                    loops.back().contains[header] = true;
+                }
+
+                auto &loop = loops[loopOf[header]];
+                std::vector<size_t> worklist = {block};
+                while (!worklist.empty())
+                {
+                    size_t member = worklist.back();
+                    worklist.pop_back();
+                    if (loop.contains[member])
+                        continue;
+
+                    loop.contains[member] = true;
+                    loop.blocks.push_back(member);
+                    for (size_t pred : cfg.blocks[member].preds)
+                    {
+                        if (idoms[pred] != SIZE_MAX)
+                            worklist.push_back(pred);
+                    }
+                }
+            }
+        }
+
+        for (auto &loop : loops)
+            std::sort(loop.blocks.begin(), loop.blocks.end());
+        std::stable_sort(loops.begin(), loops.end(), [](const Loop &lhs, const Loop &rhs)
+                         { return lhs.blocks.size() < rhs.blocks.size(); });
+
+        return loops;
+    }
+
+    std::vector<std::pair<long, long>> QuaternionOptimizer::liveRanges(const std::vector<Quaternion> &codes, size_t begin, size_t end,
+                                                                        size_t numIds, const std::function<uint32_t(const Arg &)> &idOf)
+    {
+        std::vector<std::pair<long, long>> ranges(numIds, {LONG_MAX, LONG_MIN});
+        auto extend = [&ranges](uint32_t id, size_t addr)
+        {
+            if (id == UINT32_MAX)
+                return;
+            ranges[id].first = std::min(ranges[id].first, static_cast<long>(addr));
+            ranges[id].second = std::max(ranges[id].second, static_cast<long>(addr));
+        };
+        if (begin >= end)
+            return ranges;
+
+        // a symbol every block writes before reading it lives within the hull of its touches,
+        // the others get dense ids for the dataflow
+        CFG cfg = buildCFG(codes, begin, end);
+        std::vector<size_t> writtenIn(numIds, SIZE_MAX); // id -> last block writing it
+        std::vector<uint32_t> crossingIds(numIds, UINT32_MAX);
+        std::vector<uint32_t> crossing; // dense id -> id
+        std::vector<const Arg *> reads, writes;
+        for (size_t block = 0; block < cfg.blocks.size(); block++)
+        {
+            for (size_t addr = cfg.blocks[block].begin; addr < cfg.blocks[block].end; addr++)
+            {
+                const Quaternion &code = codes[addr];
+                extend(idOf(code.arg1), addr);
+                extend(idOf(code.arg2), addr);
+                extend(idOf(code.result), addr);
+
+                accessedOperands(code, reads, writes);
+                for (const Arg *arg : reads)
+                {
+                    uint32_t id = idOf(*arg);
+                    if (id != UINT32_MAX && writtenIn[id] != block && crossingIds[id] == UINT32_MAX)
+                    {
+                        crossingIds[id] = crossing.size();
+                        crossing.push_back(id);
+                    }
+                }
+                for (const Arg *arg : writes)
+                {
+                    uint32_t id = idOf(*arg);
+                    if (id != UINT32_MAX)
+                        writtenIn[id] = block;
+                }
+            }
+        }
+        if (crossing.empty())
+            return ranges;
+
+        size_t numBlocks = cfg.blocks.size();
+        DataflowProblem problem{false, std::vector<llvm::BitVector>(numBlocks, llvm::BitVector(crossing.size())),
+                                std::vector<llvm::BitVector>(numBlocks, llvm::BitVector(crossing.size())),
+                                llvm::BitVector(crossing.size()), {}, {}};
+        auto crossingOf = [&](const Arg &arg)
+        {
+            uint32_t id = idOf(arg);
+            return id == UINT32_MAX ? UINT32_MAX : crossingIds[id];
+        };
+        for (size_t block = 0; block < numBlocks; block++)
+        {
+            for (size_t addr = cfg.blocks[block].begin; addr < cfg.blocks[block].end; addr++)
+            {
+                accessedOperands(codes[addr], reads, writes);
+                for (const Arg *arg : reads)
+                {
+                    uint32_t id = crossingOf(*arg);
+                    if (id != UINT32_MAX && !problem.kill[block].test(id))
+                        problem.gen[block].set(id);
+                }
+                for (const Arg *arg : writes)
+                {
+                    uint32_t id = crossingOf(*arg);
+                    if (id != UINT32_MAX)
+                        problem.kill[block].set(id);
+                }
+            }
+        }
+
+        solve(cfg, problem);
+        for (size_t block = 0; block < numBlocks; block++)
+        {
+            for (auto id : problem.in[block].set_bits())
+                extend(crossing[id], cfg.blocks[block].begin);
+            for (auto id : problem.out[block].set_bits())
+                extend(crossing[id], cfg.blocks[block].end - 1);
+        }
+
+        return ranges;
+    }
+
+    QuaternionOptimizer::CFG QuaternionOptimizer::buildCFG(const std::vector<Quaternion> &codes, size_t begin, size_t end)
+    {
+        CFG cfg{begin, end, {}};
+
+        std::vector<bool> isLeader(end - begin, false);
+        isLeader[0] = true;
+        for (size_t i = begin; i < end; i++)
+        {
+            QuaternionOperator op = codes[i].op;
+            if (op != QuaternionOperator::J && op != QuaternionOperator::Jnz && op != QuaternionOperator::Ret)
+                continue;
+
+            if (op != QuaternionOperator::Ret)
+            {
+                size_t target = codes[i].result.codeAddr;
+                if (target >= begin && target < end)
+                    isLeader[target - begin] = true;
+            }
+            if (i + 1 < end)
+                isLeader[i + 1 - begin] = true;
+        }
+
+        std::vector<size_t> blockOf(end - begin);
+        for (size_t i = begin; i < end; i++)
+        {
+            if (isLeader[i - begin])
+                cfg.blocks.push_back({i, i + 1, {}, {}, false});
+            else
+                cfg.blocks.back().end = i + 1;
+            blockOf[i - begin] = cfg.blocks.size() - 1;
+        }
+
+        auto addEdge = [&cfg](size_t from, size_t to)
+        {
+            auto &succs = cfg.blocks[from].succs;
+            if (std::find(succs.begin(), succs.end(), to) != succs.end())
+                return;
+            succs.push_back(to);
+            cfg.blocks[to].preds.push_back(from);
+        };
+
+        for (size_t block = 0; block < cfg.blocks.size(); block++)
+        {
+            const Quaternion &last = codes[cfg.blocks[block].end - 1];
+            bool fallsThrough = last.op != QuaternionOperator::J && last.op != QuaternionOperator::Ret;
+            if (last.op == QuaternionOperator::J || last.op == QuaternionOperator::Jnz)
+            {
+                size_t target = last.result.codeAddr;
+                if (target >= begin && target < end)
+                    addEdge(block, blockOf[target - begin]);
+                else
+                    cfg.blocks[block].isExit = true;
+            }
+            else if (last.op == QuaternionOperator::Ret)
+                cfg.blocks[block].isExit = true;
+
+            if (fallsThrough)
+            {
+                if (block + 1 < cfg.blocks.size())
+                    addEdge(block, block + 1);
+                else
+                    cfg.blocks[block].isExit = true;
+            }
+        }
+
+        return cfg;
+    }
+
+    void QuaternionOptimizer::numberNames(const CFG &cfg)
+    {
+        auto &codes = _generator->_codes;
+        for (auto symbol : _names)
+            _nameIds[symbol] = NoSymbol;
+        _names.clear();
+        _globals.clear();
+
+        auto addName = [this](uint32_t symbol)
+        {
+            if (_nameIds[symbol] != NoSymbol)
+                return;
+            _nameIds[symbol] = _names.size();
+            _names.push_back(symbol);
+            if (_isGlobal[symbol])
+                _globals.push_back(_nameIds[symbol]);
+        };
+
+        std::vector<uint32_t> symbols;
+        std::unordered_set<uint32_t> defined;
+        for (auto &bb : cfg.blocks)
+        {
+            defined.clear();
+            for (size_t i = bb.begin; i < bb.end; i++)
+            {
+                symbols.clear();
+                usedSymbols(codes[i], symbols);
+                for (auto symbol : symbols)
+                {
+                    if (_isGlobal[symbol] || !defined.count(symbol))
+                        addName(symbol); // read before written in this block
+                }
+
+                symbols.clear();
+                definedSymbols(codes[i], symbols);
+                for (auto symbol : symbols)
+                {
+                    if (_isGlobal[symbol])
+                        addName(symbol); // live at the exit
+                    defined.insert(symbol);
+                }
+            }
+        }
+    }
+
+    QuaternionOptimizer::DataflowProblem QuaternionOptimizer::liveness(const CFG &cfg) const
+    {
+        auto &codes = _generator->_codes;
+        unsigned width = _names.size();
+        DataflowProblem problem{false, {}, {}, llvm::BitVector(width), {}, {}};
+        for (auto global : _globals) // the caller may read any global
+            problem.boundary.set(global);
+
+        std::vector<uint32_t> symbols;
+        for (auto &bb : cfg.blocks)
+        {
+            llvm::BitVector gen(width), kill(width);
+            for (size_t i = bb.begin; i < bb.end; i++)
+            {
+                if (_removed[i])
+                    continue;
+
+                const Quaternion &code = codes[i];
+                symbols.clear();
+                usedSymbols(code, symbols);
+                for (auto symbol : symbols)
+                {
+                    uint32_t id = _nameIds[symbol];
+                    if (id != NoSymbol && !kill.test(id))
+                        gen.set(id);
+                }
+                if (code.op == QuaternionOperator::Call || code.op == QuaternionOperator::Ret)
+                {
+                    for (auto global : _globals)
+                    {
+                        if (!kill.test(global))
+                            gen.set(global);
+                    }
+                }
+
+                symbols.clear();
+                definedSymbols(code, symbols);
+                for (auto symbol : symbols)
+                {
+                    uint32_t id = _nameIds[symbol];
+                    if (id != NoSymbol)
+                        kill.set(id);
+                }
+            }
+
+            problem.gen.push_back(std::move(gen));
+            problem.kill.push_back(std::move(kill));
+        }
+
+        solve(cfg, problem);
+        return problem;
+    }
+
+    bool QuaternionOptimizer::removeUnreachable(const CFG &cfg)
+    {
+        std::vector<bool> isReachable(cfg.blocks.size(), false);
+        std::vector<size_t> worklist = {0};
+        isReachable[0] = true;
+        while (!worklist.empty())
+        {
+            size_t block = worklist.back();
+            worklist.pop_back();
+            for (size_t succ : cfg.blocks[block].succs)
+            {
+                if (!isReachable[succ])
+                {
+                    isReachable[succ] = true;
+                    worklist.push_back(succ);
+                }
+            }
+        }
+
+        bool changed = false;
+        for (size_t block = 0; block < cfg.blocks.size(); block++)
+        {
+            if (isReachable[block])
+                continue;
+
+            for (size_t i = cfg.blocks[block].begin; i < cfg.blocks[block].end; i++)
+                _removed[i] = true;
+            changed = true;
+        }
+
+        return changed;
+    }
+
+    bool QuaternionOptimizer::numberValues(const CFG &cfg)
+    {
+        auto &codes = _generator->_codes;
+        bool changed = false;
+
+        std::unordered_map<uint32_t, uint32_t> vnOf; // symbol -> value number
+        std::vector<std::optional<Constant>> constantOf; // value number -> its value when known
+        std::vector<uint32_t> holderOf; // value number -> a symbol that held it
+        std::map<std::pair<bool, uint32_t>, uint32_t> constantVns;
+        std::map<std::tuple<int, uint32_t, uint32_t>, uint32_t> exprVns;
+        std::vector<uint32_t> globals; // globals with a value number, a call clobbers them
+
+        auto newVn = [&](std::optional<Constant> constant, uint32_t holder)
+        {
+            constantOf.push_back(constant);
+            holderOf.push_back(holder);
+            return static_cast<uint32_t>(constantOf.size() - 1);
+        };
+        auto constantVn = [&](const Constant &constant)
+        {
+            auto key = ConstantKey(constant);
+            auto it = constantVns.find(key);
+            if (it != constantVns.end())
+                return it->second;
+            return constantVns[key] = newVn(constant, NoSymbol);
+        };
+        auto assign = [&](uint32_t symbol, uint32_t vn)
+        {
+            if (_isGlobal[symbol] && !vnOf.count(symbol))
+                globals.push_back(symbol);
+            vnOf[symbol] = vn;
+
+            uint32_t holder = holderOf[vn];
+            if (holder == NoSymbol || vnOf[holder] != vn)
+                holderOf[vn] = symbol;
+        };
+        auto vnOfArg = [&](const Arg &arg)
+        {
+            if (auto constant = toConstant(arg))
+                return constantVn(*constant);
+            if (!isSymbol(arg))
+                return newVn(std::nullopt, NoSymbol); // an unknown value, e.g. an array element
+
+            auto it = vnOf.find(arg.symbol);
+            if (it != vnOf.end())
+                return it->second;
+
+            uint32_t vn = newVn(std::nullopt, arg.symbol);
+            assign(arg.symbol, vn);
+            return vn;
+        };
+        auto exprVn = [&](QuaternionOperator op, uint32_t lhs, uint32_t rhs, bool &isNew)
+        {
+            if (isCommutative(op) && lhs > rhs)
+                std::swap(lhs, rhs);
+
+            auto key = std::make_tuple(static_cast<int>(op), lhs, rhs);
+            auto it = exprVns.find(key);
+            isNew = it == exprVns.end();
+            if (!isNew)
+                return it->second;
+            return exprVns[key] = newVn(std::nullopt, NoSymbol);
+        };
+        // the value number dest holds after vn is stored to it, a char holds a narrowed copy
+        auto storedVn = [&](const Arg &dest, uint32_t vn)
+        {
+            if (!_isChar[dest.symbol])
+                return vn;
+            if (auto value = storedValue(dest, constantOf[vn]))
+                return constantVn(*value);
+            return newVn(std::nullopt, dest.symbol);
+        };
+        // a symbol other than exclude that holds vn now
+        auto holderOfVn = [&](uint32_t vn, uint32_t exclude)
+        {
+            uint32_t holder = holderOf[vn];
+            if (holder == NoSymbol || holder == exclude || vnOf[holder] != vn)
+                return NoSymbol;
+            return holder;
+        };
+
+        std::vector<Arg *> operands;
+        for (auto &bb : cfg.blocks)
+        {
+            vnOf.clear();
+            constantOf.clear();
+            holderOf.clear();
+            constantVns.clear();
+            exprVns.clear();
+            globals.clear();
+
+            for (size_t i = bb.begin; i < bb.end; i++)
+            {
+                if (_removed[i])
+                    continue;
+
+                Quaternion &code = codes[i];
+
+                // constant and copy propagation
+                operands.clear();
+                valueOperands(code, operands);
+                for (Arg *operand : operands)
+                {
+                    if (!isSymbol(*operand))
+                        continue;
+
+                    uint32_t vn = vnOfArg(*operand);
+                    uint32_t holder = holderOfVn(vn, operand->symbol);
+                    if (constantOf[vn])
+                        *operand = toArg(*constantOf[vn]);
+                    else if (holder != NoSymbol)
+                        *operand = Arg::entry(holder);
+                    else
+                        continue;
+                    changed = true;
+                }
+
+                QuaternionOperator op = code.op;
+                Arg *lvalue = target(code);
+                bool hasResult = isSymbol(code.result) && op != QuaternionOperator::Ret && op != QuaternionOperator::Store;
+                if (op == QuaternionOperator::DefineEqual)
+                {
+                    uint32_t vn = vnOfArg(code.arg1);
+                    if (hasResult)
+                        assign(code.result.symbol, storedVn(code.result, vn));
+                }
+                else if (isPureBinary(op) || isPureUnary(op))
+                {
+                    auto lhs = toConstant(code.arg1), rhs = toConstant(code.arg2);
+                    Constant value;
+                    bool isFolded = isPureBinary(op) ? lhs && rhs && fold(op, *lhs, *rhs, value)
+                                                     : lhs && foldUnary(op, *lhs, value);
+                    if (isFolded)
+                    {
+                        code = {QuaternionOperator::DefineEqual, toArg(value), Arg::nil(), code.result};
+                        if (hasResult)
+                            assign(code.result.symbol, storedVn(code.result, constantVn(value)));
+                        changed = true;
+                        continue;
+                    }
+
+                    bool isNew = false;
+                    uint32_t vn = exprVn(op, vnOfArg(code.arg1), isPureBinary(op) ? vnOfArg(code.arg2) : NoSymbol, isNew);
+                    uint32_t holder = isNew ? NoSymbol : holderOfVn(vn, hasResult ? code.result.symbol : NoSymbol);
+                    if (holder != NoSymbol) // computed already, reuse it
+                    {
+                        code = {QuaternionOperator::DefineEqual, Arg::entry(holder), Arg::nil(), code.result};
+                        changed = true;
+                    }
+                    if (hasResult)
+                        assign(code.result.symbol, storedVn(code.result, vn));
+                }
+                else if (op == QuaternionOperator::Assign)
+                {
+                    // the value of an assignment is the one left in the variable
+                    uint32_t vn = vnOfArg(code.arg2);
+                    if (isSymbol(*lvalue))
+                    {
+                        vn = storedVn(*lvalue, vn);
+                        assign(lvalue->symbol, vn);
+                    }
+                    if (hasResult)
+                        assign(code.result.symbol, vn);
+                }
+                else if (lvalue != nullptr && isSymbol(*lvalue)) // compound assignments, increments and decrements
+                {
+                    QuaternionOperator base = baseOperator(op);
+                    uint32_t oldVn = vnOfArg(*lvalue);
+                    Arg rhs = isIncDec(op) ? Arg::value(1) : code.arg2;
+                    uint32_t newVn = 0;
+                    auto lhsValue = constantOf[oldVn], rhsValue = toConstant(rhs);
+                    Constant value;
+                    if (lhsValue && rhsValue && fold(base, *lhsValue, *rhsValue, value))
+                    {
+                        newVn = storedVn(*lvalue, constantVn(value));
+                        if (op != QuaternionOperator::PostInc && op != QuaternionOperator::PostDec)
+                        {
+                            code = {QuaternionOperator::Assign, *lvalue, toArg(value), code.result};
+                            changed = true;
+                        }
+                    }
+                    else
+                    {
+                        bool isNew = false;
+                        newVn = storedVn(*lvalue, exprVn(base, oldVn, vnOfArg(rhs), isNew));
+                    }
+
+                    uint32_t symbol = code.arg1.symbol;
+                    assign(symbol, newVn);
+                    if (hasResult)
+                        assign(code.result.symbol, op == QuaternionOperator::PostInc || op == QuaternionOperator::PostDec ? oldVn : newVn);
+                }
+                else if (op == QuaternionOperator::Jnz)
+                {
+                    if (auto condition = toConstant(code.arg1))
+                    {
+                        if (condition->isTrue())
+                            code = {QuaternionOperator::J, Arg::nil(), Arg::nil(), code.result};
+                        else
+                            _removed[i] = true;
+                        changed = true;
+                    }
+                }
+                else
+                {
+                    if (op == QuaternionOperator::Call)
+                    {
+                        for (auto global : globals)
+                            assign(global, newVn(std::nullopt, global));
+                    }
+                    if (hasResult)
+                        assign(code.result.symbol, newVn(std::nullopt, code.result.symbol));
+                }
+            }
+        }
+
+        return changed;
+    }
+
+    bool QuaternionOptimizer::propagateConstants(const CFG &cfg)
+    {
+        auto &codes = _generator->_codes;
+        size_t numNames = _names.size();
+        if (numNames == 0)
+            return false;
+
+        // only names with a constant definition somewhere may fold
+        auto constantDef = [this](const Quaternion &code)
+        {
+            if (code.op == QuaternionOperator::DefineEqual)
+                return storedValue(code.result, toConstant(code.arg1));
+            if (code.op == QuaternionOperator::Assign)
+                return storedValue(code.arg1, toConstant(code.arg2));
+            return std::optional<Constant>();
+        };
+
+        std::vector<uint32_t> symbols;
+        std::vector<bool> isTracked(numNames, false);
+        bool hasTracked = false;
+        for (size_t i = cfg.begin; i < cfg.end; i++)
+        {
+            if (_removed[i] || !constantDef(codes[i]))
+                continue;
+
+            symbols.clear();
+            definedSymbols(codes[i], symbols);
+            for (auto symbol : symbols)
+            {
+                if (_nameIds[symbol] != NoSymbol)
+                {
+                    isTracked[_nameIds[symbol]] = true;
+                    hasTracked = true;
+                }
+            }
+        }
+        if (!hasTracked)
+            return false;
+
+        // definitions of tracked names, every one has an unknown one at the entry and a call may
+        // define any global
+        std::vector<std::optional<Constant>> defValues;
+        std::vector<std::vector<uint32_t>> defsOf(numNames);
+        for (uint32_t id = 0; id < numNames; id++)
+        {
+            if (!isTracked[id])
+                continue;
+            defsOf[id].push_back(defValues.size());
+            defValues.push_back(std::nullopt);
+        }
+
+        typedef struct
+        {
+            uint32_t lastDef; // definite definition
+            std::vector<uint32_t> mayDefs; // following lastDef
+        } BlockDefs;
+
+        std::vector<std::unordered_map<uint32_t, BlockDefs>> blockDefs(cfg.blocks.size());
+        for (size_t block = 0; block < cfg.blocks.size(); block++)
+        {
+            auto &bb = cfg.blocks[block];
+            for (size_t i = bb.begin; i < bb.end; i++)
+            {
+                if (_removed[i])
+                    continue;
+
+                const Quaternion &code = codes[i];
+                symbols.clear();
+                definedSymbols(code, symbols);
+                for (auto symbol : symbols)
+                {
+                    uint32_t id = _nameIds[symbol];
+                    if (id == NoSymbol || !isTracked[id])
+                        continue;
+
+                    defsOf[id].push_back(defValues.size());
+                    blockDefs[block][id] = {static_cast<uint32_t>(defValues.size()), {}};
+                    defValues.push_back(constantDef(code));
+                }
+
+                if (code.op == QuaternionOperator::Call)
+                {
+                    for (auto global : _globals)
+                    {
+                        if (!isTracked[global])
+                            continue;
+                        defsOf[global].push_back(defValues.size());
+                        auto it = blockDefs[block].find(global);
+                        if (it == blockDefs[block].end())
+                            blockDefs[block][global] = {NoSymbol, {static_cast<uint32_t>(defValues.size())}};
+                        else
+                            it->second.mayDefs.push_back(defValues.size());
+                        defValues.push_back(std::nullopt);
+                    }
+                }
+            }
+        }
+
+        unsigned width = defValues.size();
+        DataflowProblem problem{true, {}, {}, llvm::BitVector(width), {}, {}};
+        for (uint32_t id = 0; id < numNames; id++)
+        {
+            if (isTracked[id])
+                problem.boundary.set(defsOf[id].front());
+        }
+
+        for (size_t block = 0; block < cfg.blocks.size(); block++)
+        {
+            llvm::BitVector gen(width), kill(width);
+            for (auto &[id, defs] : blockDefs[block])
+            {
+                if (defs.lastDef != NoSymbol)
+                {
+                    for (auto def : defsOf[id])
+                        kill.set(def);
+                    gen.set(defs.lastDef);
+                }
+                for (auto def : defs.mayDefs)
+                    gen.set(def);
+            }
+
+            problem.gen.push_back(std::move(gen));
+            problem.kill.push_back(std::move(kill));
+        }
+
+        solve(cfg, problem);
+
+        // a read of a name not yet written in its block is replaced when every definition reaching
+        // it stores the same constant
+        bool changed = false;
+        std::vector<Arg *> operands;
+        std::unordered_map<uint32_t, std::optional<Constant>> entryValues;
+        std::unordered_set<uint32_t> defined;
+        for (size_t block = 0; block < cfg.blocks.size(); block++)
+        {
+            auto &bb = cfg.blocks[block];
+            const llvm::BitVector &in = problem.in[block];
+            entryValues.clear();
+            defined.clear();
+
+            auto entryValue = [&](uint32_t id)
+            {
+                auto it = entryValues.find(id);
+                if (it != entryValues.end())
+                    return it->second;
+
+                std::optional<Constant> value;
+                bool isFirst = true;
+                for (auto def : defsOf[id])
+                {
+                    if (!in.test(def))
+                        continue;
+                    if (!defValues[def] || (!isFirst && !IsSameConstant(*value, *defValues[def])))
+                    {
+                        value = std::nullopt;
+                        break;
+                    }
+                    value = defValues[def];
+                    isFirst = false;
+                }
+                return entryValues[id] = value;
+            };
+
+            for (size_t i = bb.begin; i < bb.end; i++)
+            {
+                if (_removed[i])
+                    continue;
+
+                Quaternion &code = codes[i];
+                operands.clear();
+                valueOperands(code, operands);
+                for (Arg *operand : operands)
+                {
+                    if (!isSymbol(*operand))
+                        continue;
+
+                    uint32_t id = _nameIds[operand->symbol];
+                    if (id == NoSymbol || !isTracked[id] || defined.count(id))
+                        continue;
+
+                    if (auto value = entryValue(id))
+                    {
+                        *operand = toArg(*value);
+                        changed = true;
+                    }
+                }
+
+                symbols.clear();
+                definedSymbols(code, symbols);
+                for (auto symbol : symbols)
+                {
+                    if (_nameIds[symbol] != NoSymbol)
+                        defined.insert(_nameIds[symbol]);
+                }
+                if (code.op == QuaternionOperator::Call)
+                    defined.insert(_globals.begin(), _globals.end());
+            }
+        }
+
+        return changed;
+    }
+
+    bool QuaternionOptimizer::coalesceCopies(const CFG &cfg)
+    {
+        auto &codes = _generator->_codes;
+        bool changed = false;
+
+        std::unordered_map<uint32_t, size_t> numUses;
+        std::unordered_map<uint32_t, size_t> defAt; // symbol -> the pure code that last wrote it
+        std::unordered_map<uint32_t, size_t> accessAt; // symbol -> the code that last read or wrote it
+        std::vector<uint32_t> symbols;
+        for (auto &bb : cfg.blocks)
+        {
+            numUses.clear();
+            defAt.clear();
+            accessAt.clear();
+            for (size_t i = bb.begin; i < bb.end; i++)
+            {
+                if (_removed[i])
+                    continue;
+
+                symbols.clear();
+                usedSymbols(codes[i], symbols);
+                for (auto symbol : symbols)
+                    numUses[symbol]++;
+            }
+
+            size_t lastCallAt = bb.begin;
+            bool hasCall = false;
+            for (size_t i = bb.begin; i < bb.end; i++)
+            {
+                if (_removed[i])
+                    continue;
+
+                Quaternion &code = codes[i];
+                if (code.op == QuaternionOperator::DefineEqual && isSymbol(code.arg1) && isSymbol(code.result))
+                {
+                    // a symbol without a name id is never read outside its block
+                    uint32_t temp = code.arg1.symbol, symbol = code.result.symbol;
+                    auto def = defAt.find(temp);
+                    // a char temp can't hand its write to a wider symbol, the narrowing would be lost
+                    if (_nameIds[temp] == NoSymbol && numUses[temp] == 1 && temp != symbol && def != defAt.end() && (!_isChar[temp] || _isChar[symbol]))
+                    {
+                        // the write to symbol moves up to def, nothing in between may see the difference
+                        size_t j = def->second;
+                        auto access = accessAt.find(symbol);
+                        if ((access == accessAt.end() || access->second <= j) && (!_isGlobal[symbol] || !hasCall || lastCallAt < j))
+                        {
+                            codes[j].result = code.result;
+                            _removed[i] = true;
+                            defAt.erase(temp);
+                            defAt[symbol] = j;
+                            accessAt[symbol] = j;
+                            changed = true;
+                            continue;
+                        }
+                    }
+                }
+
+                symbols.clear();
+                usedSymbols(code, symbols);
+                definedSymbols(code, symbols);
+                for (auto symbol : symbols)
+                {
+                    accessAt[symbol] = i;
+                    defAt.erase(symbol);
+                }
+
+                bool isPure = code.op == QuaternionOperator::DefineEqual || code.op == QuaternionOperator::Subscript || isPureBinary(code.op) || isPureUnary(code.op);
+                if (isPure && isSymbol(code.result))
+                    defAt[code.result.symbol] = i;
+                if (code.op == QuaternionOperator::Call)
+                {
+                    lastCallAt = i;
+                    hasCall = true;
+                }
+            }
+        }
+
+        return changed;
+    }
+
+    bool QuaternionOptimizer::eliminateDeadCode(const CFG &cfg)
+    {
+        auto &codes = _generator->_codes;
+        DataflowProblem live = liveness(cfg);
+        bool changed = false;
+
+        std::vector<uint32_t> symbols;
+        for (size_t block = 0; block < cfg.blocks.size(); block++)
+        {
+            auto &bb = cfg.blocks[block];
+            llvm::BitVector liveNames = live.out[block];
+            std::unordered_set<uint32_t> liveLocals;
+
+            auto isLive = [&](uint32_t symbol)
+            {
+                uint32_t id = _nameIds[symbol];
+                return id != NoSymbol ? liveNames.test(id) : liveLocals.count(symbol) != 0;
+            };
+            auto setLive = [&](uint32_t symbol, bool isLive)
+            {
+                uint32_t id = _nameIds[symbol];
+                if (id != NoSymbol)
+                    liveNames[id] = isLive;
+                else if (isLive)
+                    liveLocals.insert(symbol);
+                else
+                    liveLocals.erase(symbol);
+            };
+
+            for (size_t i = bb.end; i-- > bb.begin;)
+            {
+                if (_removed[i])
+                    continue;
+
+                Quaternion &code = codes[i];
+                Arg *lvalue = target(code);
+                if (lvalue != nullptr && isSymbol(*lvalue))
+                {
+                    bool isTargetLive = isLive(lvalue->symbol);
+                    bool hasResult = isSymbol(code.result);
+                    bool isResultLive = hasResult && isLive(code.result.symbol);
+                    if (!isTargetLive && !isResultLive)
+                    {
+                        _removed[i] = true;
+                        changed = true;
+                        continue;
+                    }
+
+                    if (hasResult && !isResultLive) // the value of the expression is unused
+                    {
+                        if (code.op == QuaternionOperator::Assign)
+                            code = {QuaternionOperator::DefineEqual, code.arg2, Arg::nil(), *lvalue};
+                        else
+                            code.result = Arg::nil();
+                        changed = true;
+                    }
+                    else if (!isTargetLive) // only the value of the expression is used
+                    {
+                        QuaternionOperator op = code.op;
+                        if (op == QuaternionOperator::Assign)
+                            code = {QuaternionOperator::DefineEqual, code.arg2, Arg::nil(), code.result};
+                        else if (op == QuaternionOperator::PostInc || op == QuaternionOperator::PostDec)
+                            code = {QuaternionOperator::DefineEqual, *lvalue, Arg::nil(), code.result};
+                        else if (isIncDec(op))
+                            code = {baseOperator(op), *lvalue, Arg::value(1), code.result};
+                        else
+                            code = {baseOperator(op), *lvalue, code.arg2, code.result};
+                        changed = true;
+                    }
+                }
+                else if (!hasSideEffects(code))
+                {
+                    symbols.clear();
+                    definedSymbols(code, symbols);
+                    if (std::none_of(symbols.begin(), symbols.end(), isLive))
+                    {
+                        _removed[i] = true;
+                        changed = true;
+                        continue;
+                    }
+                }
+
+                symbols.clear();
+                definedSymbols(code, symbols);
+                for (auto symbol : symbols)
+                    setLive(symbol, false);
+
+                symbols.clear();
+                usedSymbols(code, symbols);
+                for (auto symbol : symbols)
+                    setLive(symbol, true);
+                if (code.op == QuaternionOperator::Call || code.op == QuaternionOperator::Ret)
+                {
+                    for (auto global : _globals)
+                        liveNames.set(global);
+                }
+            }
+        }
+
+        return changed;
+    }
+
+    bool QuaternionOptimizer::simplifyJumps(const CFG &cfg)
+    {
+        auto &codes = _generator->_codes;
+        auto nextCode = [&](size_t addr)
+        {
+            while (addr < cfg.end && _removed[addr])
+                addr++;
+            return addr;
+        };
+
+        bool changed = false;
+        for (size_t i = cfg.begin; i < cfg.end; i++)
+        {
+            Quaternion &code = codes[i];
+            if (_removed[i] || (code.op != QuaternionOperator::J && code.op != QuaternionOperator::Jnz))
+                continue;
+
+            // a jump to a jump goes to the final target at once
+            size_t target = nextCode(code.result.codeAddr);
+            for (int hops = 0; hops < MAX_JUMP_HOPS && target < cfg.end && codes[target].op == QuaternionOperator::J; hops++)
+                target = nextCode(codes[target].result.codeAddr);
+            if (target != static_cast<size_t>(code.result.codeAddr))
+            {
+                code.result = Arg::addr(target);
+                changed = true;
+            }
+
+            if (target == nextCode(i + 1)) // jumps to where it would fall through anyway
+            {
+                _removed[i] = true;
+                changed = true;
+            }
+        }
+
+        return changed;
+    }
+
+    bool QuaternionOptimizer::optimizeLoops(const CFG &cfg)
+    {
+        auto &codes = _generator->_codes;
+        DominatorTree dominatorTree = dominators(cfg);
+        std::vector<Loop> loops = findLoops(cfg, dominatorTree);
+        if (loops.empty())
+            return false;
+
+        DataflowProblem live = liveness(cfg);
+        std::vector<bool> isTouched(cfg.blocks.size(), false); // by a loop optimized already, the others wait
+        bool changed = false;
+        std::vector<uint32_t> symbols;
+        for (auto &loop : loops)
+        {
+            size_t header = loop.header;
+            // the preheader goes right before the header, nothing in the loop may fall into it
+            if (header != 0 && loop.contains[header - 1])
+                continue;
+            if (std::any_of(loop.blocks.begin(), loop.blocks.end(), [&isTouched](size_t block)
+                            { return isTouched[block]; }))
+                continue;
+
+            std::unordered_map<uint32_t, int> numDefs;
+            bool hasCall = false;
+            std::vector<size_t> exitings; // blocks control may leave the loop from
+            llvm::BitVector liveOut(_names.size());
+            for (size_t block : loop.blocks)
+            {
+                auto &bb = cfg.blocks[block];
+                for (size_t i = bb.begin; i < bb.end; i++)
+                {
+                    symbols.clear();
+                    definedSymbols(codes[i], symbols);
+                    for (auto symbol : symbols)
+                        numDefs[symbol]++;
+                    hasCall |= codes[i].op == QuaternionOperator::Call;
+                }
+
+                bool isExiting = bb.isExit;
+                for (size_t succ : bb.succs)
+                {
+                    if (!loop.contains[succ])
+                    {
+                        liveOut |= live.in[succ];
+                        isExiting = true;
+                    }
+                }
+                if (isExiting)
+                    exitings.push_back(block);
+            }
+
+            std::vector<Quaternion> preheader;
+            std::unordered_set<uint32_t> hoisted;
+            auto isInvariant = [&](const Arg &arg)
+            {
+                if (!isSymbol(arg))
+                    return arg.type == ArgType::INTEGER || arg.type == ArgType::FLOATING;
+                if (!numDefs.count(arg.symbol))
+                    return !hasCall || !_isGlobal[arg.symbol];
+                return hoisted.count(arg.symbol) != 0;
+            };
+
+            // a hoisted code runs even when the loop body doesn't, its result must not be seen
+            // before the loop, nor after it unless the code runs on every way out
+            bool isHoisted = true;
+            while (isHoisted)
+            {
+                isHoisted = false;
+                for (size_t block : loop.blocks)
+                {
+                    bool dominatesExits = std::all_of(exitings.begin(), exitings.end(), [&](size_t exiting)
+                                                      { return dominatorTree.dominates(block, exiting); });
+                    for (size_t i = cfg.blocks[block].begin; i < cfg.blocks[block].end; i++)
+                    {
+                        const Quaternion &code = codes[i];
+                        QuaternionOperator op = code.op;
+                        bool isPure = op == QuaternionOperator::DefineEqual || isPureBinary(op) || isPureUnary(op);
+                        if (_removed[i] || !isPure || !isSymbol(code.result))
+                            continue;
+
+                        uint32_t symbol = code.result.symbol;
+                        if (_isGlobal[symbol] || numDefs[symbol] != 1 || !isInvariant(code.arg1) || (isPureBinary(op) && !isInvariant(code.arg2)))
+                            continue;
+                        bool isDivision = op == QuaternionOperator::Div || op == QuaternionOperator::Rem;
+                        if (isDivision && (code.arg2.type != ArgType::INTEGER || code.arg2.integerVal == 0 || code.arg2.integerVal == -1))
+                            continue;
+                        uint32_t id = _nameIds[symbol];
+                        if (id != NoSymbol && (live.in[header].test(id) || (liveOut.test(id) && !dominatesExits)))
+                            continue;
+
+                        preheader.push_back(code);
+                        hoisted.insert(symbol);
+                        _removed[i] = true;
+                        isHoisted = true;
+                    }
+                }
+            }
+
+            // basic induction variables, ints stepped by a constant at a single place in the loop
+            std::unordered_map<uint32_t, std::pair<size_t, int>> inductions; // symbol -> where, step
+            for (size_t block : loop.blocks)
+            {
+                for (size_t i = cfg.blocks[block].begin; i < cfg.blocks[block].end; i++)
+                {
+                    uint32_t symbol = NoSymbol;
+                    int step = 0;
+                    if (!_removed[i] && isInductionStep(codes[i], symbol, step) && numDefs[symbol] == 1 && !_isGlobal[symbol] && _generator->_symbols[symbol].type == "int")
+                        inductions[symbol] = {i, step};
+                }
+            }
+
+            // t := i * k becomes t := s, with s := i * k in the preheader and s := s + step * k
+            // right after i steps, a shift by a constant is a multiply too
+            std::map<std::pair<uint32_t, uint32_t>, uint32_t> reduced; // induction variable, factor -> s
+            for (size_t block : loop.blocks)
+            {
+                for (size_t i = cfg.blocks[block].begin; i < cfg.blocks[block].end; i++)
+                {
+                    Quaternion &code = codes[i];
+                    if (_removed[i] || !isSymbol(code.result) || (code.op != QuaternionOperator::Mul && code.op != QuaternionOperator::Shl))
+                        continue;
+
+                    bool isLhsInduction = isSymbol(code.arg1) && inductions.count(code.arg1.symbol);
+                    bool isRhsInduction = isSymbol(code.arg2) && inductions.count(code.arg2.symbol);
+                    Quaternion init = code;
+                    if (code.op == QuaternionOperator::Shl)
+                    {
+                        if (!isLhsInduction || code.arg2.type != ArgType::INTEGER || code.arg2.integerVal < 0 || code.arg2.integerVal > 31)
+                            continue;
+                    }
+                    else if (isLhsInduction && code.arg2.type == ArgType::INTEGER)
+                        ;
+                    else if (isRhsInduction && code.arg1.type == ArgType::INTEGER)
+                        std::swap(init.arg1, init.arg2);
+                    else
+                        continue;
+
+                    uint32_t induction = init.arg1.symbol;
+                    uint32_t factor = code.op == QuaternionOperator::Shl ? 1u << init.arg2.integerVal : static_cast<uint32_t>(init.arg2.integerVal);
+                    auto [stepAt, step] = inductions[induction];
+                    auto it = reduced.find({induction, factor});
+                    if (it == reduced.end())
+                    {
+                        uint32_t temp = newTemp(induction);
+                        init.result = Arg::entry(temp);
+                        preheader.push_back(init);
+                        int increment = static_cast<int>(static_cast<uint32_t>(step) * factor); // wraps around like the multiply
+                        _insertions.push_back({stepAt + 1, false, {{QuaternionOperator::Add, Arg::entry(temp), Arg::value(increment), Arg::entry(temp)}}});
+                        it = reduced.insert({{induction, factor}, temp}).first;
+                    }
+
+                    code = {QuaternionOperator::DefineEqual, Arg::entry(it->second), Arg::nil(), code.result};
+                }
+            }
+
+            if (preheader.empty())
+                continue;
+
+            size_t headerAddr = cfg.blocks[header].begin;
+            _insertions.push_back({headerAddr, true, std::move(preheader)});
+            for (size_t block : loop.blocks)
+            {
+                size_t last = cfg.blocks[block].end - 1;
+                bool isJump = codes[last].op == QuaternionOperator::J || codes[last].op == QuaternionOperator::Jnz;
+                if (isJump && static_cast<size_t>(codes[last].result.codeAddr) == headerAddr)
+                    _backEdges.insert(last);
+                isTouched[block] = true;
+            }
+            changed = true;
+        }
+
+        return changed;
+    }
+
+    void QuaternionOptimizer::compact()
+    {
+        auto &codes = _generator->_codes;
+        size_t numCodes = codes.size();
+        std::stable_sort(_insertions.begin(), _insertions.end(), [](const Insertion &lhs, const Insertion &rhs)
+                         { return lhs.addr != rhs.addr ? lhs.addr < rhs.addr : lhs.isEntered < rhs.isEntered; });
+
+        std::vector<Quaternion> kept;
+        kept.reserve(numCodes);
+        std::vector<size_t> newAddr(numCodes + 1); // a removed code maps to the next one kept
+        std::vector<size_t> entryAddr(numCodes + 1); // where a jump to the address lands
+        std::vector<std::pair<size_t, size_t>> jumps; // new address, old address
+        size_t next = 0;
+        for (size_t i = 0; i <= numCodes; i++)
+        {
+            for (; next < _insertions.size() && _insertions[next].addr == i && !_insertions[next].isEntered; next++)
+                kept.insert(kept.end(), _insertions[next].codes.begin(), _insertions[next].codes.end());
+            entryAddr[i] = kept.size();
+            for (; next < _insertions.size() && _insertions[next].addr == i; next++)
+                kept.insert(kept.end(), _insertions[next].codes.begin(), _insertions[next].codes.end());
+            newAddr[i] = kept.size();
+
+            if (i == numCodes || _removed[i])
+                continue;
+            if (codes[i].op == QuaternionOperator::J || codes[i].op == QuaternionOperator::Jnz)
+                jumps.push_back({kept.size(), i});
+            kept.push_back(codes[i]);
+        }
+
+        for (auto [addr, oldAddr] : jumps)
+        {
+            size_t target = std::min<size_t>(kept[addr].result.codeAddr, numCodes);
+            kept[addr].result = Arg::addr(_backEdges.count(oldAddr) ? newAddr[target] : entryAddr[target]);
+        }
+
+        // the entered insertions at an entry belong to the function, the others to the one before
+        for (auto &func : _generator->_functionTable)
+        {
+            func.entry = entryAddr[std::min<size_t>(func.entry, numCodes)];
+            func.exit = entryAddr[std::min<size_t>(func.exit, numCodes)];
+        }
+
+        codes = std::move(kept);
+        _removed.assign(codes.size(), false);
+        _insertions.clear();
+        _backEdges.clear();
+    }
+
+    void QuaternionOptimizer::eliminateDeadTemps()
+    {
+        auto &symbols = _generator->_symbols;
+        std::vector<bool> isUsed(symbols.size(), false);
+        for (auto &code : _generator->_codes)
+        {
+            for (const Arg *arg : {&code.arg1, &code.arg2, &code.result})
+            {
+                if (isSymbol(*arg))
+                    isUsed[arg->symbol] = true;
+            }
+        }
+
+        // the remaining items are packed again, the temps of each function get their slots anew as the
+        // passes have moved their live ranges
+        for (auto &table : _generator->_tables)
+        {
+            auto &items = table->items;
+            std::vector<uint32_t> kept;
+            int offset = 0;
+            for (auto symbol : items)
+            {
+                auto &item = symbols[symbol];
+                if (!isUsed[symbol] && item.name.compare(0, 2, "@T") == 0)
+                    continue;
+
+                item.offset = offset;
+                offset += item.width;
+                kept.push_back(symbol);
+            }
+
+            items = std::move(kept);
+            table->totalWidth = offset;
+        }
+        for (size_t id = 0; id < _generator->_functionTable.size(); id++)
+        {
+            if (_generator->_functionTable[id].isInitialized)
+                _generator->recycleTemps(id);
+        }
+    }
+
+    void QuaternionOptimizer::valueOperands(Quaternion &code, std::vector<Arg *> &operands)
+    {
+        QuaternionOperator op = code.op;
+        if (op == QuaternionOperator::DefineEqual || op == QuaternionOperator::Jnz || op == QuaternionOperator::Param ||
+            op == QuaternionOperator::AsmInput || isPureUnary(op))
+            operands.push_back(&code.arg1);
+        else if (isPureBinary(op) || op == QuaternionOperator::Store)
+        {
+            operands.push_back(&code.arg1);
+            operands.push_back(&code.arg2);
+        }
+        else if (op == QuaternionOperator::Subscript) // the array itself is no value
+            operands.push_back(&code.arg2);
+        else if (isAssignment(op))
+            operands.push_back(&code.arg2);
+        else if (op == QuaternionOperator::Ret)
+            operands.push_back(&code.result);
+    }
+
+    QuaternionOptimizer::Arg *QuaternionOptimizer::target(Quaternion &code)
+    {
+        return isAssignment(code.op) || isIncDec(code.op) ? &code.arg1 : nullptr;
+    }
+
+    void QuaternionOptimizer::definedSymbols(const Quaternion &code, std::vector<uint32_t> &symbols) const
+    {
+        QuaternionOperator op = code.op;
+        if (op != QuaternionOperator::Ret && op != QuaternionOperator::Store && isSymbol(code.result))
+            symbols.push_back(code.result.symbol);
+        if ((isAssignment(op) || isIncDec(op)) && isSymbol(code.arg1))
+            symbols.push_back(code.arg1.symbol);
+    }
+
+    void QuaternionOptimizer::usedSymbols(const Quaternion &code, std::vector<uint32_t> &symbols) const
+    {
+        QuaternionOperator op = code.op;
+        std::vector<Arg *> operands;
+        valueOperands(const_cast<Quaternion &>(code), operands);
+        if ((isAssignment(op) && op != QuaternionOperator::Assign) || isIncDec(op))
+            operands.push_back(const_cast<Arg *>(&code.arg1));
+        else if (op == QuaternionOperator::Invalid)
+            operands = {const_cast<Arg *>(&code.arg1), const_cast<Arg *>(&code.arg2)};
+        else if (op == QuaternionOperator::Subscript)
+            operands.push_back(const_cast<Arg *>(&code.arg1));
+        else if (op == QuaternionOperator::Store) // an element is written, the rest of the array stays
+            operands.push_back(const_cast<Arg *>(&code.result));
+
+        for (Arg *operand : operands)
+        {
+            if (isSymbol(*operand))
+                symbols.push_back(operand->symbol);
+        }
+    }
+
+    void QuaternionOptimizer::accessedOperands(const Quaternion &code, std::vector<const Arg *> &reads, std::vector<const Arg *> &writes)
+    {
+        reads.clear();
+        writes.clear();
+        QuaternionOperator op = code.op;
+        if (op == QuaternionOperator::Assign)
+            reads.push_back(&code.arg2);
+        else if (op == QuaternionOperator::Ret)
+            reads.push_back(&code.result);
+        else if (op != QuaternionOperator::Call && op != QuaternionOperator::J)
+            reads.insert(reads.end(), {&code.arg1, &code.arg2});
+
+        if (isIncDec(op) || isAssignment(op))
+            writes.push_back(&code.arg1);
+        if (op != QuaternionOperator::Ret)
+            writes.push_back(&code.result);
+    }
+
+    bool QuaternionOptimizer::hasSideEffects(const Quaternion &code) const
+    {
+        QuaternionOperator op = code.op;
+        if (op == QuaternionOperator::DefineEqual || op == QuaternionOperator::Subscript || isPureBinary(op) || isPureUnary(op))
+            return false;
+        if (isAssignment(op) || isIncDec(op))
+            return !isSymbol(code.arg1); // stores through an unknown place
+
+        return true; // jumps, calls, returns and anything not understood
+    }
+
+    bool QuaternionOptimizer::isSymbol(const Arg &arg) const
+    {
+        return arg.type == ArgType::ENTRY && arg.symbol < _generator->_symbols.size();
+    }
+
+    uint32_t QuaternionOptimizer::newTemp(uint32_t like)
+    {
+        auto previousTable = _generator->_currentSymbolTable;
+        for (auto &table : _generator->_tables)
+        {
+            if (std::find(table->items.begin(), table->items.end(), like) != table->items.end())
+            {
+                _generator->changeTable(table);
+                break;
+            }
+        }
+
+        uint32_t temp = _generator->newtemp(_generator->_symbols[like].type, 4);
+        _generator->changeTable(previousTable);
+        _isGlobal.push_back(false);
+        _isChar.push_back(false);
+        _nameIds.push_back(NoSymbol);
+        return temp;
+    }
+
+    bool QuaternionOptimizer::isInductionStep(const Quaternion &code, uint32_t &symbol, int &step) const
+    {
+        QuaternionOperator op = code.op;
+        if (isIncDec(op) && isSymbol(code.arg1))
+        {
+            symbol = code.arg1.symbol;
+            step = op == QuaternionOperator::PostInc || op == QuaternionOperator::PreInc ? 1 : -1;
+            return true;
+        }
+
+        bool isAdd = op == QuaternionOperator::Add || op == QuaternionOperator::AddAssign;
+        bool isSub = op == QuaternionOperator::Sub || op == QuaternionOperator::SubAssign;
+        if (!isAdd && !isSub)
+            return false;
+
+        const Arg *variable = &code.arg1, *constant = &code.arg2;
+        if (op == QuaternionOperator::Add && code.arg1.type == ArgType::INTEGER)
+            std::swap(variable, constant);
+
+        bool isCompound = op == QuaternionOperator::AddAssign || op == QuaternionOperator::SubAssign;
+        if (!isSymbol(*variable) || constant->type != ArgType::INTEGER)
+            return false;
+        if (!isCompound && (!isSymbol(code.result) || code.result.symbol != variable->symbol))
+            return false;
+
+        symbol = variable->symbol;
+        step = isAdd ? constant->integerVal : static_cast<int>(0u - static_cast<uint32_t>(constant->integerVal));
+        return true;
+    }
+
+    bool QuaternionOptimizer::isPureBinary(QuaternionOperator op)
+    {
+        return op >= QuaternionOperator::Mul && op <= QuaternionOperator::LOr;
+    }
+
+    bool QuaternionOptimizer::isPureUnary(QuaternionOperator op)
+    {
+        return op >= QuaternionOperator::Plus && op <= QuaternionOperator::LNot;
+    }
+
+    bool QuaternionOptimizer::isAssignment(QuaternionOperator op)
+    {
+        return op >= QuaternionOperator::Assign && op <= QuaternionOperator::OrAssign;
+    }
+
+    bool QuaternionOptimizer::isIncDec(QuaternionOperator op)
+    {
+        return op >= QuaternionOperator::PostInc && op <= QuaternionOperator::PreDec;
+    }
+
+    bool QuaternionOptimizer::isCommutative(QuaternionOperator op)
+    {
+        switch (op)
+        {
+        case QuaternionOperator::Mul:
+        case QuaternionOperator::Add:
+        case QuaternionOperator::EQ:
+        case QuaternionOperator::NE:
+        case QuaternionOperator::And:
+        case QuaternionOperator::Xor:
+        case QuaternionOperator::Or:
+        case QuaternionOperator::LAnd:
+        case QuaternionOperator::LOr:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    QuaternionOptimizer::QuaternionOperator QuaternionOptimizer::baseOperator(QuaternionOperator op)
+    {
+        switch (op)
+        {
+        case QuaternionOperator::PostInc:
+        case QuaternionOperator::PreInc:
+            return QuaternionOperator::Add;
+        case QuaternionOperator::PostDec:
+        case QuaternionOperator::PreDec:
+            return QuaternionOperator::Sub;
+        case QuaternionOperator::MulAssign: return QuaternionOperator::Mul;
+        case QuaternionOperator::DivAssign: return QuaternionOperator::Div;
+        case QuaternionOperator::RemAssign: return QuaternionOperator::Rem;
+        case QuaternionOperator::AddAssign: return QuaternionOperator::Add;
+        case QuaternionOperator::SubAssign: return QuaternionOperator::Sub;
+        case QuaternionOperator::ShlAssign: return QuaternionOperator::Shl;
+        case QuaternionOperator::ShrAssign: return QuaternionOperator::Shr;
+        case QuaternionOperator::AndAssign: return QuaternionOperator::And;
+        case QuaternionOperator::XorAssign: return QuaternionOperator::Xor;
+        case QuaternionOperator::OrAssign: return QuaternionOperator::Or;
+        default:
+            return QuaternionOperator::Invalid;
+        }
+    }
+
+    bool QuaternionOptimizer::fold(QuaternionOperator op, const Constant &lhs, const Constant &rhs, Constant &result)
+    {
+        switch (op)
+        {
+#define BINARY_OPERATION(name, disc) \
+    case QuaternionOperator::name:   \
+        return ConstEvaluator::foldBinary(AST::BinaryOpType::BO_##name, lhs, rhs, result);
+#define UNARY_OPERATION(name, disc)
+#include "OperationType.inc"
+#undef UNARY_OPERATION
+#undef BINARY_OPERATION
+        default:
+            return false;
+        }
+    }
+
+    bool QuaternionOptimizer::foldUnary(QuaternionOperator op, const Constant &body, Constant &result)
+    {
+        switch (op)
+        {
+#define BINARY_OPERATION(name, disc)
+#define UNARY_OPERATION(name, disc) \
+    case QuaternionOperator::name:  \
+        return ConstEvaluator::foldUnary(AST::UnaryOpType::UO_##name, body, result);
+#include "OperationType.inc"
+#undef UNARY_OPERATION
+#undef BINARY_OPERATION
+        default:
+            return false;
+        }
+    }
+
+    std::optional<Constant> QuaternionOptimizer::toConstant(const Arg &arg)
+    {
+        if (arg.type == ArgType::INTEGER)
+            return Constant::makeInt(arg.integerVal);
+        if (arg.type == ArgType::FLOATING)
+            return Constant::makeFloat(arg.floatVal);
+        return std::nullopt;
+    }
+
+    QuaternionOptimizer::Arg QuaternionOptimizer::toArg(const Constant &constant)
+    {
+        return constant.isFloat ? Arg::value(constant.floatValue) : Arg::value(constant.intValue);
+    }
+
+    std::optional<Constant> QuaternionOptimizer::storedValue(const Arg &dest, const std::optional<Constant> &value) const
+    {
+        if (!value || !isSymbol(dest) || !_isChar[dest.symbol])
+            return value;
+
+        Constant result;
+        if (!ConstEvaluator::convert(*value, AST::Type::getBuiltin(AST::Type::Kind::Char), result))
+            return std::nullopt;
+        return result;
+    }
+}
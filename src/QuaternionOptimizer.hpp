@@ -0,0 +1,189 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <optional>
+#include <unordered_set>
+#include <vector>
+
+#include "llvm/ADT/BitVector.h"
+
+#include "ConstEvaluator.hpp"
+#include "IRGenerator.hpp"
+
+namespace lcc
+{
+    // Optimizer for the quaternion IR(QuaternionOptimizer.cpp). Each function body is split into
+    // basic blocks and a CFG, liveness and reaching definitions are solved on it, then local value
+    // numbering, constant and copy propagation, copy coalescing, jump simplification and dead code
+    // elimination are repeated until nothing changes. Once a function settles, its natural loops
+    // get invariant codes hoisted and induction variable multiplies reduced to adds. Values carry
+    // their own int/float kind and are folded with the arithmetic of ConstEvaluator. Temps no code
+    // refers to are dropped from their tables. Calls of small leaf functions are inlined before all
+    // of that, so the passes see through the former call boundaries.
+    class QuaternionOptimizer
+    {
+        typedef QuaternionIRGenerator::Quaternion Quaternion;
+        typedef QuaternionIRGenerator::QuaternionOperator QuaternionOperator;
+        typedef QuaternionIRGenerator::Arg Arg;
+        typedef QuaternionIRGenerator::ArgType ArgType;
+        static constexpr uint32_t NoSymbol = QuaternionIRGenerator::NoSymbol;
+
+        typedef struct _BasicBlock
+        {
+            size_t begin; // code addresses [begin, end)
+            size_t end;
+            std::vector<size_t> succs; // block indices, the function exit is not a block
+            std::vector<size_t> preds;
+            bool isExit{false}; // control may leave the function from this block
+        } BasicBlock;
+
+        typedef struct _CFG
+        {
+            size_t begin;
+            size_t end;
+            std::vector<BasicBlock> blocks; // blocks[0] is the entry
+        } CFG;
+
+        // a gen/kill bit vector problem, in and out are filled by solve()
+        typedef struct _DataflowProblem
+        {
+            bool isForward;
+            std::vector<llvm::BitVector> gen;
+            std::vector<llvm::BitVector> kill;
+            llvm::BitVector boundary; // in of the entry when forward, out of exits when backward
+            std::vector<llvm::BitVector> in;
+            std::vector<llvm::BitVector> out;
+        } DataflowProblem;
+
+        typedef struct _DominatorTree
+        {
+            std::vector<size_t> idoms; // SIZE_MAX for blocks unreachable from the entry
+            std::vector<size_t> enter; // a block dominates the blocks numbered within its interval
+            std::vector<size_t> leave;
+
+            bool dominates(size_t dominator, size_t block) const
+            {
+                return idoms[block] != SIZE_MAX && enter[dominator] <= enter[block] && leave[block] <= leave[dominator];
+            }
+        } DominatorTree;
+
+        // a natural loop, the blocks that reach a back edge to header without passing it
+        typedef struct _Loop
+        {
+            size_t header;
+            std::vector<size_t> blocks; // in address order
+            std::vector<bool> contains; // block index -> in the loop
+        } Loop;
+
+        // codes compact() places before addr, a jump to addr runs them only when isEntered
+        typedef struct _Insertion
+        {
+            size_t addr;
+            bool isEntered;
+            std::vector<Quaternion> codes;
+        } Insertion;
+
+    private:
+        QuaternionOptimizer() = default;
+        QuaternionOptimizer(const QuaternionOptimizer &) = delete;
+        QuaternionOptimizer &operator=(const QuaternionOptimizer &) = delete;
+
+    public:
+        static QuaternionOptimizer *getInstance()
+        {
+            if (_inst.get() == nullptr)
+                _inst.reset(new QuaternionOptimizer);
+
+            return _inst.get();
+        }
+
+    private:
+        static std::unique_ptr<QuaternionOptimizer> _inst;
+
+    public:
+        // returns the number of codes that have been removed, counted after inlining
+        size_t run(QuaternionIRGenerator *generator);
+        size_t numInlined() const { return _numInlined; } // calls inlined by the last run
+
+        // union meet, iterated to a fixed point in reverse post order(post order when backward)
+        static void solve(const CFG &cfg, DataflowProblem &problem);
+        // of the blocks reachable from the entry
+        static std::vector<size_t> postOrder(const CFG &cfg);
+        static DominatorTree dominators(const CFG &cfg);
+        // innermost loops first
+        static std::vector<Loop> findLoops(const CFG &cfg, const DominatorTree &dominatorTree);
+        // live ranges over the codes [begin, end) of the symbols idOf maps to ids below numIds(UINT32_MAX
+        // for the others), the hull of the codes touching a symbol and of the blocks it is live through,
+        // {LONG_MAX, LONG_MIN} when no code does. A Call reading its Params and an Asm its AsmInputs is left
+        // to the caller. Only the symbols some block reads before writing them are solved for.
+        static std::vector<std::pair<long, long>> liveRanges(const std::vector<Quaternion> &codes, size_t begin, size_t end,
+                                                             size_t numIds, const std::function<uint32_t(const Arg &)> &idOf);
+
+    private:
+        // replaces the calls of leaf functions whose bodies have at most Options::QuaternionInlineLimit
+        // codes by copies of the bodies, the program grows by MAX_INLINE_GROWTH times at most
+        void inlineCalls();
+        // appends a copy of the callee's body for the call at addr to codes, the callee's symbols are
+        // copied into the caller's first table and its parameters are assigned the arguments
+        void inlineCall(size_t caller, size_t addr, std::vector<Quaternion> &codes);
+
+        static CFG buildCFG(const std::vector<Quaternion> &codes, size_t begin, size_t end);
+        // symbols read across blocks get dense ids, the others are handled within their block
+        void numberNames(const CFG &cfg);
+        DataflowProblem liveness(const CFG &cfg) const;
+
+        bool removeUnreachable(const CFG &cfg);
+        bool numberValues(const CFG &cfg);
+        bool propagateConstants(const CFG &cfg);
+        // t := a op b; x := t becomes x := a op b when the copy is the only read of t
+        bool coalesceCopies(const CFG &cfg);
+        bool eliminateDeadCode(const CFG &cfg);
+        bool simplifyJumps(const CFG &cfg);
+        // hoists invariant codes into a preheader and turns multiplies of induction variables into adds
+        bool optimizeLoops(const CFG &cfg);
+        void compact();
+        void eliminateDeadTemps();
+
+        // operands read as values, a constant or another symbol with the same value may replace them
+        static void valueOperands(Quaternion &code, std::vector<Arg *> &operands);
+        // the variable an assignment, compound assignment, increment or decrement writes
+        static Arg *target(Quaternion &code);
+        void definedSymbols(const Quaternion &code, std::vector<uint32_t> &symbols) const;
+        void usedSymbols(const Quaternion &code, std::vector<uint32_t> &symbols) const;
+        // the operands the register and temp allocation take as read and written, up to two each
+        static void accessedOperands(const Quaternion &code, std::vector<const Arg *> &reads, std::vector<const Arg *> &writes);
+        bool hasSideEffects(const Quaternion &code) const;
+        bool isSymbol(const Arg &arg) const;
+        uint32_t newTemp(uint32_t like); // an int temp in the table of like
+        // i++, i--, i += c, i -= c, i := i + c or i := i - c with an int constant c
+        bool isInductionStep(const Quaternion &code, uint32_t &symbol, int &step) const;
+
+        static bool isPureBinary(QuaternionOperator op);
+        static bool isPureUnary(QuaternionOperator op);
+        static bool isAssignment(QuaternionOperator op);
+        static bool isIncDec(QuaternionOperator op);
+        static bool isCommutative(QuaternionOperator op);
+        // the operator a compound assignment, increment or decrement applies, Invalid otherwise
+        static QuaternionOperator baseOperator(QuaternionOperator op);
+        static bool fold(QuaternionOperator op, const Constant &lhs, const Constant &rhs, Constant &result);
+        static bool foldUnary(QuaternionOperator op, const Constant &body, Constant &result);
+        static std::optional<Constant> toConstant(const Arg &arg);
+        static Arg toArg(const Constant &constant);
+        // the value a store of value leaves in dest, a char keeps the low byte sign extended
+        std::optional<Constant> storedValue(const Arg &dest, const std::optional<Constant> &value) const;
+
+    private:
+        QuaternionIRGenerator *_generator{nullptr};
+        std::vector<bool> _removed; // code address -> removed by the current iteration
+        std::vector<Insertion> _insertions; // added by the current iteration
+        std::unordered_set<size_t> _backEdges; // jumps that skip the insertions before their target
+        std::vector<bool> _isGlobal; // symbol -> declared at file scope
+        std::vector<bool> _isChar; // symbol -> a char variable, stores to it are narrowed
+
+        std::vector<uint32_t> _names; // dense id -> symbol read across blocks of the current function
+        std::vector<uint32_t> _nameIds; // symbol -> dense id, NoSymbol when block local
+        std::vector<uint32_t> _globals; // dense ids of globals, calls and returns read them
+        size_t _numInlined{0};
+    };
+}
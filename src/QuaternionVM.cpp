@@ -0,0 +1,855 @@
+#include "lcc.hpp"
+#include <climits>
+#include <cstdio>
+
+// labels as values let every handler jump straight to the next one, other compilers get a switch
+#if defined(__GNUC__)
+#define VM_THREADED 1
+#else
+#define VM_THREADED 0
+#endif
+
+namespace lcc
+{
+    std::unique_ptr<QuaternionVM> QuaternionVM::_inst;
+
+    namespace
+    {
+        int32_t WrapAdd(int32_t lhs, int32_t rhs)
+        {
+            return static_cast<int32_t>(static_cast<uint32_t>(lhs) + static_cast<uint32_t>(rhs));
+        }
+
+        int32_t WrapSub(int32_t lhs, int32_t rhs)
+        {
+            return static_cast<int32_t>(static_cast<uint32_t>(lhs) - static_cast<uint32_t>(rhs));
+        }
+
+        int32_t WrapMul(int32_t lhs, int32_t rhs)
+        {
+            return static_cast<int32_t>(static_cast<uint32_t>(lhs) * static_cast<uint32_t>(rhs));
+        }
+
+        // NaN and out of range values become INT_MIN, as cvttss2si does
+        int32_t FloatToInt(float value)
+        {
+            if (!(value > -2147483904.0f && value < 2147483648.0f))
+                return INT32_MIN;
+            return static_cast<int32_t>(value);
+        }
+
+        QuaternionVM::Slot PutChar(QuaternionVM *vm, const QuaternionVM::Slot *args, size_t numArgs)
+        {
+            QuaternionVM::Slot result;
+            result.i = numArgs < 1 ? EOF : std::putchar(static_cast<unsigned char>(args[0].i));
+            return result;
+        }
+
+        QuaternionVM::Slot Puts(QuaternionVM *vm, const QuaternionVM::Slot *args, size_t numArgs)
+        {
+            const std::string *str = numArgs < 1 ? nullptr : vm->string(args[0].i);
+            QuaternionVM::Slot result;
+            result.i = str == nullptr ? EOF : std::puts(str->c_str());
+            return result;
+        }
+    }
+
+    QuaternionVM::QuaternionVM()
+    {
+        registerHost("putchar", PutChar);
+        registerHost("puts", Puts);
+    }
+
+    void QuaternionVM::registerHost(const std::string &name, HostFunction function)
+    {
+        auto it = _hostIds.find(name);
+        if (it != _hostIds.end())
+        {
+            _hosts[it->second] = function;
+            return;
+        }
+
+        _hostIds[name] = _hosts.size();
+        _hosts.push_back(function);
+    }
+
+    const std::string *QuaternionVM::string(int32_t id) const
+    {
+        if (id < 0 || static_cast<size_t>(id) >= _strings.size())
+            return nullptr;
+        return &_strings[id];
+    }
+
+    bool QuaternionVM::load(const QuaternionIRGenerator *generator)
+    {
+        auto &codes = generator->_codes;
+        auto &functionTable = generator->_functionTable;
+
+        // a program stops before its first instruction rather than at a construct the VM can't run
+        if (generator->numUnlowered() != 0)
+        {
+            FATAL_ERROR("The quaternion IR has no codes for " << generator->numUnlowered() << " pointer subscripts or asm statements with operands other than registers.");
+            return false;
+        }
+        for (size_t addr = 0; addr < codes.size(); addr++)
+        {
+            if (codes[addr].op == QuaternionOperator::Asm)
+            {
+                FATAL_ERROR("Inline asm at code " << addr << " can't be run on the quaternion VM.");
+                return false;
+            }
+        }
+
+        _generator = generator;
+
+        _code.clear();
+        _isThreaded = false;
+        _constantRefs.clear();
+        _strings = generator->_strings;
+        _trapMessages.clear();
+        _functionIds = generator->_functionIds;
+        _pcs.assign(codes.size(), 0);
+        layout();
+
+        // global initializers sit in the gaps between function bodies
+        size_t addr = 0;
+        for (auto &item : functionTable)
+        {
+            for (; addr < static_cast<size_t>(item.entry); addr++)
+                decode(addr, NumScratchSlots, "void");
+            if (item.isInitialized)
+                addr = std::max(addr, static_cast<size_t>(item.exit));
+        }
+        for (; addr < codes.size(); addr++)
+            decode(addr, NumScratchSlots, "void");
+        emit(Opcode::Halt, 0, NoRef);
+        resolveJumps(0, codes.size(), SIZE_MAX, 0);
+
+        // run() fills in the entry, its value is returned to the first slot of the initializers' frame
+        _bootstrap = _code.size();
+        emit(Opcode::Call, 0, 0, NumScratchSlots);
+        emit(Opcode::Halt, 0, 0);
+
+        for (size_t id = 0; id < functionTable.size(); id++)
+        {
+            auto &item = functionTable[id];
+            if (!item.isInitialized)
+                continue;
+
+            Function &function = _functions[id];
+            function.entry = _code.size();
+            for (size_t addr = item.entry; addr < static_cast<size_t>(item.exit); addr++)
+                decode(addr, function.frameSize, item.type);
+
+            size_t exitPc = _code.size();
+            emit(Opcode::RetVoid, 0); // falling off the end of a body
+            resolveJumps(item.entry, item.exit, item.exit, exitPc);
+        }
+
+        _generator = nullptr;
+        return true;
+    }
+
+    bool QuaternionVM::run(const std::string &entry, int &exitCode)
+    {
+        auto it = _functionIds.find(entry);
+        if (it == _functionIds.end() || _functions[it->second].entry == NoEntry)
+        {
+            FATAL_ERROR("Function " << entry << " is not defined.");
+            return false;
+        }
+
+        _code[_bootstrap].b = it->second;
+        _globals = _globalImage;
+        _stack.assign(StackSlots + _maxFrameSize, Slot{0});
+        _frames.resize(MaxCallDepth);
+        _numExecuted = 0;
+
+        Slot value{0};
+        bool isSucceeded = execute(_code.data(), _stack.data(), value) && execute(_code.data() + _bootstrap, _stack.data(), value);
+        std::fflush(stdout);
+        exitCode = value.i;
+        return isSucceeded;
+    }
+
+#define VM_SLOT(ref) ((ref) >= 0 ? fp[(ref)] : globals[~(ref)])
+#define VM_JUMP(target)  \
+    do                   \
+    {                    \
+        pc = (target);   \
+        ++numExecuted;   \
+        VM_DISPATCH();   \
+    } while (0)
+#define VM_NEXT() VM_JUMP(pc + 1)
+#define VM_BINARY(name, type, field, resultField, expr) \
+    VM_CASE(name)                                       \
+    {                                                   \
+        type lhs = VM_SLOT(pc->b).field;                \
+        type rhs = VM_SLOT(pc->c).field;                \
+        VM_SLOT(pc->a).resultField = (expr);            \
+        VM_NEXT();                                      \
+    }
+#define VM_UNARY(name, type, field, resultField, expr) \
+    VM_CASE(name)                                      \
+    {                                                  \
+        type body = VM_SLOT(pc->b).field;              \
+        VM_SLOT(pc->a).resultField = (expr);           \
+        VM_NEXT();                                     \
+    }
+
+#if VM_THREADED
+#define VM_CASE(name) L_##name:
+#define VM_DISPATCH() goto *pc->handler
+#else
+#define VM_CASE(name) case Opcode::name:
+#define VM_DISPATCH() goto dispatch
+#endif
+
+    bool QuaternionVM::execute(const Instruction *pc, Slot *fp, Slot &value)
+    {
+        const Instruction *code = _code.data();
+        const Function *functions = _functions.data();
+        const Array *arrays = _arrays.data();
+        Slot *globals = _globals.data();
+        const Slot *stackEnd = _stack.data() + _stack.size() - _maxFrameSize; // the rest is for the Params of the top frame
+        Frame *frame = _frames.data();
+        Frame *framesBegin = frame, *framesEnd = frame + _frames.size();
+        uint64_t numExecuted = _numExecuted;
+        Slot returnValue;
+        std::string error;
+
+#if VM_THREADED
+        static const void *const labels[] = {
+#define VM_OPCODE(name) &&L_##name,
+#include "QuaternionVMOpcode.inc"
+#undef VM_OPCODE
+        };
+        if (!_isThreaded)
+        {
+            for (auto &instruction : _code)
+                instruction.handler = labels[static_cast<size_t>(instruction.opcode)];
+            _isThreaded = true;
+        }
+
+        VM_JUMP(pc);
+#else
+        VM_JUMP(pc);
+    dispatch:
+        switch (pc->opcode)
+        {
+#endif
+        VM_UNARY(Mov, int32_t, i, i, body)
+        VM_UNARY(IntToFloat, int32_t, i, f, static_cast<float>(body))
+        VM_UNARY(FloatToInt, float, f, i, FloatToInt(body))
+        VM_UNARY(IntToChar, int32_t, i, i, static_cast<int8_t>(body))
+
+        VM_BINARY(AddI, int32_t, i, i, WrapAdd(lhs, rhs))
+        VM_BINARY(SubI, int32_t, i, i, WrapSub(lhs, rhs))
+        VM_BINARY(MulI, int32_t, i, i, WrapMul(lhs, rhs))
+        VM_CASE(DivI)
+        VM_CASE(RemI)
+        {
+            int32_t lhs = VM_SLOT(pc->b).i;
+            int32_t rhs = VM_SLOT(pc->c).i;
+            if (rhs == 0 || (lhs == INT32_MIN && rhs == -1))
+            {
+                error = "Integer division by zero or overflow";
+                goto fail;
+            }
+            VM_SLOT(pc->a).i = pc->opcode == Opcode::DivI ? lhs / rhs : lhs % rhs;
+            VM_NEXT();
+        }
+        VM_BINARY(ShlI, int32_t, i, i, static_cast<int32_t>(static_cast<uint32_t>(lhs) << (rhs & 31)))
+        VM_BINARY(ShrI, int32_t, i, i, lhs >> (rhs & 31))
+        VM_BINARY(AndI, int32_t, i, i, lhs & rhs)
+        VM_BINARY(XorI, int32_t, i, i, lhs ^ rhs)
+        VM_BINARY(OrI, int32_t, i, i, lhs | rhs)
+        VM_BINARY(LTI, int32_t, i, i, lhs < rhs)
+        VM_BINARY(GTI, int32_t, i, i, lhs > rhs)
+        VM_BINARY(LEI, int32_t, i, i, lhs <= rhs)
+        VM_BINARY(GEI, int32_t, i, i, lhs >= rhs)
+        VM_BINARY(EQI, int32_t, i, i, lhs == rhs)
+        VM_BINARY(NEI, int32_t, i, i, lhs != rhs)
+        VM_BINARY(LAndI, int32_t, i, i, lhs && rhs)
+        VM_BINARY(LOrI, int32_t, i, i, lhs || rhs)
+        VM_BINARY(AddF, float, f, f, lhs + rhs)
+        VM_BINARY(SubF, float, f, f, lhs - rhs)
+        VM_BINARY(MulF, float, f, f, lhs * rhs)
+        VM_BINARY(DivF, float, f, f, lhs / rhs)
+        VM_BINARY(LTF, float, f, i, lhs < rhs)
+        VM_BINARY(GTF, float, f, i, lhs > rhs)
+        VM_BINARY(LEF, float, f, i, lhs <= rhs)
+        VM_BINARY(GEF, float, f, i, lhs >= rhs)
+        VM_BINARY(EQF, float, f, i, lhs == rhs)
+        VM_BINARY(NEF, float, f, i, lhs != rhs)
+        VM_BINARY(LAndF, float, f, i, lhs != 0.0f && rhs != 0.0f)
+        VM_BINARY(LOrF, float, f, i, lhs != 0.0f || rhs != 0.0f)
+
+        VM_UNARY(MinusI, int32_t, i, i, WrapSub(0, body))
+        VM_UNARY(MinusF, float, f, f, -body)
+        VM_UNARY(NotI, int32_t, i, i, ~body)
+        VM_UNARY(LNotI, int32_t, i, i, !body)
+        VM_UNARY(LNotF, float, f, i, body == 0.0f)
+
+        VM_CASE(Load)
+        VM_CASE(Store)
+        {
+            bool isLoad = pc->opcode == Opcode::Load;
+            const Array &array = arrays[isLoad ? pc->b : pc->a];
+            int32_t offset = VM_SLOT(pc->c).i;
+            if (offset < 0 || offset % static_cast<int32_t>(sizeof(Slot)) != 0 || offset / static_cast<int32_t>(sizeof(Slot)) >= array.numSlots)
+            {
+                error = "Array subscript out of range";
+                goto fail;
+            }
+            Slot &element = array.ref >= 0 ? fp[array.ref + offset / sizeof(Slot)] : globals[~array.ref + offset / sizeof(Slot)];
+            if (isLoad)
+                VM_SLOT(pc->a) = element;
+            else
+                element = VM_SLOT(pc->b);
+            VM_NEXT();
+        }
+
+        VM_CASE(Jmp)
+        {
+            VM_JUMP(code + pc->a);
+        }
+        VM_CASE(JnzI)
+        {
+            if (VM_SLOT(pc->b).i != 0)
+                VM_JUMP(code + pc->a);
+            VM_NEXT();
+        }
+        VM_CASE(JnzF)
+        {
+            if (VM_SLOT(pc->b).f != 0.0f)
+                VM_JUMP(code + pc->a);
+            VM_NEXT();
+        }
+
+        VM_CASE(Call)
+        {
+            const Function &callee = functions[pc->b];
+            Slot *calleeFp = fp + pc->c; // the Params have been stored there already
+            if (frame == framesEnd || calleeFp + callee.frameSize > stackEnd)
+            {
+                error = "Stack overflow";
+                goto fail;
+            }
+
+            *frame++ = {pc + 1, fp, pc->a};
+            fp = calleeFp;
+            VM_JUMP(code + callee.entry);
+        }
+        VM_CASE(CallHost)
+        {
+            const Function &callee = functions[pc->b];
+            Slot result = _hosts[callee.host](this, fp + pc->c, callee.numParams);
+            if (pc->a != NoRef)
+                VM_SLOT(pc->a) = result;
+            VM_NEXT();
+        }
+        VM_CASE(Ret)
+        {
+            returnValue = VM_SLOT(pc->b);
+            goto ret;
+        }
+        VM_CASE(RetVoid)
+        {
+            returnValue.i = 0;
+            goto ret;
+        }
+        VM_CASE(Halt)
+        {
+            if (pc->b != NoRef)
+                value = VM_SLOT(pc->b);
+            goto halt;
+        }
+        VM_CASE(Trap)
+        {
+            error = _trapMessages[pc->b];
+            goto fail;
+        }
+#if !VM_THREADED
+        }
+#endif
+
+    ret:
+        if (frame == framesBegin)
+        {
+            value = returnValue;
+            goto halt;
+        }
+        --frame;
+        fp = frame->fp;
+        if (frame->result != NoRef)
+            VM_SLOT(frame->result) = returnValue;
+        VM_JUMP(frame->returnPc);
+
+    halt:
+        _numExecuted = numExecuted;
+        return true;
+
+    fail:
+        _numExecuted = numExecuted;
+        FATAL_ERROR(error);
+        return false;
+    }
+
+#undef VM_DISPATCH
+#undef VM_CASE
+#undef VM_UNARY
+#undef VM_BINARY
+#undef VM_NEXT
+#undef VM_JUMP
+#undef VM_SLOT
+
+    void QuaternionVM::layout()
+    {
+        auto &tables = _generator->_tables;
+        auto &symbols = _generator->_symbols;
+        auto &functionTable = _generator->_functionTable;
+        int32_t slotWidth = sizeof(Slot);
+
+        _slots.assign(symbols.size(), NoRef);
+        _isFloat.resize(symbols.size());
+        _isChar.resize(symbols.size());
+        for (size_t symbol = 0; symbol < symbols.size(); symbol++)
+        {
+            std::string type = QuaternionIRGenerator::elementType(symbols[symbol].type);
+            _isFloat[symbol] = type == "float";
+            _isChar[symbol] = type == "char";
+        }
+
+        // a frame holds the tables of its function one after another
+        std::vector<bool> isLocal(tables.size(), false);
+        _functions.assign(functionTable.size(), {NoEntry, UINT32_MAX, 0, 0});
+        _maxFrameSize = NumScratchSlots;
+        for (size_t id = 0; id < functionTable.size(); id++)
+        {
+            auto &item = functionTable[id];
+            int width = 0;
+            for (size_t table = item.firstTable; table < item.endTable; table++)
+            {
+                isLocal[table] = true;
+                for (auto symbol : tables[table]->items)
+                    _slots[symbol] = (width + symbols[symbol].offset) / slotWidth;
+                width += tables[table]->totalWidth;
+            }
+
+            Function &function = _functions[id];
+            function.frameSize = (width + slotWidth - 1) / slotWidth + NumScratchSlots;
+            function.numParams = item.params.size();
+            _maxFrameSize = std::max(_maxFrameSize, function.frameSize);
+
+            auto host = _hostIds.find(item.name);
+            if (!item.isInitialized && host != _hostIds.end())
+                function.host = host->second;
+        }
+
+        int width = 0;
+        for (size_t table = 0; table < tables.size(); table++)
+        {
+            if (isLocal[table])
+                continue;
+            for (auto symbol : tables[table]->items)
+                _slots[symbol] = ~((width + symbols[symbol].offset) / slotWidth);
+            width += tables[table]->totalWidth;
+        }
+        _globalImage.assign((width + slotWidth - 1) / slotWidth, Slot{0});
+
+        _arrayIds.assign(symbols.size(), -1);
+        _arrays.clear();
+        for (size_t symbol = 0; symbol < symbols.size(); symbol++)
+        {
+            if (_slots[symbol] == NoRef || !QuaternionIRGenerator::isArrayType(symbols[symbol].type))
+                continue;
+            _arrayIds[symbol] = _arrays.size();
+            _arrays.push_back({_slots[symbol], symbols[symbol].width / slotWidth});
+        }
+    }
+
+    void QuaternionVM::decode(size_t addr, int32_t frameSize, const std::string &returnType)
+    {
+        const Quaternion &code = _generator->_codes[addr];
+        QuaternionOperator op = code.op;
+        int32_t scratch = frameSize - NumScratchSlots;
+        _pcs[addr] = _code.size();
+
+        if (!isValid(code.arg1) || !isValid(code.arg2) || !isValid(code.result))
+        {
+            trap("Code " + std::to_string(addr) + " refers to an expression the quaternion IR doesn't support");
+            return;
+        }
+
+        switch (op)
+        {
+        case QuaternionOperator::DefineEqual:
+        case QuaternionOperator::Plus:
+            store(code.result, code.arg1, scratch);
+            return;
+        case QuaternionOperator::Minus:
+        {
+            bool isFloatBody = isFloat(code.arg1);
+            emitResult(isFloatBody ? Opcode::MinusF : Opcode::MinusI, isFloatBody, code.result, operand(code.arg1, isFloatBody, scratch), 0, scratch);
+            return;
+        }
+        case QuaternionOperator::Not:
+            emitResult(Opcode::NotI, false, code.result, operand(code.arg1, false, scratch), 0, scratch);
+            return;
+        case QuaternionOperator::LNot:
+            emitResult(isFloat(code.arg1) ? Opcode::LNotF : Opcode::LNotI, false, code.result, operand(code.arg1, isFloat(code.arg1), scratch), 0, scratch);
+            return;
+        case QuaternionOperator::Jnz:
+            emit(isFloat(code.arg1) ? Opcode::JnzF : Opcode::JnzI, 0, operand(code.arg1, isFloat(code.arg1), scratch));
+            _jumps.emplace_back(_code.size() - 1, code.result.codeAddr);
+            return;
+        case QuaternionOperator::J:
+            emit(Opcode::Jmp, 0);
+            _jumps.emplace_back(_code.size() - 1, code.result.codeAddr);
+            return;
+        case QuaternionOperator::Param:
+            if (!decodeParam(addr, frameSize))
+                trap("Code " + std::to_string(addr) + " passes an argument to no matching call");
+            return;
+        case QuaternionOperator::Call:
+        {
+            auto &callee = _generator->_functionTable[code.arg1.function];
+            const Function &function = _functions[code.arg1.function];
+            if (code.arg2.type != ArgType::INTEGER || static_cast<size_t>(code.arg2.integerVal) != callee.params.size())
+                trap("Function " + callee.name + " is called with a wrong number of arguments");
+            else if (callee.isInitialized)
+                emitResult(Opcode::Call, callee.type == "float", code.result, code.arg1.function, frameSize, scratch);
+            else if (function.host != UINT32_MAX)
+                emitResult(Opcode::CallHost, callee.type == "float", code.result, code.arg1.function, frameSize, scratch);
+            else
+                trap("Function " + callee.name + " is not defined");
+            return;
+        }
+        case QuaternionOperator::Subscript:
+        case QuaternionOperator::Store:
+        {
+            const Arg &array = op == QuaternionOperator::Store ? code.result : code.arg1;
+            if (array.type != ArgType::ENTRY || _arrayIds[array.symbol] < 0)
+            {
+                trap("Code " + std::to_string(addr) + " subscripts no array");
+                return;
+            }
+
+            bool isElementFloat = _isFloat[array.symbol];
+            int32_t offset = operand(code.arg2, false, scratch + 1);
+            if (op == QuaternionOperator::Store)
+            {
+                int32_t value = operand(code.arg1, isElementFloat, scratch);
+                if (_isChar[array.symbol])
+                {
+                    emit(Opcode::IntToChar, scratch, value);
+                    value = scratch;
+                }
+                emit(Opcode::Store, _arrayIds[array.symbol], value, offset);
+            }
+            else
+                emitResult(Opcode::Load, isElementFloat, code.result, _arrayIds[array.symbol], offset, scratch);
+            return;
+        }
+        case QuaternionOperator::Ret:
+            if (code.result.type == ArgType::NIL)
+                emit(Opcode::RetVoid, 0);
+            else if (returnType == "char")
+            {
+                emit(Opcode::IntToChar, scratch, operand(code.result, false, scratch));
+                emit(Opcode::Ret, 0, scratch);
+            }
+            else
+                emit(Opcode::Ret, 0, operand(code.result, returnType == "float", scratch));
+            return;
+        default:
+            break;
+        }
+
+        Opcode opcode;
+        bool isValueFloat;
+        bool isUpdate = op >= QuaternionOperator::PostInc && op <= QuaternionOperator::PreDec;
+        bool isAssignment = op >= QuaternionOperator::Assign; // compound assignments follow Assign in OperationType.inc
+        if (!isUpdate && !binaryOpcode(op, false, opcode, isValueFloat) && op != QuaternionOperator::Assign)
+        {
+            trap("Code " + std::to_string(addr) + " can't be executed");
+            return;
+        }
+        if (!isUpdate && !isAssignment)
+        {
+            binary(op, code.result, code.arg1, code.arg2, scratch);
+            return;
+        }
+
+        // the rest writes a variable
+        if (code.arg1.type != ArgType::ENTRY)
+        {
+            trap("Code " + std::to_string(addr) + " stores to an unsupported place");
+            return;
+        }
+
+        Arg one = isFloat(code.arg1) ? Arg::value(1.0f) : Arg::value(1);
+        switch (op)
+        {
+        case QuaternionOperator::Assign:
+            store(code.arg1, code.arg2, scratch);
+            break;
+        case QuaternionOperator::PreInc:
+        case QuaternionOperator::PreDec:
+            binary(op == QuaternionOperator::PreInc ? QuaternionOperator::Add : QuaternionOperator::Sub, code.arg1, code.arg1, one, scratch);
+            break;
+        case QuaternionOperator::PostInc:
+        case QuaternionOperator::PostDec:
+            // the result is the old value
+            store(code.result, code.arg1, scratch);
+            binary(op == QuaternionOperator::PostInc ? QuaternionOperator::Add : QuaternionOperator::Sub, code.arg1, code.arg1, one, scratch);
+            return;
+        default:
+            binary(op, code.arg1, code.arg1, code.arg2, scratch);
+            break;
+        }
+
+        store(code.result, code.arg1, scratch);
+    }
+
+    bool QuaternionVM::decodeParam(size_t addr, int32_t frameSize)
+    {
+        auto &codes = _generator->_codes;
+        size_t call = addr;
+        while (call < codes.size() && codes[call].op == QuaternionOperator::Param)
+            call++;
+        if (call == codes.size() || codes[call].op != QuaternionOperator::Call || codes[call].arg1.type != ArgType::FUNCTION || codes[call].arg2.type != ArgType::INTEGER)
+            return false;
+
+        auto &params = _generator->_functionTable[codes[call].arg1.function].params;
+        size_t numArgs = codes[call].arg2.integerVal;
+        if (numArgs != params.size() || call - addr > numArgs)
+            return false;
+
+        uint32_t param = params[numArgs - (call - addr)];
+        int32_t scratch = frameSize - NumScratchSlots;
+        storeRef(frameSize + _slots[param], _isFloat[param], operand(codes[addr].arg1, _isFloat[param], scratch), _isFloat[param], _isChar[param]);
+        return true;
+    }
+
+    void QuaternionVM::resolveJumps(size_t begin, size_t end, size_t exitAddr, size_t exitPc)
+    {
+        for (auto &jump : _jumps)
+        {
+            Instruction &instruction = _code[jump.first];
+            size_t target = jump.second;
+            if (target == exitAddr)
+                instruction.a = exitPc;
+            else if (target >= begin && target < end)
+                instruction.a = _pcs[target];
+            else
+            {
+                _trapMessages.push_back("Jump to " + std::to_string(target) + " leaves its function");
+                instruction.opcode = Opcode::Trap;
+                instruction.b = _trapMessages.size() - 1;
+            }
+        }
+        _jumps.clear();
+    }
+
+    void QuaternionVM::emit(Opcode opcode, int32_t a, int32_t b, int32_t c)
+    {
+        _code.push_back({nullptr, opcode, a, b, c});
+    }
+
+    void QuaternionVM::trap(const std::string &message)
+    {
+        _trapMessages.push_back(message);
+        emit(Opcode::Trap, 0, _trapMessages.size() - 1);
+    }
+
+    int32_t QuaternionVM::operand(const Arg &arg, bool isFloat, int32_t scratch)
+    {
+        Slot value{0};
+        switch (arg.type)
+        {
+        case ArgType::ENTRY:
+        {
+            int32_t ref = _slots[arg.symbol];
+            if (_isFloat[arg.symbol] == isFloat)
+                return ref;
+            storeRef(scratch, isFloat, ref, !isFloat);
+            return scratch;
+        }
+        case ArgType::INTEGER:
+        case ArgType::STRING: // the index of the literal
+        {
+            int32_t integerVal = arg.type == ArgType::INTEGER ? arg.integerVal : static_cast<int32_t>(arg.string);
+            if (isFloat)
+                value.f = static_cast<float>(integerVal);
+            else
+                value.i = integerVal;
+            break;
+        }
+        case ArgType::FLOATING:
+            if (isFloat)
+                value.f = arg.floatVal;
+            else
+                value.i = FloatToInt(arg.floatVal);
+            break;
+        default:
+            break;
+        }
+
+        return constant(value);
+    }
+
+    void QuaternionVM::store(const Arg &dest, const Arg &src, int32_t scratch)
+    {
+        if (dest.type != ArgType::ENTRY)
+            return;
+
+        bool isDestFloat = _isFloat[dest.symbol];
+        storeRef(_slots[dest.symbol], isDestFloat, operand(src, isDestFloat, scratch), isDestFloat, _isChar[dest.symbol]);
+    }
+
+    void QuaternionVM::storeRef(int32_t dest, bool isDestFloat, int32_t src, bool isSrcFloat, bool isDestChar)
+    {
+        if (isDestChar)
+        {
+            if (isSrcFloat)
+            {
+                emit(Opcode::FloatToInt, dest, src);
+                src = dest;
+            }
+            emit(Opcode::IntToChar, dest, src);
+        }
+        else if (isDestFloat != isSrcFloat)
+            emit(isDestFloat ? Opcode::IntToFloat : Opcode::FloatToInt, dest, src);
+        else if (dest != src)
+            emit(Opcode::Mov, dest, src);
+    }
+
+    void QuaternionVM::emitResult(Opcode opcode, bool isValueFloat, const Arg &result, int32_t b, int32_t c, int32_t scratch)
+    {
+        bool isCall = opcode == Opcode::Call || opcode == Opcode::CallHost;
+        if (result.type != ArgType::ENTRY)
+        {
+            if (isCall) // the value is dropped but the call is made
+                emit(opcode, NoRef, b, c);
+            return;
+        }
+
+        bool isResultFloat = _isFloat[result.symbol];
+        int32_t ref = _slots[result.symbol];
+        if (isResultFloat == isValueFloat)
+        {
+            emit(opcode, ref, b, c);
+            if (_isChar[result.symbol])
+                emit(Opcode::IntToChar, ref, ref);
+            return;
+        }
+
+        emit(opcode, scratch, b, c);
+        storeRef(ref, isResultFloat, scratch, isValueFloat, _isChar[result.symbol]);
+    }
+
+    void QuaternionVM::binary(QuaternionOperator op, const Arg &result, const Arg &lhs, const Arg &rhs, int32_t scratch)
+    {
+        Opcode opcode;
+        bool isValueFloat;
+        bool isFloatOperation = isFloat(lhs) || isFloat(rhs);
+        if (!binaryOpcode(op, isFloatOperation, opcode, isValueFloat))
+        {
+            isFloatOperation = false; // bitwise operators only have an int form
+            binaryOpcode(op, false, opcode, isValueFloat);
+        }
+
+        int32_t lhsRef = operand(lhs, isFloatOperation, scratch);
+        int32_t rhsRef = operand(rhs, isFloatOperation, scratch + 1);
+        emitResult(opcode, isValueFloat, result, lhsRef, rhsRef, scratch);
+    }
+
+    int32_t QuaternionVM::constant(Slot value)
+    {
+        auto it = _constantRefs.find(value.i);
+        if (it != _constantRefs.end())
+            return it->second;
+
+        int32_t ref = ~static_cast<int32_t>(_globalImage.size());
+        _globalImage.push_back(value);
+        _constantRefs[value.i] = ref;
+        return ref;
+    }
+
+    bool QuaternionVM::isFloat(const Arg &arg) const
+    {
+        if (arg.type == ArgType::ENTRY)
+            return _isFloat[arg.symbol];
+        return arg.type == ArgType::FLOATING;
+    }
+
+    bool QuaternionVM::isValid(const Arg &arg) const
+    {
+        if (arg.type == ArgType::ENTRY)
+            return arg.symbol < _slots.size();
+        if (arg.type == ArgType::FUNCTION)
+            return arg.function < _functions.size();
+        return true;
+    }
+
+    bool QuaternionVM::binaryOpcode(QuaternionOperator op, bool isFloat, Opcode &opcode, bool &isValueFloat)
+    {
+        isValueFloat = false;
+        switch (op)
+        {
+        case QuaternionOperator::Mul:
+        case QuaternionOperator::MulAssign:
+            opcode = isFloat ? Opcode::MulF : Opcode::MulI;
+            isValueFloat = isFloat;
+            return true;
+        case QuaternionOperator::Div:
+        case QuaternionOperator::DivAssign:
+            opcode = isFloat ? Opcode::DivF : Opcode::DivI;
+            isValueFloat = isFloat;
+            return true;
+        case QuaternionOperator::Add:
+        case QuaternionOperator::AddAssign:
+            opcode = isFloat ? Opcode::AddF : Opcode::AddI;
+            isValueFloat = isFloat;
+            return true;
+        case QuaternionOperator::Sub:
+        case QuaternionOperator::SubAssign:
+            opcode = isFloat ? Opcode::SubF : Opcode::SubI;
+            isValueFloat = isFloat;
+            return true;
+        case QuaternionOperator::LT: opcode = isFloat ? Opcode::LTF : Opcode::LTI; return true;
+        case QuaternionOperator::GT: opcode = isFloat ? Opcode::GTF : Opcode::GTI; return true;
+        case QuaternionOperator::LE: opcode = isFloat ? Opcode::LEF : Opcode::LEI; return true;
+        case QuaternionOperator::GE: opcode = isFloat ? Opcode::GEF : Opcode::GEI; return true;
+        case QuaternionOperator::EQ: opcode = isFloat ? Opcode::EQF : Opcode::EQI; return true;
+        case QuaternionOperator::NE: opcode = isFloat ? Opcode::NEF : Opcode::NEI; return true;
+        case QuaternionOperator::LAnd: opcode = isFloat ? Opcode::LAndF : Opcode::LAndI; return true;
+        case QuaternionOperator::LOr: opcode = isFloat ? Opcode::LOrF : Opcode::LOrI; return true;
+        default:
+            break;
+        }
+
+        if (isFloat)
+            return false;
+
+        switch (op)
+        {
+        case QuaternionOperator::Rem:
+        case QuaternionOperator::RemAssign: opcode = Opcode::RemI; return true;
+        case QuaternionOperator::Shl:
+        case QuaternionOperator::ShlAssign: opcode = Opcode::ShlI; return true;
+        case QuaternionOperator::Shr:
+        case QuaternionOperator::ShrAssign: opcode = Opcode::ShrI; return true;
+        case QuaternionOperator::And:
+        case QuaternionOperator::AndAssign: opcode = Opcode::AndI; return true;
+        case QuaternionOperator::Xor:
+        case QuaternionOperator::XorAssign: opcode = Opcode::XorI; return true;
+        case QuaternionOperator::Or:
+        case QuaternionOperator::OrAssign: opcode = Opcode::OrI; return true;
+        default:
+            return false;
+        }
+    }
+}
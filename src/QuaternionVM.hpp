@@ -0,0 +1,170 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "IRGenerator.hpp"
+
+namespace lcc
+{
+    // Virtual machine for the quaternion IR(QuaternionVM.cpp). load() decodes the codes once into a
+    // compact stream of typed instructions whose operands are slot refs, frames are laid out from the
+    // totalWidth of each function's symbol tables and globals share one area with the interned
+    // constants, arrays take one slot per element. run() executes the stream with computed goto
+    // threaded dispatch when the compiler supports it and a switch otherwise. Stores to chars keep
+    // the low byte of the value, sign extended, as chars are held as ints. Functions that are only
+    // declared are bound to host functions by name, putchar and puts are registered by default.
+    // Inline asm can't be run, load() fails on it before anything is executed.
+    class QuaternionVM
+    {
+        typedef QuaternionIRGenerator::Quaternion Quaternion;
+        typedef QuaternionIRGenerator::QuaternionOperator QuaternionOperator;
+        typedef QuaternionIRGenerator::Arg Arg;
+        typedef QuaternionIRGenerator::ArgType ArgType;
+
+    public:
+        typedef union _Slot
+        {
+            int32_t i; // ints, chars and string literal indices
+            float f;
+        } Slot;
+
+        typedef Slot (*HostFunction)(QuaternionVM *vm, const Slot *args, size_t numArgs);
+
+        enum class Opcode : uint32_t
+        {
+#define VM_OPCODE(name) name,
+#include "QuaternionVMOpcode.inc"
+#undef VM_OPCODE
+        };
+
+    private:
+        static constexpr int32_t NoRef = INT32_MIN;
+        static constexpr size_t NoEntry = SIZE_MAX;
+        static constexpr int32_t NumScratchSlots = 2; // hold converted operands and results
+        static constexpr size_t StackSlots = 1 << 20;
+        static constexpr size_t MaxCallDepth = 1 << 16;
+
+        // a ref >= 0 is a slot of the current frame, a ref < 0 is ~index into _globals
+        typedef struct _Instruction
+        {
+            const void *handler; // label of opcode once threaded
+            Opcode opcode;
+            int32_t a;
+            int32_t b;
+            int32_t c;
+        } Instruction;
+
+        typedef struct _Function
+        {
+            size_t entry;      // instruction index, NoEntry when not defined
+            uint32_t host;     // index into _hosts when bound to a host function, UINT32_MAX otherwise
+            int32_t frameSize; // slots, the scratch slots are the last ones
+            size_t numParams;
+        } Function;
+
+        // subscripts refer to arrays by index into _arrays, elements are bounds checked
+        typedef struct _Array
+        {
+            int32_t ref; // first element
+            int32_t numSlots;
+        } Array;
+
+        typedef struct _Frame
+        {
+            const Instruction *returnPc;
+            Slot *fp;
+            int32_t result; // ref in the caller's frame, NoRef when the value is dropped
+        } Frame;
+
+    private:
+        QuaternionVM();
+        QuaternionVM(const QuaternionVM &) = delete;
+        QuaternionVM &operator=(const QuaternionVM &) = delete;
+
+    public:
+        static QuaternionVM *getInstance()
+        {
+            if (_inst.get() == nullptr)
+                _inst.reset(new QuaternionVM);
+
+            return _inst.get();
+        }
+
+    private:
+        static std::unique_ptr<QuaternionVM> _inst;
+
+    public:
+        // binds the functions named name that are called but not defined, takes effect on the next load()
+        void registerHost(const std::string &name, HostFunction function);
+        // false when the IR has codes the VM can't run, e.g. inline asm
+        bool load(const QuaternionIRGenerator *generator);
+        // runs the global initializers, then entry, whose return value becomes exitCode
+        bool run(const std::string &entry, int &exitCode);
+
+        const std::string *string(int32_t id) const; // nullptr if id isn't a string literal
+        uint64_t numExecuted() const { return _numExecuted; } // instructions of the last run
+        size_t numInstructions() const { return _code.size(); }
+
+    private:
+        bool execute(const Instruction *pc, Slot *fp, Slot &value);
+
+        // frames and the global area, symbol refs and host bindings
+        void layout();
+        // frameSize is the one of the function addr belongs to, the scratch slots are its last ones
+        void decode(size_t addr, int32_t frameSize, const std::string &returnType);
+        // stores the argument into the callee's frame, which starts right after the caller's one
+        bool decodeParam(size_t addr, int32_t frameSize);
+        // jumps to exitAddr go to exitPc, the others must stay within [begin, end)
+        void resolveJumps(size_t begin, size_t end, size_t exitAddr, size_t exitPc);
+        void emit(Opcode opcode, int32_t a, int32_t b = 0, int32_t c = 0);
+        void trap(const std::string &message);
+
+        // the ref holding arg as an int or a float, converted into scratch when needed
+        int32_t operand(const Arg &arg, bool isFloat, int32_t scratch);
+        void store(const Arg &dest, const Arg &src, int32_t scratch);
+        void storeRef(int32_t dest, bool isDestFloat, int32_t src, bool isSrcFloat, bool isDestChar = false);
+        // opcode a b c with a being result, through scratch when result is of the other kind
+        void emitResult(Opcode opcode, bool isValueFloat, const Arg &result, int32_t b, int32_t c, int32_t scratch);
+        // result = lhs op rhs, op may be a compound assignment too
+        void binary(QuaternionOperator op, const Arg &result, const Arg &lhs, const Arg &rhs, int32_t scratch);
+        int32_t constant(Slot value);
+        bool isFloat(const Arg &arg) const;
+        bool isValid(const Arg &arg) const;
+
+        static bool binaryOpcode(QuaternionOperator op, bool isFloat, Opcode &opcode, bool &isValueFloat);
+
+    private:
+        const QuaternionIRGenerator *_generator{nullptr}; // only while loading
+
+        std::vector<HostFunction> _hosts;
+        std::unordered_map<std::string, uint32_t> _hostIds;
+
+        std::vector<Instruction> _code; // the global initializers come first and end with a Halt
+        size_t _bootstrap{0};           // Call of the entry then Halt
+        bool _isThreaded{false};
+        std::vector<Function> _functions; // same indices as the function table
+        int32_t _maxFrameSize{0};
+        std::vector<Slot> _globalImage; // globals are zero, then the constants
+        std::unordered_map<int32_t, int32_t> _constantRefs; // bits -> ref
+        std::vector<std::string> _strings;
+        std::vector<std::string> _trapMessages;
+
+        std::vector<int32_t> _slots; // symbol -> ref
+        std::vector<bool> _isFloat;  // symbol -> holds a float, or float elements
+        std::vector<bool> _isChar;   // symbol -> holds a char, or char elements
+        std::vector<int32_t> _arrayIds; // symbol -> index into _arrays, -1 for scalars
+        std::vector<Array> _arrays;
+        std::vector<int32_t> _pcs;   // code address -> first instruction
+        std::vector<std::pair<size_t, size_t>> _jumps; // instruction -> code address of the target
+        std::unordered_map<std::string, uint32_t> _functionIds;
+
+        std::vector<Slot> _globals;
+        std::vector<Slot> _stack; // StackSlots plus room for the Params of the deepest frame
+        std::vector<Frame> _frames;
+        uint64_t _numExecuted{0};
+    };
+}
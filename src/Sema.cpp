@@ -0,0 +1,454 @@
+#include "lcc.hpp"
+
+namespace lcc
+{
+    std::unique_ptr<Sema> Sema::_inst;
+
+    namespace
+    {
+        bool IsComparison(AST::BinaryOpType op)
+        {
+            switch (op)
+            {
+            case AST::BinaryOpType::BO_LT:
+            case AST::BinaryOpType::BO_GT:
+            case AST::BinaryOpType::BO_LE:
+            case AST::BinaryOpType::BO_GE:
+            case AST::BinaryOpType::BO_EQ:
+            case AST::BinaryOpType::BO_NE:
+            case AST::BinaryOpType::BO_LAnd:
+            case AST::BinaryOpType::BO_LOr:
+                return true;
+            default:
+                return false;
+            }
+        }
+
+        bool IsIntegral(const AST::Type *type)
+        {
+            return type->kind() == AST::Type::Kind::Char || type->kind() == AST::Type::Kind::Int;
+        }
+
+        // usual arithmetic conversions, chars are promoted to int
+        const AST::Type *ArithmeticType(const AST::Type *lhs, const AST::Type *rhs)
+        {
+            if (lhs->kind() == AST::Type::Kind::Float || rhs->kind() == AST::Type::Kind::Float)
+                return AST::Type::getBuiltin(AST::Type::Kind::Float);
+
+            return AST::Type::getBuiltin(AST::Type::Kind::Int);
+        }
+    }
+
+    bool Sema::run(AST::ASTNode *astRoot)
+    {
+        reset();
+
+        bool result = visit(astRoot);
+        while (!_scopeStarts.empty()) // a failed visit leaves its scopes open
+            leaveScope();
+        return result;
+    }
+
+    void Sema::reset()
+    {
+        _bindings.assign(InitialBindings, Binding{});
+        _numBindings = 0;
+        _undoLog.clear();
+        _scopeStarts.clear();
+        enterScope(); // the globals
+        _functions.clear();
+    }
+
+    bool Sema::gen(AST::TranslationUnitDecl *translationUnitDecl)
+    {
+        for (auto &decl : translationUnitDecl->_decls)
+            if (!visit(decl))
+                return false;
+
+        return true;
+    }
+
+    bool Sema::gen(AST::FunctionDecl *functionDecl)
+    {
+        auto it = _functions.find(functionDecl->name());
+        if (it != _functions.end())
+        {
+            const AST::FunctionDecl *previousDecl = it->second;
+            if (previousDecl->_body != nullptr || functionDecl->_body != nullptr)
+            {
+                FATAL_ERROR("Redefinition function " << functionDecl->name());
+                return false;
+            }
+            else if (previousDecl->_params.size() != functionDecl->_params.size())
+            {
+                FATAL_ERROR("Function " << functionDecl->name() << " definition doesn't match with declaration");
+                return false;
+            }
+        }
+        _functions[functionDecl->name()] = functionDecl; // visible in its own body
+
+        enterScope(); // params get a scope of their own
+
+        bool result = true;
+        for (auto &param : functionDecl->_params)
+        {
+            if (!visit(param))
+            {
+                result = false;
+                break;
+            }
+        }
+
+        if (result && functionDecl->_body != nullptr)
+            result = visit(functionDecl->_body);
+
+        leaveScope();
+        return result;
+    }
+
+    bool Sema::gen(AST::VarDecl *varDecl)
+    {
+        if (isInCurrentScope(varDecl->name()))
+        {
+            FATAL_ERROR("Redefinition " << varDecl->type()->name() << " " << varDecl->name());
+            return false;
+        }
+
+        // the initializer can't see the variable it initializes
+        if (varDecl->_isInitialized && !visit(varDecl->_value))
+            return false;
+
+        return enter(varDecl);
+    }
+
+    bool Sema::gen(AST::IntegerLiteral *integerLiteral)
+    {
+        integerLiteral->_exprType = AST::Type::getBuiltin(AST::Type::Kind::Int);
+        return true;
+    }
+
+    bool Sema::gen(AST::FloatingLiteral *floatingLiteral)
+    {
+        floatingLiteral->_exprType = AST::Type::getBuiltin(AST::Type::Kind::Float);
+        return true;
+    }
+
+    bool Sema::gen(AST::CharacterLiteral *charLiteral)
+    {
+        charLiteral->_exprType = AST::Type::getBuiltin(AST::Type::Kind::Char);
+        return true;
+    }
+
+    bool Sema::gen(AST::StringLiteral *strLiteral)
+    {
+        auto charType = AST::Type::getBuiltin(AST::Type::Kind::Char);
+        strLiteral->_exprType = AST::Type::getArray(charType, strLiteral->value().size() + 1); // +1 for null terminator
+        return true;
+    }
+
+    bool Sema::gen(AST::DeclRefExpr *declRefExpr)
+    {
+        auto varDecl = lookup(declRefExpr->name());
+        if (varDecl == nullptr)
+        {
+            FATAL_ERROR("Referencing undefined symbol " << declRefExpr->name());
+            return false;
+        }
+
+        declRefExpr->_decl = varDecl;
+        declRefExpr->_exprType = varDecl->type();
+        return true;
+    }
+
+    bool Sema::gen(AST::CastExpr *castExpr)
+    {
+        if (!visit(castExpr->_subExpr))
+            return false;
+
+        castExpr->_exprType = castExpr->_subExpr->_exprType; // LValueToRValue keeps the type
+        return true;
+    }
+
+    bool Sema::gen(AST::BinaryOperator *binaryOperator)
+    {
+        if (binaryOperator->isAssignment())
+        {
+            auto lhsKind = binaryOperator->_lhs->kind();
+            if (lhsKind != AST::ASTNode::Kind::DeclRefExpr && lhsKind != AST::ASTNode::Kind::ArraySubscriptExpr)
+            {
+                FATAL_ERROR("Invalid lhs expression for an assignment");
+                return false;
+            }
+        }
+
+        if (!visit(binaryOperator->_lhs) || !visit(binaryOperator->_rhs))
+            return false;
+
+        auto lhsType = binaryOperator->_lhs->_exprType;
+        auto rhsType = binaryOperator->_rhs->_exprType;
+        if (binaryOperator->isAssignment())
+            binaryOperator->_exprType = lhsType;
+        else if (IsComparison(binaryOperator->type()))
+            binaryOperator->_exprType = AST::Type::getBuiltin(AST::Type::Kind::Int);
+        else
+            binaryOperator->_exprType = ArithmeticType(lhsType, rhsType);
+
+        return true;
+    }
+
+    bool Sema::gen(AST::UnaryOperator *unaryOperator)
+    {
+        if (!visit(unaryOperator->_body))
+            return false;
+
+        if (unaryOperator->type() == AST::UnaryOpType::UO_LNot)
+            unaryOperator->_exprType = AST::Type::getBuiltin(AST::Type::Kind::Int);
+        else
+            unaryOperator->_exprType = unaryOperator->_body->_exprType;
+
+        return true;
+    }
+
+    bool Sema::gen(AST::ParenExpr *parenExpr)
+    {
+        if (!visit(parenExpr->_subExpr))
+            return false;
+
+        parenExpr->_exprType = parenExpr->_subExpr->_exprType;
+        return true;
+    }
+
+    bool Sema::gen(AST::CompoundStmt *compoundStmt)
+    {
+        enterScope();
+
+        bool result = true;
+        for (auto &stmt : compoundStmt->_body)
+        {
+            if (!visit(stmt))
+            {
+                result = false;
+                break;
+            }
+        }
+
+        leaveScope();
+        return result;
+    }
+
+    bool Sema::gen(AST::DeclStmt *declStmt)
+    {
+        for (auto &decl : declStmt->_decls)
+        {
+            if (!visit(decl))
+                return false;
+        }
+
+        return true;
+    }
+
+    bool Sema::gen(AST::IfStmt *ifStmt)
+    {
+        if (!visit(ifStmt->_condition) || !visit(ifStmt->_body))
+            return false;
+
+        if (ifStmt->_elseBody != nullptr && !visit(ifStmt->_elseBody))
+            return false;
+
+        return true;
+    }
+
+    bool Sema::gen(AST::ValueStmt *valueStmt)
+    {
+        return visit(valueStmt->_expr);
+    }
+
+    bool Sema::gen(AST::ReturnStmt *returnStmt)
+    {
+        if (returnStmt->_value == nullptr)
+            return true;
+
+        return visit(returnStmt->_value);
+    }
+
+    bool Sema::gen(AST::WhileStmt *whileStmt)
+    {
+        return visit(whileStmt->_condition) && visit(whileStmt->_body);
+    }
+
+    bool Sema::gen(AST::CallExpr *callExpr)
+    {
+        std::string funcName = callExpr->_functionExpr->name();
+        auto it = _functions.find(funcName);
+        if (it == _functions.end())
+        {
+            FATAL_ERROR("Referencing undefined function " << funcName);
+            return false;
+        }
+
+        const AST::FunctionDecl *functionDecl = it->second;
+        if (callExpr->_params.size() != functionDecl->_params.size())
+        {
+            FATAL_ERROR("Function " << funcName << " required for " << std::to_string(functionDecl->_params.size()) << " arguments, but " << std::to_string(callExpr->_params.size()) << " were given");
+            return false;
+        }
+
+        for (auto &param : callExpr->_params)
+        {
+            if (!visit(param))
+                return false;
+        }
+
+        callExpr->_functionExpr->_decl = functionDecl;
+        callExpr->_functionExpr->_exprType = functionDecl->_type;
+        callExpr->_exprType = functionDecl->_type;
+        return true;
+    }
+
+    bool Sema::gen(AST::NullStmt *nullStmt)
+    {
+        return true;
+    }
+
+    bool Sema::gen(AST::AsmStmt *asmStmt)
+    {
+        for (auto &constraint : asmStmt->_outputConstraints)
+        {
+            if (constraint.second == nullptr)
+            {
+                FATAL_ERROR("Expected an lvalue for asm output constraint " << constraint.first);
+                return false;
+            }
+
+            if (!visit(constraint.second))
+                return false;
+        }
+
+        for (auto &constraint : asmStmt->_inputConstraints)
+        {
+            if (!visit(constraint.second))
+                return false;
+        }
+
+        return true;
+    }
+
+    bool Sema::gen(AST::ArraySubscriptExpr *arraySubscriptExpr)
+    {
+        if (arraySubscriptExpr->_lhs->kind() != AST::ASTNode::Kind::DeclRefExpr)
+        {
+            FATAL_ERROR("Invalid lhs expression for an array subscript expression");
+            return false;
+        }
+
+        if (!visit(arraySubscriptExpr->_lhs) || !visit(arraySubscriptExpr->_rhs))
+            return false;
+
+        auto arrayDecl = static_cast<AST::DeclRefExpr *>(arraySubscriptExpr->_lhs.get())->_decl;
+        auto arrayType = arraySubscriptExpr->_lhs->_exprType;
+        if (!arrayType->isArray() && !arrayType->isPointer())
+        {
+            FATAL_ERROR("Subscripted value " << arraySubscriptExpr->name() << " is not an array");
+            return false;
+        }
+
+        if (!IsIntegral(arraySubscriptExpr->_rhs->_exprType))
+        {
+            FATAL_ERROR("Expecting integer type for array index " << arraySubscriptExpr->name());
+            return false;
+        }
+
+        arraySubscriptExpr->_decl = arrayDecl;
+        arraySubscriptExpr->_exprType = arrayType->elementType();
+        return true;
+    }
+
+    void Sema::enterScope()
+    {
+        _scopeStarts.push_back(_undoLog.size());
+    }
+
+    void Sema::leaveScope()
+    {
+        for (size_t start = _scopeStarts.back(); _undoLog.size() > start; _undoLog.pop_back())
+        {
+            const Binding &previous = _undoLog.back();
+            size_t slot = find(*previous.name, previous.hash);
+            if (previous.varDecl != nullptr)
+                _bindings[slot] = previous;
+            else
+                erase(slot);
+        }
+        _scopeStarts.pop_back();
+    }
+
+    const AST::VarDecl *Sema::lookup(const std::string &name) const
+    {
+        return _bindings[find(name, std::hash<std::string>()(name))].varDecl;
+    }
+
+    bool Sema::isInCurrentScope(const std::string &name) const
+    {
+        const Binding &binding = _bindings[find(name, std::hash<std::string>()(name))];
+        return binding.name != nullptr && binding.scope == _scopeStarts.size();
+    }
+
+    bool Sema::enter(const AST::VarDecl *varDecl)
+    {
+        const std::string &name = varDecl->name();
+        size_t hash = std::hash<std::string>()(name);
+        size_t slot = find(name, hash);
+        Binding &binding = _bindings[slot];
+        if (binding.name != nullptr && binding.scope == _scopeStarts.size())
+            return false;
+
+        // a shadowed binding keeps its slot, the name's probe sequence stays the same
+        _undoLog.push_back(binding.name != nullptr ? binding : Binding{&name, hash, nullptr, 0});
+        if (binding.name == nullptr && 2 * (_numBindings + 1) > _bindings.size())
+        {
+            grow();
+            slot = find(name, hash);
+        }
+        if (_bindings[slot].name == nullptr)
+            _numBindings++;
+        _bindings[slot] = {&name, hash, varDecl, static_cast<uint32_t>(_scopeStarts.size())};
+        return true;
+    }
+
+    size_t Sema::find(const std::string &name, size_t hash) const
+    {
+        size_t mask = _bindings.size() - 1;
+        size_t slot = hash & mask;
+        while (_bindings[slot].name != nullptr && (_bindings[slot].hash != hash || *_bindings[slot].name != name))
+            slot = (slot + 1) & mask;
+        return slot;
+    }
+
+    void Sema::erase(size_t slot)
+    {
+        // later bindings of the probe run move back into the hole unless it lies before their home slot
+        size_t mask = _bindings.size() - 1;
+        for (size_t next = (slot + 1) & mask; _bindings[next].name != nullptr; next = (next + 1) & mask)
+        {
+            size_t home = _bindings[next].hash & mask;
+            if (((next - home) & mask) >= ((next - slot) & mask))
+            {
+                _bindings[slot] = _bindings[next];
+                slot = next;
+            }
+        }
+        _bindings[slot] = Binding{};
+        _numBindings--;
+    }
+
+    void Sema::grow()
+    {
+        std::vector<Binding> bindings(2 * _bindings.size());
+        std::swap(bindings, _bindings);
+        for (auto &binding : bindings)
+        {
+            if (binding.name != nullptr)
+                _bindings[find(*binding.name, binding.hash)] = binding;
+        }
+    }
+}
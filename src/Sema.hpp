@@ -0,0 +1,96 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "AST.hpp"
+#include "ASTVisitor.hpp"
+
+namespace lcc
+{
+    // Semantic analysis(Sema.cpp), runs once between parsing and IR generation. It binds every
+    // DeclRefExpr and CallExpr to its declaration and records the type of every Expr, so IR
+    // generators follow these pointers instead of looking names up in scopes of their own.
+    class Sema : public AST::ASTVisitor<Sema>
+    {
+        // a name visible in the current scope, scope is the depth of the one that entered it
+        typedef struct _Binding
+        {
+            const std::string *name{nullptr}; // the VarDecl's own, nullptr for an empty slot
+            size_t hash{0};
+            const AST::VarDecl *varDecl{nullptr};
+            uint32_t scope{0};
+        } Binding;
+
+        static constexpr size_t InitialBindings = 64;
+
+    private:
+        Sema() = default;
+        Sema(const Sema &) = delete;
+        Sema &operator=(const Sema &) = delete;
+
+    public:
+        static Sema *getInstance()
+        {
+            if (_inst.get() == nullptr)
+                _inst.reset(new Sema);
+
+            return _inst.get();
+        }
+
+    private:
+        static std::unique_ptr<Sema> _inst;
+
+    public:
+        // false if the AST references an undeclared symbol or redefines one
+        bool run(AST::ASTNode *astRoot);
+        // starts over with an empty global scope, top level declarations can then be visited one by one
+        void reset();
+
+        bool gen(AST::TranslationUnitDecl *translationUnitDecl);
+        bool gen(AST::FunctionDecl *functionDecl);
+        bool gen(AST::VarDecl *varDecl);
+        bool gen(AST::IntegerLiteral *integerLiteral);
+        bool gen(AST::FloatingLiteral *floatingLiteral);
+        bool gen(AST::CharacterLiteral *charLiteral);
+        bool gen(AST::StringLiteral *strLiteral);
+        bool gen(AST::DeclRefExpr *declRefExpr);
+        bool gen(AST::CastExpr *castExpr);
+        bool gen(AST::BinaryOperator *binaryOperator);
+        bool gen(AST::UnaryOperator *unaryOperator);
+        bool gen(AST::ParenExpr *parenExpr);
+        bool gen(AST::CompoundStmt *compoundStmt);
+        bool gen(AST::DeclStmt *declStmt);
+        bool gen(AST::IfStmt *ifStmt);
+        bool gen(AST::ValueStmt *valueStmt);
+        bool gen(AST::ReturnStmt *returnStmt);
+        bool gen(AST::WhileStmt *whileStmt);
+        bool gen(AST::CallExpr *callExpr);
+        bool gen(AST::NullStmt *nullStmt);
+        bool gen(AST::AsmStmt *asmStmt);
+        bool gen(AST::ArraySubscriptExpr *arraySubscriptExpr);
+
+    private:
+        // leaving a scope undoes the bindings it entered, newest first, restoring what they shadowed
+        void enterScope();
+        void leaveScope();
+        const AST::VarDecl *lookup(const std::string &name) const;
+        bool isInCurrentScope(const std::string &name) const;
+        bool enter(const AST::VarDecl *varDecl);
+        // the slot bound to name, or the empty one its probe ends at
+        size_t find(const std::string &name, size_t hash) const;
+        void erase(size_t slot);
+        void grow();
+
+    private:
+        // names of all open scopes in one open addressing table with linear probing, a shadowed
+        // binding waits in the undo log, so a lookup is one probe however deep the scopes nest
+        std::vector<Binding> _bindings; // the size is a power of two
+        size_t _numBindings{0};
+        std::vector<Binding> _undoLog;    // bindings replaced by enter, varDecl is nullptr when the name was unbound
+        std::vector<size_t> _scopeStarts; // open scope -> size of the undo log when it was entered
+        std::map<std::string, const AST::FunctionDecl *> _functions; // latest declaration of each function
+    };
+}
@@ -4,116 +4,110 @@ namespace lcc
 {
     namespace AST
     {
-        json NullStmt::asJson() const
+        ValueStmt::~ValueStmt()
         {
-            json j;
-            j["type"] = "NullStmt";
-            return j;
+            destroyLater(std::move(_expr));
         }
 
-        json ValueStmt::asJson() const
+        IfStmt::~IfStmt()
         {
-            json j;
-            j["type"] = "ValueStmt";
-            j["expr"] = json::array({_expr->asJson()});
-            return j;
+            destroyLater(std::move(_condition));
+            destroyLater(std::move(_body));
+            destroyLater(std::move(_elseBody));
         }
 
-        json IfStmt::asJson() const
+        WhileStmt::~WhileStmt()
         {
-            json j;
-            j["type"] = "IfStmt";
-            j["condition"] = json::array({_condition->asJson()});
-            j["body"] = json::array({_body->asJson()});
-            if (_elseBody == nullptr)
-                j["elseBody"] = "Empty";
-            else
-                j["elseBody"] = json::array({_elseBody->asJson()});
-            return j;
+            destroyLater(std::move(_condition));
+            destroyLater(std::move(_body));
         }
 
-        json WhileStmt::asJson() const
+        DeclStmt::~DeclStmt()
         {
-            json j;
-            j["type"] = "WhileStmt";
-            j["condition"] = json::array({_condition->asJson()});
-            j["body"] = json::array({_body->asJson()});
-            return j;
+            destroyLater(_decls);
         }
 
-        json DeclStmt::asJson() const
+        CompoundStmt::~CompoundStmt()
         {
-            json j;
-            j["type"] = "DeclStmt";
-            j["children"] = json::array();
-            for (const auto &decl : _decls)
-                j["children"].emplace_back(decl->asJson());
-            return j;
+            destroyLater(_body);
         }
 
-        json CompoundStmt::asJson() const
+        ReturnStmt::~ReturnStmt()
         {
-            json j;
-            j["type"] = "CompoundStmt";
-            j["children"] = json::array();
-            for (const auto &stmt : _body)
-                j["children"].emplace_back(stmt->asJson());
-            return j;
+            destroyLater(std::move(_value));
         }
 
-        json ReturnStmt::asJson() const
+        void NullStmt::dump(DumpWriter &writer) const
         {
-            json j;
-            j["type"] = "ReturnStmt";
-            if (_value == nullptr)
-                j["value"] = "VOID";
-            else
-                j["value"] = json::array({_value->asJson()});
-            return j;
+            writer.beginObject();
+            writer.writeString("type", "NullStmt");
+            writer.endObject();
         }
 
-        json AsmStmt::asJson() const
+        void ValueStmt::dump(DumpWriter &writer) const
         {
-            // TODO: Content json print
-            json j;
-            j["type"] = "AsmStmt";
-            j["AsmStmt"] = _asmString;
-            return j;
+            writer.beginObject();
+            writer.writeString("type", "ValueStmt");
+            dumpChild(writer, "expr", _expr.get());
+            writer.endObject();
         }
 
-        bool CompoundStmt::gen(lcc::IRGeneratorBase *generator)
+        void IfStmt::dump(DumpWriter &writer) const
         {
-            return generator->gen(this);
-        }
-
-        bool DeclStmt::gen(lcc::IRGeneratorBase *generator)
-        {
-            return generator->gen(this);
+            writer.beginObject();
+            writer.writeString("type", "IfStmt");
+            dumpChild(writer, "condition", _condition.get());
+            dumpChild(writer, "body", _body.get());
+            if (_elseBody == nullptr)
+                writer.writeString("elseBody", "Empty");
+            else
+                dumpChild(writer, "elseBody", _elseBody.get());
+            writer.endObject();
         }
 
-        bool IfStmt::gen(lcc::IRGeneratorBase *generator)
+        void WhileStmt::dump(DumpWriter &writer) const
         {
-            return generator->gen(this);
+            writer.beginObject();
+            writer.writeString("type", "WhileStmt");
+            dumpChild(writer, "condition", _condition.get());
+            dumpChild(writer, "body", _body.get());
+            writer.endObject();
         }
 
-        bool WhileStmt::gen(lcc::IRGeneratorBase *generator)
+        void DeclStmt::dump(DumpWriter &writer) const
         {
-            return generator->gen(this);
+            writer.beginObject();
+            writer.writeString("type", "DeclStmt");
+            dumpChildren(writer, "children", _decls);
+            writer.endObject();
         }
 
-        bool ValueStmt::gen(lcc::IRGeneratorBase *generator)
+        void CompoundStmt::dump(DumpWriter &writer) const
         {
-            return generator->gen(this);
+            writer.beginObject();
+            writer.writeString("type", "CompoundStmt");
+            dumpChildren(writer, "children", _body);
+            writer.endObject();
         }
 
-        bool ReturnStmt::gen(lcc::IRGeneratorBase *generator)
+        void ReturnStmt::dump(DumpWriter &writer) const
         {
-            return generator->gen(this);
+            writer.beginObject();
+            writer.writeString("type", "ReturnStmt");
+            if (_value == nullptr)
+                writer.writeString("value", "VOID");
+            else
+                dumpChild(writer, "value", _value.get());
+            writer.endObject();
         }
 
-        bool AsmStmt::gen(lcc::IRGeneratorBase *generator)
+        void AsmStmt::dump(DumpWriter &writer) const
         {
-            return generator->gen(this);
+            // TODO: Content dump
+            writer.beginObject();
+            writer.writeString("type", "AsmStmt");
+            writer.writeString("AsmStmt", _asmString);
+            writer.endObject();
         }
 
         char AsmStmt::AsmStringPiece::getModifier() const
@@ -0,0 +1,92 @@
+#include "lcc.hpp"
+
+namespace lcc
+{
+    namespace AST
+    {
+        namespace
+        {
+            typedef std::tuple<Type::Kind, const Type *, size_t> TypeKey;
+
+            struct TypeTable
+            {
+                std::vector<std::unique_ptr<Type>> types; // indexed by type id
+                std::map<TypeKey, const Type *> derivedTypes;
+            };
+
+            TypeTable &GetTypeTable()
+            {
+                static TypeTable table;
+                return table;
+            }
+        }
+
+        const Type *Type::intern(Kind kind, const Type *elementType, size_t length)
+        {
+            TypeTable &table = GetTypeTable();
+            if (table.types.empty()) // builtins take the first ids, in Kind order
+            {
+                table.types.emplace_back(new Type(Kind::Void, 0, nullptr, 0, "void"));
+                table.types.emplace_back(new Type(Kind::Char, 1, nullptr, 0, "char"));
+                table.types.emplace_back(new Type(Kind::Int, 2, nullptr, 0, "int"));
+                table.types.emplace_back(new Type(Kind::Float, 3, nullptr, 0, "float"));
+            }
+
+            if (kind <= Kind::Float)
+                return table.types[static_cast<size_t>(kind)].get();
+
+            TypeKey key = std::make_tuple(kind, elementType, length);
+            auto it = table.derivedTypes.find(key);
+            if (it != table.derivedTypes.end())
+                return it->second;
+
+            std::string name = elementType->name();
+            if (kind == Kind::Pointer)
+                name += '*';
+            else
+                name += '[' + std::to_string(length) + ']';
+
+            uint32_t id = table.types.size();
+            table.types.emplace_back(new Type(kind, id, elementType, length, name));
+            table.derivedTypes.insert(std::make_pair(key, table.types.back().get()));
+            return table.types.back().get();
+        }
+
+        const Type *Type::getBuiltin(const std::string &name)
+        {
+            if (name == "int")
+                return intern(Kind::Int, nullptr, 0);
+            else if (name == "float")
+                return intern(Kind::Float, nullptr, 0);
+            else if (name == "char")
+                return intern(Kind::Char, nullptr, 0);
+            else if (name == "void")
+                return intern(Kind::Void, nullptr, 0);
+
+            return nullptr;
+        }
+
+        const Type *Type::getBuiltin(Kind kind)
+        {
+            if (kind > Kind::Float)
+                return nullptr;
+
+            return intern(kind, nullptr, 0);
+        }
+
+        const Type *Type::getPointer(const Type *pointee)
+        {
+            return intern(Kind::Pointer, pointee, 0);
+        }
+
+        const Type *Type::getArray(const Type *elementType, size_t length)
+        {
+            return intern(Kind::Array, elementType, length);
+        }
+
+        uint32_t Type::numTypes()
+        {
+            return GetTypeTable().types.size();
+        }
+    }
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace lcc
+{
+    namespace AST
+    {
+        // Canonical type of a declaration(Type.cpp). Types are interned, so two types are
+        // equal iff their pointers are equal, and each one is created only once.
+        class Type
+        {
+        public:
+            enum class Kind : uint8_t
+            {
+                Void = 0,
+                Char,
+                Int,
+                Float,
+                Pointer,
+                Array
+            };
+
+        private:
+            Type(Kind kind, uint32_t id, const Type *elementType, size_t length, const std::string &name) : _kind(kind), _id(id), _elementType(elementType), _length(length), _name(name){};
+            Type(const Type &) = delete;
+            Type &operator=(const Type &) = delete;
+
+            static const Type *intern(Kind kind, const Type *elementType, size_t length);
+
+        public:
+            // builtin type by keyword, nullptr if the keyword doesn't name a type
+            static const Type *getBuiltin(const std::string &name);
+            static const Type *getBuiltin(Kind kind);
+            static const Type *getPointer(const Type *pointee);
+            static const Type *getArray(const Type *elementType, size_t length);
+
+            // ids are dense, so backends can cache per-type data in flat tables
+            static uint32_t numTypes();
+
+            Kind kind() const { return _kind; };
+            uint32_t id() const { return _id; };
+            const Type *elementType() const { return _elementType; }; // pointee or array element type
+            size_t length() const { return _length; };                // array length
+            const std::string &name() const { return _name; };        // C spelling, e.g. "int*" or "char[8]"
+
+            bool isBuiltin() const { return _kind <= Kind::Float; };
+            bool isVoid() const { return _kind == Kind::Void; };
+            bool isPointer() const { return _kind == Kind::Pointer; };
+            bool isArray() const { return _kind == Kind::Array; };
+
+        private:
+            Kind _kind;
+            uint32_t _id;
+            const Type *_elementType;
+            size_t _length;
+            std::string _name;
+        };
+    }
+}
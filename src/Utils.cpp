@@ -49,18 +49,4 @@ namespace lcc
 
         return c;
     }
-
-    bool dumpJson(const json &j, const std::string outPath)
-    {
-        if (outPath.empty())
-        {
-            FATAL_ERROR("Dump file path not specified.");
-            return false;
-        }
-
-        std::ofstream ofs(outPath);
-        ofs << j.dump(2) << std::endl;
-        ofs.close();
-        return true;
-    }
 }
\ No newline at end of file
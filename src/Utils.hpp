@@ -22,7 +22,6 @@ namespace lcc
     bool isLetter(const char c);
     bool isDigit(const char c);
     char charToEscapedChar(char c);
-    bool dumpJson(const json &j, const std::string outPath);
 
     // cast helpers
     template <class T, class U>
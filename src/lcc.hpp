@@ -20,10 +20,21 @@
         std::cout << rang::style::bold << rang::fg::yellow << "Warning: " << rang::style::reset << msg << std::endl; \
     } while (0)
 
+#include "Dumper.hpp"
 #include "Options.hpp"
+#include "Type.hpp"
 #include "AST.hpp"
+#include "ASTVisitor.hpp"
+#include "ASTCache.hpp"
+#include "Sema.hpp"
+#include "ConstEvaluator.hpp"
+#include "ExprFolder.hpp"
+#include "DeadCodeEliminator.hpp"
 #include "File.hpp"
 #include "IRGenerator.hpp"
+#include "QuaternionOptimizer.hpp"
+#include "QuaternionVM.hpp"
+#include "QuaternionCodegen.hpp"
 #include "Lexer.hpp"
 #include "LR1Parser.hpp"
 #include "Parser.hpp"
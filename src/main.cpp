@@ -1,4 +1,59 @@
 #include "lcc.hpp"
+#include <chrono>
+
+namespace
+{
+    // Lowers file one top level declaration at a time, a function body is freed as soon as its IR
+    // has been written, so the peak AST size is that of the largest function instead of the file.
+    // Folding across functions and dropping unreachable functions need the whole AST and are skipped.
+    bool StreamTranslationUnit(std::shared_ptr<lcc::File> file)
+    {
+        auto parser = lcc::Parser::getInstance();
+        auto generator = lcc::LLVMIRGenerator::getInstance();
+        if (!generator->openStream(lcc::Options::IRDumpPath))
+            return false;
+
+        lcc::Sema::getInstance()->reset();
+        parser->begin(file);
+
+        std::vector<std::unique_ptr<lcc::AST::Decl>> decls; // declarations stay referenced by later calls
+        size_t numSimplified = 0, numEliminated = 0, peakBytes = 0;
+        while (!parser->atEnd())
+        {
+            auto decl = parser->next();
+            if (decl == nullptr)
+                return false;
+
+            if (!lcc::Sema::getInstance()->visit(decl))
+            {
+                FATAL_ERROR("Semantic analysis failed.");
+                return false;
+            }
+
+            numSimplified += lcc::ExprFolder::getInstance()->run(decl.get());
+            numEliminated += lcc::DeadCodeEliminator::getInstance()->run(decl.get());
+            if (!generator->generate(decl.get()))
+            {
+                FATAL_ERROR("Failed to generate IR.");
+                return false;
+            }
+
+            peakBytes = std::max(peakBytes, lcc::AST::ASTContext::current()->bytesAllocated());
+            if (decl->kind() == lcc::AST::ASTNode::Kind::FunctionDecl)
+                parser->releaseBody(static_cast<lcc::AST::FunctionDecl *>(decl.get()));
+            decls.push_back(std::move(decl));
+        }
+
+        generator->closeStream();
+        if (lcc::Options::ShouldPrintLog)
+        {
+            INFO("Streamed " << decls.size() << " declarations, peak AST size " << peakBytes << " bytes");
+            INFO("Simplified " << numSimplified << " expressions");
+            INFO("Eliminated " << numEliminated << " unreachable statements");
+        }
+        return true;
+    }
+}
 
 int main(int argc, char **argv)
 {
@@ -11,39 +66,177 @@ int main(int argc, char **argv)
         return 0;
     }
 
-    auto tokens = lcc::Lexer::getInstance()->run(file);
+    lcc::AST::ASTContext astContext; // owns all AST nodes of this translation unit, must outlive astRoot
+
+    if (lcc::Options::StreamDecls)
+    {
+        if (!StreamTranslationUnit(file))
+            return 0;
+        INFO("IR has been dumped to " << lcc::Options::IRDumpPath);
+
+        if (!lcc::Codegen::getInstance()->run()) // reads the IR back from the dump as a whole
+            FATAL_ERROR("Failed to generate target assembly.");
+        else
+            INFO("Target assembly has been generated and dumped to " << lcc::Options::OutputFilename);
+        return 0;
+    }
 
     std::unique_ptr<lcc::AST::Decl> astRoot = nullptr;
-    if (lcc::Options::LR1GrammarFilePath != "-")
-        astRoot = lcc::LR1Parser::getInstance()->run(
-            tokens, lcc::Options::LR1GrammarFilePath, lcc::Options::ShouldPrintLog);
-    else
-        astRoot = lcc::Parser::getInstance()->run(tokens);
 
-    if (astRoot == nullptr)
-        WARNING("Parsed empty AST");
+    // an unchanged source parsed in the same mode reuses its cached AST
+    std::string astCacheKey;
+    if (lcc::Options::ASTCacheDir != "-")
+    {
+        astCacheKey = lcc::ASTCache::getInstance()->key(lcc::Options::InputFilename, lcc::Options::LR1GrammarFilePath);
+        astRoot = lcc::ASTCache::getInstance()->load(lcc::Options::ASTCacheDir, astCacheKey);
+        if (astRoot)
+            INFO("AST has been loaded from cache " << lcc::Options::ASTCacheDir);
+    }
+    bool isASTCached = astRoot != nullptr;
+
+    // tokens are only needed to parse or to be dumped
+    std::vector<std::shared_ptr<lcc::Token>> tokens;
+    if (!isASTCached || lcc::Options::TokenDumpPath != "-")
+        tokens = lcc::Lexer::getInstance()->run(file);
 
+    if (!isASTCached)
+    {
+        if (lcc::Options::LR1GrammarFilePath != "-")
+            astRoot = lcc::LR1Parser::getInstance()->run(
+                tokens, lcc::Options::LR1GrammarFilePath, lcc::Options::ShouldPrintLog);
+        else
+            astRoot = lcc::Parser::getInstance()->run(tokens);
 
-    lcc::dumpJson(lcc::Lexer::jsonifyTokens(tokens), lcc::Options::TokenDumpPath);
-    INFO("Tokens have been dumped to " << lcc::Options::TokenDumpPath);
+        if (astRoot == nullptr)
+            WARNING("Parsed empty AST");
+        else if (lcc::Options::ShouldPrintLog)
+            INFO("Allocated " << astContext.numAllocations() << " AST nodes (" << astContext.bytesAllocated() << " bytes in " << astContext.numSlabs() << " slabs)");
 
-    if (astRoot)
+        if (astRoot && !astCacheKey.empty())
+            lcc::ASTCache::getInstance()->store(lcc::Options::ASTCacheDir, astCacheKey, astRoot.get());
+    }
+
+    // the dumps and the IR generator still walk the tree recursively, so deeply nested inputs stop here
+    if (lcc::Options::ParseOnly)
     {
-        lcc::dumpJson(astRoot->asJson(), lcc::Options::ASTDumpPath);
-        INFO("AST has been dumped to " << lcc::Options::ASTDumpPath);
+        bool isParsed = astRoot != nullptr;
+        astRoot.reset();
+        return isParsed ? 0 : 1;
+    }
+
+    // token and AST dumps are only written when a path is given
+    if (lcc::Options::TokenDumpPath != "-")
+    {
+        auto writer = lcc::DumpWriter::open(lcc::Options::TokenDumpPath, lcc::Options::TokenDumpFormat);
+        if (writer)
+        {
+            lcc::Lexer::dumpTokens(tokens, *writer);
+            INFO("Tokens have been dumped to " << lcc::Options::TokenDumpPath);
+        }
+    }
+
+    if (astRoot && lcc::Options::ASTDumpPath != "-")
+    {
+        auto writer = lcc::DumpWriter::open(lcc::Options::ASTDumpPath, lcc::Options::ASTDumpFormat);
+        if (writer)
+        {
+            astRoot->dump(*writer);
+            INFO("AST has been dumped to " << lcc::Options::ASTDumpPath);
+        }
+    }
+
+    if (astRoot && !lcc::Sema::getInstance()->run(astRoot.get()))
+    {
+        FATAL_ERROR("Semantic analysis failed.");
+        return 0;
     }
 
     if (astRoot)
     {
-        if (!astRoot->gen(lcc::LLVMIRGenerator::getInstance()))
+        size_t numSimplified = lcc::ExprFolder::getInstance()->run(astRoot.get());
+        if (lcc::Options::ShouldPrintLog)
+            INFO("Simplified " << numSimplified << " expressions");
+
+        size_t numEliminated = lcc::DeadCodeEliminator::getInstance()->run(astRoot.get());
+        if (lcc::Options::ShouldPrintLog)
+            INFO("Eliminated " << numEliminated << " unreachable statements and functions");
+
+        if (lcc::Options::QuaternionDumpPath != "-" || lcc::Options::RunQuaternions || lcc::Options::UseQuaternionCodegen)
+        {
+            auto generator = lcc::QuaternionIRGenerator::getInstance();
+            if (!generator->generate(astRoot.get()))
+            {
+                FATAL_ERROR("Failed to generate quaternion IR.");
+                if (lcc::Options::RunQuaternions || lcc::Options::UseQuaternionCodegen)
+                    return 1;
+            }
+            else
+            {
+                if (lcc::Options::OptimizeQuaternions)
+                {
+                    auto optimizer = lcc::QuaternionOptimizer::getInstance();
+                    size_t numRemoved = optimizer->run(generator);
+                    if (lcc::Options::ShouldPrintLog && optimizer->numInlined() != 0)
+                        INFO("Inlined " << optimizer->numInlined() << " calls");
+                    if (lcc::Options::ShouldPrintLog)
+                        INFO("Optimized quaternion IR from " << generator->numCodes() + numRemoved << " to " << generator->numCodes() << " codes");
+                }
+                if (lcc::Options::QuaternionDumpPath != "-")
+                {
+                    generator->dumpCode(lcc::Options::QuaternionDumpPath);
+                    INFO("Quaternion IR has been dumped to " << lcc::Options::QuaternionDumpPath);
+                }
+
+                if (lcc::Options::RunQuaternions)
+                {
+                    auto vm = lcc::QuaternionVM::getInstance();
+                    int exitCode = 0;
+                    auto start = std::chrono::steady_clock::now();
+                    if (!vm->load(generator) || !vm->run("main", exitCode))
+                    {
+                        FATAL_ERROR("Failed to run quaternion IR.");
+                        return 1;
+                    }
+
+                    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                    if (lcc::Options::ShouldPrintLog)
+                        INFO("Executed " << vm->numExecuted() << " quaternion VM instructions in " << seconds << "s, "
+                                         << static_cast<uint64_t>(vm->numExecuted() / std::max(seconds, 1e-9)) << " instructions/s");
+                    return exitCode;
+                }
+
+                if (lcc::Options::UseQuaternionCodegen)
+                {
+                    auto codegen = lcc::QuaternionCodegen::getInstance();
+                    auto start = std::chrono::steady_clock::now();
+                    if (codegen->run(generator, lcc::Options::OutputFilename))
+                    {
+                        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                        if (lcc::Options::ShouldPrintLog)
+                            INFO("Lowered quaternion IR to x86-64 in " << seconds << "s, " << codegen->numSpilled() << " symbols spilled to the stack");
+                        INFO("Target assembly has been generated and dumped to " << lcc::Options::OutputFilename);
+                        return 0;
+                    }
+                    FATAL_ERROR("Failed to lower quaternion IR to x86-64.");
+                    return 1;
+                }
+            }
+        }
+
+        auto irGenerator = lcc::LLVMIRGenerator::getInstance();
+        if (!irGenerator->generate(astRoot.get()))
             FATAL_ERROR("Failed to generate IR.");
         else
         {
             // lcc::LLVMIRGenerator::getInstance()->printCode();
-            lcc::LLVMIRGenerator::getInstance()->dumpCode(lcc::Options::IRDumpPath);
-            INFO("IR has been dumped to " << lcc::Options::IRDumpPath);
+            bool isDumping = lcc::Options::IRDumpPath != "-";
+            if (isDumping && lcc::Options::DumpIRInBackground)
+                irGenerator->dumpCodeInBackground(lcc::Options::IRDumpPath);
+            else if (isDumping)
+                irGenerator->dumpCode(lcc::Options::IRDumpPath);
 
-             if(!lcc::Codegen::getInstance()->run())
+             // the module is compiled in memory, the dump is only for reading
+             if(!lcc::Codegen::getInstance()->run(irGenerator->takeModule()))
              {
                  FATAL_ERROR("Failed to generate target assembly.");
              }
@@ -51,6 +244,12 @@ int main(int argc, char **argv)
              {
                  INFO("Target assembly has been generated and dumped to " << lcc::Options::OutputFilename);
              }
+
+            if (isDumping)
+            {
+                irGenerator->waitForDump();
+                INFO("IR has been dumped to " << lcc::Options::IRDumpPath);
+            }
         }
     }
 }
\ No newline at end of file
@@ -0,0 +1,39 @@
+# Generates a source whose AST is a million nodes deep or a million nodes long and checks that it is
+# parsed and freed again with -parse-only, neither the parser nor the AST teardown may recurse on it.
+# INPUT is parens or blocks for the nests, statements or params for the lists.
+# INPUT ifs is a chain of ifs as long as the function that is compiled in full, the SSA construction
+# looks variables up through every block of it.
+# cmake -DLCC=<LameCC> -DINPUT=<input> -DOUTPUT=<file.c> -P CheckDeepInputs.cmake
+
+set(count 1000000)
+set(options -parse-only)
+math(EXPR countButOne "${count} - 1")
+
+if(INPUT STREQUAL "parens")
+    string(REPEAT "(" ${count} open)
+    string(REPEAT ")" ${count} close)
+    set(source "int main()\n{\n    return ${open}1${close};\n}\n")
+elseif(INPUT STREQUAL "blocks")
+    string(REPEAT "{" ${count} open)
+    string(REPEAT "}" ${count} close)
+    set(source "int main()\n{\n    ${open}${close}\n    return 0;\n}\n")
+elseif(INPUT STREQUAL "statements")
+    string(REPEAT "    a = a + 1;\n" ${count} statements)
+    set(source "int main()\n{\n    int a = 0;\n${statements}    return a;\n}\n")
+elseif(INPUT STREQUAL "params")
+    # the names repeat, only the semantic analysis would reject that
+    string(REPEAT "int a, " ${countButOne} params)
+    set(source "int f(${params}int a)\n{\n    return 0;\n}\n\nint main()\n{\n    return 0;\n}\n")
+elseif(INPUT STREQUAL "ifs")
+    string(REPEAT "    if (a) b = b + 1;\n" 20000 ifs)
+    set(source "int main()\n{\n    int a = 1;\n    int b = 0;\n    int c = 7;\n${ifs}    return c;\n}\n")
+    set(options -o ${OUTPUT}.s)
+else()
+    message(FATAL_ERROR "Unknown input ${INPUT}")
+endif()
+file(WRITE ${OUTPUT} "${source}")
+
+execute_process(COMMAND ${LCC} ${OUTPUT} ${options} RESULT_VARIABLE result OUTPUT_VARIABLE output ERROR_VARIABLE output)
+if(NOT result EQUAL 0 OR output MATCHES "Fatal error")
+    message(FATAL_ERROR "Compiling the ${INPUT} in ${OUTPUT} exited with ${result}\n${output}")
+endif()
@@ -0,0 +1,35 @@
+# Checks that SOURCE goes through the quaternion backend and prints EXPECTED.
+# MODE codegen builds it with -quat-codegen, links it with the C compiler CC and runs it,
+# MODE run runs it on the VM with -quat-run, MODE reject expects -quat-run to fail before printing anything.
+# cmake -DMODE=<mode> -DLCC=<LameCC> -DCC=<cc> -DSOURCE=<file.c> -DEXPECTED=<file.out> -DOUTPUT=<path> -P CheckQuaternionBackend.cmake
+
+if(MODE STREQUAL "codegen")
+    execute_process(COMMAND ${LCC} ${SOURCE} -quat-codegen -o ${OUTPUT}.s RESULT_VARIABLE result)
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "${SOURCE} can't be built through the quaternion backend")
+    endif()
+
+    execute_process(COMMAND ${CC} -no-pie ${OUTPUT}.s -o ${OUTPUT} RESULT_VARIABLE result)
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "The assembly of ${SOURCE} doesn't link")
+    endif()
+
+    execute_process(COMMAND ${OUTPUT} OUTPUT_VARIABLE output RESULT_VARIABLE result)
+else()
+    execute_process(COMMAND ${LCC} ${SOURCE} -quat-run -ir ${OUTPUT}.ll OUTPUT_VARIABLE output RESULT_VARIABLE result)
+endif()
+
+if(MODE STREQUAL "reject")
+    # the program itself mustn't start, so not even the first line it prints may show up
+    file(STRINGS ${EXPECTED} firstLine LIMIT_COUNT 1)
+    string(FIND "${output}" "${firstLine}" printed)
+    if(result EQUAL 0 OR NOT printed EQUAL -1)
+        message(FATAL_ERROR "${SOURCE} exited with ${result} and printed\n${output}\ninstead of being rejected by the VM")
+    endif()
+    return()
+endif()
+
+file(READ ${EXPECTED} expected)
+if(NOT result EQUAL 0 OR NOT output STREQUAL expected)
+    message(FATAL_ERROR "${SOURCE} exited with ${result} and printed\n${output}\ninstead of\n${expected}")
+endif()
@@ -0,0 +1,65 @@
+extern "C" int putchar(char a);
+extern "C" int puts(char *a);
+
+void putInt(int i)
+{
+    if (i < 0)
+    {
+        putchar('-');
+        i = -i;
+    }
+    if (i >= 10)
+        putInt(i / 10);
+
+    putchar(i % 10 + '0');
+}
+
+char low(int value)
+{
+    return value;
+}
+
+int widen(char value)
+{
+    return value;
+}
+
+int main()
+{
+    char c = 300;
+    int x = c;
+    putInt(x);
+    puts("");
+
+    char b = 127;
+    b = b + 1;
+    putInt(b);
+    puts("");
+
+    // the values aren't known before the loop runs
+    char d = 100;
+    char e = -128;
+    int i = 0;
+    while (i < 3)
+    {
+        d += 10;
+        e--;
+        i++;
+    }
+    putInt(d);
+    puts("");
+    putInt(e);
+    puts("");
+
+    char s[2];
+    s[0] = 200;
+    putInt(s[0]);
+    puts("");
+
+    putInt(low(511));
+    puts("");
+    putInt(widen(i + 197));
+    puts("");
+
+    return 0;
+}